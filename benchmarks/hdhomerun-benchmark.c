@@ -0,0 +1,802 @@
+/* hdhomerun-benchmark.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "hdhomerun-channel-item.h"
+#include "hdhomerun-channel-store.h"
+#include "hdhomerun-device-store.h"
+#include "hdhomerun-discovery.h"
+#include "hdhomerun-discovery-monitor.h"
+#include "hdhomerun-simulated-backend.h"
+#include "hdhomerun-ts-demux.h"
+
+/* Microbenchmarks of the core library against the simulated backend,
+ * with no latency and no loss so that a case costs what our own
+ * processing costs and nothing on the wire.
+ *
+ * Every case runs once to warm up, then a fixed number of rounds of a
+ * fixed number of operations, and reports the median round. Inputs come
+ * from fixed seeds, so two runs on the same machine do the same work and
+ * differ only by noise.
+ *
+ * Run from meson with `meson test --benchmark`, or directly with the
+ * names of the suites to run.
+ */
+
+#define DEFAULT_ROUNDS 5
+#define MAX_ROUNDS 99
+#define SEED 0x48444852
+
+#define TS_SIZE 188
+#define TS_PACKETS_PER_DATAGRAM 7
+
+typedef void (*CaseFunc) (gpointer data);
+
+static int n_rounds = DEFAULT_ROUNDS;
+static int n_devices_option;
+static guint n_fleet;
+
+static int
+compare_samples (gconstpointer a,
+                 gconstpointer b)
+{
+  gint64 x = *(const gint64 *)a;
+  gint64 y = *(const gint64 *)b;
+
+  return x < y ? -1 : x > y;
+}
+
+/* @bytes is how much each operation processes, or 0 for no throughput */
+static void
+run_case (const char *name,
+          guint       iterations,
+          gsize       bytes,
+          CaseFunc    func,
+          gpointer    data)
+{
+  gint64 samples[MAX_ROUNDS];
+  double median;
+
+  func (data);
+
+  for (int round = 0; round < n_rounds; round++)
+    {
+      gint64 start = g_get_monotonic_time ();
+
+      for (guint i = 0; i < iterations; i++)
+        func (data);
+
+      samples[round] = g_get_monotonic_time () - start;
+    }
+
+  qsort (samples, n_rounds, sizeof (samples[0]), compare_samples);
+  median = (double) samples[n_rounds / 2];
+
+  g_print ("%-40s %8u ops %14.0f ns/op", name, iterations, median * 1000.0 / iterations);
+  if (bytes > 0 && median > 0)
+    g_print (" %10.1f MB/s", (double) bytes * iterations / median);
+  g_print ("\n");
+}
+
+static void
+set_fleet (guint n_devices,
+           guint n_interfaces)
+{
+  HdhomerunSimulatedConfig config;
+
+  hdhomerun_simulated_config_init (&config);
+  config.n_devices = n_devices;
+  config.n_interfaces = n_interfaces;
+  config.latency_ms = 0;
+  config.timeout_ms = 0;
+  config.loss = 0;
+
+  hdhomerun_simulated_backend_configure (&config);
+  n_fleet = n_devices;
+}
+
+static void
+get_fleet_sizes (const guint  *defaults,
+                 guint         n_defaults,
+                 const guint **sizes,
+                 guint        *n_sizes)
+{
+  static guint custom;
+
+  if (n_devices_option > 0)
+    {
+      custom = (guint) n_devices_option;
+      *sizes = &custom;
+      *n_sizes = 1;
+    }
+  else
+    {
+      *sizes = defaults;
+      *n_sizes = n_defaults;
+    }
+}
+
+/* Discovery */
+
+typedef struct
+{
+  GPtrArray *devices;
+  gboolean done;
+} FindData;
+
+static void
+on_found (GObject      *source_object,
+          GAsyncResult *result,
+          gpointer      user_data)
+{
+  FindData *find = user_data;
+  g_autoptr(GError) error = NULL;
+
+  (void)source_object; /* unused */
+
+  find->devices = hdhomerun_discovery_find_devices_finish (result, &error);
+  if (find->devices == NULL)
+    g_error ("Discovery failed: %s", error->message);
+  find->done = TRUE;
+}
+
+static GPtrArray *
+find_devices (const char * const *targets)
+{
+  FindData find = { NULL, FALSE };
+
+  hdhomerun_discovery_find_devices_async (targets, NULL, on_found, &find);
+  while (!find.done)
+    g_main_context_iteration (NULL, TRUE);
+
+  return find.devices;
+}
+
+static void
+discovery_case (gpointer data)
+{
+  const char * const *targets = data;
+
+  g_ptr_array_unref (find_devices (targets));
+}
+
+static void
+run_discovery (void)
+{
+  static const guint defaults[] = { 16, 256, 1024 };
+  g_autoptr(GStrvBuilder) builder = g_strv_builder_new ();
+  g_auto(GStrv) targets = NULL;
+  const guint *sizes;
+  guint n_sizes;
+
+  get_fleet_sizes (defaults, G_N_ELEMENTS (defaults), &sizes, &n_sizes);
+
+  for (guint i = 0; i < n_sizes; i++)
+    {
+      g_autofree char *name = g_strdup_printf ("discovery/broadcast-%u", sizes[i]);
+      g_autoptr(GPtrArray) devices = NULL;
+
+      /* Two interfaces per device doubles the model queries */
+      set_fleet (sizes[i], 2);
+
+      devices = find_devices (NULL);
+      if (devices->len != sizes[i])
+        g_error ("Discovery found %u of %u simulated devices", devices->len, sizes[i]);
+
+      run_case (name, MAX (4096 / sizes[i], 4), 0, discovery_case, NULL);
+    }
+
+  /* Sixteen targets run sixteen probe threads on top of the broadcasts */
+  set_fleet (256, 1);
+  for (guint i = 0; i < 16; i++)
+    {
+      g_autofree char *target = g_strdup_printf ("10.0.0.%u", i + 1);
+
+      g_strv_builder_add (builder, target);
+    }
+  targets = g_strv_builder_end (builder);
+
+  run_case ("discovery/targeted-16", 16, 0, discovery_case, targets);
+}
+
+/* Device list diffing */
+
+typedef struct
+{
+  HdhomerunDiscoveryMonitor *monitor;
+  HdhomerunDeviceStore *store;
+  GPtrArray *snapshots[2];
+  GPtrArray *churned;         /* Device IDs whose health flips */
+  guint op;
+  gboolean scanned;
+} DiffData;
+
+static void
+on_device_added (HdhomerunDiscoveryMonitor *monitor,
+                 HdhomerunDeviceInfo       *info,
+                 HdhomerunDeviceStore      *store)
+{
+  (void)monitor; /* unused */
+
+  hdhomerun_device_store_set_device (store, info);
+}
+
+static void
+on_device_removed (HdhomerunDiscoveryMonitor *monitor,
+                   HdhomerunDeviceInfo       *info,
+                   HdhomerunDeviceStore      *store)
+{
+  (void)monitor; /* unused */
+
+  hdhomerun_device_store_remove_device (store, info->device_id_str);
+}
+
+static void
+on_scan_finished (HdhomerunDiscoveryMonitor *monitor,
+                  GPtrArray                 *snapshot,
+                  DiffData                  *diff)
+{
+  (void)monitor; /* unused */
+  (void)snapshot; /* unused */
+
+  diff->scanned = TRUE;
+}
+
+/* Wired up the way the window does it, minus the health prober */
+static void
+diff_data_init (DiffData *diff)
+{
+  memset (diff, 0, sizeof (*diff));
+
+  diff->monitor = hdhomerun_discovery_monitor_new ();
+  diff->store = hdhomerun_device_store_new ();
+
+  g_signal_connect (diff->monitor, "device-added", G_CALLBACK (on_device_added), diff->store);
+  g_signal_connect (diff->monitor, "device-changed", G_CALLBACK (on_device_added), diff->store);
+  g_signal_connect (diff->monitor, "device-removed", G_CALLBACK (on_device_removed), diff->store);
+  g_signal_connect (diff->monitor, "scan-finished", G_CALLBACK (on_scan_finished), diff);
+}
+
+static void
+diff_data_clear (DiffData *diff)
+{
+  g_clear_object (&diff->monitor);
+  g_clear_object (&diff->store);
+  g_clear_pointer (&diff->snapshots[0], g_ptr_array_unref);
+  g_clear_pointer (&diff->snapshots[1], g_ptr_array_unref);
+  g_clear_pointer (&diff->churned, g_ptr_array_unref);
+}
+
+/* Equal to @snapshot, but none of the infos are shared with it */
+static GPtrArray *
+copy_snapshot (GPtrArray *snapshot)
+{
+  GPtrArray *copy;
+
+  copy = g_ptr_array_new_full (snapshot->len, (GDestroyNotify) hdhomerun_device_info_unref);
+  for (guint i = 0; i < snapshot->len; i++)
+    g_ptr_array_add (copy, hdhomerun_device_info_copy (g_ptr_array_index (snapshot, i)));
+
+  return copy;
+}
+
+static void
+seed_case (gpointer data)
+{
+  DiffData *diff = data;
+
+  hdhomerun_discovery_monitor_seed (diff->monitor, diff->snapshots[diff->op++ & 1]);
+}
+
+static void
+health_case (gpointer data)
+{
+  DiffData *diff = data;
+  HdhomerunDeviceHealth health;
+
+  health = diff->op++ & 1 ? HDHOMERUN_DEVICE_HEALTH_GOOD : HDHOMERUN_DEVICE_HEALTH_DEGRADED;
+  for (guint i = 0; i < diff->churned->len; i++)
+    hdhomerun_device_store_set_health (diff->store, g_ptr_array_index (diff->churned, i), health);
+}
+
+static void
+refresh_case (gpointer data)
+{
+  DiffData *diff = data;
+
+  /* Every other pass a twentieth of the fleet goes missing */
+  hdhomerun_simulated_backend_set_n_online (diff->op++ & 1 ? n_fleet : n_fleet - n_fleet / 20);
+
+  diff->scanned = FALSE;
+  hdhomerun_discovery_monitor_refresh (diff->monitor);
+  while (!diff->scanned)
+    g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+run_device_diff (void)
+{
+  static const guint defaults[] = { 256, 1024 };
+  const guint *sizes;
+  guint n_sizes;
+
+  get_fleet_sizes (defaults, G_N_ELEMENTS (defaults), &sizes, &n_sizes);
+
+  for (guint i = 0; i < n_sizes; i++)
+    {
+      g_autoptr(GRand) rand = g_rand_new_with_seed (SEED);
+      g_autofree char *name = NULL;
+      g_autoptr(GPtrArray) devices = NULL;
+      DiffData diff;
+
+      set_fleet (sizes[i], 2);
+      devices = find_devices (NULL);
+
+      diff_data_init (&diff);
+      hdhomerun_discovery_monitor_seed (diff.monitor, devices);
+
+      /* Nothing changed: every device is compared and left alone */
+      diff.snapshots[0] = copy_snapshot (devices);
+      diff.snapshots[1] = copy_snapshot (devices);
+      name = g_strdup_printf ("device-diff/unchanged-%u", sizes[i]);
+      run_case (name, 64, 0, seed_case, &diff);
+      g_clear_pointer (&name, g_free);
+
+      /* A twentieth of the fleet switches control interface and back */
+      g_ptr_array_unref (diff.snapshots[1]);
+      diff.snapshots[1] = copy_snapshot (devices);
+      diff.churned = g_ptr_array_new ();
+      for (guint j = 0; j < sizes[i] / 20; j++)
+        {
+          HdhomerunDeviceInfo *info;
+
+          info = g_ptr_array_index (diff.snapshots[1], g_rand_int_range (rand, 0, sizes[i]));
+          g_free (info->control_address);
+          info->control_address = g_strdup (info->ip_addresses[1]);
+          g_ptr_array_add (diff.churned, info->device_id_str);
+        }
+      name = g_strdup_printf ("device-diff/churn-%u", sizes[i]);
+      run_case (name, 64, 0, seed_case, &diff);
+      g_clear_pointer (&name, g_free);
+
+      /* The same devices flip between good and degraded, moving in the list */
+      name = g_strdup_printf ("device-diff/health-%u", sizes[i]);
+      run_case (name, 64, 0, health_case, &diff);
+      g_clear_pointer (&name, g_free);
+
+      /* A full pass, including devices disappearing and coming back */
+      name = g_strdup_printf ("device-diff/refresh-%u", sizes[i]);
+      run_case (name, MAX (4096 / sizes[i], 4), 0, refresh_case, &diff);
+      g_clear_pointer (&name, g_free);
+
+      diff_data_clear (&diff);
+    }
+}
+
+/* Channel store filtering */
+
+#define PROGRAMS_PER_FREQUENCY 8
+
+typedef struct
+{
+  HdhomerunChannelStore *store;
+  GPtrArray *results;
+  GPtrArray *queries;
+  guint op;
+} ChannelData;
+
+static GPtrArray *
+make_lineup (GRand *rand,
+             guint  n_channels)
+{
+  static const char * const suffixes[] = { "HD", "SD", "DT", "LD", "CD", "TV" };
+  GPtrArray *results;
+  guint n_frequencies = MAX (n_channels / PROGRAMS_PER_FREQUENCY, 1);
+
+  results = g_ptr_array_new_with_free_func ((GDestroyNotify) hdhomerun_scan_result_unref);
+
+  for (guint i = 0; i < n_frequencies; i++)
+    {
+      g_autofree char *channel = g_strdup_printf ("us-bcast:%u", i + 2);
+      HdhomerunScanResult *result;
+
+      result = hdhomerun_scan_result_new (channel, 57000000 + i * 6000000, PROGRAMS_PER_FREQUENCY);
+      result->locked = TRUE;
+      result->modulation = g_strdup ("8vsb");
+      result->signal_strength = 80;
+      result->signal_quality = 90;
+
+      for (guint j = 0; j < PROGRAMS_PER_FREQUENCY; j++)
+        {
+          HdhomerunScanProgram *program = &result->programs[j];
+          char callsign[5];
+
+          callsign[0] = g_rand_boolean (rand) ? 'K' : 'W';
+          for (guint k = 1; k < 4; k++)
+            callsign[k] = 'A' + g_rand_int_range (rand, 0, 26);
+          callsign[4] = '\0';
+
+          program->program_number = j + 1;
+          program->virtual_major = i + 2;
+          program->virtual_minor = j + 1;
+          program->name = g_strdup_printf ("%s-%s", callsign,
+                                           suffixes[g_rand_int_range (rand, 0, G_N_ELEMENTS (suffixes))]);
+        }
+
+      g_ptr_array_add (results, result);
+    }
+
+  return results;
+}
+
+/* What a GtkStringFilter does with each label on every keystroke */
+static gboolean
+label_matches (const char *label,
+               const char *needle)
+{
+  g_autofree char *normalized = g_utf8_normalize (label, -1, G_NORMALIZE_ALL);
+  g_autofree char *folded = g_utf8_casefold (normalized, -1);
+
+  return strstr (folded, needle) != NULL;
+}
+
+/* Typing a callsign one letter at a time and refiltering after each */
+static void
+filter_case (gpointer data)
+{
+  ChannelData *channels = data;
+  GListModel *model = G_LIST_MODEL (channels->store);
+  const char *callsign = g_ptr_array_index (channels->queries, channels->op++ % channels->queries->len);
+  guint n_items = g_list_model_get_n_items (model);
+  guint n_matches = 0;
+
+  for (gsize typed = 1; typed <= 4; typed++)
+    {
+      g_autofree char *needle = g_utf8_casefold (callsign, typed);
+
+      for (guint i = 0; i < n_items; i++)
+        {
+          g_autoptr(HdhomerunChannelItem) item = g_list_model_get_item (model, i);
+
+          n_matches += label_matches (hdhomerun_channel_item_get_label (item), needle);
+        }
+    }
+
+  /* Every needle is a prefix of at least one callsign */
+  g_assert (n_matches >= 4);
+}
+
+static void
+find_case (gpointer data)
+{
+  ChannelData *channels = data;
+  const char *query = g_ptr_array_index (channels->queries, channels->op++ % channels->queries->len);
+
+  hdhomerun_channel_store_find (channels->store, query);
+}
+
+static void
+set_results_case (gpointer data)
+{
+  ChannelData *channels = data;
+
+  hdhomerun_channel_store_set_results (channels->store, channels->results);
+}
+
+static void
+run_channel_filter (void)
+{
+  static const guint sizes[] = { 512, 4096 };
+
+  for (guint i = 0; i < G_N_ELEMENTS (sizes); i++)
+    {
+      g_autoptr(GRand) rand = g_rand_new_with_seed (SEED);
+      g_autofree char *name = NULL;
+      ChannelData channels = { 0 };
+
+      channels.store = hdhomerun_channel_store_new ();
+      channels.results = make_lineup (rand, sizes[i]);
+      channels.queries = g_ptr_array_new_with_free_func (g_free);
+      hdhomerun_channel_store_set_results (channels.store, channels.results);
+
+      for (guint j = 0; j < 64; j++)
+        {
+          HdhomerunScanResult *result;
+
+          result = g_ptr_array_index (channels.results, g_rand_int_range (rand, 0, channels.results->len));
+          g_ptr_array_add (channels.queries,
+                           g_strndup (result->programs[g_rand_int_range (rand, 0, PROGRAMS_PER_FREQUENCY)].name, 4));
+        }
+
+      name = g_strdup_printf ("channel-filter/type-%u", sizes[i]);
+      run_case (name, 16, 0, filter_case, &channels);
+      g_clear_pointer (&name, g_free);
+
+      /* Callsigns, virtual channels and frequencies in MHz, in turn */
+      for (guint j = 0; j < 64; j += 3)
+        {
+          HdhomerunScanResult *result;
+
+          result = g_ptr_array_index (channels.results, g_rand_int_range (rand, 0, channels.results->len));
+          g_ptr_array_add (channels.queries, g_strdup_printf ("%u.%u", result->programs[0].virtual_major,
+                                                              g_rand_int_range (rand, 1, PROGRAMS_PER_FREQUENCY + 1)));
+          g_ptr_array_add (channels.queries, g_strdup_printf ("%u", result->frequency / 1000000));
+        }
+      name = g_strdup_printf ("channel-filter/find-%u", sizes[i]);
+      run_case (name, 65536, 0, find_case, &channels);
+      g_clear_pointer (&name, g_free);
+
+      name = g_strdup_printf ("channel-filter/set-results-%u", sizes[i]);
+      run_case (name, 64, 0, set_results_case, &channels);
+      g_clear_pointer (&name, g_free);
+
+      g_clear_object (&channels.store);
+      g_clear_pointer (&channels.results, g_ptr_array_unref);
+      g_clear_pointer (&channels.queries, g_ptr_array_unref);
+    }
+}
+
+/* TS demux throughput */
+
+#define PID_PMT 0x100
+#define PID_VIDEO 0x101
+#define PID_AUDIO 0x102
+
+/* Every PID appears a multiple of sixteen times, so the continuity
+ * counters carry on across the end of the buffer as it is fed again.
+ */
+#define TS_PERIOD 256
+#define TS_PERIODS 16
+
+typedef struct
+{
+  HdhomerunTsDemux *demux;
+  guint8 *packets;
+  gsize n_packets;
+  guint8 *noise;
+  gsize noise_len;
+} DemuxData;
+
+static guint32
+crc32_mpeg (const guint8 *data,
+            gsize         len)
+{
+  guint32 crc = 0xffffffff;
+
+  for (gsize i = 0; i < len; i++)
+    {
+      crc ^= (guint32) data[i] << 24;
+      for (int bit = 0; bit < 8; bit++)
+        crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+    }
+
+  return crc;
+}
+
+static void
+write_header (guint8   *p,
+              guint16   pid,
+              gboolean  unit_start,
+              guint8   *cc)
+{
+  p[0] = 0x47;
+  p[1] = (unit_start ? 0x40 : 0) | (pid >> 8);
+  p[2] = pid & 0xff;
+  p[3] = 0x10 | (cc[pid] & 0x0f);
+  cc[pid]++;
+}
+
+/* @section excludes the CRC, which is appended */
+static void
+write_section (guint8       *p,
+               guint16       pid,
+               const guint8 *section,
+               gsize         len,
+               guint8       *cc)
+{
+  guint32 crc = crc32_mpeg (section, len);
+
+  memset (p, 0xff, TS_SIZE);
+  write_header (p, pid, TRUE, cc);
+  p[4] = 0;                       /* Pointer field */
+  memcpy (p + 5, section, len);
+  p[5 + len] = crc >> 24;
+  p[6 + len] = crc >> 16;
+  p[7 + len] = crc >> 8;
+  p[8 + len] = crc;
+}
+
+static void
+make_stream (DemuxData *demux_data,
+             GRand     *rand)
+{
+  static const guint8 pat[] = {
+    0x00, 0xb0, 13, 0x00, 0x01, 0xc1, 0x00, 0x00,
+    0x00, 0x01, 0xe0 | (PID_PMT >> 8), PID_PMT & 0xff,
+  };
+  static const guint8 pmt[] = {
+    0x02, 0xb0, 23, 0x00, 0x01, 0xc1, 0x00, 0x00,
+    0xe0 | (PID_VIDEO >> 8), PID_VIDEO & 0xff, 0xf0, 0x00,
+    0x02, 0xe0 | (PID_VIDEO >> 8), PID_VIDEO & 0xff, 0xf0, 0x00,
+    0x81, 0xe0 | (PID_AUDIO >> 8), PID_AUDIO & 0xff, 0xf0, 0x00,
+  };
+  g_autofree guint8 *cc = g_new0 (guint8, HDHOMERUN_TS_N_PIDS);
+
+  demux_data->n_packets = TS_PERIOD * TS_PERIODS;
+  demux_data->packets = g_malloc (demux_data->n_packets * TS_SIZE);
+
+  for (gsize i = 0; i < demux_data->n_packets; i++)
+    {
+      guint8 *p = demux_data->packets + i * TS_SIZE;
+      gsize position = i % TS_PERIOD;
+
+      if (position == 0)
+        write_section (p, 0, pat, sizeof (pat), cc);
+      else if (position == 1)
+        write_section (p, PID_PMT, pmt, sizeof (pmt), cc);
+      else
+        {
+          /* One packet in eight is audio, the rest video */
+          write_header (p, position % 8 == 0 || position == 2 ? PID_AUDIO : PID_VIDEO,
+                        position % 64 == 2, cc);
+          for (gsize j = 4; j < TS_SIZE; j++)
+            p[j] = g_rand_int (rand);
+        }
+    }
+
+  /* Noise without a sync byte, so finding sync scans all of it */
+  demux_data->noise_len = 1 << 20;
+  demux_data->noise = g_malloc (demux_data->noise_len + TS_SIZE * 2);
+  for (gsize i = 0; i < demux_data->noise_len; i++)
+    {
+      guint8 byte = g_rand_int (rand);
+
+      demux_data->noise[i] = byte == 0x47 ? 0x48 : byte;
+    }
+  memcpy (demux_data->noise + demux_data->noise_len, demux_data->packets, TS_SIZE * 2);
+}
+
+static void
+feed_packets_case (gpointer data)
+{
+  DemuxData *demux_data = data;
+
+  hdhomerun_ts_demux_feed_packets (demux_data->demux, demux_data->packets, demux_data->n_packets);
+}
+
+/* One call per datagram, as a stream without a ring delivers it */
+static void
+feed_datagrams_case (gpointer data)
+{
+  DemuxData *demux_data = data;
+  gsize len = demux_data->n_packets * TS_SIZE;
+  gsize datagram = TS_PACKETS_PER_DATAGRAM * TS_SIZE;
+
+  for (gsize offset = 0; offset < len; offset += datagram)
+    hdhomerun_ts_demux_feed (demux_data->demux, demux_data->packets + offset,
+                             MIN (datagram, len - offset));
+}
+
+static void
+find_sync_case (gpointer data)
+{
+  DemuxData *demux_data = data;
+  gsize offset;
+
+  offset = hdhomerun_ts_find_sync (demux_data->noise, demux_data->noise_len + TS_SIZE * 2);
+  g_assert (offset == demux_data->noise_len);
+}
+
+static void
+run_ts_demux (void)
+{
+  g_autoptr(GRand) rand = g_rand_new_with_seed (SEED);
+  DemuxData demux_data = { 0 };
+  HdhomerunTsPidStats stats;
+
+  make_stream (&demux_data, rand);
+  demux_data.demux = hdhomerun_ts_demux_new (NULL, NULL, NULL);
+
+  run_case ("ts-demux/feed-packets", 64, demux_data.n_packets * TS_SIZE,
+            feed_packets_case, &demux_data);
+  run_case ("ts-demux/feed-datagrams", 64, demux_data.n_packets * TS_SIZE,
+            feed_datagrams_case, &demux_data);
+  run_case ("ts-demux/find-sync", 64, demux_data.noise_len,
+            find_sync_case, &demux_data);
+
+  /* A stream that counted errors was not built the way it was meant to */
+  hdhomerun_ts_demux_get_pid_stats (demux_data.demux, PID_VIDEO, &stats);
+  if (stats.continuity_errors != 0 || hdhomerun_ts_demux_get_sync_losses (demux_data.demux) != 0)
+    g_error ("Synthetic stream has %u continuity errors", stats.continuity_errors);
+
+  hdhomerun_ts_demux_unref (demux_data.demux);
+  g_free (demux_data.packets);
+  g_free (demux_data.noise);
+}
+
+static const struct
+{
+  const char *name;
+  void (*run) (void);
+} suites[] = {
+  { "discovery", run_discovery },
+  { "device-diff", run_device_diff },
+  { "channel-filter", run_channel_filter },
+  { "ts-demux", run_ts_demux },
+};
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_autoptr(GOptionContext) context = NULL;
+  g_autoptr(GError) error = NULL;
+  g_auto(GStrv) names = NULL;
+  const GOptionEntry entries[] = {
+    { "rounds", 'r', 0, G_OPTION_ARG_INT, &n_rounds,
+      "Rounds per case; the median is reported", "N" },
+    { "devices", 'n', 0, G_OPTION_ARG_INT, &n_devices_option,
+      "Size of the simulated fleet instead of the built-in sizes", "N" },
+    { G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_STRING_ARRAY, &names,
+      NULL, "[SUITE…]" },
+    G_OPTION_ENTRY_NULL
+  };
+
+  context = g_option_context_new (NULL);
+  g_option_context_set_summary (context,
+                                "Suites: discovery, device-diff, channel-filter, ts-demux. "
+                                "With none given, all of them run.");
+  g_option_context_add_main_entries (context, entries, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 2;
+    }
+
+  if (n_rounds < 1 || n_rounds > MAX_ROUNDS || n_devices_option < 0)
+    {
+      g_printerr ("Rounds must be between 1 and %d and the fleet size positive\n", MAX_ROUNDS);
+      return 2;
+    }
+
+  hdhomerun_backend_set_default (hdhomerun_simulated_backend_get ());
+
+  for (guint i = 0; names && names[i]; i++)
+    {
+      gboolean known = FALSE;
+
+      for (guint j = 0; j < G_N_ELEMENTS (suites); j++)
+        known |= g_str_equal (names[i], suites[j].name);
+
+      if (!known)
+        {
+          g_printerr ("Unknown suite %s\n", names[i]);
+          return 2;
+        }
+    }
+
+  for (guint i = 0; i < G_N_ELEMENTS (suites); i++)
+    {
+      if (names == NULL || g_strv_contains ((const char * const *)names, suites[i].name))
+        suites[i].run ();
+    }
+
+  return 0;
+}
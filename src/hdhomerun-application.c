@@ -25,6 +25,8 @@
 struct _HdhomerunApplication
 {
   AdwApplication parent_instance;
+
+  gint64 launch_time;
 };
 
 G_DEFINE_FINAL_TYPE (HdhomerunApplication, hdhomerun_application, ADW_TYPE_APPLICATION)
@@ -41,6 +43,21 @@ hdhomerun_application_new (const char        *application_id,
                        NULL);
 }
 
+/**
+ * hdhomerun_application_get_launch_time:
+ * @self: a #HdhomerunApplication
+ *
+ * Returns: the monotonic time at which @self was created, which is as
+ *   close to process start as main() gets
+ */
+gint64
+hdhomerun_application_get_launch_time (HdhomerunApplication *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_APPLICATION (self), 0);
+
+  return self->launch_time;
+}
+
 static void
 hdhomerun_application_activate (GApplication *app)
 {
@@ -116,6 +133,8 @@ static const GActionEntry app_actions[] = {
 static void
 hdhomerun_application_init (HdhomerunApplication *self)
 {
+  self->launch_time = g_get_monotonic_time ();
+
   g_action_map_add_action_entries (G_ACTION_MAP (self),
                                    app_actions,
                                    G_N_ELEMENTS (app_actions),
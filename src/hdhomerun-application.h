@@ -26,7 +26,8 @@ G_BEGIN_DECLS
 
 G_DECLARE_FINAL_TYPE (HdhomerunApplication, hdhomerun_application, HDHOMERUN, APPLICATION, AdwApplication)
 
-HdhomerunApplication *hdhomerun_application_new (const char        *application_id,
-                                                  GApplicationFlags  flags);
+HdhomerunApplication *hdhomerun_application_new             (const char           *application_id,
+                                                              GApplicationFlags     flags);
+gint64                hdhomerun_application_get_launch_time (HdhomerunApplication *self);
 
 G_END_DECLS
@@ -0,0 +1,161 @@
+/* hdhomerun-backend.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-config-gtk-config.h"
+#include "hdhomerun-backend.h"
+#include "hdhomerun-simulated-backend.h"
+
+/* The backend is chosen once per process, on first use. The
+ * HDHOMERUN_BACKEND environment variable names it, "hdhomerun" for
+ * real devices or "simulated" for a made-up fleet configured through
+ * HDHOMERUN_SIMULATE; without it the backend picked at build time with
+ * the "backend" meson option is used.
+ */
+
+static struct hdhomerun_discover_t *
+discover_create (void)
+{
+  return hdhomerun_discover_create (NULL);
+}
+
+static struct hdhomerun_device_t *
+device_create_from_str (const char *device_str)
+{
+  return hdhomerun_device_create_from_str (device_str, NULL);
+}
+
+static const HdhomerunBackend libhdhomerun_backend = {
+  .name = "hdhomerun",
+
+  .discover_create = discover_create,
+  .discover_destroy = hdhomerun_discover_destroy,
+  .discover_find_devices_broadcast = hdhomerun_discover2_find_devices_broadcast,
+  .discover_find_devices_targeted = hdhomerun_discover2_find_devices_targeted,
+  .discover_iter_device_first = hdhomerun_discover2_iter_device_first,
+  .discover_iter_device_next = hdhomerun_discover2_iter_device_next,
+  .discover_iter_device_if_first = hdhomerun_discover2_iter_device_if_first,
+  .discover_iter_device_if_next = hdhomerun_discover2_iter_device_if_next,
+  .discover_device_get_device_id = hdhomerun_discover2_device_get_device_id,
+  .discover_device_get_tuner_count = hdhomerun_discover2_device_get_tuner_count,
+  .discover_device_if_get_ip_addr = hdhomerun_discover2_device_if_get_ip_addr,
+
+  .device_create_from_str = device_create_from_str,
+  .device_destroy = hdhomerun_device_destroy,
+  .device_set_tuner = hdhomerun_device_set_tuner,
+  .device_get_model_str = hdhomerun_device_get_model_str,
+  .device_get_local_machine_addr = hdhomerun_device_get_local_machine_addr,
+  .device_get_var = hdhomerun_device_get_var,
+  .device_get_tuner_status = hdhomerun_device_get_tuner_status,
+  .device_set_tuner_channel = hdhomerun_device_set_tuner_channel,
+  .device_set_tuner_program = hdhomerun_device_set_tuner_program,
+  .device_get_tuner_target = hdhomerun_device_get_tuner_target,
+  .device_set_tuner_target = hdhomerun_device_set_tuner_target,
+  .device_get_tuner_channelmap = hdhomerun_device_get_tuner_channelmap,
+  .device_tuner_lockkey_request = hdhomerun_device_tuner_lockkey_request,
+  .device_tuner_lockkey_release = hdhomerun_device_tuner_lockkey_release,
+  .device_channelscan_init = hdhomerun_device_channelscan_init,
+  .device_channelscan_advance = hdhomerun_device_channelscan_advance,
+  .device_channelscan_detect = hdhomerun_device_channelscan_detect,
+  .device_channelscan_get_progress = hdhomerun_device_channelscan_get_progress,
+};
+
+static const HdhomerunBackend *default_backend;
+static gsize default_backend_initialized;
+
+static const HdhomerunBackend *
+backend_from_environment (void)
+{
+  const char *name = g_getenv ("HDHOMERUN_BACKEND");
+
+  if (name == NULL || *name == '\0')
+    name = HDHOMERUN_DEFAULT_BACKEND;
+
+  if (g_str_equal (name, "simulated"))
+    {
+      HdhomerunSimulatedConfig config;
+      g_autoptr(GError) error = NULL;
+      const char *spec = g_getenv ("HDHOMERUN_SIMULATE");
+
+      hdhomerun_simulated_config_init (&config);
+      if (spec != NULL && !hdhomerun_simulated_config_parse (&config, spec, &error))
+        g_warning ("Ignoring HDHOMERUN_SIMULATE: %s", error->message);
+
+      hdhomerun_simulated_backend_configure (&config);
+      g_message ("Simulating %u device(s) with %u tuner(s) each",
+                 config.n_devices, config.tuners_per_device);
+
+      return hdhomerun_simulated_backend_get ();
+    }
+
+  if (!g_str_equal (name, "hdhomerun"))
+    g_warning ("Unknown backend %s; using libhdhomerun", name);
+
+  return &libhdhomerun_backend;
+}
+
+/**
+ * hdhomerun_backend_get_default:
+ *
+ * Returns: (transfer none): the backend every device call of the
+ *   process goes through
+ */
+const HdhomerunBackend *
+hdhomerun_backend_get_default (void)
+{
+  if (g_once_init_enter (&default_backend_initialized))
+    {
+      default_backend = backend_from_environment ();
+      g_once_init_leave (&default_backend_initialized, 1);
+    }
+
+  return default_backend;
+}
+
+/**
+ * hdhomerun_backend_set_default:
+ * @backend: the backend to use
+ *
+ * Choose the backend instead of the environment. Only possible before
+ * the first device call, since handles cannot move between backends.
+ */
+void
+hdhomerun_backend_set_default (const HdhomerunBackend *backend)
+{
+  g_return_if_fail (backend != NULL);
+
+  if (g_once_init_enter (&default_backend_initialized))
+    {
+      default_backend = backend;
+      g_once_init_leave (&default_backend_initialized, 1);
+    }
+  else if (default_backend != backend)
+    {
+      g_critical ("The %s backend is already in use", default_backend->name);
+    }
+}
+
+/**
+ * hdhomerun_backend_get_libhdhomerun:
+ *
+ * Returns: (transfer none): the backend that talks to real devices
+ */
+const HdhomerunBackend *
+hdhomerun_backend_get_libhdhomerun (void)
+{
+  return &libhdhomerun_backend;
+}
@@ -0,0 +1,101 @@
+/* hdhomerun-backend.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include <libhdhomerun/hdhomerun.h>
+
+G_BEGIN_DECLS
+
+typedef struct _HdhomerunBackend HdhomerunBackend;
+
+/* Everything the core asks of the network, with the signatures of the
+ * libhdhomerun calls it stands for. The handles are opaque, so each
+ * backend is free to put its own state behind them; handles of one
+ * backend are never passed to another.
+ *
+ * Pure helpers that never touch a device, such as
+ * hdhomerun_sock_sockaddr_to_ip_str() and the channel map lookups, are
+ * called on libhdhomerun directly.
+ */
+struct _HdhomerunBackend
+{
+  const char *name;
+
+  /* Discovery */
+  struct hdhomerun_discover_t            *(*discover_create)                  (void);
+  void                                    (*discover_destroy)                 (struct hdhomerun_discover_t            *ds);
+  int                                     (*discover_find_devices_broadcast)  (struct hdhomerun_discover_t            *ds,
+                                                                               uint32_t                                flags,
+                                                                               uint32_t const                          device_types[],
+                                                                               size_t                                  device_types_count);
+  int                                     (*discover_find_devices_targeted)   (struct hdhomerun_discover_t            *ds,
+                                                                               const struct sockaddr                  *target_addr,
+                                                                               uint32_t const                          device_types[],
+                                                                               size_t                                  device_types_count);
+  struct hdhomerun_discover2_device_t    *(*discover_iter_device_first)       (struct hdhomerun_discover_t            *ds);
+  struct hdhomerun_discover2_device_t    *(*discover_iter_device_next)        (struct hdhomerun_discover2_device_t    *device);
+  struct hdhomerun_discover2_device_if_t *(*discover_iter_device_if_first)    (struct hdhomerun_discover2_device_t    *device);
+  struct hdhomerun_discover2_device_if_t *(*discover_iter_device_if_next)     (struct hdhomerun_discover2_device_if_t *device_if);
+  uint32_t                                (*discover_device_get_device_id)    (struct hdhomerun_discover2_device_t    *device);
+  uint8_t                                 (*discover_device_get_tuner_count)  (struct hdhomerun_discover2_device_t    *device);
+  void                                    (*discover_device_if_get_ip_addr)   (struct hdhomerun_discover2_device_if_t *device_if,
+                                                                               struct sockaddr_storage                *ip_addr);
+
+  /* Device control */
+  struct hdhomerun_device_t              *(*device_create_from_str)           (const char                             *device_str);
+  void                                    (*device_destroy)                   (struct hdhomerun_device_t              *hd);
+  int                                     (*device_set_tuner)                 (struct hdhomerun_device_t              *hd,
+                                                                               unsigned int                            tuner);
+  const char                             *(*device_get_model_str)             (struct hdhomerun_device_t              *hd);
+  uint32_t                                (*device_get_local_machine_addr)    (struct hdhomerun_device_t              *hd);
+  int                                     (*device_get_var)                   (struct hdhomerun_device_t              *hd,
+                                                                               const char                             *name,
+                                                                               char                                  **pvalue,
+                                                                               char                                  **perror);
+  int                                     (*device_get_tuner_status)          (struct hdhomerun_device_t              *hd,
+                                                                               char                                  **pstatus_str,
+                                                                               struct hdhomerun_tuner_status_t        *status);
+  int                                     (*device_set_tuner_channel)         (struct hdhomerun_device_t              *hd,
+                                                                               const char                             *channel);
+  int                                     (*device_set_tuner_program)         (struct hdhomerun_device_t              *hd,
+                                                                               const char                             *program);
+  int                                     (*device_get_tuner_target)          (struct hdhomerun_device_t              *hd,
+                                                                               char                                  **ptarget);
+  int                                     (*device_set_tuner_target)          (struct hdhomerun_device_t              *hd,
+                                                                               const char                             *target);
+  int                                     (*device_get_tuner_channelmap)      (struct hdhomerun_device_t              *hd,
+                                                                               char                                  **pchannelmap);
+  int                                     (*device_tuner_lockkey_request)     (struct hdhomerun_device_t              *hd,
+                                                                               char                                  **perror);
+  int                                     (*device_tuner_lockkey_release)     (struct hdhomerun_device_t              *hd);
+  int                                     (*device_channelscan_init)          (struct hdhomerun_device_t              *hd,
+                                                                               const char                             *channelmap);
+  int                                     (*device_channelscan_advance)       (struct hdhomerun_device_t              *hd,
+                                                                               struct hdhomerun_channelscan_result_t  *result);
+  int                                     (*device_channelscan_detect)        (struct hdhomerun_device_t              *hd,
+                                                                               struct hdhomerun_channelscan_result_t  *result);
+  uint8_t                                 (*device_channelscan_get_progress)  (struct hdhomerun_device_t              *hd);
+};
+
+const HdhomerunBackend *hdhomerun_backend_get_default (void);
+void                    hdhomerun_backend_set_default (const HdhomerunBackend *backend);
+const HdhomerunBackend *hdhomerun_backend_get_libhdhomerun (void);
+
+G_END_DECLS
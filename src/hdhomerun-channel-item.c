@@ -0,0 +1,138 @@
+/* hdhomerun-channel-item.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-channel-item.h"
+
+/* HdhomerunChannelItem is the object HdhomerunChannelStore hands out for
+ * one program. It shares the scan result with the store instead of
+ * copying the program out of it.
+ */
+struct _HdhomerunChannelItem
+{
+  GObject parent_instance;
+
+  HdhomerunScanResult *result;
+  guint program_index;
+  char *label;
+};
+
+G_DEFINE_FINAL_TYPE (HdhomerunChannelItem, hdhomerun_channel_item, G_TYPE_OBJECT)
+
+enum {
+  PROP_0,
+  PROP_LABEL,
+  N_PROPS
+};
+
+static GParamSpec *properties [N_PROPS];
+
+HdhomerunChannelItem *
+hdhomerun_channel_item_new (HdhomerunScanResult *result,
+                            guint                program_index,
+                            const char          *label)
+{
+  HdhomerunChannelItem *self;
+
+  g_return_val_if_fail (result != NULL, NULL);
+  g_return_val_if_fail (program_index < result->n_programs, NULL);
+
+  self = g_object_new (HDHOMERUN_TYPE_CHANNEL_ITEM, NULL);
+  self->result = hdhomerun_scan_result_ref (result);
+  self->program_index = program_index;
+  self->label = g_strdup (label);
+
+  return self;
+}
+
+const char *
+hdhomerun_channel_item_get_label (HdhomerunChannelItem *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_CHANNEL_ITEM (self), NULL);
+
+  return self->label;
+}
+
+const HdhomerunScanResult *
+hdhomerun_channel_item_get_result (HdhomerunChannelItem *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_CHANNEL_ITEM (self), NULL);
+
+  return self->result;
+}
+
+const HdhomerunScanProgram *
+hdhomerun_channel_item_get_program (HdhomerunChannelItem *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_CHANNEL_ITEM (self), NULL);
+
+  return &self->result->programs[self->program_index];
+}
+
+static void
+hdhomerun_channel_item_finalize (GObject *object)
+{
+  HdhomerunChannelItem *self = (HdhomerunChannelItem *)object;
+
+  g_clear_pointer (&self->result, hdhomerun_scan_result_unref);
+  g_clear_pointer (&self->label, g_free);
+
+  G_OBJECT_CLASS (hdhomerun_channel_item_parent_class)->finalize (object);
+}
+
+static void
+hdhomerun_channel_item_get_property (GObject    *object,
+                                     guint       prop_id,
+                                     GValue     *value,
+                                     GParamSpec *pspec)
+{
+  HdhomerunChannelItem *self = HDHOMERUN_CHANNEL_ITEM (object);
+
+  switch (prop_id)
+    {
+    case PROP_LABEL:
+      g_value_set_string (value, self->label);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+hdhomerun_channel_item_class_init (HdhomerunChannelItemClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = hdhomerun_channel_item_finalize;
+  object_class->get_property = hdhomerun_channel_item_get_property;
+
+  properties [PROP_LABEL] =
+    g_param_spec_string ("label",
+                         "Label",
+                         "Virtual channel and name, as shown and searched",
+                         NULL,
+                         (G_PARAM_READABLE |
+                          G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_properties (object_class, N_PROPS, properties);
+}
+
+static void
+hdhomerun_channel_item_init (HdhomerunChannelItem *self)
+{
+  (void)self; /* unused */
+}
@@ -0,0 +1,38 @@
+/* hdhomerun-channel-item.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "hdhomerun-channel-scan.h"
+
+G_BEGIN_DECLS
+
+#define HDHOMERUN_TYPE_CHANNEL_ITEM (hdhomerun_channel_item_get_type())
+
+G_DECLARE_FINAL_TYPE (HdhomerunChannelItem, hdhomerun_channel_item, HDHOMERUN, CHANNEL_ITEM, GObject)
+
+HdhomerunChannelItem       *hdhomerun_channel_item_new         (HdhomerunScanResult  *result,
+                                                                guint                 program_index,
+                                                                const char           *label);
+const char                 *hdhomerun_channel_item_get_label   (HdhomerunChannelItem *self);
+const HdhomerunScanResult  *hdhomerun_channel_item_get_result  (HdhomerunChannelItem *self);
+const HdhomerunScanProgram *hdhomerun_channel_item_get_program (HdhomerunChannelItem *self);
+
+G_END_DECLS
@@ -0,0 +1,755 @@
+/* hdhomerun-channel-scan.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-channel-scan.h"
+#include "hdhomerun-backend.h"
+#include "hdhomerun-dispatcher.h"
+#include "hdhomerun-trace.h"
+
+/* HdhomerunChannelScan splits a channel scan across several tuners.
+ *
+ * Almost all the time of a scan is spent waiting for each frequency to
+ * lock, so every idle tuner walks the same channel map but only detects
+ * its own share of the frequencies: with N tuners on the same scan group,
+ * tuner k takes every frequency whose index is k modulo N. Tuners that
+ * are streaming or locked by another client are left alone.
+ *
+ * Each frequency is handed to the HdhomerunDispatcher as soon as it has
+ * been scanned, locked or not, and reported on the main thread with the
+ * next batch of updates.
+ *
+ * Known results can be handed in before the scan. Frequencies that
+ * locked within FRESH_SECONDS are reported from them without being
+ * probed again, and only the remaining ones are shared out, so a rescan
+ * or a resumed scan pays for stale and failed frequencies only.
+ */
+
+#define FRESH_SECONDS (7 * 24 * 60 * 60)
+
+G_DEFINE_BOXED_TYPE (HdhomerunScanResult, hdhomerun_scan_result,
+                     hdhomerun_scan_result_ref, hdhomerun_scan_result_unref)
+
+HdhomerunScanResult *
+hdhomerun_scan_result_new (const char *channel,
+                           guint32     frequency,
+                           guint       n_programs)
+{
+  HdhomerunScanResult *result;
+
+  result = g_atomic_rc_box_new0 (HdhomerunScanResult);
+  result->channel = g_strdup (channel);
+  result->frequency = frequency;
+  result->n_programs = n_programs;
+  result->programs = g_new0 (HdhomerunScanProgram, n_programs);
+
+  return result;
+}
+
+HdhomerunScanResult *
+hdhomerun_scan_result_ref (HdhomerunScanResult *result)
+{
+  g_return_val_if_fail (result != NULL, NULL);
+
+  return g_atomic_rc_box_acquire (result);
+}
+
+static void
+scan_result_clear (HdhomerunScanResult *result)
+{
+  for (guint i = 0; i < result->n_programs; i++)
+    g_free (result->programs[i].name);
+
+  g_free (result->programs);
+  g_free (result->channel);
+  g_free (result->modulation);
+}
+
+void
+hdhomerun_scan_result_unref (HdhomerunScanResult *result)
+{
+  g_return_if_fail (result != NULL);
+
+  g_atomic_rc_box_release_full (result, (GDestroyNotify) scan_result_clear);
+}
+
+static gboolean
+same_programs (const HdhomerunScanResult *result,
+               GArray                    *programs)
+{
+  if (result->n_programs != programs->len)
+    return FALSE;
+
+  for (guint i = 0; i < programs->len; i++)
+    {
+      const HdhomerunTsProgram *program = &g_array_index (programs, HdhomerunTsProgram, i);
+      const HdhomerunScanProgram *known = &result->programs[i];
+
+      if (known->program_number != program->program_number ||
+          known->virtual_major != program->virtual_major ||
+          known->virtual_minor != program->virtual_minor ||
+          g_strcmp0 (known->name, program->name) != 0)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/**
+ * hdhomerun_scan_result_new_from_programs:
+ * @known: (nullable): what the last scan found on @frequency
+ * @frequency: the frequency the programs were received on
+ * @programs: (element-type HdhomerunTsProgram): the programs of the stream
+ *
+ * Build a result from what the tables of a locked stream say, keeping
+ * the channel name and signal figures of @known.
+ *
+ * Returns: (transfer full) (nullable): the new result, or %NULL if
+ *   @programs is empty or @known already lists exactly @programs
+ */
+HdhomerunScanResult *
+hdhomerun_scan_result_new_from_programs (const HdhomerunScanResult *known,
+                                         guint32                    frequency,
+                                         GArray                    *programs)
+{
+  HdhomerunScanResult *result;
+
+  g_return_val_if_fail (programs != NULL, NULL);
+
+  if (programs->len == 0 || (known != NULL && same_programs (known, programs)))
+    return NULL;
+
+  if (known != NULL)
+    {
+      result = hdhomerun_scan_result_new (known->channel, frequency, programs->len);
+      result->modulation = g_strdup (known->modulation);
+      result->signal_strength = known->signal_strength;
+      result->signal_quality = known->signal_quality;
+    }
+  else
+    {
+      g_autofree char *channel = g_strdup_printf ("auto:%u", frequency);
+
+      result = hdhomerun_scan_result_new (channel, frequency, programs->len);
+    }
+  result->locked = TRUE;
+  result->scanned_at = g_get_real_time ();
+
+  for (guint i = 0; i < programs->len; i++)
+    {
+      const HdhomerunTsProgram *program = &g_array_index (programs, HdhomerunTsProgram, i);
+
+      result->programs[i].program_number = program->program_number;
+      result->programs[i].virtual_major = program->virtual_major;
+      result->programs[i].virtual_minor = program->virtual_minor;
+      result->programs[i].name = g_strdup (program->name);
+    }
+
+  return result;
+}
+
+struct _HdhomerunChannelScan
+{
+  GObject parent_instance;
+
+  GPtrArray *connections;  /* Held HdhomerunConnection */
+  GHashTable *results;     /* Frequency -> HdhomerunScanResult */
+  gboolean running;
+  double progress;
+};
+
+G_DEFINE_FINAL_TYPE (HdhomerunChannelScan, hdhomerun_channel_scan, G_TYPE_OBJECT)
+
+enum {
+  PROP_0,
+  PROP_PROGRESS,
+  N_PROPS
+};
+
+enum {
+  FREQUENCY_SCANNED,
+  N_SIGNALS
+};
+
+static GParamSpec *properties [N_PROPS];
+static guint signals [N_SIGNALS];
+
+/* Shared by the workers of one run */
+typedef struct
+{
+  HdhomerunChannelScan *self;
+  GCancellable *cancellable;
+  GHashTable *fresh;       /* Frequency -> HdhomerunScanResult, read-only */
+  guint n_workers;
+  gint progress_sum;       /* Atomic, percent summed over workers */
+} ScanRun;
+
+typedef struct
+{
+  ScanRun *run;
+  HdhomerunConnection *connection;
+  char *scan_group;
+  guint slice;
+  guint n_slices;
+  gint progress;
+} ScanWorker;
+
+typedef struct
+{
+  HdhomerunChannelScan *self;
+  HdhomerunScanResult *result;
+  double progress;
+} ScanReport;
+
+typedef struct
+{
+  GHashTable *fresh;
+} ScanSetup;
+
+static void
+scan_worker_free (ScanWorker *worker)
+{
+  g_free (worker->scan_group);
+  g_free (worker);
+}
+
+static void
+scan_setup_free (ScanSetup *setup)
+{
+  g_hash_table_unref (setup->fresh);
+  g_free (setup);
+}
+
+static void
+scan_report_free (ScanReport *report)
+{
+  g_object_unref (report->self);
+  hdhomerun_scan_result_unref (report->result);
+  g_free (report);
+}
+
+HdhomerunChannelScan *
+hdhomerun_channel_scan_new (void)
+{
+  return g_object_new (HDHOMERUN_TYPE_CHANNEL_SCAN, NULL);
+}
+
+/**
+ * hdhomerun_channel_scan_add_tuner:
+ * @self: a #HdhomerunChannelScan
+ * @connection: a tuner that may take part in the scan
+ *
+ * Offer a tuner to the scan. Whether it is used is decided when the scan
+ * starts, depending on whether it is idle.
+ */
+void
+hdhomerun_channel_scan_add_tuner (HdhomerunChannelScan *self,
+                                  HdhomerunConnection  *connection)
+{
+  g_return_if_fail (HDHOMERUN_IS_CHANNEL_SCAN (self));
+  g_return_if_fail (connection != NULL);
+  g_return_if_fail (!self->running);
+
+  hdhomerun_connection_pool_hold (hdhomerun_connection_pool_get_default (), connection);
+  g_ptr_array_add (self->connections, connection);
+}
+
+/**
+ * hdhomerun_channel_scan_add_known_results:
+ * @self: a #HdhomerunChannelScan
+ * @results: (element-type HdhomerunScanResult): results of earlier scans
+ *
+ * Seed the scan with earlier results, such as those from the scan cache.
+ * Recently locked frequencies are not probed again.
+ */
+void
+hdhomerun_channel_scan_add_known_results (HdhomerunChannelScan *self,
+                                          GPtrArray            *results)
+{
+  g_return_if_fail (HDHOMERUN_IS_CHANNEL_SCAN (self));
+  g_return_if_fail (results != NULL);
+  g_return_if_fail (!self->running);
+
+  for (guint i = 0; i < results->len; i++)
+    {
+      HdhomerunScanResult *result = g_ptr_array_index (results, i);
+
+      g_hash_table_replace (self->results, GUINT_TO_POINTER (result->frequency),
+                            hdhomerun_scan_result_ref (result));
+    }
+}
+
+static int
+compare_frequency (gconstpointer a,
+                   gconstpointer b)
+{
+  const HdhomerunScanResult *result_a = *(HdhomerunScanResult * const *)a;
+  const HdhomerunScanResult *result_b = *(HdhomerunScanResult * const *)b;
+
+  return (result_a->frequency > result_b->frequency) - (result_a->frequency < result_b->frequency);
+}
+
+/**
+ * hdhomerun_channel_scan_get_results:
+ * @self: a #HdhomerunChannelScan
+ *
+ * Get the known results merged with everything scanned so far, so an
+ * interrupted scan can still be saved.
+ *
+ * Returns: (transfer container) (element-type HdhomerunScanResult): the
+ *   results, sorted by frequency
+ */
+GPtrArray *
+hdhomerun_channel_scan_get_results (HdhomerunChannelScan *self)
+{
+  GPtrArray *results;
+  GHashTableIter iter;
+  HdhomerunScanResult *result;
+
+  g_return_val_if_fail (HDHOMERUN_IS_CHANNEL_SCAN (self), NULL);
+
+  results = g_ptr_array_new_full (g_hash_table_size (self->results),
+                                  (GDestroyNotify) hdhomerun_scan_result_unref);
+
+  g_hash_table_iter_init (&iter, self->results);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&result))
+    g_ptr_array_add (results, hdhomerun_scan_result_ref (result));
+
+  g_ptr_array_sort (results, compare_frequency);
+
+  return results;
+}
+
+double
+hdhomerun_channel_scan_get_progress (HdhomerunChannelScan *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_CHANNEL_SCAN (self), 0.0);
+
+  return self->progress;
+}
+
+static void
+deliver_report (gpointer user_data)
+{
+  ScanReport *report = user_data;
+  HdhomerunChannelScan *self = report->self;
+
+  /* A cached result can be reported by more than one scan group */
+  if (g_hash_table_lookup (self->results, GUINT_TO_POINTER (report->result->frequency)) !=
+      report->result)
+    {
+      g_hash_table_replace (self->results, GUINT_TO_POINTER (report->result->frequency),
+                            hdhomerun_scan_result_ref (report->result));
+      g_signal_emit (self, signals [FREQUENCY_SCANNED], 0, report->result);
+    }
+
+  if (report->progress > self->progress)
+    {
+      self->progress = report->progress;
+      g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_PROGRESS]);
+    }
+}
+
+static HdhomerunScanResult *
+result_from_libhdhomerun (const struct hdhomerun_channelscan_result_t *scanned)
+{
+  HdhomerunScanResult *result;
+  const struct hdhomerun_tuner_status_t *status = &scanned->status;
+
+  result = hdhomerun_scan_result_new (scanned->channel_str, scanned->frequency,
+                                      MAX (scanned->program_count, 0));
+  result->locked = status->lock_supported;
+  result->modulation = status->lock_supported ? g_strdup (status->lock_str) : NULL;
+  result->signal_strength = status->signal_strength;
+  result->signal_quality = status->signal_to_noise_quality;
+  result->scanned_at = g_get_real_time ();
+
+  for (guint i = 0; i < result->n_programs; i++)
+    {
+      const struct hdhomerun_channelscan_program_t *program = &scanned->programs[i];
+
+      result->programs[i].program_number = program->program_number;
+      result->programs[i].virtual_major = program->virtual_major;
+      result->programs[i].virtual_minor = program->virtual_minor;
+      result->programs[i].name = g_strdup (program->name);
+    }
+
+  return result;
+}
+
+static void
+report_result (ScanWorker          *worker,
+               HdhomerunScanResult *result,
+               guint                progress)
+{
+  ScanRun *run = worker->run;
+  ScanReport *report;
+  gint sum;
+
+  sum = g_atomic_int_add (&run->progress_sum, (gint) progress - worker->progress);
+  sum += (gint) progress - worker->progress;
+  worker->progress = progress;
+
+  report = g_new0 (ScanReport, 1);
+  report->self = g_object_ref (run->self);
+  report->result = result;
+  report->progress = sum / (100.0 * run->n_workers);
+
+  hdhomerun_dispatcher_push (hdhomerun_dispatcher_get_default (),
+                             deliver_report, report,
+                             (GDestroyNotify) scan_report_free);
+}
+
+static void
+run_worker (gpointer data,
+            gpointer user_data)
+{
+  const HdhomerunBackend *backend = hdhomerun_backend_get_default ();
+  ScanWorker *worker = data;
+  GCancellable *cancellable = worker->run->cancellable;
+  gint64 worker_trace = hdhomerun_trace_begin ();
+  struct hdhomerun_device_t *hd;
+  guint n_detected = 0;
+  int ret;
+
+  (void)user_data; /* unused */
+
+  /* Every exit goes through out, which gives the lockkey back */
+  hd = hdhomerun_connection_lock (worker->connection);
+  if (hd == NULL)
+    goto out;
+  ret = backend->device_channelscan_init (hd, worker->scan_group);
+  hdhomerun_connection_unlock (worker->connection);
+
+  if (ret <= 0)
+    {
+      g_warning ("Failed to start scan on %s tuner %u",
+                 hdhomerun_connection_get_device_id (worker->connection),
+                 hdhomerun_connection_get_tuner_index (worker->connection));
+      goto out;
+    }
+
+  /* The connection is only locked per frequency, so the keepalive and
+   * other requests on this tuner are not held up for the whole scan.
+   */
+  for (guint index = 0; !g_cancellable_is_cancelled (cancellable); )
+    {
+      struct hdhomerun_channelscan_result_t scanned;
+      HdhomerunScanResult *fresh;
+      guint progress;
+      gint64 trace;
+
+      hd = hdhomerun_connection_lock (worker->connection);
+      if (hd == NULL)
+        break;
+
+      ret = backend->device_channelscan_advance (hd, &scanned);
+      if (ret <= 0)
+        {
+          hdhomerun_connection_unlock (worker->connection);
+          break;
+        }
+
+      /* Every worker walks the same list, so they agree on which
+       * frequencies need probing and on their order.
+       */
+      fresh = g_hash_table_lookup (worker->run->fresh, GUINT_TO_POINTER (scanned.frequency));
+      if (fresh != NULL)
+        {
+          progress = backend->device_channelscan_get_progress (hd);
+          hdhomerun_connection_unlock (worker->connection);
+
+          if (worker->slice == 0)
+            report_result (worker, hdhomerun_scan_result_ref (fresh), progress);
+          continue;
+        }
+
+      if (index++ % worker->n_slices != worker->slice)
+        {
+          hdhomerun_connection_unlock (worker->connection);
+          continue;
+        }
+
+      trace = hdhomerun_trace_begin ();
+      ret = backend->device_channelscan_detect (hd, &scanned);
+      progress = backend->device_channelscan_get_progress (hd);
+      hdhomerun_connection_unlock (worker->connection);
+      n_detected++;
+
+      hdhomerun_trace_end (trace, "scan-detect", "%s: %d program(s)",
+                           scanned.channel_str, ret > 0 ? scanned.program_count : 0);
+
+      if (ret < 0)
+        break;
+      if (ret > 0)
+        report_result (worker, result_from_libhdhomerun (&scanned), progress);
+    }
+
+out:
+  hd = hdhomerun_connection_lock (worker->connection);
+  if (hd)
+    {
+      backend->device_tuner_lockkey_release (hd);
+      hdhomerun_connection_unlock (worker->connection);
+    }
+
+  hdhomerun_trace_end (worker_trace, "scan-worker", "%s tuner %u: %u frequencies detected",
+                       hdhomerun_connection_get_device_id (worker->connection),
+                       hdhomerun_connection_get_tuner_index (worker->connection),
+                       n_detected);
+}
+
+/* Returns a worker when the tuner is idle and could be locked for us */
+static ScanWorker *
+claim_tuner (HdhomerunConnection *connection)
+{
+  const HdhomerunBackend *backend = hdhomerun_backend_get_default ();
+  struct hdhomerun_device_t *hd;
+  ScanWorker *worker = NULL;
+  char *target = NULL;
+  char *channelmap = NULL;
+  char *error = NULL;
+
+  hd = hdhomerun_connection_lock (connection);
+  if (hd == NULL)
+    return NULL;
+
+  if (backend->device_get_tuner_target (hd, &target) <= 0 ||
+      g_strcmp0 (target, "none") != 0)
+    goto out;
+
+  if (backend->device_tuner_lockkey_request (hd, &error) <= 0)
+    {
+      g_message ("Tuner %u of %s is locked: %s",
+                 hdhomerun_connection_get_tuner_index (connection),
+                 hdhomerun_connection_get_device_id (connection),
+                 error ? error : "unknown error");
+      goto out;
+    }
+
+  if (backend->device_get_tuner_channelmap (hd, &channelmap) <= 0 ||
+      hdhomerun_channelmap_get_channelmap_scan_group (channelmap) == NULL)
+    {
+      backend->device_tuner_lockkey_release (hd);
+      goto out;
+    }
+
+  worker = g_new0 (ScanWorker, 1);
+  worker->connection = connection;
+  worker->scan_group = g_strdup (hdhomerun_channelmap_get_channelmap_scan_group (channelmap));
+
+out:
+  hdhomerun_connection_unlock (connection);
+  return worker;
+}
+
+static void
+run_thread (GTask        *task,
+            gpointer      source_object,
+            gpointer      task_data,
+            GCancellable *cancellable)
+{
+  HdhomerunChannelScan *self = source_object;
+  ScanSetup *setup = task_data;
+  g_autoptr(GPtrArray) workers = NULL;
+  g_autoptr(GHashTable) group_sizes = NULL;
+  GThreadPool *pool;
+  ScanRun run = { self, cancellable, setup->fresh, 0, 0 };
+
+  workers = g_ptr_array_new_with_free_func ((GDestroyNotify) scan_worker_free);
+  group_sizes = g_hash_table_new (g_str_hash, g_str_equal);
+
+  for (guint i = 0; i < self->connections->len; i++)
+    {
+      ScanWorker *worker = claim_tuner (g_ptr_array_index (self->connections, i));
+      guint n;
+
+      if (worker == NULL)
+        continue;
+
+      /* Tuners on the same scan group walk the same list, so they split it */
+      n = GPOINTER_TO_UINT (g_hash_table_lookup (group_sizes, worker->scan_group));
+      worker->slice = n;
+      g_hash_table_insert (group_sizes, worker->scan_group, GUINT_TO_POINTER (n + 1));
+
+      worker->run = &run;
+      g_ptr_array_add (workers, worker);
+    }
+
+  if (workers->len == 0)
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_BUSY,
+                               "No idle tuner is available to scan with");
+      return;
+    }
+
+  for (guint i = 0; i < workers->len; i++)
+    {
+      ScanWorker *worker = g_ptr_array_index (workers, i);
+
+      worker->n_slices = GPOINTER_TO_UINT (g_hash_table_lookup (group_sizes, worker->scan_group));
+    }
+
+  run.n_workers = workers->len;
+
+  g_message ("Scanning with %u tuners", workers->len);
+
+  pool = g_thread_pool_new (run_worker, NULL, workers->len, FALSE, NULL);
+  for (guint i = 0; i < workers->len; i++)
+    g_thread_pool_push (pool, g_ptr_array_index (workers, i), NULL);
+
+  /* Wait for every worker, so none outlives the run */
+  g_thread_pool_free (pool, FALSE, TRUE);
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * hdhomerun_channel_scan_run_async:
+ * @self: a #HdhomerunChannelScan
+ * @cancellable: (nullable): a #GCancellable to stop the scan early
+ * @callback: called when every tuner has finished
+ * @user_data: data for @callback
+ *
+ * Scan with every idle tuner that was added. #HdhomerunChannelScan::frequency-scanned
+ * is emitted on the main thread as results come in, and for all of them
+ * by the time hdhomerun_channel_scan_run_finish() returns.
+ */
+void
+hdhomerun_channel_scan_run_async (HdhomerunChannelScan *self,
+                                  GCancellable         *cancellable,
+                                  GAsyncReadyCallback   callback,
+                                  gpointer              user_data)
+{
+  g_autoptr(GTask) task = NULL;
+  gint64 fresh_after = g_get_real_time () - (gint64) FRESH_SECONDS * G_USEC_PER_SEC;
+  ScanSetup *setup;
+  GHashTableIter iter;
+  gpointer frequency;
+  HdhomerunScanResult *result;
+
+  g_return_if_fail (HDHOMERUN_IS_CHANNEL_SCAN (self));
+  g_return_if_fail (!self->running);
+
+  /* The workers only read this copy, results keep changing meanwhile */
+  setup = g_new0 (ScanSetup, 1);
+  setup->fresh = g_hash_table_new_full (NULL, NULL, NULL,
+                                        (GDestroyNotify) hdhomerun_scan_result_unref);
+
+  g_hash_table_iter_init (&iter, self->results);
+  while (g_hash_table_iter_next (&iter, &frequency, (gpointer *)&result))
+    if (result->locked && result->scanned_at > fresh_after)
+      g_hash_table_insert (setup->fresh, frequency, hdhomerun_scan_result_ref (result));
+
+  self->running = TRUE;
+  self->progress = 0.0;
+  g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_PROGRESS]);
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, hdhomerun_channel_scan_run_async);
+  g_task_set_task_data (task, setup, (GDestroyNotify) scan_setup_free);
+  g_task_run_in_thread (task, run_thread);
+}
+
+gboolean
+hdhomerun_channel_scan_run_finish (HdhomerunChannelScan  *self,
+                                   GAsyncResult          *result,
+                                   GError               **error)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_CHANNEL_SCAN (self), FALSE);
+  g_return_val_if_fail (g_task_is_valid (result, self), FALSE);
+
+  self->running = FALSE;
+
+  /* Results still waiting for a frame come before the end of the scan */
+  hdhomerun_dispatcher_flush (hdhomerun_dispatcher_get_default ());
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+static void
+release_connection (gpointer data)
+{
+  hdhomerun_connection_pool_release (hdhomerun_connection_pool_get_default (), data);
+}
+
+static void
+hdhomerun_channel_scan_finalize (GObject *object)
+{
+  HdhomerunChannelScan *self = (HdhomerunChannelScan *)object;
+
+  g_clear_pointer (&self->connections, g_ptr_array_unref);
+  g_clear_pointer (&self->results, g_hash_table_unref);
+
+  G_OBJECT_CLASS (hdhomerun_channel_scan_parent_class)->finalize (object);
+}
+
+static void
+hdhomerun_channel_scan_get_property (GObject    *object,
+                                     guint       prop_id,
+                                     GValue     *value,
+                                     GParamSpec *pspec)
+{
+  HdhomerunChannelScan *self = HDHOMERUN_CHANNEL_SCAN (object);
+
+  switch (prop_id)
+    {
+    case PROP_PROGRESS:
+      g_value_set_double (value, self->progress);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+hdhomerun_channel_scan_class_init (HdhomerunChannelScanClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = hdhomerun_channel_scan_finalize;
+  object_class->get_property = hdhomerun_channel_scan_get_property;
+
+  properties [PROP_PROGRESS] =
+    g_param_spec_double ("progress",
+                         "Progress",
+                         "Fraction of the channel map scanned so far",
+                         0.0, 1.0, 0.0,
+                         (G_PARAM_READABLE |
+                          G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_properties (object_class, N_PROPS, properties);
+
+  signals [FREQUENCY_SCANNED] =
+    g_signal_new ("frequency-scanned",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL, NULL,
+                  G_TYPE_NONE, 1,
+                  HDHOMERUN_TYPE_SCAN_RESULT | G_SIGNAL_TYPE_STATIC_SCOPE);
+}
+
+static void
+hdhomerun_channel_scan_init (HdhomerunChannelScan *self)
+{
+  self->connections = g_ptr_array_new_with_free_func (release_connection);
+  self->results = g_hash_table_new_full (NULL, NULL, NULL,
+                                         (GDestroyNotify) hdhomerun_scan_result_unref);
+}
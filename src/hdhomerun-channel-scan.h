@@ -0,0 +1,87 @@
+/* hdhomerun-channel-scan.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "hdhomerun-connection-pool.h"
+#include "hdhomerun-ts-demux.h"
+
+G_BEGIN_DECLS
+
+#define HDHOMERUN_TYPE_SCAN_RESULT (hdhomerun_scan_result_get_type())
+#define HDHOMERUN_TYPE_CHANNEL_SCAN (hdhomerun_channel_scan_get_type())
+
+typedef struct
+{
+  guint16  program_number;
+  guint16  virtual_major;
+  guint16  virtual_minor;
+  char    *name;
+} HdhomerunScanProgram;
+
+typedef struct _HdhomerunScanResult HdhomerunScanResult;
+
+/* What one frequency of a channel map held when it was scanned */
+struct _HdhomerunScanResult
+{
+  char                 *channel;          /* e.g. "us-bcast:33" */
+  guint32               frequency;        /* Hz */
+  gboolean              locked;
+  char                 *modulation;       /* NULL when not locked */
+  guint                 signal_strength;  /* Percent */
+  guint                 signal_quality;   /* Percent */
+  gint64                scanned_at;       /* g_get_real_time() */
+  guint                 n_programs;
+  HdhomerunScanProgram *programs;
+};
+
+/* Like HdhomerunDeviceInfo, results are immutable once handed out */
+GType                hdhomerun_scan_result_get_type (void) G_GNUC_CONST;
+HdhomerunScanResult *hdhomerun_scan_result_new      (const char          *channel,
+                                                     guint32              frequency,
+                                                     guint                n_programs);
+HdhomerunScanResult *hdhomerun_scan_result_ref      (HdhomerunScanResult *result);
+void                 hdhomerun_scan_result_unref    (HdhomerunScanResult *result);
+HdhomerunScanResult *hdhomerun_scan_result_new_from_programs
+                                                    (const HdhomerunScanResult *known,
+                                                     guint32                    frequency,
+                                                     GArray                    *programs);
+
+G_DECLARE_FINAL_TYPE (HdhomerunChannelScan, hdhomerun_channel_scan, HDHOMERUN, CHANNEL_SCAN, GObject)
+
+HdhomerunChannelScan *hdhomerun_channel_scan_new          (void);
+void                  hdhomerun_channel_scan_add_tuner    (HdhomerunChannelScan  *self,
+                                                           HdhomerunConnection   *connection);
+void                  hdhomerun_channel_scan_add_known_results
+                                                          (HdhomerunChannelScan  *self,
+                                                           GPtrArray             *results);
+GPtrArray            *hdhomerun_channel_scan_get_results  (HdhomerunChannelScan  *self);
+void                  hdhomerun_channel_scan_run_async    (HdhomerunChannelScan  *self,
+                                                           GCancellable          *cancellable,
+                                                           GAsyncReadyCallback    callback,
+                                                           gpointer               user_data);
+gboolean              hdhomerun_channel_scan_run_finish   (HdhomerunChannelScan  *self,
+                                                           GAsyncResult          *result,
+                                                           GError               **error);
+double                hdhomerun_channel_scan_get_progress (HdhomerunChannelScan  *self);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (HdhomerunScanResult, hdhomerun_scan_result_unref)
+
+G_END_DECLS
@@ -0,0 +1,510 @@
+/* hdhomerun-channel-store.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-channel-store.h"
+#include "hdhomerun-channel-item.h"
+
+/* HdhomerunChannelStore is a GListModel of every program found by channel
+ * scans, ordered by virtual channel, then frequency and program number.
+ *
+ * Programs are kept as records pointing into the shared scan results, and
+ * an item is only created once the list asks for it. Items are kept after
+ * that: filtering visits every item on each keystroke, and recreating
+ * them every time would cost more than keeping them.
+ *
+ * Virtual channel, callsign and frequency are indexed, so a lookup by any
+ * of them does not walk the list.
+ */
+
+typedef struct
+{
+  HdhomerunScanResult *result;
+  guint program_index;
+  guint32 virtual_key;         /* major << 16 | minor */
+  char *label;
+  HdhomerunChannelItem *item;  /* Created on first use */
+} ChannelRecord;
+
+struct _HdhomerunChannelStore
+{
+  GObject parent_instance;
+
+  GPtrArray *records;         /* ChannelRecord, sorted */
+  GHashTable *by_frequency;   /* Frequency -> HdhomerunScanResult */
+  GHashTable *by_virtual;     /* Virtual key -> GPtrArray of ChannelRecord */
+  GHashTable *by_callsign;    /* Casefolded name -> GPtrArray of ChannelRecord */
+};
+
+static void hdhomerun_channel_store_list_model_init (GListModelInterface *iface);
+
+G_DEFINE_FINAL_TYPE_WITH_CODE (HdhomerunChannelStore, hdhomerun_channel_store, G_TYPE_OBJECT,
+                               G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL,
+                                                      hdhomerun_channel_store_list_model_init))
+
+static const HdhomerunScanProgram *
+record_program (const ChannelRecord *record)
+{
+  return &record->result->programs[record->program_index];
+}
+
+static ChannelRecord *
+channel_record_new (HdhomerunScanResult *result,
+                    guint                program_index)
+{
+  ChannelRecord *record = g_new0 (ChannelRecord, 1);
+  const HdhomerunScanProgram *program;
+
+  record->result = hdhomerun_scan_result_ref (result);
+  record->program_index = program_index;
+
+  program = record_program (record);
+  record->virtual_key = (guint32) program->virtual_major << 16 | program->virtual_minor;
+
+  if (program->virtual_major > 0)
+    record->label = g_strdup_printf ("%u.%u %s", program->virtual_major,
+                                     program->virtual_minor, program->name);
+  else
+    record->label = g_strdup_printf ("%s program %u", result->channel,
+                                     program->program_number);
+
+  return record;
+}
+
+static void
+channel_record_free (ChannelRecord *record)
+{
+  g_clear_object (&record->item);
+  hdhomerun_scan_result_unref (record->result);
+  g_free (record->label);
+  g_free (record);
+}
+
+static int
+compare_records (const ChannelRecord *a,
+                 const ChannelRecord *b)
+{
+  if (a->virtual_key != b->virtual_key)
+    return a->virtual_key < b->virtual_key ? -1 : 1;
+  if (a->result->frequency != b->result->frequency)
+    return a->result->frequency < b->result->frequency ? -1 : 1;
+
+  return (int) record_program (a)->program_number - (int) record_program (b)->program_number;
+}
+
+static int
+compare_records_indirect (gconstpointer a,
+                          gconstpointer b)
+{
+  return compare_records (*(ChannelRecord * const *)a, *(ChannelRecord * const *)b);
+}
+
+static GType
+hdhomerun_channel_store_get_item_type (GListModel *model)
+{
+  (void)model; /* unused */
+
+  return HDHOMERUN_TYPE_CHANNEL_ITEM;
+}
+
+static guint
+hdhomerun_channel_store_get_n_items (GListModel *model)
+{
+  HdhomerunChannelStore *self = HDHOMERUN_CHANNEL_STORE (model);
+
+  return self->records->len;
+}
+
+static gpointer
+hdhomerun_channel_store_get_item (GListModel *model,
+                                  guint       position)
+{
+  HdhomerunChannelStore *self = HDHOMERUN_CHANNEL_STORE (model);
+  ChannelRecord *record;
+
+  if (position >= self->records->len)
+    return NULL;
+
+  record = g_ptr_array_index (self->records, position);
+
+  if (record->item == NULL)
+    record->item = hdhomerun_channel_item_new (record->result, record->program_index,
+                                               record->label);
+
+  return g_object_ref (record->item);
+}
+
+static void
+hdhomerun_channel_store_list_model_init (GListModelInterface *iface)
+{
+  iface->get_item_type = hdhomerun_channel_store_get_item_type;
+  iface->get_n_items = hdhomerun_channel_store_get_n_items;
+  iface->get_item = hdhomerun_channel_store_get_item;
+}
+
+/* Returns the position of the first record not sorting before @record */
+static guint
+find_position (HdhomerunChannelStore *self,
+               const ChannelRecord   *record)
+{
+  guint low = 0;
+  guint high = self->records->len;
+
+  while (low < high)
+    {
+      guint mid = low + (high - low) / 2;
+
+      if (compare_records (g_ptr_array_index (self->records, mid), record) < 0)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+
+  return low;
+}
+
+/* Several records can share a virtual channel or a callsign, so each
+ * key keeps all of them and a lookup goes to the first in list order.
+ */
+static void
+index_add (GHashTable     *index,
+           gpointer        key,
+           GDestroyNotify  key_free,
+           ChannelRecord  *record)
+{
+  GPtrArray *records = g_hash_table_lookup (index, key);
+
+  if (records == NULL)
+    {
+      records = g_ptr_array_new ();
+      g_hash_table_insert (index, key, records);
+    }
+  else if (key_free != NULL)
+    key_free (key);
+
+  g_ptr_array_add (records, record);
+}
+
+static void
+index_remove (GHashTable    *index,
+              gconstpointer  key,
+              ChannelRecord *record)
+{
+  GPtrArray *records = g_hash_table_lookup (index, key);
+
+  if (records == NULL || !g_ptr_array_remove_fast (records, record))
+    return;
+
+  if (records->len == 0)
+    g_hash_table_remove (index, key);
+}
+
+static ChannelRecord *
+index_lookup (GHashTable    *index,
+              gconstpointer  key)
+{
+  GPtrArray *records = g_hash_table_lookup (index, key);
+  ChannelRecord *first = NULL;
+
+  if (records == NULL)
+    return NULL;
+
+  for (guint i = 0; i < records->len; i++)
+    {
+      ChannelRecord *record = g_ptr_array_index (records, i);
+
+      if (first == NULL || compare_records (record, first) < 0)
+        first = record;
+    }
+
+  return first;
+}
+
+static void
+index_record (HdhomerunChannelStore *self,
+              ChannelRecord         *record)
+{
+  const char *name = record_program (record)->name;
+
+  if (record_program (record)->virtual_major > 0)
+    index_add (self->by_virtual, GUINT_TO_POINTER (record->virtual_key), NULL, record);
+
+  if (name != NULL && *name)
+    index_add (self->by_callsign, g_utf8_casefold (name, -1), g_free, record);
+}
+
+static void
+unindex_record (HdhomerunChannelStore *self,
+                ChannelRecord         *record)
+{
+  const char *name = record_program (record)->name;
+
+  index_remove (self->by_virtual, GUINT_TO_POINTER (record->virtual_key), record);
+
+  if (name != NULL && *name)
+    {
+      g_autofree char *key = g_utf8_casefold (name, -1);
+
+      index_remove (self->by_callsign, key, record);
+    }
+}
+
+static void
+remove_result (HdhomerunChannelStore *self,
+               HdhomerunScanResult   *result)
+{
+  for (guint i = 0; i < result->n_programs; i++)
+    {
+      ChannelRecord key = { .result = result, .program_index = i };
+      const HdhomerunScanProgram *program = &result->programs[i];
+      guint position;
+      ChannelRecord *record;
+
+      key.virtual_key = (guint32) program->virtual_major << 16 | program->virtual_minor;
+      position = find_position (self, &key);
+      if (position >= self->records->len)
+        continue;
+
+      record = g_ptr_array_index (self->records, position);
+      if (compare_records (record, &key) != 0)
+        continue;
+
+      unindex_record (self, record);
+      g_ptr_array_remove_index (self->records, position);
+      g_list_model_items_changed (G_LIST_MODEL (self), position, 1, 0);
+    }
+}
+
+/**
+ * hdhomerun_channel_store_set_result:
+ * @self: a #HdhomerunChannelStore
+ * @result: a freshly scanned frequency
+ *
+ * Replace the programs of the frequency of @result with those it found.
+ * A result without a lock just removes them. Only the rows that were
+ * actually added or removed emit #GListModel::items-changed.
+ */
+void
+hdhomerun_channel_store_set_result (HdhomerunChannelStore *self,
+                                    HdhomerunScanResult   *result)
+{
+  HdhomerunScanResult *old;
+
+  g_return_if_fail (HDHOMERUN_IS_CHANNEL_STORE (self));
+  g_return_if_fail (result != NULL);
+
+  old = g_hash_table_lookup (self->by_frequency, GUINT_TO_POINTER (result->frequency));
+  if (old == result)
+    return;
+
+  if (old != NULL)
+    {
+      remove_result (self, old);
+      g_hash_table_remove (self->by_frequency, GUINT_TO_POINTER (result->frequency));
+    }
+
+  if (!result->locked || result->n_programs == 0)
+    return;
+
+  g_hash_table_insert (self->by_frequency, GUINT_TO_POINTER (result->frequency),
+                       hdhomerun_scan_result_ref (result));
+
+  for (guint i = 0; i < result->n_programs; i++)
+    {
+      ChannelRecord *record = channel_record_new (result, i);
+      guint position = find_position (self, record);
+
+      g_ptr_array_insert (self->records, position, record);
+      index_record (self, record);
+      g_list_model_items_changed (G_LIST_MODEL (self), position, 0, 1);
+    }
+}
+
+/**
+ * hdhomerun_channel_store_set_results:
+ * @self: a #HdhomerunChannelStore
+ * @results: (element-type HdhomerunScanResult): results to show
+ *
+ * Replace the whole store, such as with the cached results of another
+ * device. The list is rebuilt and sorted once, with a single
+ * #GListModel::items-changed.
+ */
+void
+hdhomerun_channel_store_set_results (HdhomerunChannelStore *self,
+                                     GPtrArray             *results)
+{
+  guint removed;
+
+  g_return_if_fail (HDHOMERUN_IS_CHANNEL_STORE (self));
+  g_return_if_fail (results != NULL);
+
+  removed = self->records->len;
+  g_ptr_array_set_size (self->records, 0);
+  g_hash_table_remove_all (self->by_frequency);
+  g_hash_table_remove_all (self->by_virtual);
+  g_hash_table_remove_all (self->by_callsign);
+
+  for (guint i = 0; i < results->len; i++)
+    {
+      HdhomerunScanResult *result = g_ptr_array_index (results, i);
+
+      if (!result->locked || result->n_programs == 0)
+        continue;
+
+      g_hash_table_replace (self->by_frequency, GUINT_TO_POINTER (result->frequency),
+                            hdhomerun_scan_result_ref (result));
+
+      for (guint j = 0; j < result->n_programs; j++)
+        g_ptr_array_add (self->records, channel_record_new (result, j));
+    }
+
+  g_ptr_array_sort (self->records, compare_records_indirect);
+
+  for (guint i = 0; i < self->records->len; i++)
+    index_record (self, g_ptr_array_index (self->records, i));
+
+  g_list_model_items_changed (G_LIST_MODEL (self), 0, removed, self->records->len);
+}
+
+/**
+ * hdhomerun_channel_store_find:
+ * @self: a #HdhomerunChannelStore
+ * @query: a virtual channel ("7.1" or "7-1"), a frequency in Hz or MHz,
+ *   or a callsign
+ *
+ * Look @query up in the indexes.
+ *
+ * Returns: the position of the matching channel, or %G_MAXUINT
+ */
+guint
+hdhomerun_channel_store_find (HdhomerunChannelStore *self,
+                              const char            *query)
+{
+  g_autofree char *text = NULL;
+  g_autofree char *key = NULL;
+  ChannelRecord *record;
+  char *end;
+  guint64 major;
+  double value;
+
+  g_return_val_if_fail (HDHOMERUN_IS_CHANNEL_STORE (self), G_MAXUINT);
+  g_return_val_if_fail (query != NULL, G_MAXUINT);
+
+  text = g_strstrip (g_strdup (query));
+
+  major = g_ascii_strtoull (text, &end, 10);
+  if (end == text)
+    goto callsign;
+
+  if ((*end == '.' || *end == '-') && major <= G_MAXUINT16)
+    {
+      const char *minor_str = end + 1;
+      guint64 minor = g_ascii_strtoull (minor_str, &end, 10);
+
+      if (end != minor_str && *end == '\0' && minor <= G_MAXUINT16)
+        {
+          record = index_lookup (self->by_virtual, GUINT_TO_POINTER (major << 16 | minor));
+          if (record != NULL)
+            return find_position (self, record);
+        }
+    }
+
+  /* Not a virtual channel, so maybe a frequency */
+  value = g_ascii_strtod (text, &end);
+  if (*end == '\0')
+    {
+      /* Small values are taken to be MHz */
+      double hz = value < 1e6 ? value * 1e6 + 0.5 : value;
+      HdhomerunScanResult *result;
+
+      /* Also false for NaN */
+      if (!(hz >= 0 && hz <= G_MAXUINT32))
+        return G_MAXUINT;
+
+      result = g_hash_table_lookup (self->by_frequency, GUINT_TO_POINTER ((guint32) hz));
+      if (result != NULL)
+        {
+          ChannelRecord first = { .result = result, .program_index = 0 };
+
+          first.virtual_key = (guint32) result->programs[0].virtual_major << 16 |
+                              result->programs[0].virtual_minor;
+          return find_position (self, &first);
+        }
+
+      return G_MAXUINT;
+    }
+
+callsign:
+  key = g_utf8_casefold (text, -1);
+  record = index_lookup (self->by_callsign, key);
+
+  return record != NULL ? find_position (self, record) : G_MAXUINT;
+}
+
+/**
+ * hdhomerun_channel_store_lookup:
+ * @self: a #HdhomerunChannelStore
+ * @frequency: a frequency in Hz
+ *
+ * Returns: (transfer none) (nullable): the result shown for @frequency
+ */
+HdhomerunScanResult *
+hdhomerun_channel_store_lookup (HdhomerunChannelStore *self,
+                                guint32                frequency)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_CHANNEL_STORE (self), NULL);
+
+  return g_hash_table_lookup (self->by_frequency, GUINT_TO_POINTER (frequency));
+}
+
+HdhomerunChannelStore *
+hdhomerun_channel_store_new (void)
+{
+  return g_object_new (HDHOMERUN_TYPE_CHANNEL_STORE, NULL);
+}
+
+static void
+hdhomerun_channel_store_finalize (GObject *object)
+{
+  HdhomerunChannelStore *self = (HdhomerunChannelStore *)object;
+
+  g_clear_pointer (&self->by_virtual, g_hash_table_unref);
+  g_clear_pointer (&self->by_callsign, g_hash_table_unref);
+  g_clear_pointer (&self->records, g_ptr_array_unref);
+  g_clear_pointer (&self->by_frequency, g_hash_table_unref);
+
+  G_OBJECT_CLASS (hdhomerun_channel_store_parent_class)->finalize (object);
+}
+
+static void
+hdhomerun_channel_store_class_init (HdhomerunChannelStoreClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = hdhomerun_channel_store_finalize;
+}
+
+static void
+hdhomerun_channel_store_init (HdhomerunChannelStore *self)
+{
+  self->records = g_ptr_array_new_with_free_func ((GDestroyNotify) channel_record_free);
+  self->by_frequency = g_hash_table_new_full (NULL, NULL, NULL,
+                                              (GDestroyNotify) hdhomerun_scan_result_unref);
+  self->by_virtual = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) g_ptr_array_unref);
+  self->by_callsign = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                             g_free, (GDestroyNotify) g_ptr_array_unref);
+}
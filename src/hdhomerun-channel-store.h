@@ -0,0 +1,41 @@
+/* hdhomerun-channel-store.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "hdhomerun-channel-scan.h"
+
+G_BEGIN_DECLS
+
+#define HDHOMERUN_TYPE_CHANNEL_STORE (hdhomerun_channel_store_get_type())
+
+G_DECLARE_FINAL_TYPE (HdhomerunChannelStore, hdhomerun_channel_store, HDHOMERUN, CHANNEL_STORE, GObject)
+
+HdhomerunChannelStore *hdhomerun_channel_store_new         (void);
+void                   hdhomerun_channel_store_set_result  (HdhomerunChannelStore *self,
+                                                            HdhomerunScanResult   *result);
+void                   hdhomerun_channel_store_set_results (HdhomerunChannelStore *self,
+                                                            GPtrArray             *results);
+guint                  hdhomerun_channel_store_find        (HdhomerunChannelStore *self,
+                                                            const char            *query);
+HdhomerunScanResult   *hdhomerun_channel_store_lookup      (HdhomerunChannelStore *self,
+                                                            guint32                frequency);
+
+G_END_DECLS
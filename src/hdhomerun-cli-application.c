@@ -0,0 +1,1122 @@
+/* hdhomerun-cli-application.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-config-gtk-config.h"
+#include "hdhomerun-cli-application.h"
+#include "hdhomerun-backend.h"
+#include "hdhomerun-channel-scan.h"
+#include "hdhomerun-connection-pool.h"
+#include "hdhomerun-discovery.h"
+#include "hdhomerun-scan-cache.h"
+#include "hdhomerun-tuner.h"
+#include "hdhomerun-tuner-item.h"
+
+#include <glib-unix.h>
+#include <glib/gi18n.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* HdhomerunCliApplication drives the discovery, status, scan and tune
+ * engines without any UI, for scripting many devices at once.
+ *
+ * A command given on the command line runs in-process and prints its
+ * result, as text or with --json as JSON, so nothing but GIO and
+ * libhdhomerun is ever loaded. With --service the application instead
+ * stays on the session bus and offers the same commands as methods of
+ * ENGINE_INTERFACE, each returning the JSON a --json run would print.
+ * A long-running service keeps its pooled control connections open, so
+ * repeated calls skip connection setup. Scans take minutes, so callers
+ * should pass a long timeout for Scan().
+ */
+
+#define ENGINE_INTERFACE        "com.github.andrewstclair.HDHomeRunConfig.Engine"
+#define INACTIVITY_TIMEOUT_MS   60000
+
+#define EXIT_INCOMPLETE         1  /* Ran, but did not lock or was interrupted */
+#define EXIT_USAGE              2
+
+static const char engine_introspection[] =
+  "<node>"
+  "  <interface name='" ENGINE_INTERFACE "'>"
+  "    <method name='Discover'>"
+  "      <arg type='s' name='json' direction='out'/>"
+  "    </method>"
+  "    <method name='GetStatus'>"
+  "      <arg type='s' name='device' direction='in'/>"
+  "      <arg type='u' name='tuner' direction='in'/>"
+  "      <arg type='s' name='json' direction='out'/>"
+  "    </method>"
+  "    <method name='Scan'>"
+  "      <arg type='s' name='device' direction='in'/>"
+  "      <arg type='s' name='json' direction='out'/>"
+  "    </method>"
+  "    <method name='Tune'>"
+  "      <arg type='s' name='device' direction='in'/>"
+  "      <arg type='u' name='tuner' direction='in'/>"
+  "      <arg type='u' name='frequency' direction='in'/>"
+  "      <arg type='u' name='program' direction='in'/>"
+  "      <arg type='s' name='json' direction='out'/>"
+  "    </method>"
+  "  </interface>"
+  "</node>";
+
+typedef enum
+{
+  COMMAND_DISCOVER,
+  COMMAND_STATUS,
+  COMMAND_SCAN,
+  COMMAND_TUNE,
+} CommandKind;
+
+typedef struct
+{
+  guint tuner_index;
+  HdhomerunTunerStatus status;
+} TunerStatusEntry;
+
+typedef struct
+{
+  CommandKind kind;
+  char *device;                 /* Device ID or address */
+  int tuner;                    /* -1 for every tuner */
+  guint32 frequency;
+  guint program;
+  char **targets;
+  gboolean json;
+
+  /* Filled in as the command runs */
+  HdhomerunDeviceInfo *info;
+  GPtrArray *devices;           /* HdhomerunDeviceInfo */
+  GArray *statuses;             /* TunerStatusEntry */
+  HdhomerunChannelScan *scan;
+  GPtrArray *results;           /* HdhomerunScanResult */
+  GError *scan_error;
+  HdhomerunTuner *tuner_object;
+  gulong tuned_id;
+  guint signal_strength;
+  guint signal_quality;
+  guint symbol_quality;
+} Command;
+
+struct _HdhomerunCliApplication
+{
+  GApplication parent_instance;
+
+  guint registration_id;
+};
+
+G_DEFINE_FINAL_TYPE (HdhomerunCliApplication, hdhomerun_cli_application, G_TYPE_APPLICATION)
+
+static Command *
+command_new (CommandKind kind)
+{
+  Command *command = g_new0 (Command, 1);
+
+  command->kind = kind;
+  command->tuner = -1;
+
+  return command;
+}
+
+static void
+command_free (Command *command)
+{
+  if (command->tuner_object != NULL)
+    g_clear_signal_handler (&command->tuned_id, command->tuner_object);
+  g_clear_object (&command->tuner_object);
+  g_clear_object (&command->scan);
+  g_clear_pointer (&command->results, g_ptr_array_unref);
+  g_clear_error (&command->scan_error);
+  g_clear_pointer (&command->statuses, g_array_unref);
+  g_clear_pointer (&command->devices, g_ptr_array_unref);
+  g_clear_pointer (&command->info, hdhomerun_device_info_unref);
+  g_strfreev (command->targets);
+  g_free (command->device);
+  g_free (command);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (Command, command_free)
+
+/* Output */
+
+static void
+json_append_string (GString    *json,
+                    const char *value)
+{
+  if (value == NULL)
+    {
+      g_string_append (json, "null");
+      return;
+    }
+
+  g_string_append_c (json, '"');
+  for (const char *p = value; *p != '\0'; p++)
+    {
+      guchar c = *p;
+
+      switch (c)
+        {
+        case '"':
+          g_string_append (json, "\\\"");
+          break;
+        case '\\':
+          g_string_append (json, "\\\\");
+          break;
+        case '\n':
+          g_string_append (json, "\\n");
+          break;
+        case '\t':
+          g_string_append (json, "\\t");
+          break;
+        default:
+          if (c < 0x20)
+            g_string_append_printf (json, "\\u%04x", c);
+          else
+            g_string_append_c (json, c);
+        }
+    }
+  g_string_append_c (json, '"');
+}
+
+static const char *
+tune_state_nick (HdhomerunTuneState state)
+{
+  GEnumClass *klass = g_type_class_ref (HDHOMERUN_TYPE_TUNE_STATE);
+  GEnumValue *value = g_enum_get_value (klass, state);
+  const char *nick = value != NULL ? value->value_nick : "unknown";
+
+  /* The nicks are static, so they outlive the class reference */
+  g_type_class_unref (klass);
+
+  return nick;
+}
+
+static void
+format_discover (Command *command,
+                 GString *out)
+{
+  if (command->json)
+    g_string_append_c (out, '[');
+
+  for (guint i = 0; i < command->devices->len; i++)
+    {
+      HdhomerunDeviceInfo *info = g_ptr_array_index (command->devices, i);
+
+      if (!command->json)
+        {
+          g_autofree char *addresses = g_strjoinv (", ", info->ip_addresses);
+
+          g_string_append_printf (out, "%s  %s  %u tuner(s)  %s\n",
+                                  info->device_id_str,
+                                  info->model ? info->model : "unknown model",
+                                  info->tuner_count, addresses);
+          continue;
+        }
+
+      if (i > 0)
+        g_string_append_c (out, ',');
+      g_string_append (out, "{\"device_id\":");
+      json_append_string (out, info->device_id_str);
+      g_string_append (out, ",\"model\":");
+      json_append_string (out, info->model);
+      g_string_append_printf (out, ",\"tuner_count\":%u,\"control_address\":", info->tuner_count);
+      json_append_string (out, info->control_address);
+      g_string_append (out, ",\"addresses\":[");
+      for (guint j = 0; info->ip_addresses[j] != NULL; j++)
+        {
+          if (j > 0)
+            g_string_append_c (out, ',');
+          json_append_string (out, info->ip_addresses[j]);
+        }
+      g_string_append (out, "]}");
+    }
+
+  if (command->json)
+    g_string_append (out, "]\n");
+}
+
+static void
+format_status (Command *command,
+               GString *out)
+{
+  if (command->json)
+    {
+      g_string_append (out, "{\"device_id\":");
+      json_append_string (out, command->info->device_id_str);
+      g_string_append (out, ",\"tuners\":[");
+    }
+
+  for (guint i = 0; i < command->statuses->len; i++)
+    {
+      const TunerStatusEntry *entry = &g_array_index (command->statuses, TunerStatusEntry, i);
+      const HdhomerunTunerStatus *status = &entry->status;
+
+      if (!command->json)
+        {
+          if (!status->valid)
+            g_string_append_printf (out, _("Tuner %u: no status\n"), entry->tuner_index);
+          else if (g_str_equal (status->lock, "none"))
+            g_string_append_printf (out, _("Tuner %u: idle\n"), entry->tuner_index);
+          else
+            g_string_append_printf (out, _("Tuner %u: %s · %u%% signal · %u%% SNR · %u%% symbol · %.1f Mbps\n"),
+                                    entry->tuner_index, status->lock,
+                                    status->signal_strength, status->signal_quality,
+                                    status->symbol_quality, status->bits_per_second / 1e6);
+          continue;
+        }
+
+      if (i > 0)
+        g_string_append_c (out, ',');
+      g_string_append_printf (out, "{\"tuner\":%u,\"lock\":", entry->tuner_index);
+      json_append_string (out, status->valid && !g_str_equal (status->lock, "none") ?
+                               status->lock : NULL);
+      g_string_append_printf (out, ",\"signal_strength\":%u,\"signal_quality\":%u,"
+                                   "\"symbol_quality\":%u,\"bits_per_second\":%u}",
+                              status->signal_strength, status->signal_quality,
+                              status->symbol_quality, status->bits_per_second);
+    }
+
+  if (command->json)
+    g_string_append (out, "]}\n");
+}
+
+static void
+format_scan (Command *command,
+             GString *out)
+{
+  guint n_locked = 0;
+
+  if (command->json)
+    {
+      g_string_append (out, "{\"device_id\":");
+      json_append_string (out, command->info->device_id_str);
+      g_string_append_printf (out, ",\"complete\":%s,\"results\":[",
+                              command->scan_error == NULL ? "true" : "false");
+    }
+
+  for (guint i = 0; i < command->results->len; i++)
+    {
+      HdhomerunScanResult *result = g_ptr_array_index (command->results, i);
+
+      if (!command->json)
+        {
+          if (!result->locked)
+            continue;
+
+          n_locked++;
+          g_string_append_printf (out, "%s  %u Hz  %s  %u%% signal  %u%% SNR\n",
+                                  result->channel, result->frequency,
+                                  result->modulation ? result->modulation : "",
+                                  result->signal_strength, result->signal_quality);
+          for (guint j = 0; j < result->n_programs; j++)
+            {
+              const HdhomerunScanProgram *program = &result->programs[j];
+
+              g_string_append_printf (out, "    %u.%u  %s  (program %u)\n",
+                                      program->virtual_major, program->virtual_minor,
+                                      program->name ? program->name : "",
+                                      program->program_number);
+            }
+          continue;
+        }
+
+      if (i > 0)
+        g_string_append_c (out, ',');
+      g_string_append (out, "{\"channel\":");
+      json_append_string (out, result->channel);
+      g_string_append_printf (out, ",\"frequency\":%u,\"locked\":%s,\"modulation\":",
+                              result->frequency, result->locked ? "true" : "false");
+      json_append_string (out, result->modulation);
+      g_string_append_printf (out, ",\"signal_strength\":%u,\"signal_quality\":%u,\"programs\":[",
+                              result->signal_strength, result->signal_quality);
+      for (guint j = 0; j < result->n_programs; j++)
+        {
+          const HdhomerunScanProgram *program = &result->programs[j];
+
+          if (j > 0)
+            g_string_append_c (out, ',');
+          g_string_append_printf (out, "{\"program_number\":%u,\"virtual_major\":%u,"
+                                       "\"virtual_minor\":%u,\"name\":",
+                                  program->program_number, program->virtual_major,
+                                  program->virtual_minor);
+          json_append_string (out, program->name);
+          g_string_append_c (out, '}');
+        }
+      g_string_append (out, "]}");
+    }
+
+  if (command->json)
+    g_string_append (out, "]}\n");
+  else
+    g_string_append_printf (out, _("%u of %u frequencies locked\n"),
+                            n_locked, command->results->len);
+}
+
+static void
+format_tune (Command *command,
+             GString *out)
+{
+  HdhomerunTuneState state = hdhomerun_tuner_get_state (command->tuner_object);
+
+  if (!command->json)
+    {
+      g_string_append_printf (out, _("Tuner %d of %s: %s on %u Hz · %u%% signal · %u%% SNR · %u%% symbol\n"),
+                              command->tuner, command->info->device_id_str,
+                              tune_state_nick (state), command->frequency,
+                              command->signal_strength, command->signal_quality,
+                              command->symbol_quality);
+      return;
+    }
+
+  g_string_append (out, "{\"device_id\":");
+  json_append_string (out, command->info->device_id_str);
+  g_string_append_printf (out, ",\"tuner\":%d,\"frequency\":%u,\"program\":%u,\"state\":",
+                          command->tuner, command->frequency, command->program);
+  json_append_string (out, tune_state_nick (state));
+  g_string_append_printf (out, ",\"signal_strength\":%u,\"signal_quality\":%u,\"symbol_quality\":%u}\n",
+                          command->signal_strength, command->signal_quality,
+                          command->symbol_quality);
+}
+
+static char *
+format_output (Command *command)
+{
+  GString *out = g_string_new (NULL);
+
+  switch (command->kind)
+    {
+    case COMMAND_DISCOVER:
+      format_discover (command, out);
+      break;
+    case COMMAND_STATUS:
+      format_status (command, out);
+      break;
+    case COMMAND_SCAN:
+      format_scan (command, out);
+      break;
+    case COMMAND_TUNE:
+      format_tune (command, out);
+      break;
+    default:
+      g_assert_not_reached ();
+    }
+
+  return g_string_free (out, FALSE);
+}
+
+/* Running commands */
+
+static void
+status_thread (GTask        *task,
+               gpointer      source_object,
+               gpointer      task_data,
+               GCancellable *cancellable)
+{
+  HdhomerunConnectionPool *pool = hdhomerun_connection_pool_get_default ();
+  Command *command = task_data;
+  HdhomerunConnection *connection;
+  struct hdhomerun_device_t *hd;
+  guint first;
+  guint last;
+
+  (void)source_object; /* unused */
+  (void)cancellable; /* unused */
+
+  first = command->tuner >= 0 ? (guint) command->tuner : 0;
+  last = command->tuner >= 0 ? (guint) command->tuner : command->info->tuner_count - 1;
+
+  connection = hdhomerun_connection_pool_acquire (pool, command->info->device_id_str, first,
+                                                  command->info->control_address);
+  hd = hdhomerun_connection_lock (connection);
+  if (hd == NULL)
+    {
+      hdhomerun_connection_pool_release (pool, connection);
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_CONNECTED,
+                               _("Could not reach device %s"), command->info->device_id_str);
+      return;
+    }
+
+  /* One connection for the whole device, as the status poller does */
+  command->statuses = g_array_new (FALSE, TRUE, sizeof (TunerStatusEntry));
+  for (guint i = first; i <= last; i++)
+    {
+      TunerStatusEntry entry = { .tuner_index = i };
+      char path[32];
+      char *value = NULL;
+      char *error = NULL;
+
+      g_snprintf (path, sizeof path, "/tuner%u/status", i);
+      if (hdhomerun_backend_get_default ()->device_get_var (hd, path, &value, &error) > 0 && error == NULL && value != NULL)
+        hdhomerun_tuner_status_parse (value, &entry.status);
+      g_array_append_val (command->statuses, entry);
+    }
+
+  hdhomerun_connection_unlock (connection);
+  hdhomerun_connection_pool_release (pool, connection);
+
+  g_task_return_pointer (task, format_output (command), g_free);
+}
+
+static void
+finish_scan (GTask *task)
+{
+  Command *command = g_task_get_task_data (task);
+
+  if (command->scan_error != NULL &&
+      !g_error_matches (command->scan_error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    g_task_return_error (task, g_error_copy (command->scan_error));
+  else
+    g_task_return_pointer (task, format_output (command), g_free);
+}
+
+static void
+on_scan_saved (GObject      *source,
+               GAsyncResult *result,
+               gpointer      user_data)
+{
+  g_autoptr(GTask) task = user_data;
+  g_autoptr(GError) error = NULL;
+
+  (void)source; /* unused */
+
+  if (!hdhomerun_scan_cache_save_finish (result, &error))
+    g_warning ("Failed to save scan results: %s", error->message);
+
+  finish_scan (task);
+}
+
+static void
+on_scan_finished (GObject      *source,
+                  GAsyncResult *result,
+                  gpointer      user_data)
+{
+  g_autoptr(GTask) task = user_data;
+  Command *command = g_task_get_task_data (task);
+
+  hdhomerun_channel_scan_run_finish (HDHOMERUN_CHANNEL_SCAN (source), result,
+                                     &command->scan_error);
+
+  /* Saved even when interrupted, so the next scan resumes, also the one
+   * the window runs
+   */
+  command->results = hdhomerun_channel_scan_get_results (command->scan);
+  if (command->results->len == 0)
+    {
+      finish_scan (task);
+      return;
+    }
+
+  hdhomerun_scan_cache_save_async (command->info->device_id_str, command->results,
+                                   NULL, on_scan_saved, g_steal_pointer (&task));
+}
+
+static void
+start_scan (GTask *task)
+{
+  HdhomerunConnectionPool *pool = hdhomerun_connection_pool_get_default ();
+  Command *command = g_task_get_task_data (task);
+  g_autoptr(GPtrArray) known = NULL;
+  g_autoptr(GError) error = NULL;
+
+  command->scan = hdhomerun_channel_scan_new ();
+  for (guint i = 0; i < command->info->tuner_count; i++)
+    {
+      HdhomerunConnection *connection;
+
+      connection = hdhomerun_connection_pool_acquire (pool, command->info->device_id_str, i,
+                                                      command->info->control_address);
+      hdhomerun_channel_scan_add_tuner (command->scan, connection);
+      hdhomerun_connection_pool_release (pool, connection);
+    }
+
+  known = hdhomerun_scan_cache_load (command->info->device_id_str, &error);
+  if (known != NULL)
+    hdhomerun_channel_scan_add_known_results (command->scan, known);
+  else if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+    g_message ("Ignoring scan cache: %s", error->message);
+
+  hdhomerun_channel_scan_run_async (command->scan, g_task_get_cancellable (task),
+                                    on_scan_finished, g_object_ref (task));
+}
+
+static void
+on_tuned (HdhomerunTuner *tuner,
+          guint           frequency,
+          guint           signal_strength,
+          guint           signal_quality,
+          guint           symbol_quality,
+          gpointer        user_data)
+{
+  g_autoptr(GTask) task = user_data;
+  Command *command = g_task_get_task_data (task);
+
+  (void)frequency; /* unused */
+
+  g_clear_signal_handler (&command->tuned_id, tuner);
+  command->signal_strength = signal_strength;
+  command->signal_quality = signal_quality;
+  command->symbol_quality = symbol_quality;
+
+  g_task_return_pointer (task, format_output (command), g_free);
+}
+
+static void
+start_tune (GTask *task)
+{
+  HdhomerunConnectionPool *pool = hdhomerun_connection_pool_get_default ();
+  Command *command = g_task_get_task_data (task);
+  HdhomerunConnection *connection;
+
+  connection = hdhomerun_connection_pool_acquire (pool, command->info->device_id_str,
+                                                  (guint) command->tuner,
+                                                  command->info->control_address);
+  command->tuner_object = hdhomerun_tuner_new (connection);
+  hdhomerun_connection_pool_release (pool, connection);
+
+  /* The handler owns the task reference until the tuner reports back */
+  command->tuned_id = g_signal_connect (command->tuner_object, "tuned",
+                                        G_CALLBACK (on_tuned), g_object_ref (task));
+  hdhomerun_tuner_tune (command->tuner_object, command->frequency, command->program);
+}
+
+static HdhomerunDeviceInfo *
+find_device (GPtrArray  *devices,
+             const char *device)
+{
+  for (guint i = 0; i < devices->len; i++)
+    {
+      HdhomerunDeviceInfo *info = g_ptr_array_index (devices, i);
+
+      if (g_ascii_strcasecmp (info->device_id_str, device) == 0 ||
+          g_strv_contains ((const char * const *) info->ip_addresses, device))
+        return info;
+    }
+
+  return NULL;
+}
+
+static void
+on_discovered (GObject      *source,
+               GAsyncResult *result,
+               gpointer      user_data)
+{
+  g_autoptr(GTask) task = user_data;
+  Command *command = g_task_get_task_data (task);
+  HdhomerunDeviceInfo *info;
+  GError *error = NULL;
+
+  (void)source; /* unused */
+
+  command->devices = hdhomerun_discovery_find_devices_finish (result, &error);
+  if (command->devices == NULL)
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  if (command->kind == COMMAND_DISCOVER)
+    {
+      g_task_return_pointer (task, format_output (command), g_free);
+      return;
+    }
+
+  info = find_device (command->devices, command->device);
+  if (info == NULL || info->control_address == NULL)
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+                               _("No device %s found"), command->device);
+      return;
+    }
+
+  if (info->tuner_count == 0)
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                               _("Device %s has no tuners"), info->device_id_str);
+      return;
+    }
+
+  if (command->tuner >= 0 && (guint) command->tuner >= info->tuner_count)
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                               _("Device %s has no tuner %d"), info->device_id_str, command->tuner);
+      return;
+    }
+
+  command->info = hdhomerun_device_info_ref (info);
+
+  switch (command->kind)
+    {
+    case COMMAND_STATUS:
+      g_task_run_in_thread (task, status_thread);
+      break;
+    case COMMAND_SCAN:
+      start_scan (task);
+      break;
+    case COMMAND_TUNE:
+      start_tune (task);
+      break;
+    case COMMAND_DISCOVER:
+    default:
+      g_assert_not_reached ();
+    }
+}
+
+/* Every command starts with a discovery pass, which is also how a device
+ * given by ID is found. A device given by address is probed directly, so
+ * it is found even when broadcasts do not reach it.
+ */
+static void
+command_run_async (Command             *command,
+                   GCancellable        *cancellable,
+                   GAsyncReadyCallback  callback,
+                   gpointer             user_data)
+{
+  g_autoptr(GStrvBuilder) builder = g_strv_builder_new ();
+  g_auto(GStrv) targets = NULL;
+  GTask *task;
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_source_tag (task, command_run_async);
+  g_task_set_task_data (task, command, (GDestroyNotify) command_free);
+
+  if (command->targets != NULL)
+    g_strv_builder_addv (builder, (const char **) command->targets);
+  if (command->device != NULL && g_hostname_is_ip_address (command->device))
+    g_strv_builder_add (builder, command->device);
+  targets = g_strv_builder_end (builder);
+
+  hdhomerun_discovery_find_devices_async ((const char * const *) targets, cancellable,
+                                          on_discovered, task);
+}
+
+/* @complete is FALSE when a tune did not lock or a scan was interrupted */
+static char *
+command_run_finish (GAsyncResult  *result,
+                    gboolean      *complete,
+                    GError       **error)
+{
+  Command *command;
+  char *output;
+
+  g_return_val_if_fail (g_task_is_valid (result, NULL), NULL);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) == command_run_async, NULL);
+
+  output = g_task_propagate_pointer (G_TASK (result), error);
+  if (output == NULL)
+    return NULL;
+
+  command = g_task_get_task_data (G_TASK (result));
+  if (complete != NULL)
+    *complete = command->scan_error == NULL &&
+                (command->tuner_object == NULL ||
+                 hdhomerun_tuner_get_state (command->tuner_object) == HDHOMERUN_TUNE_STATE_LOCKED);
+
+  return output;
+}
+
+/* Command line */
+
+typedef struct
+{
+  GMainLoop *loop;
+  int exit_status;
+} LocalRun;
+
+static gboolean
+on_interrupt (gpointer user_data)
+{
+  GCancellable *cancellable = user_data;
+
+  /* A scan stops after the frequencies in flight and still reports */
+  g_cancellable_cancel (cancellable);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+on_local_finished (GObject      *source,
+                   GAsyncResult *result,
+                   gpointer      user_data)
+{
+  LocalRun *run = user_data;
+  g_autofree char *output = NULL;
+  g_autoptr(GError) error = NULL;
+  gboolean complete = FALSE;
+
+  (void)source; /* unused */
+
+  output = command_run_finish (result, &complete, &error);
+  if (output == NULL)
+    {
+      g_printerr ("%s\n", error->message);
+      run->exit_status = EXIT_FAILURE;
+    }
+  else
+    {
+      g_print ("%s", output);
+      run->exit_status = complete ? EXIT_SUCCESS : EXIT_INCOMPLETE;
+    }
+
+  g_main_loop_quit (run->loop);
+}
+
+static gboolean
+parse_frequency (const char  *text,
+                 guint32     *frequency,
+                 GError     **error)
+{
+  if (hdhomerun_tuner_parse_frequency (text, frequency))
+    return TRUE;
+
+  g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+               _("Invalid frequency “%s”"), text);
+  return FALSE;
+}
+
+static Command *
+command_from_options (GVariantDict  *options,
+                      GError       **error)
+{
+  g_autoptr(Command) command = NULL;
+  const char *status = NULL;
+  const char *scan = NULL;
+  const char *tune = NULL;
+  const char *frequency = NULL;
+  gboolean discover = FALSE;
+  guint n_commands;
+  int tuner;
+  int program;
+
+  g_variant_dict_lookup (options, "discover", "b", &discover);
+  g_variant_dict_lookup (options, "status", "&s", &status);
+  g_variant_dict_lookup (options, "scan", "&s", &scan);
+  g_variant_dict_lookup (options, "tune", "&s", &tune);
+
+  n_commands = !!discover + (status != NULL) + (scan != NULL) + (tune != NULL);
+  if (n_commands != 1)
+    {
+      g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+                   _("Give exactly one of --discover, --status, --scan or --tune"));
+      return NULL;
+    }
+
+  if (discover)
+    {
+      command = command_new (COMMAND_DISCOVER);
+    }
+  else if (status != NULL)
+    {
+      command = command_new (COMMAND_STATUS);
+      command->device = g_strdup (status);
+    }
+  else if (scan != NULL)
+    {
+      command = command_new (COMMAND_SCAN);
+      command->device = g_strdup (scan);
+    }
+  else
+    {
+      command = command_new (COMMAND_TUNE);
+      command->device = g_strdup (tune);
+      command->tuner = 0;
+
+      if (!g_variant_dict_lookup (options, "frequency", "&s", &frequency))
+        {
+          g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_FAILED,
+                       _("--tune needs a --frequency"));
+          return NULL;
+        }
+      if (!parse_frequency (frequency, &command->frequency, error))
+        return NULL;
+
+      if (g_variant_dict_lookup (options, "program", "i", &program))
+        {
+          if (program < 0)
+            {
+              g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+                           _("Invalid program %d"), program);
+              return NULL;
+            }
+          command->program = (guint) program;
+        }
+    }
+
+  if (g_variant_dict_lookup (options, "tuner", "i", &tuner))
+    {
+      if (tuner < 0 || command->kind == COMMAND_DISCOVER || command->kind == COMMAND_SCAN)
+        {
+          g_set_error (error, G_OPTION_ERROR, G_OPTION_ERROR_BAD_VALUE,
+                       _("--tuner only applies to --status and --tune"));
+          return NULL;
+        }
+      command->tuner = tuner;
+    }
+
+  g_variant_dict_lookup (options, "target", "^as", &command->targets);
+  g_variant_dict_lookup (options, "json", "b", &command->json);
+
+  return g_steal_pointer (&command);
+}
+
+static int
+hdhomerun_cli_application_handle_local_options (GApplication *app,
+                                                GVariantDict *options)
+{
+  g_autoptr(GCancellable) cancellable = NULL;
+  g_autoptr(GError) error = NULL;
+  Command *command;
+  LocalRun run;
+  guint sigint_id;
+
+  if (g_variant_dict_contains (options, "service"))
+    {
+      if (g_variant_dict_contains (options, "discover") ||
+          g_variant_dict_contains (options, "status") ||
+          g_variant_dict_contains (options, "scan") ||
+          g_variant_dict_contains (options, "tune"))
+        {
+          g_printerr (_("--service cannot be combined with a command\n"));
+          return EXIT_USAGE;
+        }
+
+      g_application_set_flags (app, g_application_get_flags (app) | G_APPLICATION_IS_SERVICE);
+      return -1;
+    }
+
+  command = command_from_options (options, &error);
+  if (command == NULL)
+    {
+      g_printerr ("%s\n", error->message);
+      return EXIT_USAGE;
+    }
+
+  /* Run right here; the application never registers on the bus */
+  cancellable = g_cancellable_new ();
+  sigint_id = g_unix_signal_add (SIGINT, on_interrupt, cancellable);
+
+  run.loop = g_main_loop_new (NULL, FALSE);
+  run.exit_status = EXIT_FAILURE;
+  command_run_async (command, cancellable, on_local_finished, &run);
+  g_main_loop_run (run.loop);
+
+  g_source_remove (sigint_id);
+  g_main_loop_unref (run.loop);
+
+  return run.exit_status;
+}
+
+/* D-Bus */
+
+static void
+on_method_finished (GObject      *source,
+                    GAsyncResult *result,
+                    gpointer      user_data)
+{
+  g_autoptr(GDBusMethodInvocation) invocation = user_data;
+  g_autofree char *output = NULL;
+  GError *error = NULL;
+
+  (void)source; /* unused */
+
+  output = command_run_finish (result, NULL, &error);
+  if (output == NULL)
+    g_dbus_method_invocation_take_error (g_steal_pointer (&invocation), error);
+  else
+    g_dbus_method_invocation_return_value (g_steal_pointer (&invocation),
+                                           g_variant_new ("(s)", output));
+
+  g_application_release (g_application_get_default ());
+}
+
+static void
+handle_method_call (GDBusConnection       *connection,
+                    const char            *sender,
+                    const char            *object_path,
+                    const char            *interface_name,
+                    const char            *method_name,
+                    GVariant              *parameters,
+                    GDBusMethodInvocation *invocation,
+                    gpointer               user_data)
+{
+  HdhomerunCliApplication *self = user_data;
+  Command *command;
+
+  (void)connection; /* unused */
+  (void)sender; /* unused */
+  (void)object_path; /* unused */
+  (void)interface_name; /* unused */
+
+  if (g_str_equal (method_name, "Discover"))
+    {
+      command = command_new (COMMAND_DISCOVER);
+    }
+  else if (g_str_equal (method_name, "GetStatus"))
+    {
+      guint tuner;
+
+      /* G_MAXUINT32 asks for every tuner, like leaving out --tuner */
+      command = command_new (COMMAND_STATUS);
+      g_variant_get (parameters, "(su)", &command->device, &tuner);
+      command->tuner = tuner == G_MAXUINT32 ? -1 : (int) MIN (tuner, G_MAXINT);
+    }
+  else if (g_str_equal (method_name, "Scan"))
+    {
+      command = command_new (COMMAND_SCAN);
+      g_variant_get (parameters, "(s)", &command->device);
+    }
+  else if (g_str_equal (method_name, "Tune"))
+    {
+      guint tuner;
+
+      command = command_new (COMMAND_TUNE);
+      g_variant_get (parameters, "(suuu)", &command->device, &tuner,
+                     &command->frequency, &command->program);
+      command->tuner = (int) MIN (tuner, G_MAXINT);
+    }
+  else
+    {
+      g_dbus_method_invocation_return_error (invocation, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD,
+                                             "Unknown method %s", method_name);
+      return;
+    }
+
+  command->json = TRUE;
+
+  /* Stay up until every call has been answered */
+  g_application_hold (G_APPLICATION (self));
+  command_run_async (command, NULL, on_method_finished, invocation);
+}
+
+static const GDBusInterfaceVTable engine_vtable = {
+  .method_call = handle_method_call,
+};
+
+static GDBusInterfaceInfo *
+get_engine_interface (void)
+{
+  static GDBusNodeInfo *node;
+  static gsize initialized;
+
+  if (g_once_init_enter (&initialized))
+    {
+      node = g_dbus_node_info_new_for_xml (engine_introspection, NULL);
+      g_once_init_leave (&initialized, 1);
+    }
+
+  return node->interfaces[0];
+}
+
+static gboolean
+hdhomerun_cli_application_dbus_register (GApplication     *app,
+                                         GDBusConnection  *connection,
+                                         const char       *object_path,
+                                         GError          **error)
+{
+  HdhomerunCliApplication *self = HDHOMERUN_CLI_APPLICATION (app);
+
+  if (!G_APPLICATION_CLASS (hdhomerun_cli_application_parent_class)->dbus_register (app, connection,
+                                                                                  object_path, error))
+    return FALSE;
+
+  self->registration_id = g_dbus_connection_register_object (connection, object_path,
+                                                             get_engine_interface (),
+                                                             &engine_vtable, self, NULL,
+                                                             error);
+
+  return self->registration_id != 0;
+}
+
+static void
+hdhomerun_cli_application_dbus_unregister (GApplication    *app,
+                                           GDBusConnection *connection,
+                                           const char      *object_path)
+{
+  HdhomerunCliApplication *self = HDHOMERUN_CLI_APPLICATION (app);
+
+  if (self->registration_id != 0)
+    {
+      g_dbus_connection_unregister_object (connection, self->registration_id);
+      self->registration_id = 0;
+    }
+
+  G_APPLICATION_CLASS (hdhomerun_cli_application_parent_class)->dbus_unregister (app, connection,
+                                                                               object_path);
+}
+
+static void
+hdhomerun_cli_application_activate (GApplication *app)
+{
+  /* A service has nothing to show; calls arrive over D-Bus */
+  (void)app; /* unused */
+}
+
+HdhomerunCliApplication *
+hdhomerun_cli_application_new (const char *application_id)
+{
+  g_return_val_if_fail (application_id != NULL, NULL);
+
+  return g_object_new (HDHOMERUN_TYPE_CLI_APPLICATION,
+                       "application-id", application_id,
+                       "flags", G_APPLICATION_DEFAULT_FLAGS,
+                       NULL);
+}
+
+static void
+hdhomerun_cli_application_class_init (HdhomerunCliApplicationClass *klass)
+{
+  GApplicationClass *app_class = G_APPLICATION_CLASS (klass);
+
+  app_class->handle_local_options = hdhomerun_cli_application_handle_local_options;
+  app_class->dbus_register = hdhomerun_cli_application_dbus_register;
+  app_class->dbus_unregister = hdhomerun_cli_application_dbus_unregister;
+  app_class->activate = hdhomerun_cli_application_activate;
+}
+
+static const GOptionEntry cli_options[] = {
+  { "discover", 'd', 0, G_OPTION_ARG_NONE, NULL,
+    N_("List the devices on the network"), NULL },
+  { "status", 's', 0, G_OPTION_ARG_STRING, NULL,
+    N_("Show the tuner status of a device"), N_("DEVICE") },
+  { "scan", 0, 0, G_OPTION_ARG_STRING, NULL,
+    N_("Scan a device for channels"), N_("DEVICE") },
+  { "tune", 't', 0, G_OPTION_ARG_STRING, NULL,
+    N_("Tune a tuner of a device and wait for lock"), N_("DEVICE") },
+  { "tuner", 'n', 0, G_OPTION_ARG_INT, NULL,
+    N_("The tuner to show or tune; all or 0 when not given"), N_("INDEX") },
+  { "frequency", 'f', 0, G_OPTION_ARG_STRING, NULL,
+    N_("What to tune to, in Hz or, below 1 MHz, in MHz"), N_("FREQUENCY") },
+  { "program", 'p', 0, G_OPTION_ARG_INT, NULL,
+    N_("The program to filter for when tuning"), N_("NUMBER") },
+  { "target", 0, 0, G_OPTION_ARG_STRING_ARRAY, NULL,
+    N_("Also probe an address or IPv4 subnet"), N_("ADDRESS") },
+  { "json", 'j', 0, G_OPTION_ARG_NONE, NULL,
+    N_("Print results as JSON"), NULL },
+  { "service", 0, 0, G_OPTION_ARG_NONE, NULL,
+    N_("Offer the commands on the session bus instead"), NULL },
+  G_OPTION_ENTRY_NULL
+};
+
+static void
+hdhomerun_cli_application_init (HdhomerunCliApplication *self)
+{
+  g_application_add_main_option_entries (G_APPLICATION (self), cli_options);
+  g_application_set_option_context_summary (G_APPLICATION (self),
+                                            _("Discover, inspect, scan and tune HDHomeRun devices"));
+  g_application_set_inactivity_timeout (G_APPLICATION (self), INACTIVITY_TIMEOUT_MS);
+}
@@ -1,4 +1,4 @@
-/* hdhomerun-device-row.h
+/* hdhomerun-cli-application.h
  *
  * Copyright 2025 Andrew St. Clair
  *
@@ -18,16 +18,14 @@
 
 #pragma once
 
-#include <adwaita.h>
+#include <gio/gio.h>
 
 G_BEGIN_DECLS
 
-#define HDHOMERUN_TYPE_DEVICE_ROW (hdhomerun_device_row_get_type())
+#define HDHOMERUN_TYPE_CLI_APPLICATION (hdhomerun_cli_application_get_type())
 
-G_DECLARE_FINAL_TYPE (HdhomerunDeviceRow, hdhomerun_device_row, HDHOMERUN, DEVICE_ROW, AdwExpanderRow)
+G_DECLARE_FINAL_TYPE (HdhomerunCliApplication, hdhomerun_cli_application, HDHOMERUN, CLI_APPLICATION, GApplication)
 
-HdhomerunDeviceRow *hdhomerun_device_row_new (const char *device_id,
-                                               const char *model_name,
-                                               const char *ip_address);
+HdhomerunCliApplication *hdhomerun_cli_application_new (const char *application_id);
 
 G_END_DECLS
@@ -0,0 +1,511 @@
+/* hdhomerun-connection-pool.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-connection-pool.h"
+#include "hdhomerun-backend.h"
+
+/* HdhomerunConnectionPool keeps one libhdhomerun device per tuner, keyed
+ * by device ID and tuner index. libhdhomerun keeps the control socket of
+ * a device open between requests, so reusing the device turns a control
+ * request into a single round trip.
+ *
+ * Connections nobody has used for KEEPALIVE_SECONDS get a cheap request
+ * so the device does not drop the socket, and connections nobody holds
+ * are closed after IDLE_TIMEOUT_SECONDS. The pool's own pins, for a
+ * keepalive or a warm-up, do not count as use, so keepalives never keep
+ * an unheld connection open.
+ */
+
+#define KEEPALIVE_SECONDS    20
+#define IDLE_TIMEOUT_SECONDS 120
+
+struct _HdhomerunConnection
+{
+  GMutex lock;
+  struct hdhomerun_device_t *hd;  /* Created on first lock */
+  char *device_id;
+  char *address;
+  guint tuner_index;
+
+  /* Guarded by the pool */
+  guint users;
+  gint64 last_used;               /* By a real user */
+  gint64 last_keepalive;
+};
+
+struct _HdhomerunConnectionPool
+{
+  GObject parent_instance;
+
+  GMutex lock;
+  GHashTable *connections;  /* "DEVICEID-tuner" -> HdhomerunConnection */
+  guint maintenance_id;
+};
+
+G_DEFINE_FINAL_TYPE (HdhomerunConnectionPool, hdhomerun_connection_pool, G_TYPE_OBJECT)
+
+static void
+connection_free (HdhomerunConnection *connection)
+{
+  g_assert (connection->users == 0);
+
+  if (connection->hd)
+    hdhomerun_backend_get_default ()->device_destroy (connection->hd);
+
+  g_mutex_clear (&connection->lock);
+  g_free (connection->device_id);
+  g_free (connection->address);
+  g_free (connection);
+}
+
+/**
+ * hdhomerun_connection_pool_get_default:
+ *
+ * Returns: (transfer none): the pool shared by the whole process
+ */
+HdhomerunConnectionPool *
+hdhomerun_connection_pool_get_default (void)
+{
+  static HdhomerunConnectionPool *default_pool;
+  static gsize initialized;
+
+  if (g_once_init_enter (&initialized))
+    {
+      default_pool = g_object_new (HDHOMERUN_TYPE_CONNECTION_POOL, NULL);
+      g_once_init_leave (&initialized, 1);
+    }
+
+  return default_pool;
+}
+
+/**
+ * hdhomerun_connection_pool_acquire:
+ * @self: a #HdhomerunConnectionPool
+ * @device_id: the device ID
+ * @tuner_index: the tuner on that device
+ * @address: the address to reach the device on
+ *
+ * Get the connection for a tuner, reusing the pooled one if there is one.
+ * If the device is now reached on a different @address, the old control
+ * socket is dropped and a new one opened on next use. May be called from
+ * any thread.
+ *
+ * Returns: (transfer none): the connection, to be given back with
+ *   hdhomerun_connection_pool_release()
+ */
+HdhomerunConnection *
+hdhomerun_connection_pool_acquire (HdhomerunConnectionPool *self,
+                                   const char              *device_id,
+                                   guint                    tuner_index,
+                                   const char              *address)
+{
+  g_autofree char *key = NULL;
+  HdhomerunConnection *connection;
+
+  g_return_val_if_fail (HDHOMERUN_IS_CONNECTION_POOL (self), NULL);
+  g_return_val_if_fail (device_id != NULL, NULL);
+  g_return_val_if_fail (address != NULL, NULL);
+
+  key = g_strdup_printf ("%s-%u", device_id, tuner_index);
+
+  g_mutex_lock (&self->lock);
+
+  connection = g_hash_table_lookup (self->connections, key);
+  if (connection == NULL)
+    {
+      connection = g_new0 (HdhomerunConnection, 1);
+      g_mutex_init (&connection->lock);
+      connection->device_id = g_strdup (device_id);
+      connection->tuner_index = tuner_index;
+      connection->address = g_strdup (address);
+      g_hash_table_insert (self->connections, g_steal_pointer (&key), connection);
+    }
+
+  connection->users++;
+  connection->last_used = g_get_monotonic_time ();
+
+  g_mutex_unlock (&self->lock);
+
+  g_mutex_lock (&connection->lock);
+  if (g_strcmp0 (connection->address, address) != 0)
+    {
+      g_free (connection->address);
+      connection->address = g_strdup (address);
+      g_clear_pointer (&connection->hd, hdhomerun_backend_get_default ()->device_destroy);
+    }
+  g_mutex_unlock (&connection->lock);
+
+  return connection;
+}
+
+/**
+ * hdhomerun_connection_pool_hold:
+ * @self: a #HdhomerunConnectionPool
+ * @connection: a connection from hdhomerun_connection_pool_acquire()
+ *
+ * Take another hold on @connection, for a user that may outlive the one
+ * that acquired it. Each hold is given back with
+ * hdhomerun_connection_pool_release().
+ */
+void
+hdhomerun_connection_pool_hold (HdhomerunConnectionPool *self,
+                                HdhomerunConnection     *connection)
+{
+  g_return_if_fail (HDHOMERUN_IS_CONNECTION_POOL (self));
+  g_return_if_fail (connection != NULL);
+
+  g_mutex_lock (&self->lock);
+  connection->users++;
+  g_mutex_unlock (&self->lock);
+}
+
+/**
+ * hdhomerun_connection_pool_release:
+ * @self: a #HdhomerunConnectionPool
+ * @connection: a connection from hdhomerun_connection_pool_acquire()
+ *
+ * Give @connection back. The control socket stays open until the
+ * connection has been idle for a while.
+ */
+void
+hdhomerun_connection_pool_release (HdhomerunConnectionPool *self,
+                                   HdhomerunConnection     *connection)
+{
+  g_return_if_fail (HDHOMERUN_IS_CONNECTION_POOL (self));
+  g_return_if_fail (connection != NULL);
+
+  g_mutex_lock (&self->lock);
+  g_assert (connection->users > 0);
+  connection->users--;
+  connection->last_used = g_get_monotonic_time ();
+  g_mutex_unlock (&self->lock);
+}
+
+/* Give back a pin the pool took for itself, without counting it as use */
+static void
+unpin (HdhomerunConnectionPool *self,
+       HdhomerunConnection     *connection)
+{
+  g_mutex_lock (&self->lock);
+  g_assert (connection->users > 0);
+  connection->users--;
+  g_mutex_unlock (&self->lock);
+}
+
+/* Called with the connection lock held */
+static struct hdhomerun_device_t *
+ensure_device (HdhomerunConnection *connection)
+{
+  if (connection->hd == NULL)
+    {
+      connection->hd = hdhomerun_backend_get_default ()->device_create_from_str (connection->address);
+      if (connection->hd)
+        hdhomerun_backend_get_default ()->device_set_tuner (connection->hd, connection->tuner_index);
+      else
+        g_warning ("Failed to create device for %s", connection->address);
+    }
+
+  return connection->hd;
+}
+
+struct hdhomerun_device_t *
+hdhomerun_connection_lock (HdhomerunConnection *connection)
+{
+  g_return_val_if_fail (connection != NULL, NULL);
+
+  g_mutex_lock (&connection->lock);
+
+  if (ensure_device (connection) == NULL)
+    g_mutex_unlock (&connection->lock);
+
+  return connection->hd;
+}
+
+/* Only call this when hdhomerun_connection_lock() returned a device */
+void
+hdhomerun_connection_unlock (HdhomerunConnection *connection)
+{
+  g_return_if_fail (connection != NULL);
+
+  g_mutex_unlock (&connection->lock);
+}
+
+const char *
+hdhomerun_connection_get_device_id (HdhomerunConnection *connection)
+{
+  g_return_val_if_fail (connection != NULL, NULL);
+
+  return connection->device_id;
+}
+
+guint
+hdhomerun_connection_get_tuner_index (HdhomerunConnection *connection)
+{
+  g_return_val_if_fail (connection != NULL, 0);
+
+  return connection->tuner_index;
+}
+
+static void
+keepalive_thread (GTask        *task,
+                  gpointer      source_object,
+                  gpointer      task_data,
+                  GCancellable *cancellable)
+{
+  HdhomerunConnectionPool *self = source_object;
+  GPtrArray *connections = task_data;
+
+  (void)cancellable; /* unused */
+
+  for (guint i = 0; i < connections->len; i++)
+    {
+      HdhomerunConnection *connection = g_ptr_array_index (connections, i);
+
+      /* Whoever holds the lock is already keeping the socket busy */
+      if (g_mutex_trylock (&connection->lock))
+        {
+          char *value;
+
+          if (ensure_device (connection) &&
+              hdhomerun_backend_get_default ()->device_get_var (connection->hd, "/sys/model", &value, NULL) < 0)
+            g_message ("Keepalive to %s failed", connection->address);
+
+          g_mutex_unlock (&connection->lock);
+        }
+
+      unpin (self, connection);
+    }
+
+  g_task_return_boolean (task, TRUE);
+}
+
+static void
+run_keepalive (HdhomerunConnectionPool *self,
+               GPtrArray               *connections)
+{
+  g_autoptr(GTask) task = NULL;
+
+  if (connections->len == 0)
+    {
+      g_ptr_array_unref (connections);
+      return;
+    }
+
+  task = g_task_new (self, NULL, NULL, NULL);
+  g_task_set_source_tag (task, run_keepalive);
+  g_task_set_task_data (task, connections, (GDestroyNotify) g_ptr_array_unref);
+  g_task_run_in_thread (task, keepalive_thread);
+}
+
+/**
+ * hdhomerun_connection_pool_warm_up:
+ * @self: a #HdhomerunConnectionPool
+ * @connection: a connection from hdhomerun_connection_pool_acquire()
+ *
+ * Open the control socket of @connection in the background, so the first
+ * real request does not pay for connection setup.
+ */
+void
+hdhomerun_connection_pool_warm_up (HdhomerunConnectionPool *self,
+                                   HdhomerunConnection     *connection)
+{
+  GPtrArray *connections;
+
+  g_return_if_fail (HDHOMERUN_IS_CONNECTION_POOL (self));
+  g_return_if_fail (connection != NULL);
+
+  g_mutex_lock (&self->lock);
+  connection->users++;
+  connection->last_keepalive = g_get_monotonic_time ();
+  g_mutex_unlock (&self->lock);
+
+  connections = g_ptr_array_new ();
+  g_ptr_array_add (connections, connection);
+  run_keepalive (self, connections);
+}
+
+typedef struct
+{
+  GPtrArray *connections;  /* HdhomerunConnection, pinned */
+  char *address;
+} AddressChange;
+
+static void
+address_change_free (AddressChange *change)
+{
+  g_ptr_array_unref (change->connections);
+  g_free (change->address);
+  g_free (change);
+}
+
+static void
+address_change_thread (GTask        *task,
+                       gpointer      source_object,
+                       gpointer      task_data,
+                       GCancellable *cancellable)
+{
+  HdhomerunConnectionPool *self = source_object;
+  AddressChange *change = task_data;
+
+  (void)cancellable; /* unused */
+
+  for (guint i = 0; i < change->connections->len; i++)
+    {
+      HdhomerunConnection *connection = g_ptr_array_index (change->connections, i);
+
+      /* Waits out a request, or a whole scan, on the old address */
+      g_mutex_lock (&connection->lock);
+      if (g_strcmp0 (connection->address, change->address) != 0)
+        {
+          g_free (connection->address);
+          connection->address = g_strdup (change->address);
+          g_clear_pointer (&connection->hd, hdhomerun_backend_get_default ()->device_destroy);
+        }
+      g_mutex_unlock (&connection->lock);
+
+      unpin (self, connection);
+    }
+
+  g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * hdhomerun_connection_pool_set_device_address:
+ * @self: a #HdhomerunConnectionPool
+ * @device_id: the device ID
+ * @address: the address to reach the device on from now on
+ *
+ * Move every connection of @device_id over to @address, including ones
+ * that are being held. Connections busy with a request move once it is
+ * done, so this never blocks the caller; each opens its new control
+ * socket on next use.
+ */
+void
+hdhomerun_connection_pool_set_device_address (HdhomerunConnectionPool *self,
+                                              const char              *device_id,
+                                              const char              *address)
+{
+  g_autoptr(GTask) task = NULL;
+  GHashTableIter iter;
+  HdhomerunConnection *connection;
+  AddressChange *change;
+
+  g_return_if_fail (HDHOMERUN_IS_CONNECTION_POOL (self));
+  g_return_if_fail (device_id != NULL);
+  g_return_if_fail (address != NULL);
+
+  change = g_new0 (AddressChange, 1);
+  change->connections = g_ptr_array_new ();
+  change->address = g_strdup (address);
+
+  g_mutex_lock (&self->lock);
+
+  g_hash_table_iter_init (&iter, self->connections);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&connection))
+    {
+      if (g_strcmp0 (connection->device_id, device_id) != 0)
+        continue;
+
+      /* Pinned until the change releases it */
+      connection->users++;
+      g_ptr_array_add (change->connections, connection);
+    }
+
+  g_mutex_unlock (&self->lock);
+
+  if (change->connections->len == 0)
+    {
+      address_change_free (change);
+      return;
+    }
+
+  task = g_task_new (self, NULL, NULL, NULL);
+  g_task_set_source_tag (task, hdhomerun_connection_pool_set_device_address);
+  g_task_set_task_data (task, change, (GDestroyNotify) address_change_free);
+  g_task_run_in_thread (task, address_change_thread);
+}
+
+static gboolean
+on_maintenance (gpointer user_data)
+{
+  HdhomerunConnectionPool *self = HDHOMERUN_CONNECTION_POOL (user_data);
+  gint64 now = g_get_monotonic_time ();
+  GPtrArray *stale;
+  GHashTableIter iter;
+  HdhomerunConnection *connection;
+
+  stale = g_ptr_array_new ();
+
+  g_mutex_lock (&self->lock);
+
+  g_hash_table_iter_init (&iter, self->connections);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&connection))
+    {
+      gint64 idle = now - connection->last_used;
+
+      if (connection->users == 0 && idle > IDLE_TIMEOUT_SECONDS * G_USEC_PER_SEC)
+        {
+          g_hash_table_iter_remove (&iter);
+          continue;
+        }
+
+      /* Pinned until the keepalive releases it */
+      if (idle > KEEPALIVE_SECONDS * G_USEC_PER_SEC &&
+          now - connection->last_keepalive > KEEPALIVE_SECONDS * G_USEC_PER_SEC)
+        {
+          connection->users++;
+          connection->last_keepalive = now;
+          g_ptr_array_add (stale, connection);
+        }
+    }
+
+  g_mutex_unlock (&self->lock);
+
+  run_keepalive (self, stale);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+hdhomerun_connection_pool_finalize (GObject *object)
+{
+  HdhomerunConnectionPool *self = (HdhomerunConnectionPool *)object;
+
+  g_clear_handle_id (&self->maintenance_id, g_source_remove);
+  g_clear_pointer (&self->connections, g_hash_table_unref);
+  g_mutex_clear (&self->lock);
+
+  G_OBJECT_CLASS (hdhomerun_connection_pool_parent_class)->finalize (object);
+}
+
+static void
+hdhomerun_connection_pool_class_init (HdhomerunConnectionPoolClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = hdhomerun_connection_pool_finalize;
+}
+
+static void
+hdhomerun_connection_pool_init (HdhomerunConnectionPool *self)
+{
+  g_mutex_init (&self->lock);
+  self->connections = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                             g_free, (GDestroyNotify) connection_free);
+  self->maintenance_id = g_timeout_add_seconds (KEEPALIVE_SECONDS, on_maintenance, self);
+}
@@ -0,0 +1,58 @@
+/* hdhomerun-connection-pool.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+struct hdhomerun_device_t;
+
+typedef struct _HdhomerunConnection HdhomerunConnection;
+
+#define HDHOMERUN_TYPE_CONNECTION_POOL (hdhomerun_connection_pool_get_type())
+
+G_DECLARE_FINAL_TYPE (HdhomerunConnectionPool, hdhomerun_connection_pool, HDHOMERUN, CONNECTION_POOL, GObject)
+
+HdhomerunConnectionPool   *hdhomerun_connection_pool_get_default (void);
+HdhomerunConnection       *hdhomerun_connection_pool_acquire     (HdhomerunConnectionPool *self,
+                                                                  const char              *device_id,
+                                                                  guint                    tuner_index,
+                                                                  const char              *address);
+void                       hdhomerun_connection_pool_hold        (HdhomerunConnectionPool *self,
+                                                                  HdhomerunConnection     *connection);
+void                       hdhomerun_connection_pool_release     (HdhomerunConnectionPool *self,
+                                                                  HdhomerunConnection     *connection);
+void                       hdhomerun_connection_pool_warm_up     (HdhomerunConnectionPool *self,
+                                                                  HdhomerunConnection     *connection);
+void                       hdhomerun_connection_pool_set_device_address
+                                                                 (HdhomerunConnectionPool *self,
+                                                                  const char              *device_id,
+                                                                  const char              *address);
+
+/* A connection may be shared by several users on several threads, so
+ * the libhdhomerun device is only ever reached between lock and unlock.
+ * The control socket is opened on first use and kept open afterwards.
+ */
+struct hdhomerun_device_t *hdhomerun_connection_lock             (HdhomerunConnection     *connection);
+void                       hdhomerun_connection_unlock           (HdhomerunConnection     *connection);
+const char                *hdhomerun_connection_get_device_id    (HdhomerunConnection     *connection);
+guint                      hdhomerun_connection_get_tuner_index  (HdhomerunConnection     *connection);
+
+G_END_DECLS
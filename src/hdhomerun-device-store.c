@@ -0,0 +1,376 @@
+/* hdhomerun-device-store.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-device-store.h"
+#include "hdhomerun-tuner-item.h"
+
+#include <string.h>
+
+/* HdhomerunDeviceStore is a GListModel of every tuner on every known
+ * device, ordered by device health, then device ID and then tuner index.
+ * Tuners are kept as plain records; the HdhomerunTunerItem for a record
+ * is only created when the list asks for it and is dropped again once no
+ * row holds it.
+ *
+ * Health only sorts by class, so devices keep their place while their
+ * scores wander and only move when they become degraded or recover.
+ */
+
+typedef struct
+{
+  char device_id[HDHOMERUN_DEVICE_ID_STRING_SIZE];
+  guint tuner_index;
+  guint rank;                /* Of the device health, lower sorts first */
+  HdhomerunTunerItem *item;  /* Weak */
+} TunerRecord;
+
+struct _HdhomerunDeviceStore
+{
+  GObject parent_instance;
+
+  GPtrArray *records;  /* TunerRecord, sorted */
+  GHashTable *devices;  /* device ID -> HdhomerunDeviceInfo */
+  GHashTable *health;   /* device ID -> HdhomerunDeviceHealth, once known */
+};
+
+static void hdhomerun_device_store_list_model_init (GListModelInterface *iface);
+
+G_DEFINE_FINAL_TYPE_WITH_CODE (HdhomerunDeviceStore, hdhomerun_device_store, G_TYPE_OBJECT,
+                               G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL,
+                                                      hdhomerun_device_store_list_model_init))
+
+static void
+tuner_record_free (TunerRecord *record)
+{
+  if (record->item != NULL)
+    g_object_remove_weak_pointer (G_OBJECT (record->item), (gpointer *)&record->item);
+
+  g_free (record);
+}
+
+static guint
+health_rank (HdhomerunDeviceHealth health)
+{
+  switch (health)
+    {
+    case HDHOMERUN_DEVICE_HEALTH_GOOD:
+      return 0;
+    case HDHOMERUN_DEVICE_HEALTH_UNKNOWN:
+      return 1;
+    case HDHOMERUN_DEVICE_HEALTH_DEGRADED:
+      return 2;
+    case HDHOMERUN_DEVICE_HEALTH_UNREACHABLE:
+    default:
+      return 3;
+    }
+}
+
+static HdhomerunDeviceHealth
+lookup_health (HdhomerunDeviceStore *self,
+               const char           *device_id)
+{
+  return GPOINTER_TO_INT (g_hash_table_lookup (self->health, device_id));
+}
+
+static GType
+hdhomerun_device_store_get_item_type (GListModel *model)
+{
+  (void)model; /* unused */
+
+  return HDHOMERUN_TYPE_TUNER_ITEM;
+}
+
+static guint
+hdhomerun_device_store_get_n_items (GListModel *model)
+{
+  HdhomerunDeviceStore *self = HDHOMERUN_DEVICE_STORE (model);
+
+  return self->records->len;
+}
+
+static gpointer
+hdhomerun_device_store_get_item (GListModel *model,
+                                 guint       position)
+{
+  HdhomerunDeviceStore *self = HDHOMERUN_DEVICE_STORE (model);
+  TunerRecord *record;
+
+  if (position >= self->records->len)
+    return NULL;
+
+  record = g_ptr_array_index (self->records, position);
+
+  /* Hand out the same item for as long as somebody holds it */
+  if (record->item != NULL)
+    return g_object_ref (record->item);
+
+  record->item = hdhomerun_tuner_item_new (record->device_id, record->tuner_index);
+  hdhomerun_tuner_item_set_health (record->item, lookup_health (self, record->device_id));
+  g_object_add_weak_pointer (G_OBJECT (record->item), (gpointer *)&record->item);
+
+  return record->item;
+}
+
+static void
+hdhomerun_device_store_list_model_init (GListModelInterface *iface)
+{
+  iface->get_item_type = hdhomerun_device_store_get_item_type;
+  iface->get_n_items = hdhomerun_device_store_get_n_items;
+  iface->get_item = hdhomerun_device_store_get_item;
+}
+
+/* Returns the position of the first record of @device_id at @rank, or
+ * of the first record that sorts after it when the device is not there.
+ */
+static guint
+find_device_start (HdhomerunDeviceStore *self,
+                   guint                 rank,
+                   const char           *device_id)
+{
+  guint low = 0;
+  guint high = self->records->len;
+
+  while (low < high)
+    {
+      guint mid = low + (high - low) / 2;
+      TunerRecord *record = g_ptr_array_index (self->records, mid);
+
+      if (record->rank < rank ||
+          (record->rank == rank && strcmp (record->device_id, device_id) < 0))
+        low = mid + 1;
+      else
+        high = mid;
+    }
+
+  return low;
+}
+
+/* The number of records of @device_id from @start on */
+static guint
+count_device_tuners (HdhomerunDeviceStore *self,
+                     guint                 start,
+                     const char           *device_id)
+{
+  guint end;
+
+  for (end = start; end < self->records->len; end++)
+    {
+      TunerRecord *record = g_ptr_array_index (self->records, end);
+
+      if (strcmp (record->device_id, device_id) != 0)
+        break;
+    }
+
+  return end - start;
+}
+
+static void
+set_device_tuners (HdhomerunDeviceStore *self,
+                   const char           *device_id,
+                   guint                 tuner_count)
+{
+  guint rank = health_rank (lookup_health (self, device_id));
+  guint start;
+  guint n_tuners;
+  guint end;
+
+  start = find_device_start (self, rank, device_id);
+  n_tuners = count_device_tuners (self, start, device_id);
+  end = start + n_tuners;
+
+  if (n_tuners > tuner_count)
+    {
+      g_ptr_array_remove_range (self->records, start + tuner_count, n_tuners - tuner_count);
+      g_list_model_items_changed (G_LIST_MODEL (self), start + tuner_count,
+                                  n_tuners - tuner_count, 0);
+    }
+  else if (n_tuners < tuner_count)
+    {
+      for (guint i = n_tuners; i < tuner_count; i++)
+        {
+          TunerRecord *record = g_new0 (TunerRecord, 1);
+
+          g_strlcpy (record->device_id, device_id, sizeof (record->device_id));
+          record->tuner_index = i;
+          record->rank = rank;
+          g_ptr_array_insert (self->records, start + i, record);
+        }
+
+      g_list_model_items_changed (G_LIST_MODEL (self), end, 0, tuner_count - n_tuners);
+    }
+}
+
+/**
+ * hdhomerun_device_store_set_device:
+ * @self: a #HdhomerunDeviceStore
+ * @info: a discovered device
+ *
+ * Add @info, or replace the device with the same ID. Only tuners that
+ * appeared or went away emit #GListModel::items-changed.
+ */
+void
+hdhomerun_device_store_set_device (HdhomerunDeviceStore *self,
+                                   HdhomerunDeviceInfo  *info)
+{
+  g_return_if_fail (HDHOMERUN_IS_DEVICE_STORE (self));
+  g_return_if_fail (info != NULL);
+
+  /* The key lives in the info, so replace it along with the value */
+  g_hash_table_replace (self->devices, info->device_id_str, hdhomerun_device_info_ref (info));
+  set_device_tuners (self, info->device_id_str, info->tuner_count);
+}
+
+/**
+ * hdhomerun_device_store_remove_device:
+ * @self: a #HdhomerunDeviceStore
+ * @device_id: the device ID as shown in the list
+ *
+ * Remove every tuner of @device_id.
+ */
+void
+hdhomerun_device_store_remove_device (HdhomerunDeviceStore *self,
+                                      const char           *device_id)
+{
+  char id[HDHOMERUN_DEVICE_ID_STRING_SIZE];
+
+  g_return_if_fail (HDHOMERUN_IS_DEVICE_STORE (self));
+  g_return_if_fail (device_id != NULL);
+
+  /* @device_id may belong to the info that is about to be dropped */
+  g_strlcpy (id, device_id, sizeof (id));
+  g_hash_table_remove (self->devices, id);
+  set_device_tuners (self, id, 0);
+  g_hash_table_remove (self->health, id);
+}
+
+/**
+ * hdhomerun_device_store_set_health:
+ * @self: a #HdhomerunDeviceStore
+ * @device_id: the device ID as shown in the list
+ * @health: how well the device answers
+ *
+ * Record the health of @device_id on its tuner items. When that moves
+ * the device to another part of the list, its tuners are removed and
+ * inserted again at their new position.
+ */
+void
+hdhomerun_device_store_set_health (HdhomerunDeviceStore  *self,
+                                   const char            *device_id,
+                                   HdhomerunDeviceHealth  health)
+{
+  g_autoptr(GPtrArray) moved = NULL;
+  HdhomerunDeviceHealth old_health;
+  guint old_rank;
+  guint rank;
+  guint start;
+  guint n_tuners;
+
+  g_return_if_fail (HDHOMERUN_IS_DEVICE_STORE (self));
+  g_return_if_fail (device_id != NULL);
+
+  old_health = lookup_health (self, device_id);
+  if (old_health == health && g_hash_table_contains (self->health, device_id))
+    return;
+
+  old_rank = health_rank (old_health);
+  rank = health_rank (health);
+  start = find_device_start (self, old_rank, device_id);
+  n_tuners = count_device_tuners (self, start, device_id);
+
+  g_hash_table_replace (self->health, g_strdup (device_id), GINT_TO_POINTER (health));
+
+  for (guint i = 0; i < n_tuners; i++)
+    {
+      TunerRecord *record = g_ptr_array_index (self->records, start + i);
+
+      if (record->item != NULL)
+        hdhomerun_tuner_item_set_health (record->item, health);
+    }
+
+  if (rank == old_rank || n_tuners == 0)
+    return;
+
+  /* The records keep their items, so rows that hold one stay valid */
+  moved = g_ptr_array_sized_new (n_tuners);
+  for (guint i = 0; i < n_tuners; i++)
+    {
+      TunerRecord *record = g_ptr_array_steal_index (self->records, start);
+
+      record->rank = rank;
+      g_ptr_array_add (moved, record);
+    }
+  g_list_model_items_changed (G_LIST_MODEL (self), start, n_tuners, 0);
+
+  start = find_device_start (self, rank, device_id);
+  for (guint i = 0; i < n_tuners; i++)
+    g_ptr_array_insert (self->records, start + i, g_ptr_array_index (moved, i));
+  g_list_model_items_changed (G_LIST_MODEL (self), start, 0, n_tuners);
+}
+
+/**
+ * hdhomerun_device_store_lookup_device:
+ * @self: a #HdhomerunDeviceStore
+ * @device_id: the device ID as shown in the list
+ *
+ * Returns: (nullable) (transfer none): the discovery record for
+ *   @device_id, valid until the device is replaced or removed
+ */
+const HdhomerunDeviceInfo *
+hdhomerun_device_store_lookup_device (HdhomerunDeviceStore *self,
+                                      const char           *device_id)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_DEVICE_STORE (self), NULL);
+  g_return_val_if_fail (device_id != NULL, NULL);
+
+  return g_hash_table_lookup (self->devices, device_id);
+}
+
+HdhomerunDeviceStore *
+hdhomerun_device_store_new (void)
+{
+  return g_object_new (HDHOMERUN_TYPE_DEVICE_STORE, NULL);
+}
+
+static void
+hdhomerun_device_store_finalize (GObject *object)
+{
+  HdhomerunDeviceStore *self = (HdhomerunDeviceStore *)object;
+
+  g_clear_pointer (&self->records, g_ptr_array_unref);
+  g_clear_pointer (&self->devices, g_hash_table_unref);
+  g_clear_pointer (&self->health, g_hash_table_unref);
+
+  G_OBJECT_CLASS (hdhomerun_device_store_parent_class)->finalize (object);
+}
+
+static void
+hdhomerun_device_store_class_init (HdhomerunDeviceStoreClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = hdhomerun_device_store_finalize;
+}
+
+static void
+hdhomerun_device_store_init (HdhomerunDeviceStore *self)
+{
+  self->records = g_ptr_array_new_with_free_func ((GDestroyNotify) tuner_record_free);
+  self->devices = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         NULL, (GDestroyNotify) hdhomerun_device_info_unref);
+  self->health = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+}
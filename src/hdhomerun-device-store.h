@@ -0,0 +1,43 @@
+/* hdhomerun-device-store.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "hdhomerun-discovery.h"
+#include "hdhomerun-tuner-item.h"
+
+G_BEGIN_DECLS
+
+#define HDHOMERUN_TYPE_DEVICE_STORE (hdhomerun_device_store_get_type())
+
+G_DECLARE_FINAL_TYPE (HdhomerunDeviceStore, hdhomerun_device_store, HDHOMERUN, DEVICE_STORE, GObject)
+
+HdhomerunDeviceStore      *hdhomerun_device_store_new           (void);
+void                       hdhomerun_device_store_set_device    (HdhomerunDeviceStore *self,
+                                                                 HdhomerunDeviceInfo  *info);
+void                       hdhomerun_device_store_remove_device (HdhomerunDeviceStore *self,
+                                                                 const char           *device_id);
+const HdhomerunDeviceInfo *hdhomerun_device_store_lookup_device (HdhomerunDeviceStore *self,
+                                                                 const char           *device_id);
+void                       hdhomerun_device_store_set_health    (HdhomerunDeviceStore  *self,
+                                                                 const char            *device_id,
+                                                                 HdhomerunDeviceHealth  health);
+
+G_END_DECLS
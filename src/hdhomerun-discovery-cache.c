@@ -0,0 +1,166 @@
+/* hdhomerun-discovery-cache.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-discovery-cache.h"
+#include "hdhomerun-discovery.h"
+
+#include <errno.h>
+
+/* The cache is a serialized GVariant: a format version followed by one
+ * (device ID, tuner count, addresses, control address, model) tuple per
+ * device. An empty model string stands for an unknown model.
+ */
+#define CACHE_VERSION 2
+#define CACHE_FORMAT  "(ua(uuasss))"
+
+static char *
+get_cache_path (void)
+{
+  return g_build_filename (g_get_user_cache_dir (), "hdhomerun-config-gtk", "devices.cache", NULL);
+}
+
+GPtrArray *
+hdhomerun_discovery_cache_load (GError **error)
+{
+  g_autofree char *path = get_cache_path ();
+  g_autoptr(GVariant) variant = NULL;
+  g_autoptr(GVariantIter) devices = NULL;
+  GPtrArray *snapshot;
+  char *contents;
+  gsize length;
+  guint32 version;
+  guint32 device_id;
+  guint32 tuner_count;
+  char **ip_addresses;
+  char *control_address;
+  char *model;
+
+  if (!g_file_get_contents (path, &contents, &length, error))
+    return NULL;
+
+  variant = g_variant_new_from_data (G_VARIANT_TYPE (CACHE_FORMAT), contents, length,
+                                     FALSE, g_free, contents);
+  g_variant_ref_sink (variant);
+
+  g_variant_get (variant, CACHE_FORMAT, &version, &devices);
+  if (version != CACHE_VERSION)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                   "Unsupported discovery cache version %u", version);
+      return NULL;
+    }
+
+  snapshot = g_ptr_array_new_with_free_func ((GDestroyNotify) hdhomerun_device_info_unref);
+
+  while (g_variant_iter_next (devices, "(uu^asss)", &device_id, &tuner_count,
+                              &ip_addresses, &control_address, &model))
+    {
+      HdhomerunDeviceInfo *info;
+
+      info = hdhomerun_device_info_new (device_id, tuner_count);
+      info->ip_addresses = ip_addresses;
+      if (*control_address)
+        info->control_address = control_address;
+      else
+        g_free (control_address);
+      if (*model)
+        info->model = model;
+      else
+        g_free (model);
+
+      g_ptr_array_add (snapshot, info);
+    }
+
+  return snapshot;
+}
+
+static void
+save_thread (GTask        *task,
+             gpointer      source_object,
+             gpointer      task_data,
+             GCancellable *cancellable)
+{
+  GPtrArray *snapshot = task_data;
+  g_autofree char *path = get_cache_path ();
+  g_autofree char *dir = g_path_get_dirname (path);
+  g_autoptr(GVariant) variant = NULL;
+  g_autoptr(GError) error = NULL;
+  GVariantBuilder builder;
+
+  (void)source_object; /* unused */
+  (void)cancellable; /* unused */
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(uuasss)"));
+  for (guint i = 0; i < snapshot->len; i++)
+    {
+      const HdhomerunDeviceInfo *info = g_ptr_array_index (snapshot, i);
+
+      g_variant_builder_add (&builder, "(uu^asss)",
+                             info->device_id,
+                             info->tuner_count,
+                             info->ip_addresses,
+                             info->control_address ? info->control_address : "",
+                             info->model ? info->model : "");
+    }
+
+  variant = g_variant_ref_sink (g_variant_new (CACHE_FORMAT, CACHE_VERSION, &builder));
+
+  if (g_mkdir_with_parents (dir, 0700) != 0)
+    {
+      int errsv = errno;
+
+      g_task_return_new_error (task, G_IO_ERROR, g_io_error_from_errno (errsv),
+                               "Failed to create %s: %s", dir, g_strerror (errsv));
+      return;
+    }
+
+  if (!g_file_set_contents (path, g_variant_get_data (variant), g_variant_get_size (variant), &error))
+    {
+      g_task_return_error (task, g_steal_pointer (&error));
+      return;
+    }
+
+  g_task_return_boolean (task, TRUE);
+}
+
+void
+hdhomerun_discovery_cache_save_async (GPtrArray           *snapshot,
+                                      GCancellable        *cancellable,
+                                      GAsyncReadyCallback  callback,
+                                      gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+
+  g_return_if_fail (snapshot != NULL);
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_source_tag (task, hdhomerun_discovery_cache_save_async);
+  g_task_set_task_data (task, g_ptr_array_ref (snapshot), (GDestroyNotify) g_ptr_array_unref);
+  g_task_run_in_thread (task, save_thread);
+}
+
+gboolean
+hdhomerun_discovery_cache_save_finish (GAsyncResult  *result,
+                                       GError       **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, NULL), FALSE);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) ==
+                        hdhomerun_discovery_cache_save_async, FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
@@ -0,0 +1,36 @@
+/* hdhomerun-discovery-cache.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* The last discovery snapshot, kept in the user cache dir so the device
+ * list can be shown before the first live scan finishes.
+ */
+GPtrArray *hdhomerun_discovery_cache_load        (GError              **error);
+void       hdhomerun_discovery_cache_save_async  (GPtrArray            *snapshot,
+                                                  GCancellable         *cancellable,
+                                                  GAsyncReadyCallback   callback,
+                                                  gpointer              user_data);
+gboolean   hdhomerun_discovery_cache_save_finish (GAsyncResult         *result,
+                                                  GError              **error);
+
+G_END_DECLS
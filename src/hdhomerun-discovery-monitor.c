@@ -0,0 +1,464 @@
+/* hdhomerun-discovery-monitor.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-discovery-monitor.h"
+#include "hdhomerun-trace.h"
+
+/* HdhomerunDiscoveryMonitor runs discovery passes and turns the
+ * difference between consecutive snapshots into device-added,
+ * device-removed and device-changed signals.
+ *
+ * When enabled it also polls in the background. The interval starts
+ * short and doubles after every pass that finds no change, up to
+ * MAX_INTERVAL_SECONDS, and drops back to the minimum as soon as a
+ * device appears, disappears or changes.
+ *
+ * A single lost broadcast reply must not make a device flicker out of
+ * the list, so a device is only removed once MISSES_BEFORE_REMOVAL
+ * passes in a row have not found it. Passes run at the minimum interval
+ * while a removal is pending, even with background polling disabled, so
+ * a device that went away still leaves after one Refresh.
+ */
+
+#define MIN_INTERVAL_SECONDS  5
+#define MAX_INTERVAL_SECONDS  300
+#define MISSES_BEFORE_REMOVAL 3
+
+struct _HdhomerunDiscoveryMonitor
+{
+  GObject parent_instance;
+
+  GHashTable *devices;  /* device ID -> HdhomerunDeviceInfo */
+  GHashTable *misses;   /* device ID -> passes in a row without it */
+  char **targets;
+  GCancellable *cancellable;
+  guint timeout_id;
+  guint interval;
+  gboolean enabled;
+};
+
+G_DEFINE_FINAL_TYPE (HdhomerunDiscoveryMonitor, hdhomerun_discovery_monitor, G_TYPE_OBJECT)
+
+enum {
+  PROP_0,
+  PROP_ENABLED,
+  PROP_TARGETS,
+  PROP_INTERVAL,
+  N_PROPS
+};
+
+enum {
+  DEVICE_ADDED,
+  DEVICE_REMOVED,
+  DEVICE_CHANGED,
+  SCAN_FINISHED,
+  N_SIGNALS
+};
+
+static GParamSpec *properties [N_PROPS];
+static guint signals [N_SIGNALS];
+
+static void start_scan (HdhomerunDiscoveryMonitor *self);
+
+HdhomerunDiscoveryMonitor *
+hdhomerun_discovery_monitor_new (void)
+{
+  return g_object_new (HDHOMERUN_TYPE_DISCOVERY_MONITOR, NULL);
+}
+
+static void
+set_interval (HdhomerunDiscoveryMonitor *self,
+              guint                      interval)
+{
+  if (self->interval == interval)
+    return;
+
+  self->interval = interval;
+  g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_INTERVAL]);
+}
+
+static gboolean
+on_timeout (gpointer user_data)
+{
+  HdhomerunDiscoveryMonitor *self = HDHOMERUN_DISCOVERY_MONITOR (user_data);
+
+  self->timeout_id = 0;
+  start_scan (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+schedule_scan (HdhomerunDiscoveryMonitor *self)
+{
+  g_clear_handle_id (&self->timeout_id, g_source_remove);
+
+  if ((self->enabled || g_hash_table_size (self->misses) > 0) && self->cancellable == NULL)
+    self->timeout_id = g_timeout_add_seconds (self->interval, on_timeout, self);
+}
+
+/* Returns TRUE when the device set changed or a removal is pending */
+static gboolean
+apply_snapshot (HdhomerunDiscoveryMonitor *self,
+                GPtrArray                 *snapshot,
+                gboolean                   remove_missing)
+{
+  g_autoptr(GHashTable) seen = NULL;
+  g_autoptr(GPtrArray) removed = NULL;
+  GHashTableIter iter;
+  HdhomerunDeviceInfo *info;
+  gboolean changed = FALSE;
+  gboolean pending = FALSE;
+
+  seen = g_hash_table_new (g_str_hash, g_str_equal);
+
+  for (guint i = 0; i < snapshot->len; i++)
+    {
+      HdhomerunDeviceInfo *existing;
+
+      info = g_ptr_array_index (snapshot, i);
+      g_hash_table_add (seen, info->device_id_str);
+      g_hash_table_remove (self->misses, info->device_id_str);
+
+      existing = g_hash_table_lookup (self->devices, info->device_id_str);
+      if (existing != NULL && hdhomerun_device_info_equal (existing, info))
+        continue;
+
+      /* The key lives in the info, so replace it along with the value */
+      g_hash_table_replace (self->devices, info->device_id_str, hdhomerun_device_info_ref (info));
+      g_signal_emit (self, signals [existing ? DEVICE_CHANGED : DEVICE_ADDED], 0, info);
+      changed = TRUE;
+    }
+
+  if (!remove_missing)
+    return changed;
+
+  /* Collect first so handlers never observe a half-updated table */
+  removed = g_ptr_array_new_with_free_func ((GDestroyNotify) hdhomerun_device_info_unref);
+
+  g_hash_table_iter_init (&iter, self->devices);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&info))
+    {
+      guint misses;
+
+      if (g_hash_table_contains (seen, info->device_id_str))
+        continue;
+
+      misses = GPOINTER_TO_UINT (g_hash_table_lookup (self->misses, info->device_id_str)) + 1;
+      if (misses < MISSES_BEFORE_REMOVAL)
+        {
+          g_hash_table_insert (self->misses, g_strdup (info->device_id_str),
+                               GUINT_TO_POINTER (misses));
+          pending = TRUE;
+          continue;
+        }
+
+      g_hash_table_remove (self->misses, info->device_id_str);
+      g_ptr_array_add (removed, info);
+      g_hash_table_iter_steal (&iter);
+    }
+
+  for (guint i = 0; i < removed->len; i++)
+    g_signal_emit (self, signals [DEVICE_REMOVED], 0, g_ptr_array_index (removed, i));
+
+  return changed || pending || removed->len > 0;
+}
+
+static void
+on_scan_finished (GObject      *source_object,
+                  GAsyncResult *result,
+                  gpointer      user_data)
+{
+  HdhomerunDiscoveryMonitor *self;
+  g_autoptr(GPtrArray) snapshot = NULL;
+  g_autoptr(GError) error = NULL;
+  gint64 trace;
+
+  (void)source_object; /* unused */
+
+  snapshot = hdhomerun_discovery_find_devices_finish (result, &error);
+
+  /* A cancelled scan may complete after the monitor is gone */
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    return;
+
+  self = HDHOMERUN_DISCOVERY_MONITOR (user_data);
+  g_clear_object (&self->cancellable);
+
+  if (snapshot == NULL)
+    {
+      g_warning ("%s", error->message);
+      set_interval (self, MIN (self->interval * 2, MAX_INTERVAL_SECONDS));
+      schedule_scan (self);
+      return;
+    }
+
+  /* The handlers update the models, so this is the main loop cost of a pass */
+  trace = hdhomerun_trace_begin ();
+
+  /* Poll quickly while the fleet is in flux, back off while it is stable */
+  if (apply_snapshot (self, snapshot, TRUE))
+    set_interval (self, MIN_INTERVAL_SECONDS);
+  else
+    set_interval (self, MIN (self->interval * 2, MAX_INTERVAL_SECONDS));
+
+  g_signal_emit (self, signals [SCAN_FINISHED], 0, snapshot);
+
+  hdhomerun_trace_end (trace, "apply-snapshot", "%u device(s)", snapshot->len);
+
+  schedule_scan (self);
+}
+
+static void
+start_scan (HdhomerunDiscoveryMonitor *self)
+{
+  g_clear_handle_id (&self->timeout_id, g_source_remove);
+
+  /* Drop any scan still in flight rather than queueing behind it */
+  g_cancellable_cancel (self->cancellable);
+  g_clear_object (&self->cancellable);
+
+  self->cancellable = g_cancellable_new ();
+  hdhomerun_discovery_find_devices_async ((const char * const *)self->targets,
+                                          self->cancellable,
+                                          on_scan_finished,
+                                          self);
+}
+
+/**
+ * hdhomerun_discovery_monitor_refresh:
+ * @self: a #HdhomerunDiscoveryMonitor
+ *
+ * Start a discovery pass now, cancelling the one in flight if any.
+ */
+void
+hdhomerun_discovery_monitor_refresh (HdhomerunDiscoveryMonitor *self)
+{
+  g_return_if_fail (HDHOMERUN_IS_DISCOVERY_MONITOR (self));
+
+  start_scan (self);
+}
+
+/**
+ * hdhomerun_discovery_monitor_seed:
+ * @self: a #HdhomerunDiscoveryMonitor
+ * @snapshot: (element-type HdhomerunDeviceInfo): previously known devices
+ *
+ * Announce @snapshot as if it had been discovered, without removing any
+ * device. The next completed pass reconciles it with the network.
+ */
+void
+hdhomerun_discovery_monitor_seed (HdhomerunDiscoveryMonitor *self,
+                                  GPtrArray                 *snapshot)
+{
+  g_return_if_fail (HDHOMERUN_IS_DISCOVERY_MONITOR (self));
+  g_return_if_fail (snapshot != NULL);
+
+  apply_snapshot (self, snapshot, FALSE);
+}
+
+/**
+ * hdhomerun_discovery_monitor_stop:
+ * @self: a #HdhomerunDiscoveryMonitor
+ *
+ * Cancel the pass in flight and any scheduled one.
+ */
+void
+hdhomerun_discovery_monitor_stop (HdhomerunDiscoveryMonitor *self)
+{
+  g_return_if_fail (HDHOMERUN_IS_DISCOVERY_MONITOR (self));
+
+  g_clear_handle_id (&self->timeout_id, g_source_remove);
+  g_cancellable_cancel (self->cancellable);
+  g_clear_object (&self->cancellable);
+}
+
+/**
+ * hdhomerun_discovery_monitor_get_snapshot:
+ * @self: a #HdhomerunDiscoveryMonitor
+ *
+ * Returns: (transfer full) (element-type HdhomerunDeviceInfo): the
+ *   devices currently known
+ */
+GPtrArray *
+hdhomerun_discovery_monitor_get_snapshot (HdhomerunDiscoveryMonitor *self)
+{
+  GPtrArray *snapshot;
+  GHashTableIter iter;
+  HdhomerunDeviceInfo *info;
+
+  g_return_val_if_fail (HDHOMERUN_IS_DISCOVERY_MONITOR (self), NULL);
+
+  snapshot = g_ptr_array_new_full (g_hash_table_size (self->devices),
+                                   (GDestroyNotify) hdhomerun_device_info_unref);
+
+  g_hash_table_iter_init (&iter, self->devices);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&info))
+    g_ptr_array_add (snapshot, hdhomerun_device_info_ref (info));
+
+  return snapshot;
+}
+
+static void
+hdhomerun_discovery_monitor_dispose (GObject *object)
+{
+  HdhomerunDiscoveryMonitor *self = (HdhomerunDiscoveryMonitor *)object;
+
+  hdhomerun_discovery_monitor_stop (self);
+
+  G_OBJECT_CLASS (hdhomerun_discovery_monitor_parent_class)->dispose (object);
+}
+
+static void
+hdhomerun_discovery_monitor_finalize (GObject *object)
+{
+  HdhomerunDiscoveryMonitor *self = (HdhomerunDiscoveryMonitor *)object;
+
+  g_clear_pointer (&self->devices, g_hash_table_unref);
+  g_clear_pointer (&self->misses, g_hash_table_unref);
+  g_clear_pointer (&self->targets, g_strfreev);
+
+  G_OBJECT_CLASS (hdhomerun_discovery_monitor_parent_class)->finalize (object);
+}
+
+static void
+hdhomerun_discovery_monitor_get_property (GObject    *object,
+                                          guint       prop_id,
+                                          GValue     *value,
+                                          GParamSpec *pspec)
+{
+  HdhomerunDiscoveryMonitor *self = HDHOMERUN_DISCOVERY_MONITOR (object);
+
+  switch (prop_id)
+    {
+    case PROP_ENABLED:
+      g_value_set_boolean (value, self->enabled);
+      break;
+    case PROP_TARGETS:
+      g_value_set_boxed (value, self->targets);
+      break;
+    case PROP_INTERVAL:
+      g_value_set_uint (value, self->interval);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+hdhomerun_discovery_monitor_set_property (GObject      *object,
+                                          guint         prop_id,
+                                          const GValue *value,
+                                          GParamSpec   *pspec)
+{
+  HdhomerunDiscoveryMonitor *self = HDHOMERUN_DISCOVERY_MONITOR (object);
+
+  switch (prop_id)
+    {
+    case PROP_ENABLED:
+      self->enabled = g_value_get_boolean (value);
+      schedule_scan (self);
+      break;
+    case PROP_TARGETS:
+      g_strfreev (self->targets);
+      self->targets = g_value_dup_boxed (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+hdhomerun_discovery_monitor_class_init (HdhomerunDiscoveryMonitorClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = hdhomerun_discovery_monitor_dispose;
+  object_class->finalize = hdhomerun_discovery_monitor_finalize;
+  object_class->get_property = hdhomerun_discovery_monitor_get_property;
+  object_class->set_property = hdhomerun_discovery_monitor_set_property;
+
+  properties [PROP_ENABLED] =
+    g_param_spec_boolean ("enabled",
+                          "Enabled",
+                          "Whether to keep discovering devices in the background",
+                          FALSE,
+                          (G_PARAM_READWRITE |
+                           G_PARAM_STATIC_STRINGS));
+
+  properties [PROP_TARGETS] =
+    g_param_spec_boxed ("targets",
+                        "Targets",
+                        "Addresses and subnets probed directly on every pass",
+                        G_TYPE_STRV,
+                        (G_PARAM_READWRITE |
+                         G_PARAM_STATIC_STRINGS));
+
+  properties [PROP_INTERVAL] =
+    g_param_spec_uint ("interval",
+                       "Interval",
+                       "Seconds until the next background pass",
+                       MIN_INTERVAL_SECONDS,
+                       MAX_INTERVAL_SECONDS,
+                       MIN_INTERVAL_SECONDS,
+                       (G_PARAM_READABLE |
+                        G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_properties (object_class, N_PROPS, properties);
+
+  signals [DEVICE_ADDED] =
+    g_signal_new ("device-added",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL, NULL,
+                  G_TYPE_NONE, 1,
+                  HDHOMERUN_TYPE_DEVICE_INFO | G_SIGNAL_TYPE_STATIC_SCOPE);
+
+  signals [DEVICE_REMOVED] =
+    g_signal_new ("device-removed",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL, NULL,
+                  G_TYPE_NONE, 1,
+                  HDHOMERUN_TYPE_DEVICE_INFO | G_SIGNAL_TYPE_STATIC_SCOPE);
+
+  signals [DEVICE_CHANGED] =
+    g_signal_new ("device-changed",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL, NULL,
+                  G_TYPE_NONE, 1,
+                  HDHOMERUN_TYPE_DEVICE_INFO | G_SIGNAL_TYPE_STATIC_SCOPE);
+
+  signals [SCAN_FINISHED] =
+    g_signal_new ("scan-finished",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL, NULL,
+                  G_TYPE_NONE, 1,
+                  G_TYPE_PTR_ARRAY | G_SIGNAL_TYPE_STATIC_SCOPE);
+}
+
+static void
+hdhomerun_discovery_monitor_init (HdhomerunDiscoveryMonitor *self)
+{
+  self->devices = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         NULL, (GDestroyNotify) hdhomerun_device_info_unref);
+  self->misses = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  self->interval = MIN_INTERVAL_SECONDS;
+}
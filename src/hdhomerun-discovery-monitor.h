@@ -0,0 +1,38 @@
+/* hdhomerun-discovery-monitor.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "hdhomerun-discovery.h"
+
+G_BEGIN_DECLS
+
+#define HDHOMERUN_TYPE_DISCOVERY_MONITOR (hdhomerun_discovery_monitor_get_type())
+
+G_DECLARE_FINAL_TYPE (HdhomerunDiscoveryMonitor, hdhomerun_discovery_monitor, HDHOMERUN, DISCOVERY_MONITOR, GObject)
+
+HdhomerunDiscoveryMonitor *hdhomerun_discovery_monitor_new          (void);
+void                       hdhomerun_discovery_monitor_refresh      (HdhomerunDiscoveryMonitor *self);
+void                       hdhomerun_discovery_monitor_seed         (HdhomerunDiscoveryMonitor *self,
+                                                                     GPtrArray                 *snapshot);
+void                       hdhomerun_discovery_monitor_stop         (HdhomerunDiscoveryMonitor *self);
+GPtrArray                 *hdhomerun_discovery_monitor_get_snapshot (HdhomerunDiscoveryMonitor *self);
+
+G_END_DECLS
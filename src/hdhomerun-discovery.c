@@ -0,0 +1,465 @@
+/* hdhomerun-discovery.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-discovery.h"
+#include "hdhomerun-backend.h"
+#include "hdhomerun-trace.h"
+
+#include <string.h>
+
+#define HDHOMERUN_IP_STRING_SIZE 64  /* Size required by libhdhomerun API */
+
+G_DEFINE_BOXED_TYPE (HdhomerunDeviceInfo, hdhomerun_device_info,
+                     hdhomerun_device_info_ref, hdhomerun_device_info_unref)
+
+HdhomerunDeviceInfo *
+hdhomerun_device_info_new (guint32 device_id,
+                           guint   tuner_count)
+{
+  HdhomerunDeviceInfo *info;
+
+  info = g_atomic_rc_box_new0 (HdhomerunDeviceInfo);
+  info->device_id = device_id;
+  info->tuner_count = tuner_count;
+  g_snprintf (info->device_id_str, sizeof (info->device_id_str), "%08X", device_id);
+
+  return info;
+}
+
+/* A new, unshared info with the same contents, to change before handing
+ * it out in place of @info
+ */
+HdhomerunDeviceInfo *
+hdhomerun_device_info_copy (const HdhomerunDeviceInfo *info)
+{
+  HdhomerunDeviceInfo *copy;
+
+  g_return_val_if_fail (info != NULL, NULL);
+
+  copy = hdhomerun_device_info_new (info->device_id, info->tuner_count);
+  copy->ip_addresses = g_strdupv (info->ip_addresses);
+  copy->control_address = g_strdup (info->control_address);
+  copy->model = g_strdup (info->model);
+
+  return copy;
+}
+
+HdhomerunDeviceInfo *
+hdhomerun_device_info_ref (HdhomerunDeviceInfo *info)
+{
+  g_return_val_if_fail (info != NULL, NULL);
+
+  return g_atomic_rc_box_acquire (info);
+}
+
+static void
+device_info_clear (HdhomerunDeviceInfo *info)
+{
+  g_strfreev (info->ip_addresses);
+  g_free (info->control_address);
+  g_free (info->model);
+}
+
+void
+hdhomerun_device_info_unref (HdhomerunDeviceInfo *info)
+{
+  g_return_if_fail (info != NULL);
+
+  g_atomic_rc_box_release_full (info, (GDestroyNotify) device_info_clear);
+}
+
+/* Whether @a and @b describe the same device in the same state */
+gboolean
+hdhomerun_device_info_equal (const HdhomerunDeviceInfo *a,
+                             const HdhomerunDeviceInfo *b)
+{
+  g_return_val_if_fail (a != NULL, FALSE);
+  g_return_val_if_fail (b != NULL, FALSE);
+
+  return a->device_id == b->device_id &&
+         a->tuner_count == b->tuner_count &&
+         g_strv_equal ((const char * const *)a->ip_addresses,
+                       (const char * const *)b->ip_addresses) &&
+         g_strcmp0 (a->control_address, b->control_address) == 0 &&
+         g_strcmp0 (a->model, b->model) == 0;
+}
+
+static HdhomerunDeviceInfo *
+device_info_from_discover (struct hdhomerun_discover2_device_t *device)
+{
+  const HdhomerunBackend *backend = hdhomerun_backend_get_default ();
+  g_autoptr(GStrvBuilder) builder = g_strv_builder_new ();
+  struct hdhomerun_discover2_device_if_t *device_if;
+  HdhomerunDeviceInfo *info;
+
+  info = hdhomerun_device_info_new (backend->discover_device_get_device_id (device),
+                                    backend->discover_device_get_tuner_count (device));
+
+  /* Record every network interface the device answered on */
+  device_if = backend->discover_iter_device_if_first (device);
+  while (device_if)
+    {
+      struct sockaddr_storage ip_address;
+      char ip_address_str[HDHOMERUN_IP_STRING_SIZE];
+
+      backend->discover_device_if_get_ip_addr (device_if, &ip_address);
+      /* Convert IP address to string, FALSE omits port for display */
+      hdhomerun_sock_sockaddr_to_ip_str (ip_address_str, (struct sockaddr *)&ip_address, FALSE);
+      g_strv_builder_add (builder, ip_address_str);
+
+      device_if = backend->discover_iter_device_if_next (device_if);
+    }
+
+  info->ip_addresses = g_strv_builder_end (builder);
+
+  return info;
+}
+
+/* Asks the device for its model over each of its interfaces and keeps
+ * the one that answered fastest for control traffic. Single-homed devices
+ * only cost the one query needed for the model anyway.
+ */
+static void
+probe_interfaces (HdhomerunDeviceInfo *info)
+{
+  const HdhomerunBackend *backend = hdhomerun_backend_get_default ();
+  gint64 trace = hdhomerun_trace_begin ();
+  gint64 best_rtt = G_MAXINT64;
+
+  for (guint i = 0; info->ip_addresses[i] != NULL; i++)
+    {
+      struct hdhomerun_device_t *hd;
+      const char *model;
+      gint64 start;
+      gint64 rtt;
+
+      hd = backend->device_create_from_str (info->ip_addresses[i]);
+      if (!hd)
+        continue;
+
+      start = g_get_monotonic_time ();
+      model = backend->device_get_model_str (hd);
+      rtt = g_get_monotonic_time () - start;
+
+      if (model && rtt < best_rtt)
+        {
+          best_rtt = rtt;
+          g_free (info->model);
+          info->model = g_strdup (model);
+          g_free (info->control_address);
+          info->control_address = g_strdup (info->ip_addresses[i]);
+        }
+
+      backend->device_destroy (hd);
+    }
+
+  /* Nothing answered; fall back to the first address discovery saw */
+  if (info->control_address == NULL)
+    info->control_address = g_strdup (info->ip_addresses[0]);
+
+  hdhomerun_trace_end (trace, "probe-interfaces", "%s over %u interface(s)",
+                       info->device_id_str, g_strv_length (info->ip_addresses));
+}
+
+/* The largest number of devices asked for their model at once */
+#define MAX_PARALLEL_QUERIES 16
+
+/* One discovery request on its own socket. Every probe of a pass runs on
+ * its own thread, so a pass takes as long as its slowest probe.
+ */
+typedef struct
+{
+  uint32_t flags;                  /* Broadcast flags, 0 for a targeted probe */
+  struct sockaddr_storage target;
+  char *label;
+  GPtrArray *devices;              /* HdhomerunDeviceInfo */
+} DiscoveryProbe;
+
+static DiscoveryProbe *
+discovery_probe_new (uint32_t    flags,
+                     const char *label)
+{
+  DiscoveryProbe *probe;
+
+  probe = g_new0 (DiscoveryProbe, 1);
+  probe->flags = flags;
+  probe->label = g_strdup (label);
+  probe->devices = g_ptr_array_new_with_free_func ((GDestroyNotify) hdhomerun_device_info_unref);
+
+  return probe;
+}
+
+static void
+discovery_probe_free (DiscoveryProbe *probe)
+{
+  g_ptr_array_unref (probe->devices);
+  g_free (probe->label);
+  g_free (probe);
+}
+
+static void
+run_probe (gpointer data,
+           gpointer user_data)
+{
+  const HdhomerunBackend *backend = hdhomerun_backend_get_default ();
+  gint64 trace = hdhomerun_trace_begin ();
+  DiscoveryProbe *probe = data;
+  struct hdhomerun_discover_t *ds;
+  struct hdhomerun_discover2_device_t *device;
+  uint32_t device_types[1];
+  int ret;
+
+  (void)user_data; /* unused */
+
+  ds = backend->discover_create ();
+  if (!ds)
+    {
+      g_warning ("Failed to initialize device discovery for %s", probe->label);
+      return;
+    }
+
+  device_types[0] = HDHOMERUN_DEVICE_TYPE_TUNER;
+
+  /* These block for the full discovery timeout */
+  if (probe->flags != 0)
+    ret = backend->discover_find_devices_broadcast (ds, probe->flags, device_types, 1);
+  else
+    ret = backend->discover_find_devices_targeted (ds, (struct sockaddr *)&probe->target,
+                                                   device_types, 1);
+
+  if (ret < 0)
+    g_message ("No device answered %s", probe->label);
+
+  device = ret < 0 ? NULL : backend->discover_iter_device_first (ds);
+  while (device)
+    {
+      g_ptr_array_add (probe->devices, device_info_from_discover (device));
+      device = backend->discover_iter_device_next (device);
+    }
+
+  backend->discover_destroy (ds);
+
+  hdhomerun_trace_end (trace, "discovery-probe", "%s: %u device(s)",
+                       probe->label, probe->devices->len);
+}
+
+static void
+probe_interfaces_func (gpointer data,
+                       gpointer user_data)
+{
+  HdhomerunDeviceInfo *info = data;
+  GCancellable *cancellable = user_data;
+
+  if (!g_cancellable_is_cancelled (cancellable))
+    probe_interfaces (info);
+}
+
+static void
+run_parallel (GPtrArray *jobs,
+              GFunc      func,
+              gpointer   user_data,
+              guint      max_threads)
+{
+  GThreadPool *pool;
+
+  if (jobs->len == 0)
+    return;
+
+  pool = g_thread_pool_new (func, user_data, MIN (jobs->len, max_threads), FALSE, NULL);
+  for (guint i = 0; i < jobs->len; i++)
+    g_thread_pool_push (pool, g_ptr_array_index (jobs, i), NULL);
+
+  /* Wait for every job, including the ones still queued */
+  g_thread_pool_free (pool, FALSE, TRUE);
+}
+
+/* Accepts a single address, or an IPv4 subnet in CIDR notation which is
+ * probed through its directed broadcast address.
+ */
+static DiscoveryProbe *
+probe_for_target (const char *target)
+{
+  g_autoptr(GInetAddressMask) mask = NULL;
+  g_autoptr(GInetAddress) address = NULL;
+  g_autoptr(GSocketAddress) socket_address = NULL;
+  DiscoveryProbe *probe;
+
+  mask = g_inet_address_mask_new_from_string (target, NULL);
+  if (mask == NULL)
+    return NULL;
+
+  if (g_inet_address_mask_get_family (mask) == G_SOCKET_FAMILY_IPV4 &&
+      g_inet_address_mask_get_length (mask) < 32)
+    {
+      guint length = g_inet_address_mask_get_length (mask);
+      guint32 host_bits = length == 0 ? G_MAXUINT32 : G_MAXUINT32 >> length;
+      guint32 broadcast;
+
+      memcpy (&broadcast, g_inet_address_to_bytes (g_inet_address_mask_get_address (mask)), 4);
+      broadcast = GUINT32_TO_BE (GUINT32_FROM_BE (broadcast) | host_bits);
+      address = g_inet_address_new_from_bytes ((const guint8 *)&broadcast, G_SOCKET_FAMILY_IPV4);
+    }
+  else
+    {
+      if (g_inet_address_mask_get_family (mask) == G_SOCKET_FAMILY_IPV6 &&
+          g_inet_address_mask_get_length (mask) < 128)
+        g_warning ("IPv6 subnet %s cannot be probed directly; using its base address", target);
+
+      address = g_object_ref (g_inet_address_mask_get_address (mask));
+    }
+
+  socket_address = g_inet_socket_address_new (address, 0);
+
+  probe = discovery_probe_new (0, target);
+  if (!g_socket_address_to_native (socket_address, &probe->target, sizeof (probe->target), NULL))
+    {
+      discovery_probe_free (probe);
+      return NULL;
+    }
+
+  return probe;
+}
+
+static void
+merge_device (GPtrArray           *snapshot,
+              GHashTable          *devices_by_id,
+              HdhomerunDeviceInfo *info)
+{
+  HdhomerunDeviceInfo *existing;
+  g_autoptr(GStrvBuilder) builder = NULL;
+
+  existing = g_hash_table_lookup (devices_by_id, GUINT_TO_POINTER (info->device_id));
+  if (existing == NULL)
+    {
+      g_hash_table_insert (devices_by_id, GUINT_TO_POINTER (info->device_id), info);
+      g_ptr_array_add (snapshot, info);
+      return;
+    }
+
+  /* The same device answered more than one probe; keep every address */
+  builder = g_strv_builder_new ();
+  g_strv_builder_addv (builder, (const char **)existing->ip_addresses);
+  for (guint i = 0; info->ip_addresses[i] != NULL; i++)
+    {
+      if (!g_strv_contains ((const char * const *)existing->ip_addresses, info->ip_addresses[i]))
+        g_strv_builder_add (builder, info->ip_addresses[i]);
+    }
+
+  g_strfreev (existing->ip_addresses);
+  existing->ip_addresses = g_strv_builder_end (builder);
+  existing->tuner_count = MAX (existing->tuner_count, info->tuner_count);
+
+  hdhomerun_device_info_unref (info);
+}
+
+static void
+find_devices_thread (GTask        *task,
+                     gpointer      source_object,
+                     gpointer      task_data,
+                     GCancellable *cancellable)
+{
+  const char * const *targets = task_data;
+  gint64 trace = hdhomerun_trace_begin ();
+  g_autoptr(GPtrArray) probes = NULL;
+  g_autoptr(GHashTable) devices_by_id = NULL;
+  GPtrArray *snapshot;
+
+  (void)source_object; /* unused */
+
+  probes = g_ptr_array_new_with_free_func ((GDestroyNotify) discovery_probe_free);
+
+  /* libhdhomerun sends an IPv4 broadcast out of every local interface */
+  g_ptr_array_add (probes, discovery_probe_new (HDHOMERUN_DISCOVER_FLAGS_IPV4_GENERAL,
+                                                "the IPv4 broadcast"));
+  g_ptr_array_add (probes, discovery_probe_new (HDHOMERUN_DISCOVER_FLAGS_IPV6_GENERAL,
+                                                "the IPv6 multicast"));
+  g_ptr_array_add (probes, discovery_probe_new (HDHOMERUN_DISCOVER_FLAGS_IPV6_LINKLOCAL,
+                                                "the IPv6 link-local multicast"));
+
+  for (guint i = 0; targets && targets[i]; i++)
+    {
+      DiscoveryProbe *probe = probe_for_target (targets[i]);
+
+      if (probe == NULL)
+        {
+          g_warning ("Ignoring invalid discovery target %s", targets[i]);
+          continue;
+        }
+
+      g_ptr_array_add (probes, probe);
+    }
+
+  run_parallel (probes, run_probe, NULL, probes->len);
+
+  snapshot = g_ptr_array_new_with_free_func ((GDestroyNotify) hdhomerun_device_info_unref);
+  devices_by_id = g_hash_table_new (NULL, NULL);
+
+  for (guint i = 0; i < probes->len; i++)
+    {
+      DiscoveryProbe *probe = g_ptr_array_index (probes, i);
+
+      /* merge_device() takes ownership of each entry */
+      g_ptr_array_set_free_func (probe->devices, NULL);
+      for (guint j = 0; j < probe->devices->len; j++)
+        merge_device (snapshot, devices_by_id, g_ptr_array_index (probe->devices, j));
+    }
+
+  /* The model is not part of the discover reply, so ask each device */
+  run_parallel (snapshot, probe_interfaces_func, cancellable, MAX_PARALLEL_QUERIES);
+
+  if (g_task_return_error_if_cancelled (task))
+    {
+      g_ptr_array_unref (snapshot);
+      return;
+    }
+
+  hdhomerun_trace_end (trace, "discovery", "%u probe(s), %u device(s)",
+                       probes->len, snapshot->len);
+  g_task_return_pointer (task, snapshot, (GDestroyNotify) g_ptr_array_unref);
+}
+
+void
+hdhomerun_discovery_find_devices_async (const char * const  *targets,
+                                        GCancellable        *cancellable,
+                                        GAsyncReadyCallback  callback,
+                                        gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_source_tag (task, hdhomerun_discovery_find_devices_async);
+  g_task_set_task_data (task, g_strdupv ((char **)targets), (GDestroyNotify) g_strfreev);
+
+  /* libhdhomerun cannot interrupt a broadcast in progress, so let a
+   * cancelled scan complete immediately and discard whatever the worker
+   * produces once it finishes.
+   */
+  g_task_set_return_on_cancel (task, TRUE);
+  g_task_run_in_thread (task, find_devices_thread);
+}
+
+GPtrArray *
+hdhomerun_discovery_find_devices_finish (GAsyncResult  *result,
+                                         GError       **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, NULL), NULL);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) ==
+                        hdhomerun_discovery_find_devices_async, NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
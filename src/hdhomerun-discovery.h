@@ -0,0 +1,71 @@
+/* hdhomerun-discovery.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define HDHOMERUN_DEVICE_ID_STRING_SIZE 9  /* 8-char hex ID plus null */
+
+#define HDHOMERUN_TYPE_DEVICE_INFO (hdhomerun_device_info_get_type())
+
+typedef struct _HdhomerunDeviceInfo HdhomerunDeviceInfo;
+
+struct _HdhomerunDeviceInfo
+{
+  guint32   device_id;
+  char      device_id_str[HDHOMERUN_DEVICE_ID_STRING_SIZE];
+  guint     tuner_count;
+  char    **ip_addresses;     /* One entry per network interface */
+  char     *control_address;  /* Interface used for control traffic */
+  char     *model;            /* NULL when the device did not report one */
+};
+
+/* Device info is reference counted and never modified once a discovery
+ * pass has handed it out, so it can be shared freely.
+ */
+GType                hdhomerun_device_info_get_type (void) G_GNUC_CONST;
+HdhomerunDeviceInfo *hdhomerun_device_info_new      (guint32                    device_id,
+                                                     guint                      tuner_count);
+HdhomerunDeviceInfo *hdhomerun_device_info_copy     (const HdhomerunDeviceInfo *info);
+HdhomerunDeviceInfo *hdhomerun_device_info_ref      (HdhomerunDeviceInfo       *info);
+void                 hdhomerun_device_info_unref    (HdhomerunDeviceInfo       *info);
+gboolean             hdhomerun_device_info_equal    (const HdhomerunDeviceInfo *a,
+                                                     const HdhomerunDeviceInfo *b);
+
+/* Discovery broadcasts over IPv4 and IPv6 and probes each entry of
+ * @targets directly, either a single address or an IPv4 subnet in CIDR
+ * notation. All probes run concurrently and their replies are merged by
+ * device ID.
+ *
+ * The result is a GPtrArray of HdhomerunDeviceInfo. It is a snapshot of a
+ * single discovery pass and must be treated as immutable; share it with
+ * g_ptr_array_ref() rather than modifying it.
+ */
+void       hdhomerun_discovery_find_devices_async  (const char * const   *targets,
+                                                    GCancellable         *cancellable,
+                                                    GAsyncReadyCallback   callback,
+                                                    gpointer              user_data);
+GPtrArray *hdhomerun_discovery_find_devices_finish (GAsyncResult         *result,
+                                                    GError              **error);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (HdhomerunDeviceInfo, hdhomerun_device_info_unref)
+
+G_END_DECLS
@@ -0,0 +1,358 @@
+/* hdhomerun-dispatcher.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-dispatcher.h"
+#include "hdhomerun-trace.h"
+
+/* HdhomerunDispatcher carries results from worker threads to the main
+ * thread in batches. Workers queue updates from any thread and the whole
+ * queue is applied in one go, so a hundred tuners reporting several
+ * times a second cost one main loop dispatch per frame, not one idle
+ * source per report.
+ *
+ * The first update queued after a flush wakes the main thread with a
+ * single idle. Without a wake function that idle applies the queue
+ * straight away, which is what the command line gets. The window sets
+ * one that asks its frame clock for the next frame and flushes from
+ * there, so updates land together just before layout and paint. Should
+ * no frame come, because the window is hidden, a timer flushes after
+ * MAX_LATENCY_MS instead.
+ *
+ * An update queued with a key replaces one with the same key that has
+ * not been applied yet, in its place in the queue. Only the latest of a
+ * stream of superseding values, such as the programs of a tuner, is
+ * ever applied.
+ *
+ * Updates are applied in the order they were queued. A flush takes only
+ * what was queued when it started, one update at a time off the head,
+ * so a flush nested in an update carries on in order and the rest wait
+ * for the next wake.
+ */
+
+#define MAX_LATENCY_MS 100
+
+typedef struct
+{
+  gconstpointer key;                /* Or NULL */
+  HdhomerunDispatchFunc func;
+  gpointer user_data;
+  GDestroyNotify destroy;
+} Update;
+
+struct _HdhomerunDispatcher
+{
+  GObject parent_instance;
+
+  GMutex lock;
+  GQueue queue;                     /* Update */
+  GHashTable *keyed;                /* key -> link in queue */
+  gboolean scheduled;               /* A wake is on its way */
+
+  /* Main thread only */
+  HdhomerunDispatcherWakeFunc wake;
+  gpointer wake_data;
+  guint fallback_id;
+};
+
+G_DEFINE_FINAL_TYPE (HdhomerunDispatcher, hdhomerun_dispatcher, G_TYPE_OBJECT)
+
+static void
+update_free (Update *update)
+{
+  if (update->destroy != NULL)
+    update->destroy (update->user_data);
+  g_free (update);
+}
+
+static gboolean
+on_fallback (gpointer user_data)
+{
+  HdhomerunDispatcher *self = user_data;
+
+  self->fallback_id = 0;
+  hdhomerun_dispatcher_flush (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+on_wake (gpointer user_data)
+{
+  HdhomerunDispatcher *self = user_data;
+
+  if (self->wake == NULL)
+    {
+      hdhomerun_dispatcher_flush (self);
+      return G_SOURCE_REMOVE;
+    }
+
+  self->wake (self, self->wake_data);
+  if (self->fallback_id == 0)
+    self->fallback_id = g_timeout_add (MAX_LATENCY_MS, on_fallback, self);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+queue_update (HdhomerunDispatcher   *self,
+              gconstpointer          key,
+              HdhomerunDispatchFunc  func,
+              gpointer               user_data,
+              GDestroyNotify         destroy)
+{
+  Update *update;
+  GList *link;
+  gboolean wake = FALSE;
+
+  g_mutex_lock (&self->lock);
+
+  link = key != NULL ? g_hash_table_lookup (self->keyed, key) : NULL;
+  if (link != NULL)
+    {
+      Update replaced;
+
+      /* Take the place of the one superseded, and free it outside the lock */
+      update = link->data;
+      replaced = *update;
+      update->func = func;
+      update->user_data = user_data;
+      update->destroy = destroy;
+      g_mutex_unlock (&self->lock);
+
+      if (replaced.destroy != NULL)
+        replaced.destroy (replaced.user_data);
+      return;
+    }
+
+  update = g_new0 (Update, 1);
+  update->key = key;
+  update->func = func;
+  update->user_data = user_data;
+  update->destroy = destroy;
+  g_queue_push_tail (&self->queue, update);
+  if (key != NULL)
+    g_hash_table_insert (self->keyed, (gpointer) key, self->queue.tail);
+
+  if (!self->scheduled)
+    {
+      self->scheduled = TRUE;
+      wake = TRUE;
+    }
+
+  g_mutex_unlock (&self->lock);
+
+  if (wake)
+    {
+      GSource *source = g_idle_source_new ();
+
+      g_source_set_priority (source, G_PRIORITY_DEFAULT);
+      g_source_set_callback (source, on_wake, g_object_ref (self), g_object_unref);
+      g_source_set_static_name (source, "[hdhomerun] dispatcher wake");
+      g_source_attach (source, NULL);
+      g_source_unref (source);
+    }
+}
+
+/**
+ * hdhomerun_dispatcher_push:
+ * @self: a #HdhomerunDispatcher
+ * @func: applies the update
+ * @user_data: data for @func
+ * @destroy: (nullable): frees @user_data once @func has run
+ *
+ * Queue an update to be applied on the main thread with the next batch.
+ * Can be called from any thread.
+ */
+void
+hdhomerun_dispatcher_push (HdhomerunDispatcher   *self,
+                           HdhomerunDispatchFunc  func,
+                           gpointer               user_data,
+                           GDestroyNotify         destroy)
+{
+  g_return_if_fail (HDHOMERUN_IS_DISPATCHER (self));
+  g_return_if_fail (func != NULL);
+
+  queue_update (self, NULL, func, user_data, destroy);
+}
+
+/**
+ * hdhomerun_dispatcher_push_keyed:
+ * @self: a #HdhomerunDispatcher
+ * @key: identifies what the update is about, such as the object it is for
+ * @func: applies the update
+ * @user_data: data for @func
+ * @destroy: (nullable): frees @user_data once @func has run, or once
+ *   it has been superseded
+ *
+ * Like hdhomerun_dispatcher_push(), but replaces an update queued with
+ * the same @key that has not been applied yet.
+ */
+void
+hdhomerun_dispatcher_push_keyed (HdhomerunDispatcher   *self,
+                                 gconstpointer          key,
+                                 HdhomerunDispatchFunc  func,
+                                 gpointer               user_data,
+                                 GDestroyNotify         destroy)
+{
+  g_return_if_fail (HDHOMERUN_IS_DISPATCHER (self));
+  g_return_if_fail (key != NULL);
+  g_return_if_fail (func != NULL);
+
+  queue_update (self, key, func, user_data, destroy);
+}
+
+/**
+ * hdhomerun_dispatcher_flush:
+ * @self: a #HdhomerunDispatcher
+ *
+ * Apply every update queued so far. Called by the wake function's frame,
+ * and by anything that must see all results handed over so far, such as
+ * the end of the work that produced them.
+ */
+void
+hdhomerun_dispatcher_flush (HdhomerunDispatcher *self)
+{
+  gint64 trace = hdhomerun_trace_begin ();
+  guint n_queued;
+  guint n_applied = 0;
+
+  g_return_if_fail (HDHOMERUN_IS_DISPATCHER (self));
+
+  g_clear_handle_id (&self->fallback_id, g_source_remove);
+
+  /* Anything queued from here on wakes the main thread again */
+  g_mutex_lock (&self->lock);
+  self->scheduled = FALSE;
+  n_queued = self->queue.length;
+  g_mutex_unlock (&self->lock);
+
+  while (n_applied < n_queued)
+    {
+      Update *update;
+
+      g_mutex_lock (&self->lock);
+      update = g_queue_pop_head (&self->queue);
+      if (update != NULL && update->key != NULL)
+        g_hash_table_remove (self->keyed, update->key);
+      g_mutex_unlock (&self->lock);
+
+      /* A nested flush got to the rest */
+      if (update == NULL)
+        break;
+
+      update->func (update->user_data);
+      update_free (update);
+      n_applied++;
+    }
+
+  if (n_applied > 0)
+    hdhomerun_trace_end (trace, "dispatch", "%u updates", n_applied);
+}
+
+/**
+ * hdhomerun_dispatcher_set_wake_func:
+ * @self: a #HdhomerunDispatcher
+ * @wake: asks for a flush soon
+ * @user_data: data for @wake
+ *
+ * Have queued updates applied when @wake gets round to it, rather than
+ * as soon as the main thread is idle. Replaces any previous wake function.
+ */
+void
+hdhomerun_dispatcher_set_wake_func (HdhomerunDispatcher         *self,
+                                    HdhomerunDispatcherWakeFunc  wake,
+                                    gpointer                     user_data)
+{
+  g_return_if_fail (HDHOMERUN_IS_DISPATCHER (self));
+  g_return_if_fail (wake != NULL);
+
+  self->wake = wake;
+  self->wake_data = user_data;
+}
+
+/**
+ * hdhomerun_dispatcher_remove_wake_func:
+ * @self: a #HdhomerunDispatcher
+ * @user_data: the data the wake function was set with
+ *
+ * Go back to applying updates when the main thread is idle, unless the
+ * wake function was replaced by someone else meanwhile. Updates already
+ * waiting for a frame are applied now.
+ */
+void
+hdhomerun_dispatcher_remove_wake_func (HdhomerunDispatcher *self,
+                                       gpointer             user_data)
+{
+  g_return_if_fail (HDHOMERUN_IS_DISPATCHER (self));
+
+  if (self->wake == NULL || self->wake_data != user_data)
+    return;
+
+  self->wake = NULL;
+  self->wake_data = NULL;
+  hdhomerun_dispatcher_flush (self);
+}
+
+/**
+ * hdhomerun_dispatcher_get_default:
+ *
+ * Returns: (transfer none): the dispatcher of the main thread
+ */
+HdhomerunDispatcher *
+hdhomerun_dispatcher_get_default (void)
+{
+  static HdhomerunDispatcher *default_dispatcher;
+  static gsize initialized;
+
+  if (g_once_init_enter (&initialized))
+    {
+      default_dispatcher = g_object_new (HDHOMERUN_TYPE_DISPATCHER, NULL);
+      g_once_init_leave (&initialized, 1);
+    }
+
+  return default_dispatcher;
+}
+
+static void
+hdhomerun_dispatcher_finalize (GObject *object)
+{
+  HdhomerunDispatcher *self = (HdhomerunDispatcher *)object;
+
+  g_clear_handle_id (&self->fallback_id, g_source_remove);
+  g_queue_clear_full (&self->queue, (GDestroyNotify) update_free);
+  g_hash_table_unref (self->keyed);
+  g_mutex_clear (&self->lock);
+
+  G_OBJECT_CLASS (hdhomerun_dispatcher_parent_class)->finalize (object);
+}
+
+static void
+hdhomerun_dispatcher_class_init (HdhomerunDispatcherClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = hdhomerun_dispatcher_finalize;
+}
+
+static void
+hdhomerun_dispatcher_init (HdhomerunDispatcher *self)
+{
+  g_mutex_init (&self->lock);
+  g_queue_init (&self->queue);
+  self->keyed = g_hash_table_new (NULL, NULL);
+}
@@ -0,0 +1,57 @@
+/* hdhomerun-dispatcher.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define HDHOMERUN_TYPE_DISPATCHER (hdhomerun_dispatcher_get_type())
+
+G_DECLARE_FINAL_TYPE (HdhomerunDispatcher, hdhomerun_dispatcher, HDHOMERUN, DISPATCHER, GObject)
+
+/* Applies an update on the main thread. @user_data is freed with the
+ * destroy notify it was queued with right after.
+ */
+typedef void (*HdhomerunDispatchFunc) (gpointer user_data);
+
+/* Asks for hdhomerun_dispatcher_flush() to be called soon, such as on
+ * the next frame. Called on the main thread.
+ */
+typedef void (*HdhomerunDispatcherWakeFunc) (HdhomerunDispatcher *self,
+                                             gpointer             user_data);
+
+HdhomerunDispatcher *hdhomerun_dispatcher_get_default       (void);
+void                 hdhomerun_dispatcher_push              (HdhomerunDispatcher        *self,
+                                                             HdhomerunDispatchFunc       func,
+                                                             gpointer                    user_data,
+                                                             GDestroyNotify              destroy);
+void                 hdhomerun_dispatcher_push_keyed        (HdhomerunDispatcher        *self,
+                                                             gconstpointer               key,
+                                                             HdhomerunDispatchFunc       func,
+                                                             gpointer                    user_data,
+                                                             GDestroyNotify              destroy);
+void                 hdhomerun_dispatcher_flush             (HdhomerunDispatcher        *self);
+void                 hdhomerun_dispatcher_set_wake_func     (HdhomerunDispatcher        *self,
+                                                             HdhomerunDispatcherWakeFunc wake,
+                                                             gpointer                    user_data);
+void                 hdhomerun_dispatcher_remove_wake_func  (HdhomerunDispatcher        *self,
+                                                             gpointer                    user_data);
+
+G_END_DECLS
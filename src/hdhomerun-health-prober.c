@@ -0,0 +1,656 @@
+/* hdhomerun-health-prober.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-health-prober.h"
+#include "hdhomerun-backend.h"
+#include "hdhomerun-connection-pool.h"
+#include "hdhomerun-dispatcher.h"
+
+/* HdhomerunHealthProber measures how well each interface of each known
+ * device answers control requests, and keeps control traffic on the
+ * best one.
+ *
+ * Discovery picks the interface that answered a single request fastest,
+ * which is a coin toss on a busy network. Every PROBE_INTERVAL_SECONDS
+ * each device gets one pass on a worker thread that sends a cheap
+ * request over every interface, each on a control socket of its own
+ * that is kept open between passes. Round-trip time and loss are both
+ * smoothed, and the score of a device is that of its best interface.
+ * Finished passes are applied together through the HdhomerunDispatcher.
+ *
+ * Control traffic only moves to another interface when it scores clearly
+ * better than the current one, so two similar paths do not trade places
+ * on every pass. The health of a device is stored with
+ * hdhomerun_device_store_set_health(), which sorts degraded devices to
+ * the end of the list before they stop answering altogether.
+ */
+
+#define PROBE_INTERVAL_SECONDS 5
+#define SMOOTHING              0.25  /* Weight of the newest sample */
+#define SWITCH_MARGIN          10.0  /* Points a new interface must win by */
+#define GOOD_SCORE             70.0
+#define DEGRADED_SCORE         30.0
+#define RTT_CEILING_MS         100.0
+#define MAX_PROBE_THREADS      16
+
+typedef struct
+{
+  char *address;
+  struct hdhomerun_device_t *hd;  /* NULL while a pass has it */
+  double rtt_ms;                  /* Smoothed, of answered requests */
+  double loss;                    /* Smoothed, 0 to 1 */
+  guint samples;
+} InterfaceProbe;
+
+typedef struct
+{
+  HdhomerunDeviceInfo *info;      /* As last handed out */
+  GPtrArray *interfaces;          /* InterfaceProbe */
+  HdhomerunDeviceHealth health;
+  guint generation;               /* Tells a re-added device apart */
+  gboolean busy;
+} DeviceProbe;
+
+typedef struct
+{
+  char *address;
+  struct hdhomerun_device_t *hd;  /* Owned for the pass */
+  gboolean answered;
+  gint64 rtt;
+} ProbeSample;
+
+typedef struct
+{
+  HdhomerunHealthProber *self;    /* Held */
+  char *device_id;
+  guint generation;               /* Of the DeviceProbe that started it */
+  GArray *samples;                /* ProbeSample */
+} ProbeData;
+
+struct _HdhomerunHealthProber
+{
+  GObject parent_instance;
+
+  HdhomerunDeviceStore *devices;
+  GThreadPool *pool;              /* Runs a ProbeData per pass */
+  GHashTable *probes;             /* device ID -> DeviceProbe */
+  gboolean active;
+  guint timeout_id;
+  guint next_generation;
+};
+
+G_DEFINE_FINAL_TYPE (HdhomerunHealthProber, hdhomerun_health_prober, G_TYPE_OBJECT)
+
+enum {
+  PROP_0,
+  PROP_ACTIVE,
+  N_PROPS
+};
+
+enum {
+  INTERFACE_CHANGED,
+  N_SIGNALS
+};
+
+static GParamSpec *properties [N_PROPS];
+static guint signals [N_SIGNALS];
+
+static void
+interface_probe_free (InterfaceProbe *iface)
+{
+  g_clear_pointer (&iface->hd, hdhomerun_backend_get_default ()->device_destroy);
+  g_free (iface->address);
+  g_free (iface);
+}
+
+static void
+device_probe_free (DeviceProbe *probe)
+{
+  g_clear_pointer (&probe->info, hdhomerun_device_info_unref);
+  g_ptr_array_unref (probe->interfaces);
+  g_free (probe);
+}
+
+static void
+probe_sample_clear (ProbeSample *sample)
+{
+  g_clear_pointer (&sample->hd, hdhomerun_backend_get_default ()->device_destroy);
+  g_free (sample->address);
+}
+
+static void
+probe_data_free (ProbeData *data)
+{
+  g_array_unref (data->samples);
+  g_free (data->device_id);
+  g_object_unref (data->self);
+  g_free (data);
+}
+
+static void apply_probe (gpointer user_data);
+
+/* 100 for an interface that answers everything at once, falling with
+ * loss and, much more gently, with round-trip time
+ */
+static double
+interface_score (const InterfaceProbe *iface)
+{
+  double score;
+
+  score = (1.0 - iface->loss) * 100.0 - MIN (iface->rtt_ms, RTT_CEILING_MS) / 4.0;
+
+  return CLAMP (score, 0.0, 100.0);
+}
+
+static InterfaceProbe *
+find_interface (DeviceProbe *probe,
+                const char  *address)
+{
+  if (address == NULL)
+    return NULL;
+
+  for (guint i = 0; i < probe->interfaces->len; i++)
+    {
+      InterfaceProbe *iface = g_ptr_array_index (probe->interfaces, i);
+
+      if (g_str_equal (iface->address, address))
+        return iface;
+    }
+
+  return NULL;
+}
+
+/* The probed interface with the highest score, NULL before any pass */
+static InterfaceProbe *
+find_best_interface (DeviceProbe *probe)
+{
+  InterfaceProbe *best = NULL;
+
+  for (guint i = 0; i < probe->interfaces->len; i++)
+    {
+      InterfaceProbe *iface = g_ptr_array_index (probe->interfaces, i);
+
+      if (iface->samples == 0)
+        continue;
+
+      if (best == NULL || interface_score (iface) > interface_score (best))
+        best = iface;
+    }
+
+  return best;
+}
+
+static HdhomerunDeviceHealth
+device_health (DeviceProbe *probe)
+{
+  InterfaceProbe *best = find_best_interface (probe);
+  double score;
+
+  if (best == NULL)
+    return HDHOMERUN_DEVICE_HEALTH_UNKNOWN;
+
+  score = interface_score (best);
+  if (score >= GOOD_SCORE)
+    return HDHOMERUN_DEVICE_HEALTH_GOOD;
+  if (score >= DEGRADED_SCORE)
+    return HDHOMERUN_DEVICE_HEALTH_DEGRADED;
+
+  return HDHOMERUN_DEVICE_HEALTH_UNREACHABLE;
+}
+
+static void
+probe_thread (gpointer data_,
+              gpointer user_data)
+{
+  ProbeData *data = data_;
+
+  (void)user_data; /* unused */
+
+  for (guint i = 0; i < data->samples->len; i++)
+    {
+      ProbeSample *sample = &g_array_index (data->samples, ProbeSample, i);
+      char *value = NULL;
+      char *error = NULL;
+      gint64 start;
+      int ret;
+
+      if (sample->hd == NULL)
+        sample->hd = hdhomerun_backend_get_default ()->device_create_from_str (sample->address);
+      if (sample->hd == NULL)
+        continue;
+
+      start = g_get_monotonic_time ();
+      ret = hdhomerun_backend_get_default ()->device_get_var (sample->hd, "/sys/model", &value, &error);
+      sample->rtt = g_get_monotonic_time () - start;
+      sample->answered = ret > 0 && error == NULL;
+
+      /* Start over on a fresh socket next pass */
+      if (ret < 0)
+        g_clear_pointer (&sample->hd, hdhomerun_backend_get_default ()->device_destroy);
+    }
+
+  hdhomerun_dispatcher_push (hdhomerun_dispatcher_get_default (), apply_probe,
+                             data, (GDestroyNotify) probe_data_free);
+}
+
+static void
+update_interface (InterfaceProbe    *iface,
+                  const ProbeSample *sample)
+{
+  double rtt_ms = sample->rtt / 1000.0;
+  double lost = sample->answered ? 0.0 : 1.0;
+
+  if (iface->samples == 0)
+    {
+      iface->loss = lost;
+      iface->rtt_ms = sample->answered ? rtt_ms : RTT_CEILING_MS;
+    }
+  else
+    {
+      iface->loss += SMOOTHING * (lost - iface->loss);
+      if (sample->answered)
+        iface->rtt_ms += SMOOTHING * (rtt_ms - iface->rtt_ms);
+    }
+
+  iface->samples++;
+}
+
+static void
+switch_interface (HdhomerunHealthProber *self,
+                  DeviceProbe           *probe,
+                  InterfaceProbe        *iface)
+{
+  HdhomerunDeviceInfo *info;
+
+  g_message ("Device %s: moving control traffic from %s to %s (%.1f ms, %.0f%% loss)",
+             probe->info->device_id_str,
+             probe->info->control_address ? probe->info->control_address : "nowhere",
+             iface->address, iface->rtt_ms, iface->loss * 100.0);
+
+  info = hdhomerun_device_info_copy (probe->info);
+  g_free (info->control_address);
+  info->control_address = g_strdup (iface->address);
+  g_clear_pointer (&probe->info, hdhomerun_device_info_unref);
+  probe->info = info;
+
+  hdhomerun_device_store_set_device (self->devices, info);
+  hdhomerun_connection_pool_set_device_address (hdhomerun_connection_pool_get_default (),
+                                                info->device_id_str, info->control_address);
+  g_signal_emit (self, signals [INTERFACE_CHANGED], 0, info);
+}
+
+static void
+apply_probe (gpointer user_data)
+{
+  ProbeData *data = user_data;
+  HdhomerunHealthProber *self = data->self;
+  HdhomerunDeviceHealth health;
+  InterfaceProbe *current;
+  InterfaceProbe *best;
+  DeviceProbe *probe;
+
+  /* Forgotten meanwhile, maybe added again with a pass of its own in
+   * flight; the samples close their sockets.
+   */
+  probe = g_hash_table_lookup (self->probes, data->device_id);
+  if (probe == NULL || probe->generation != data->generation)
+    return;
+
+  probe->busy = FALSE;
+
+  for (guint i = 0; i < data->samples->len; i++)
+    {
+      ProbeSample *sample = &g_array_index (data->samples, ProbeSample, i);
+      InterfaceProbe *iface = find_interface (probe, sample->address);
+
+      /* The interface went away during the pass */
+      if (iface == NULL || iface->hd != NULL)
+        continue;
+
+      iface->hd = g_steal_pointer (&sample->hd);
+      update_interface (iface, sample);
+    }
+
+  current = find_interface (probe, probe->info->control_address);
+  best = find_best_interface (probe);
+  if (best != NULL && best != current && best->loss < 1.0 &&
+      (current == NULL || current->samples == 0 ||
+       interface_score (best) > interface_score (current) + SWITCH_MARGIN))
+    switch_interface (self, probe, best);
+
+  health = device_health (probe);
+  if (health != probe->health)
+    {
+      g_autofree char *name = g_enum_to_string (HDHOMERUN_TYPE_DEVICE_HEALTH, health);
+
+      g_debug ("Device %s is now %s", probe->info->device_id_str, name);
+      probe->health = health;
+      hdhomerun_device_store_set_health (self->devices, probe->info->device_id_str, health);
+    }
+}
+
+static void
+probe_device (HdhomerunHealthProber *self,
+              DeviceProbe           *probe)
+{
+  ProbeData *data;
+
+  if (probe->busy || probe->interfaces->len == 0)
+    return;
+
+  data = g_new0 (ProbeData, 1);
+  data->self = g_object_ref (self);
+  data->device_id = g_strdup (probe->info->device_id_str);
+  data->generation = probe->generation;
+  data->samples = g_array_sized_new (FALSE, TRUE, sizeof (ProbeSample), probe->interfaces->len);
+  g_array_set_clear_func (data->samples, (GDestroyNotify) probe_sample_clear);
+
+  /* The pass owns the sockets until it is done */
+  for (guint i = 0; i < probe->interfaces->len; i++)
+    {
+      InterfaceProbe *iface = g_ptr_array_index (probe->interfaces, i);
+      ProbeSample sample = { 0 };
+
+      sample.address = g_strdup (iface->address);
+      sample.hd = g_steal_pointer (&iface->hd);
+      g_array_append_val (data->samples, sample);
+    }
+
+  probe->busy = TRUE;
+
+  g_thread_pool_push (self->pool, data, NULL);
+}
+
+static gboolean
+on_timeout (gpointer user_data)
+{
+  HdhomerunHealthProber *self = user_data;
+  GHashTableIter iter;
+  DeviceProbe *probe;
+
+  g_hash_table_iter_init (&iter, self->probes);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &probe))
+    probe_device (self, probe);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+update_timeout (HdhomerunHealthProber *self)
+{
+  gboolean wanted = self->active && g_hash_table_size (self->probes) > 0;
+
+  if (!wanted)
+    g_clear_handle_id (&self->timeout_id, g_source_remove);
+  else if (self->timeout_id == 0)
+    self->timeout_id = g_timeout_add_seconds (PROBE_INTERVAL_SECONDS, on_timeout, self);
+}
+
+/* Probe exactly the interfaces @info lists, keeping what is known about
+ * the ones that stay
+ */
+static void
+sync_interfaces (DeviceProbe         *probe,
+                 HdhomerunDeviceInfo *info)
+{
+  GPtrArray *interfaces;
+
+  interfaces = g_ptr_array_new_with_free_func ((GDestroyNotify) interface_probe_free);
+
+  for (guint i = 0; info->ip_addresses != NULL && info->ip_addresses[i] != NULL; i++)
+    {
+      InterfaceProbe *iface = NULL;
+
+      for (guint j = 0; j < probe->interfaces->len && iface == NULL; j++)
+        {
+          InterfaceProbe *old = g_ptr_array_index (probe->interfaces, j);
+
+          if (g_str_equal (old->address, info->ip_addresses[i]))
+            iface = g_ptr_array_steal_index (probe->interfaces, j);
+        }
+
+      if (iface == NULL)
+        {
+          iface = g_new0 (InterfaceProbe, 1);
+          iface->address = g_strdup (info->ip_addresses[i]);
+        }
+
+      g_ptr_array_add (interfaces, iface);
+    }
+
+  g_ptr_array_unref (probe->interfaces);
+  probe->interfaces = interfaces;
+}
+
+/**
+ * hdhomerun_health_prober_apply:
+ * @self: a #HdhomerunHealthProber
+ * @info: a device as discovery last saw it
+ *
+ * Start probing the interfaces of @info, or pick up a changed set of
+ * them for a device already known. Discovery only saw one answer per
+ * interface, so once the interfaces have been probed the current choice
+ * for control traffic is kept over the one discovery made.
+ *
+ * Returns: (transfer full): @info, or a copy using the preferred
+ *   interface for control traffic, to be stored in its place
+ */
+HdhomerunDeviceInfo *
+hdhomerun_health_prober_apply (HdhomerunHealthProber *self,
+                               HdhomerunDeviceInfo   *info)
+{
+  DeviceProbe *probe;
+  InterfaceProbe *preferred = NULL;
+  HdhomerunDeviceInfo *result;
+  gboolean added = FALSE;
+
+  g_return_val_if_fail (HDHOMERUN_IS_HEALTH_PROBER (self), NULL);
+  g_return_val_if_fail (info != NULL, NULL);
+
+  probe = g_hash_table_lookup (self->probes, info->device_id_str);
+  if (probe == NULL)
+    {
+      probe = g_new0 (DeviceProbe, 1);
+      probe->interfaces = g_ptr_array_new_with_free_func ((GDestroyNotify) interface_probe_free);
+      probe->generation = self->next_generation++;
+      added = TRUE;
+    }
+
+  sync_interfaces (probe, info);
+
+  if (probe->info != NULL)
+    preferred = find_interface (probe, probe->info->control_address);
+  if (preferred == NULL || preferred->samples == 0)
+    preferred = find_best_interface (probe);
+
+  if (preferred != NULL && g_strcmp0 (preferred->address, info->control_address) != 0)
+    {
+      result = hdhomerun_device_info_copy (info);
+      g_free (result->control_address);
+      result->control_address = g_strdup (preferred->address);
+    }
+  else
+    {
+      result = hdhomerun_device_info_ref (info);
+    }
+
+  g_clear_pointer (&probe->info, hdhomerun_device_info_unref);
+  probe->info = hdhomerun_device_info_ref (result);
+
+  if (added)
+    {
+      g_hash_table_insert (self->probes, g_strdup (info->device_id_str), probe);
+      update_timeout (self);
+      if (self->active)
+        probe_device (self, probe);
+    }
+
+  return result;
+}
+
+/**
+ * hdhomerun_health_prober_forget:
+ * @self: a #HdhomerunHealthProber
+ * @device_id: a device that went away
+ *
+ * Stop probing @device_id and close its sockets. A pass that is still
+ * running closes its own once it is done.
+ */
+void
+hdhomerun_health_prober_forget (HdhomerunHealthProber *self,
+                                const char            *device_id)
+{
+  g_return_if_fail (HDHOMERUN_IS_HEALTH_PROBER (self));
+  g_return_if_fail (device_id != NULL);
+
+  g_hash_table_remove (self->probes, device_id);
+  update_timeout (self);
+}
+
+/**
+ * hdhomerun_health_prober_new:
+ * @devices: where to store the health and interface choice of devices
+ *
+ * Returns: (transfer full): a new #HdhomerunHealthProber
+ */
+HdhomerunHealthProber *
+hdhomerun_health_prober_new (HdhomerunDeviceStore *devices)
+{
+  HdhomerunHealthProber *self;
+
+  g_return_val_if_fail (HDHOMERUN_IS_DEVICE_STORE (devices), NULL);
+
+  self = g_object_new (HDHOMERUN_TYPE_HEALTH_PROBER, NULL);
+  self->devices = g_object_ref (devices);
+
+  return self;
+}
+
+static void
+hdhomerun_health_prober_dispose (GObject *object)
+{
+  HdhomerunHealthProber *self = (HdhomerunHealthProber *)object;
+
+  g_clear_handle_id (&self->timeout_id, g_source_remove);
+  g_hash_table_remove_all (self->probes);
+  g_clear_object (&self->devices);
+
+  G_OBJECT_CLASS (hdhomerun_health_prober_parent_class)->dispose (object);
+}
+
+static void
+hdhomerun_health_prober_finalize (GObject *object)
+{
+  HdhomerunHealthProber *self = (HdhomerunHealthProber *)object;
+
+  /* Every pass holds a reference, so none is left running by now */
+  g_thread_pool_free (self->pool, FALSE, TRUE);
+  g_clear_pointer (&self->probes, g_hash_table_unref);
+
+  G_OBJECT_CLASS (hdhomerun_health_prober_parent_class)->finalize (object);
+}
+
+static void
+hdhomerun_health_prober_get_property (GObject    *object,
+                                      guint       prop_id,
+                                      GValue     *value,
+                                      GParamSpec *pspec)
+{
+  HdhomerunHealthProber *self = HDHOMERUN_HEALTH_PROBER (object);
+
+  switch (prop_id)
+    {
+    case PROP_ACTIVE:
+      g_value_set_boolean (value, self->active);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+hdhomerun_health_prober_set_property (GObject      *object,
+                                      guint         prop_id,
+                                      const GValue *value,
+                                      GParamSpec   *pspec)
+{
+  HdhomerunHealthProber *self = HDHOMERUN_HEALTH_PROBER (object);
+
+  switch (prop_id)
+    {
+    case PROP_ACTIVE:
+      if (self->active != g_value_get_boolean (value))
+        {
+          self->active = g_value_get_boolean (value);
+          update_timeout (self);
+          g_object_notify_by_pspec (object, pspec);
+
+          if (self->active)
+            on_timeout (self);
+        }
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+hdhomerun_health_prober_class_init (HdhomerunHealthProberClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = hdhomerun_health_prober_dispose;
+  object_class->finalize = hdhomerun_health_prober_finalize;
+  object_class->get_property = hdhomerun_health_prober_get_property;
+  object_class->set_property = hdhomerun_health_prober_set_property;
+
+  properties [PROP_ACTIVE] =
+    g_param_spec_boolean ("active",
+                          "Active",
+                          "Whether devices are being probed",
+                          TRUE,
+                          (G_PARAM_READWRITE |
+                           G_PARAM_EXPLICIT_NOTIFY |
+                           G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_properties (object_class, N_PROPS, properties);
+
+  /**
+   * HdhomerunHealthProber::interface-changed:
+   * @self: the prober
+   * @info: the device, as now stored
+   *
+   * Emitted after control traffic of a device moved to another interface.
+   */
+  signals [INTERFACE_CHANGED] =
+    g_signal_new ("interface-changed",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL, NULL,
+                  G_TYPE_NONE, 1,
+                  HDHOMERUN_TYPE_DEVICE_INFO);
+}
+
+static void
+hdhomerun_health_prober_init (HdhomerunHealthProber *self)
+{
+  self->probes = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                        g_free, (GDestroyNotify) device_probe_free);
+  self->pool = g_thread_pool_new (probe_thread, NULL, MAX_PROBE_THREADS, FALSE, NULL);
+  self->active = TRUE;
+}
@@ -0,0 +1,37 @@
+/* hdhomerun-health-prober.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "hdhomerun-device-store.h"
+
+G_BEGIN_DECLS
+
+#define HDHOMERUN_TYPE_HEALTH_PROBER (hdhomerun_health_prober_get_type())
+
+G_DECLARE_FINAL_TYPE (HdhomerunHealthProber, hdhomerun_health_prober, HDHOMERUN, HEALTH_PROBER, GObject)
+
+HdhomerunHealthProber *hdhomerun_health_prober_new    (HdhomerunDeviceStore  *devices);
+HdhomerunDeviceInfo   *hdhomerun_health_prober_apply  (HdhomerunHealthProber *self,
+                                                       HdhomerunDeviceInfo   *info);
+void                   hdhomerun_health_prober_forget (HdhomerunHealthProber *self,
+                                                       const char            *device_id);
+
+G_END_DECLS
@@ -0,0 +1,584 @@
+/* hdhomerun-job-scheduler.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-job-scheduler.h"
+#include "hdhomerun-trace.h"
+
+/* HdhomerunJobScheduler runs one action over many tuners or devices
+ * with a cap on how many jobs run at once, overall and per device, so a
+ * bulk action neither floods the network nor queues up on one device's
+ * control socket.
+ *
+ * Jobs wait in a queue per device. Devices with waiting jobs and room
+ * under their cap take turns on a ready queue, so a batch spread over
+ * many devices starts on all of them before any device gets a second
+ * job, and picking the next job is constant time however many wait.
+ *
+ * Every job is reported with ::job-finished. The counters cover the
+ * batch since the scheduler was last idle.
+ */
+
+typedef struct
+{
+  char *device_id;
+  GQueue jobs;
+  guint running;
+  gboolean ready;                   /* On the scheduler's ready queue */
+} DeviceQueue;
+
+typedef struct
+{
+  DeviceQueue *queue;               /* Owned by the scheduler */
+  char *label;
+  HdhomerunJobFunc func;
+  gpointer user_data;
+  GDestroyNotify destroy;
+  gint64 trace;
+} Job;
+
+struct _HdhomerunJobScheduler
+{
+  GObject parent_instance;
+
+  guint max_running;
+  guint max_per_device;
+
+  GHashTable *devices;              /* Device ID -> DeviceQueue */
+  GQueue ready;                     /* DeviceQueues that may start a job */
+  guint n_running;
+
+  guint n_jobs;
+  guint n_done;
+  guint n_failed;
+  guint n_cancelled;
+  GCancellable *cancellable;
+};
+
+G_DEFINE_FINAL_TYPE (HdhomerunJobScheduler, hdhomerun_job_scheduler, G_TYPE_OBJECT)
+
+enum {
+  PROP_0,
+  PROP_MAX_RUNNING,
+  PROP_MAX_PER_DEVICE,
+  PROP_N_JOBS,
+  PROP_N_DONE,
+  PROP_N_FAILED,
+  PROP_N_CANCELLED,
+  N_PROPS
+};
+
+enum {
+  JOB_FINISHED,
+  N_SIGNALS
+};
+
+static GParamSpec *properties [N_PROPS];
+static guint signals [N_SIGNALS];
+
+static void
+job_free (Job *job)
+{
+  if (job->destroy != NULL)
+    job->destroy (job->user_data);
+  g_free (job->label);
+  g_free (job);
+}
+
+static void
+device_queue_free (gpointer data)
+{
+  DeviceQueue *queue = data;
+
+  g_queue_clear_full (&queue->jobs, (GDestroyNotify) job_free);
+  g_free (queue->device_id);
+  g_free (queue);
+}
+
+static void
+mark_ready (HdhomerunJobScheduler *self,
+            DeviceQueue           *queue)
+{
+  if (queue->ready || g_queue_is_empty (&queue->jobs) ||
+      queue->running >= self->max_per_device)
+    return;
+
+  queue->ready = TRUE;
+  g_queue_push_tail (&self->ready, queue);
+}
+
+static void
+forget_if_idle (HdhomerunJobScheduler *self,
+                DeviceQueue           *queue)
+{
+  if (!queue->ready && queue->running == 0 && g_queue_is_empty (&queue->jobs))
+    g_hash_table_remove (self->devices, queue->device_id);
+}
+
+static void dispatch (HdhomerunJobScheduler *self);
+
+static void
+on_job_done (GObject      *source,
+             GAsyncResult *result,
+             gpointer      user_data)
+{
+  HdhomerunJobScheduler *self = HDHOMERUN_JOB_SCHEDULER (source);
+  Job *job = user_data;
+  DeviceQueue *queue = job->queue;
+  g_autofree char *label = NULL;
+  g_autofree char *summary = NULL;
+  g_autoptr(GError) error = NULL;
+
+  summary = g_task_propagate_pointer (G_TASK (result), &error);
+
+  hdhomerun_trace_end (job->trace, "job", "%s", job->label);
+
+  self->n_running--;
+  queue->running--;
+  self->n_done++;
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    self->n_cancelled++;
+  else if (error != NULL)
+    self->n_failed++;
+
+  /* Settled before anyone hears of it, handlers may add or cancel jobs */
+  label = g_steal_pointer (&job->label);
+  job_free (job);
+  mark_ready (self, queue);
+  forget_if_idle (self, queue);
+
+  g_signal_emit (self, signals [JOB_FINISHED], 0, label, summary, error);
+
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_N_CANCELLED]);
+  else if (error != NULL)
+    g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_N_FAILED]);
+  g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_N_DONE]);
+
+  dispatch (self);
+}
+
+static void
+start_job (HdhomerunJobScheduler *self,
+           Job                   *job)
+{
+  GTask *task;
+
+  self->n_running++;
+  job->queue->running++;
+  job->trace = hdhomerun_trace_begin ();
+
+  task = g_task_new (self, self->cancellable, on_job_done, job);
+  g_task_set_source_tag (task, start_job);
+  job->func (task, job->user_data, self->cancellable);
+  g_object_unref (task);
+}
+
+static void
+dispatch (HdhomerunJobScheduler *self)
+{
+  DeviceQueue *queue;
+
+  while (self->n_running < self->max_running &&
+         (queue = g_queue_pop_head (&self->ready)) != NULL)
+    {
+      queue->ready = FALSE;
+      start_job (self, g_queue_pop_head (&queue->jobs));
+      mark_ready (self, queue);
+    }
+}
+
+/* After a limit is raised, devices held back by it can go again */
+static void
+reconsider (HdhomerunJobScheduler *self)
+{
+  GHashTableIter iter;
+  DeviceQueue *queue;
+
+  g_hash_table_iter_init (&iter, self->devices);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &queue))
+    mark_ready (self, queue);
+
+  dispatch (self);
+}
+
+/**
+ * hdhomerun_job_scheduler_new:
+ * @max_running: how many jobs may run at once
+ * @max_per_device: how many of them may be on one device
+ *
+ * Returns: (transfer full): a new #HdhomerunJobScheduler
+ */
+HdhomerunJobScheduler *
+hdhomerun_job_scheduler_new (guint max_running,
+                             guint max_per_device)
+{
+  return g_object_new (HDHOMERUN_TYPE_JOB_SCHEDULER,
+                       "max-running", MAX (max_running, 1),
+                       "max-per-device", MAX (max_per_device, 1),
+                       NULL);
+}
+
+/**
+ * hdhomerun_job_scheduler_add:
+ * @self: a #HdhomerunJobScheduler
+ * @device_id: the device the job talks to
+ * @label: what to call the job in ::job-finished
+ * @func: starts the job
+ * @user_data: for @func
+ * @destroy: (nullable): frees @user_data once the job is done
+ *
+ * Queue a job, starting it at once if there is room. Adding to an idle
+ * scheduler starts a new batch.
+ */
+void
+hdhomerun_job_scheduler_add (HdhomerunJobScheduler *self,
+                             const char            *device_id,
+                             const char            *label,
+                             HdhomerunJobFunc       func,
+                             gpointer               user_data,
+                             GDestroyNotify         destroy)
+{
+  DeviceQueue *queue;
+  Job *job;
+
+  g_return_if_fail (HDHOMERUN_IS_JOB_SCHEDULER (self));
+  g_return_if_fail (device_id != NULL);
+  g_return_if_fail (label != NULL);
+  g_return_if_fail (func != NULL);
+
+  if (!hdhomerun_job_scheduler_is_busy (self))
+    {
+      self->n_jobs = 0;
+      self->n_done = 0;
+      self->n_failed = 0;
+      self->n_cancelled = 0;
+      g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_N_DONE]);
+      g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_N_FAILED]);
+      g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_N_CANCELLED]);
+    }
+
+  if (g_cancellable_is_cancelled (self->cancellable))
+    {
+      g_object_unref (self->cancellable);
+      self->cancellable = g_cancellable_new ();
+    }
+
+  queue = g_hash_table_lookup (self->devices, device_id);
+  if (queue == NULL)
+    {
+      queue = g_new0 (DeviceQueue, 1);
+      queue->device_id = g_strdup (device_id);
+      g_queue_init (&queue->jobs);
+      g_hash_table_insert (self->devices, queue->device_id, queue);
+    }
+
+  job = g_new0 (Job, 1);
+  job->queue = queue;
+  job->label = g_strdup (label);
+  job->func = func;
+  job->user_data = user_data;
+  job->destroy = destroy;
+  g_queue_push_tail (&queue->jobs, job);
+
+  self->n_jobs++;
+  g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_N_JOBS]);
+
+  mark_ready (self, queue);
+  dispatch (self);
+}
+
+/**
+ * hdhomerun_job_scheduler_cancel:
+ * @self: a #HdhomerunJobScheduler
+ *
+ * Drop the jobs that have not started, reporting each as cancelled, and
+ * cancel the running ones. Those finish in their own time.
+ */
+void
+hdhomerun_job_scheduler_cancel (HdhomerunJobScheduler *self)
+{
+  GHashTableIter iter;
+  DeviceQueue *queue;
+  GQueue dropped = G_QUEUE_INIT;
+  Job *job;
+
+  g_return_if_fail (HDHOMERUN_IS_JOB_SCHEDULER (self));
+
+  g_cancellable_cancel (self->cancellable);
+
+  g_queue_clear (&self->ready);
+  g_hash_table_iter_init (&iter, self->devices);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &queue))
+    {
+      queue->ready = FALSE;
+      while ((job = g_queue_pop_head (&queue->jobs)) != NULL)
+        g_queue_push_tail (&dropped, job);
+
+      if (queue->running == 0)
+        g_hash_table_iter_remove (&iter);
+    }
+
+  if (g_queue_is_empty (&dropped))
+    return;
+
+  self->n_done += g_queue_get_length (&dropped);
+  self->n_cancelled += g_queue_get_length (&dropped);
+  while ((job = g_queue_pop_head (&dropped)) != NULL)
+    {
+      g_autoptr(GError) error = g_error_new (G_IO_ERROR, G_IO_ERROR_CANCELLED,
+                                             "Cancelled before it started");
+
+      g_signal_emit (self, signals [JOB_FINISHED], 0, job->label, NULL, error);
+      job_free (job);
+    }
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_N_CANCELLED]);
+  g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_N_DONE]);
+}
+
+/**
+ * hdhomerun_job_scheduler_is_busy:
+ * @self: a #HdhomerunJobScheduler
+ *
+ * Returns: %TRUE while jobs of the batch are waiting or running
+ */
+gboolean
+hdhomerun_job_scheduler_is_busy (HdhomerunJobScheduler *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_JOB_SCHEDULER (self), FALSE);
+
+  return self->n_done < self->n_jobs;
+}
+
+guint
+hdhomerun_job_scheduler_get_n_jobs (HdhomerunJobScheduler *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_JOB_SCHEDULER (self), 0);
+
+  return self->n_jobs;
+}
+
+guint
+hdhomerun_job_scheduler_get_n_done (HdhomerunJobScheduler *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_JOB_SCHEDULER (self), 0);
+
+  return self->n_done;
+}
+
+/**
+ * hdhomerun_job_scheduler_get_n_failed:
+ * @self: a #HdhomerunJobScheduler
+ *
+ * Returns: how many jobs of the batch failed, not counting cancelled ones
+ */
+guint
+hdhomerun_job_scheduler_get_n_failed (HdhomerunJobScheduler *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_JOB_SCHEDULER (self), 0);
+
+  return self->n_failed;
+}
+
+/**
+ * hdhomerun_job_scheduler_get_n_cancelled:
+ * @self: a #HdhomerunJobScheduler
+ *
+ * Returns: how many jobs of the batch were cancelled, started or not
+ */
+guint
+hdhomerun_job_scheduler_get_n_cancelled (HdhomerunJobScheduler *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_JOB_SCHEDULER (self), 0);
+
+  return self->n_cancelled;
+}
+
+static void
+hdhomerun_job_scheduler_dispose (GObject *object)
+{
+  HdhomerunJobScheduler *self = (HdhomerunJobScheduler *)object;
+
+  /* Running jobs hold the scheduler, so only waiting ones are left */
+  g_cancellable_cancel (self->cancellable);
+  g_queue_clear (&self->ready);
+  g_clear_pointer (&self->devices, g_hash_table_unref);
+
+  G_OBJECT_CLASS (hdhomerun_job_scheduler_parent_class)->dispose (object);
+}
+
+static void
+hdhomerun_job_scheduler_finalize (GObject *object)
+{
+  HdhomerunJobScheduler *self = (HdhomerunJobScheduler *)object;
+
+  g_clear_object (&self->cancellable);
+
+  G_OBJECT_CLASS (hdhomerun_job_scheduler_parent_class)->finalize (object);
+}
+
+static void
+hdhomerun_job_scheduler_get_property (GObject    *object,
+                                      guint       prop_id,
+                                      GValue     *value,
+                                      GParamSpec *pspec)
+{
+  HdhomerunJobScheduler *self = HDHOMERUN_JOB_SCHEDULER (object);
+
+  switch (prop_id)
+    {
+    case PROP_MAX_RUNNING:
+      g_value_set_uint (value, self->max_running);
+      break;
+    case PROP_MAX_PER_DEVICE:
+      g_value_set_uint (value, self->max_per_device);
+      break;
+    case PROP_N_JOBS:
+      g_value_set_uint (value, self->n_jobs);
+      break;
+    case PROP_N_DONE:
+      g_value_set_uint (value, self->n_done);
+      break;
+    case PROP_N_FAILED:
+      g_value_set_uint (value, self->n_failed);
+      break;
+    case PROP_N_CANCELLED:
+      g_value_set_uint (value, self->n_cancelled);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+hdhomerun_job_scheduler_set_property (GObject      *object,
+                                      guint         prop_id,
+                                      const GValue *value,
+                                      GParamSpec   *pspec)
+{
+  HdhomerunJobScheduler *self = HDHOMERUN_JOB_SCHEDULER (object);
+
+  switch (prop_id)
+    {
+    case PROP_MAX_RUNNING:
+      self->max_running = g_value_get_uint (value);
+      if (self->devices != NULL)
+        dispatch (self);
+      break;
+    case PROP_MAX_PER_DEVICE:
+      self->max_per_device = g_value_get_uint (value);
+      if (self->devices != NULL)
+        reconsider (self);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+hdhomerun_job_scheduler_class_init (HdhomerunJobSchedulerClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = hdhomerun_job_scheduler_dispose;
+  object_class->finalize = hdhomerun_job_scheduler_finalize;
+  object_class->get_property = hdhomerun_job_scheduler_get_property;
+  object_class->set_property = hdhomerun_job_scheduler_set_property;
+
+  properties [PROP_MAX_RUNNING] =
+    g_param_spec_uint ("max-running",
+                       "Max Running",
+                       "How many jobs may run at once",
+                       1, G_MAXUINT, 8,
+                       (G_PARAM_READWRITE |
+                        G_PARAM_CONSTRUCT |
+                        G_PARAM_STATIC_STRINGS));
+
+  properties [PROP_MAX_PER_DEVICE] =
+    g_param_spec_uint ("max-per-device",
+                       "Max Per Device",
+                       "How many jobs may run at once on one device",
+                       1, G_MAXUINT, 2,
+                       (G_PARAM_READWRITE |
+                        G_PARAM_CONSTRUCT |
+                        G_PARAM_STATIC_STRINGS));
+
+  properties [PROP_N_JOBS] =
+    g_param_spec_uint ("n-jobs",
+                       "Jobs",
+                       "How many jobs the batch has",
+                       0, G_MAXUINT, 0,
+                       (G_PARAM_READABLE |
+                        G_PARAM_EXPLICIT_NOTIFY |
+                        G_PARAM_STATIC_STRINGS));
+
+  properties [PROP_N_DONE] =
+    g_param_spec_uint ("n-done",
+                       "Done",
+                       "How many jobs of the batch have finished, failed or been cancelled",
+                       0, G_MAXUINT, 0,
+                       (G_PARAM_READABLE |
+                        G_PARAM_EXPLICIT_NOTIFY |
+                        G_PARAM_STATIC_STRINGS));
+
+  properties [PROP_N_FAILED] =
+    g_param_spec_uint ("n-failed",
+                       "Failed",
+                       "How many jobs of the batch have failed",
+                       0, G_MAXUINT, 0,
+                       (G_PARAM_READABLE |
+                        G_PARAM_EXPLICIT_NOTIFY |
+                        G_PARAM_STATIC_STRINGS));
+
+  properties [PROP_N_CANCELLED] =
+    g_param_spec_uint ("n-cancelled",
+                       "Cancelled",
+                       "How many jobs of the batch have been cancelled",
+                       0, G_MAXUINT, 0,
+                       (G_PARAM_READABLE |
+                        G_PARAM_EXPLICIT_NOTIFY |
+                        G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_properties (object_class, N_PROPS, properties);
+
+  /**
+   * HdhomerunJobScheduler::job-finished:
+   * @self: a #HdhomerunJobScheduler
+   * @label: the job's label
+   * @summary: (nullable): what the job returned
+   * @error: (nullable): why it failed or was cancelled
+   */
+  signals [JOB_FINISHED] =
+    g_signal_new ("job-finished",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL, NULL,
+                  G_TYPE_NONE, 3,
+                  G_TYPE_STRING,
+                  G_TYPE_STRING,
+                  G_TYPE_ERROR);
+}
+
+static void
+hdhomerun_job_scheduler_init (HdhomerunJobScheduler *self)
+{
+  self->devices = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         NULL, device_queue_free);
+  g_queue_init (&self->ready);
+  self->cancellable = g_cancellable_new ();
+}
@@ -0,0 +1,54 @@
+/* hdhomerun-job-scheduler.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define HDHOMERUN_TYPE_JOB_SCHEDULER (hdhomerun_job_scheduler_get_type())
+
+G_DECLARE_FINAL_TYPE (HdhomerunJobScheduler, hdhomerun_job_scheduler, HDHOMERUN, JOB_SCHEDULER, GObject)
+
+/* A job is started on the main context and finishes by returning on
+ * @task, with g_task_return_pointer() of a summary string (or %NULL) or
+ * g_task_return_error(). It may hand the work to a thread or wait on
+ * signals in between. @task carries the scheduler's cancellable.
+ */
+typedef void (*HdhomerunJobFunc) (GTask        *task,
+                                  gpointer      user_data,
+                                  GCancellable *cancellable);
+
+HdhomerunJobScheduler *hdhomerun_job_scheduler_new           (guint                  max_running,
+                                                              guint                  max_per_device);
+void                   hdhomerun_job_scheduler_add           (HdhomerunJobScheduler *self,
+                                                              const char            *device_id,
+                                                              const char            *label,
+                                                              HdhomerunJobFunc       func,
+                                                              gpointer               user_data,
+                                                              GDestroyNotify         destroy);
+void                   hdhomerun_job_scheduler_cancel        (HdhomerunJobScheduler *self);
+gboolean               hdhomerun_job_scheduler_is_busy       (HdhomerunJobScheduler *self);
+guint                  hdhomerun_job_scheduler_get_n_jobs    (HdhomerunJobScheduler *self);
+guint                  hdhomerun_job_scheduler_get_n_done    (HdhomerunJobScheduler *self);
+guint                  hdhomerun_job_scheduler_get_n_failed  (HdhomerunJobScheduler *self);
+guint                  hdhomerun_job_scheduler_get_n_cancelled
+                                                             (HdhomerunJobScheduler *self);
+
+G_END_DECLS
@@ -0,0 +1,556 @@
+/* hdhomerun-recorder.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE  /* O_DIRECT, fallocate(), sync_file_range() */
+
+#include "hdhomerun-config-gtk-config.h"
+
+#include "hdhomerun-recorder.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#if HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+/* HdhomerunRecorder writes the raw transport stream of a HdhomerunStream
+ * to a file. It reads from a tap ring of its own that the stream hands
+ * every batch to, so it can run alongside the preview, and the stream
+ * keeps running for it while nothing else reads. When the disk cannot
+ * keep up it only drops datagrams from its own ring, never the preview's.
+ *
+ * Packets are gathered into large aligned buffers and written with
+ * O_DIRECT, bypassing the page cache so that several recordings to one
+ * disk do not push everything else out of memory. Where the filesystem
+ * refuses O_DIRECT, writes are buffered, and each buffer is pushed out
+ * and dropped from the cache once the next one is written. With liburing
+ * one buffer is written while the other fills; otherwise the writer
+ * blocks on the disk and the tap ring, several seconds deep, absorbs the
+ * stall. Space is reserved ahead of the data so concurrent recordings do
+ * not interleave on disk.
+ */
+
+#define BUFFER_SIZE     (4 * 1024 * 1024)
+#define ALIGNMENT       4096
+#define PREALLOCATE     (64 * 1024 * 1024)
+#define TAP_DATAGRAMS   16384
+
+struct _HdhomerunRecorder
+{
+  GObject parent_instance;
+
+  HdhomerunStream *stream;
+  HdhomerunTsRing *tap;
+  char *path;
+  GThread *thread;
+  GError *error;                    /* Set by the writer before it exits */
+  GMutex lock;
+  guint64 bytes_written;            /* Guarded by lock */
+
+  /* Writer thread only */
+  int fd;
+  gboolean direct;
+  guint8 *buffers[2];
+  guint current;
+  gsize fill;
+  guint64 offset;                   /* Of the next write */
+  guint64 allocated;
+  guint64 dirty_offset;             /* Buffered mode: not yet dropped */
+  gsize dirty_len;
+
+#if HAVE_LIBURING
+  struct io_uring uring;
+  gboolean uring_initialized;
+  gboolean uring_ok;
+  gboolean in_flight;
+  const guint8 *in_flight_data;
+  gsize in_flight_len;
+  gsize in_flight_payload;          /* in_flight_len less O_DIRECT padding */
+  guint64 in_flight_offset;
+#endif
+};
+
+G_DEFINE_FINAL_TYPE (HdhomerunRecorder, hdhomerun_recorder, G_TYPE_OBJECT)
+
+static void
+set_errno_error (GError     **error,
+                 int          errsv,
+                 const char  *what,
+                 const char  *path)
+{
+  g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errsv),
+               "Failed to %s %s: %s", what, path, g_strerror (errsv));
+}
+
+static gboolean
+write_all (HdhomerunRecorder  *self,
+           const guint8       *data,
+           gsize               len,
+           guint64             offset,
+           GError            **error)
+{
+  while (len > 0)
+    {
+      gssize written = pwrite (self->fd, data, len, (off_t) offset);
+
+      if (written < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          set_errno_error (error, errno, "write", self->path);
+          return FALSE;
+        }
+
+      data += written;
+      len -= written;
+      offset += written;
+    }
+
+  return TRUE;
+}
+
+/* Count a completed write of @len bytes of stream, not counting any
+ * O_DIRECT padding after them. In buffered mode, also start writeback of
+ * the range just written, then wait for the one before and drop it from
+ * the page cache.
+ */
+static void
+on_written (HdhomerunRecorder *self,
+            guint64            offset,
+            gsize              len)
+{
+  g_mutex_lock (&self->lock);
+  self->bytes_written += len;
+  g_mutex_unlock (&self->lock);
+
+  if (self->direct)
+    return;
+
+  sync_file_range (self->fd, (off_t) offset, (off_t) len, SYNC_FILE_RANGE_WRITE);
+
+  if (self->dirty_len > 0)
+    {
+      sync_file_range (self->fd, (off_t) self->dirty_offset, (off_t) self->dirty_len,
+                       SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+                       SYNC_FILE_RANGE_WAIT_AFTER);
+      posix_fadvise (self->fd, (off_t) self->dirty_offset, (off_t) self->dirty_len,
+                     POSIX_FADV_DONTNEED);
+    }
+
+  self->dirty_offset = offset;
+  self->dirty_len = len;
+}
+
+#if HAVE_LIBURING
+static gboolean
+wait_in_flight (HdhomerunRecorder  *self,
+                GError            **error)
+{
+  struct io_uring_cqe *cqe;
+  int ret;
+  int res;
+
+  if (!self->in_flight)
+    return TRUE;
+
+  do
+    ret = io_uring_wait_cqe (&self->uring, &cqe);
+  while (ret == -EINTR);
+
+  self->in_flight = FALSE;
+
+  if (ret < 0)
+    {
+      set_errno_error (error, -ret, "write", self->path);
+      return FALSE;
+    }
+
+  res = cqe->res;
+  io_uring_cqe_seen (&self->uring, cqe);
+
+  if (res < 0)
+    {
+      set_errno_error (error, -res, "write", self->path);
+      return FALSE;
+    }
+
+  /* Short writes are rare; finish them synchronously */
+  if ((gsize) res < self->in_flight_len &&
+      !write_all (self, self->in_flight_data + res, self->in_flight_len - res,
+                  self->in_flight_offset + res, error))
+    return FALSE;
+
+  on_written (self, self->in_flight_offset, self->in_flight_payload);
+  return TRUE;
+}
+#endif
+
+static gboolean
+flush (HdhomerunRecorder  *self,
+       GError            **error)
+{
+  guint8 *data = self->buffers[self->current];
+  gsize len = self->fill;
+  gsize write_len = len;
+
+  if (len == 0)
+    return TRUE;
+
+  /* Only the last buffer can be partial; O_DIRECT needs whole blocks, so
+   * it is padded and the file truncated afterwards.
+   */
+  if (self->direct && len % ALIGNMENT != 0)
+    {
+      write_len = len + ALIGNMENT - len % ALIGNMENT;
+      memset (data + len, 0, write_len - len);
+    }
+
+  if (self->offset + write_len > self->allocated)
+    {
+      /* Best effort, not every filesystem can */
+      if (fallocate (self->fd, FALLOC_FL_KEEP_SIZE, (off_t) self->allocated, PREALLOCATE) == 0)
+        self->allocated += PREALLOCATE;
+      else
+        self->allocated = G_MAXUINT64;
+    }
+
+#if HAVE_LIBURING
+  if (self->uring_ok)
+    {
+      struct io_uring_sqe *sqe;
+
+      /* The other buffer has to be on disk before it is refilled */
+      if (!wait_in_flight (self, error))
+        return FALSE;
+
+      sqe = io_uring_get_sqe (&self->uring);
+      io_uring_prep_write (sqe, self->fd, data, write_len, self->offset);
+      if (io_uring_submit (&self->uring) == 1)
+        {
+          self->in_flight = TRUE;
+          self->in_flight_data = data;
+          self->in_flight_len = write_len;
+          self->in_flight_payload = len;
+          self->in_flight_offset = self->offset;
+          self->offset += len;
+          self->current ^= 1;
+          self->fill = 0;
+          return TRUE;
+        }
+
+      /* Fall back for good on a ring that cannot submit */
+      self->uring_ok = FALSE;
+    }
+#endif
+
+  if (!write_all (self, data, write_len, self->offset, error))
+    return FALSE;
+
+  on_written (self, self->offset, len);
+  self->offset += len;
+  self->fill = 0;
+
+  return TRUE;
+}
+
+static gboolean
+finish (HdhomerunRecorder  *self,
+        GError            **error)
+{
+  gboolean padded = self->direct && self->fill % ALIGNMENT != 0;
+
+  if (!flush (self, error))
+    return FALSE;
+
+#if HAVE_LIBURING
+  if (!wait_in_flight (self, error))
+    return FALSE;
+#endif
+
+  /* Drop the padding and the space reserved past the end */
+  if ((padded || self->allocated > self->offset) &&
+      ftruncate (self->fd, (off_t) self->offset) < 0)
+    {
+      set_errno_error (error, errno, "truncate", self->path);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gpointer
+write_thread (gpointer user_data)
+{
+  HdhomerunRecorder *self = user_data;
+  GError *error = NULL;
+
+  for (;;)
+    {
+      const guint8 *packets;
+      gsize n_packets;
+      gsize len;
+
+      packets = hdhomerun_ts_ring_peek (self->tap, &n_packets);
+      if (packets == NULL)
+        {
+          if (!hdhomerun_ts_ring_wait (self->tap, -1))
+            break;
+          continue;
+        }
+
+      len = n_packets * HDHOMERUN_TS_PACKET_SIZE;
+      while (len > 0)
+        {
+          gsize chunk = MIN (len, BUFFER_SIZE - self->fill);
+
+          memcpy (self->buffers[self->current] + self->fill, packets, chunk);
+          self->fill += chunk;
+          packets += chunk;
+          len -= chunk;
+
+          if (self->fill == BUFFER_SIZE && !flush (self, &error))
+            break;
+        }
+
+      hdhomerun_ts_ring_advance (self->tap);
+
+      if (error != NULL)
+        break;
+    }
+
+  if (error == NULL)
+    finish (self, &error);
+#if HAVE_LIBURING
+  else
+    wait_in_flight (self, NULL);
+#endif
+
+  self->error = error;
+
+  return NULL;
+}
+
+static int
+open_file (const char  *path,
+           gboolean    *direct,
+           GError     **error)
+{
+  int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+  int fd;
+
+  fd = open (path, flags | O_DIRECT, 0644);
+  if (fd < 0 && errno == EINVAL)
+    {
+      g_message ("%s does not support O_DIRECT, using buffered writes", path);
+      fd = open (path, flags, 0644);
+      *direct = FALSE;
+    }
+  else
+    {
+      *direct = TRUE;
+    }
+
+  if (fd < 0)
+    set_errno_error (error, errno, "open", path);
+
+  return fd;
+}
+
+/**
+ * hdhomerun_recorder_new:
+ * @stream: the stream to record
+ * @path: the file to write, replaced if it exists
+ * @error: return location for a #GError
+ *
+ * Start recording @stream to @path. The stream needs to be started by
+ * the caller if it is not already running.
+ *
+ * Returns: (transfer full) (nullable): a new #HdhomerunRecorder, or %NULL
+ *   if @path could not be opened
+ */
+HdhomerunRecorder *
+hdhomerun_recorder_new (HdhomerunStream  *stream,
+                        const char       *path,
+                        GError          **error)
+{
+  g_autoptr(HdhomerunRecorder) self = NULL;
+  gboolean direct;
+  int fd;
+
+  g_return_val_if_fail (HDHOMERUN_IS_STREAM (stream), NULL);
+  g_return_val_if_fail (path != NULL, NULL);
+
+  fd = open_file (path, &direct, error);
+  if (fd < 0)
+    return NULL;
+
+  self = g_object_new (HDHOMERUN_TYPE_RECORDER, NULL);
+  self->stream = g_object_ref (stream);
+  self->path = g_strdup (path);
+  self->fd = fd;
+  self->direct = direct;
+  self->buffers[0] = g_aligned_alloc (1, BUFFER_SIZE, ALIGNMENT);
+  self->buffers[1] = g_aligned_alloc (1, BUFFER_SIZE, ALIGNMENT);
+
+#if HAVE_LIBURING
+  self->uring_initialized = io_uring_queue_init (2, &self->uring, 0) == 0;
+  self->uring_ok = self->uring_initialized;
+  if (!self->uring_ok)
+    g_message ("io_uring is not available, using synchronous writes");
+#endif
+
+  self->tap = hdhomerun_ts_ring_new (TAP_DATAGRAMS);
+  self->thread = g_thread_new ("hdhomerun-recorder", write_thread, self);
+  hdhomerun_stream_add_consumer (stream, self->tap);
+
+  g_message ("Recording to %s%s", path, direct ? " (direct I/O)" : "");
+
+  return g_steal_pointer (&self);
+}
+
+/**
+ * hdhomerun_recorder_stop:
+ * @self: a #HdhomerunRecorder
+ * @error: return location for a #GError
+ *
+ * Detach from the stream, write out what is left and close the file.
+ * The stream itself keeps running.
+ *
+ * Returns: %FALSE if writing failed at any point
+ */
+gboolean
+hdhomerun_recorder_stop (HdhomerunRecorder  *self,
+                         GError            **error)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_RECORDER (self), FALSE);
+
+  if (self->thread == NULL)
+    return TRUE;
+
+  hdhomerun_stream_remove_consumer (self->stream, self->tap);
+  hdhomerun_ts_ring_close (self->tap);
+  g_thread_join (g_steal_pointer (&self->thread));
+
+  if (close (self->fd) < 0 && self->error == NULL)
+    set_errno_error (&self->error, errno, "close", self->path);
+  self->fd = -1;
+
+  if (hdhomerun_ts_ring_get_dropped (self->tap) > 0)
+    g_warning ("Recording %s dropped %" G_GUINT64_FORMAT " datagrams",
+               self->path, hdhomerun_ts_ring_get_dropped (self->tap));
+
+  if (self->error != NULL)
+    {
+      g_propagate_error (error, g_steal_pointer (&self->error));
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+/**
+ * hdhomerun_recorder_get_stream:
+ * @self: a #HdhomerunRecorder
+ *
+ * Returns: (transfer none): the stream being recorded
+ */
+HdhomerunStream *
+hdhomerun_recorder_get_stream (HdhomerunRecorder *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_RECORDER (self), NULL);
+
+  return self->stream;
+}
+
+const char *
+hdhomerun_recorder_get_path (HdhomerunRecorder *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_RECORDER (self), NULL);
+
+  return self->path;
+}
+
+guint64
+hdhomerun_recorder_get_bytes_written (HdhomerunRecorder *self)
+{
+  guint64 bytes_written;
+
+  g_return_val_if_fail (HDHOMERUN_IS_RECORDER (self), 0);
+
+  g_mutex_lock (&self->lock);
+  bytes_written = self->bytes_written;
+  g_mutex_unlock (&self->lock);
+
+  return bytes_written;
+}
+
+/**
+ * hdhomerun_recorder_get_dropped:
+ * @self: a #HdhomerunRecorder
+ *
+ * Returns: the number of datagrams lost because the disk fell behind
+ */
+guint64
+hdhomerun_recorder_get_dropped (HdhomerunRecorder *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_RECORDER (self), 0);
+
+  return hdhomerun_ts_ring_get_dropped (self->tap);
+}
+
+static void
+hdhomerun_recorder_finalize (GObject *object)
+{
+  HdhomerunRecorder *self = (HdhomerunRecorder *)object;
+
+  if (self->stream != NULL)
+    hdhomerun_recorder_stop (self, NULL);
+
+#if HAVE_LIBURING
+  if (self->uring_initialized)
+    io_uring_queue_exit (&self->uring);
+#endif
+
+  g_clear_pointer (&self->tap, hdhomerun_ts_ring_unref);
+  g_clear_object (&self->stream);
+  g_clear_error (&self->error);
+  g_aligned_free (self->buffers[0]);
+  g_aligned_free (self->buffers[1]);
+  g_free (self->path);
+  g_mutex_clear (&self->lock);
+
+  G_OBJECT_CLASS (hdhomerun_recorder_parent_class)->finalize (object);
+}
+
+static void
+hdhomerun_recorder_class_init (HdhomerunRecorderClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = hdhomerun_recorder_finalize;
+}
+
+static void
+hdhomerun_recorder_init (HdhomerunRecorder *self)
+{
+  g_mutex_init (&self->lock);
+  self->fd = -1;
+}
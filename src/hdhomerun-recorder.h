@@ -0,0 +1,41 @@
+/* hdhomerun-recorder.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "hdhomerun-stream.h"
+
+G_BEGIN_DECLS
+
+#define HDHOMERUN_TYPE_RECORDER (hdhomerun_recorder_get_type())
+
+G_DECLARE_FINAL_TYPE (HdhomerunRecorder, hdhomerun_recorder, HDHOMERUN, RECORDER, GObject)
+
+HdhomerunRecorder *hdhomerun_recorder_new               (HdhomerunStream    *stream,
+                                                         const char         *path,
+                                                         GError            **error);
+gboolean           hdhomerun_recorder_stop              (HdhomerunRecorder  *self,
+                                                         GError            **error);
+HdhomerunStream   *hdhomerun_recorder_get_stream        (HdhomerunRecorder  *self);
+const char        *hdhomerun_recorder_get_path          (HdhomerunRecorder  *self);
+guint64            hdhomerun_recorder_get_bytes_written (HdhomerunRecorder  *self);
+guint64            hdhomerun_recorder_get_dropped       (HdhomerunRecorder  *self);
+
+G_END_DECLS
@@ -0,0 +1,217 @@
+/* hdhomerun-scan-cache.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-scan-cache.h"
+#include "hdhomerun-channel-scan.h"
+
+#include <errno.h>
+
+/* One serialized GVariant per device: a format version followed by one
+ * (frequency, channel, locked, modulation, signal strength, signal
+ * quality, scan time, programs) tuple per frequency. Each program is
+ * (program number, virtual major, virtual minor, name). An empty
+ * modulation string stands for none.
+ */
+#define CACHE_VERSION 1
+#define CACHE_FORMAT  "(ua(usbsuuxa(qqqs)))"
+
+typedef struct
+{
+  char *device_id;
+  GPtrArray *results;
+} SaveData;
+
+static char *
+get_cache_path (const char *device_id)
+{
+  g_autofree char *name = g_strconcat (device_id, ".scan", NULL);
+
+  return g_build_filename (g_get_user_data_dir (), "hdhomerun-config-gtk", "scans", name, NULL);
+}
+
+GPtrArray *
+hdhomerun_scan_cache_load (const char  *device_id,
+                           GError     **error)
+{
+  g_autofree char *path = NULL;
+  g_autoptr(GVariant) variant = NULL;
+  g_autoptr(GVariantIter) frequencies = NULL;
+  GPtrArray *results;
+  GVariantIter *programs;
+  char *contents;
+  gsize length;
+  guint32 version;
+  guint32 frequency;
+  const char *channel;
+  gboolean locked;
+  const char *modulation;
+  guint32 signal_strength;
+  guint32 signal_quality;
+  gint64 scanned_at;
+
+  g_return_val_if_fail (device_id != NULL, NULL);
+
+  path = get_cache_path (device_id);
+  if (!g_file_get_contents (path, &contents, &length, error))
+    return NULL;
+
+  variant = g_variant_new_from_data (G_VARIANT_TYPE (CACHE_FORMAT), contents, length,
+                                     FALSE, g_free, contents);
+  g_variant_ref_sink (variant);
+
+  g_variant_get (variant, CACHE_FORMAT, &version, &frequencies);
+  if (version != CACHE_VERSION)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                   "Unsupported scan cache version %u", version);
+      return NULL;
+    }
+
+  results = g_ptr_array_new_with_free_func ((GDestroyNotify) hdhomerun_scan_result_unref);
+
+  while (g_variant_iter_next (frequencies, "(u&sb&suuxa(qqqs))", &frequency, &channel, &locked,
+                              &modulation, &signal_strength, &signal_quality, &scanned_at,
+                              &programs))
+    {
+      HdhomerunScanResult *result;
+      const char *name;
+      guint i = 0;
+
+      result = hdhomerun_scan_result_new (channel, frequency, g_variant_iter_n_children (programs));
+      result->locked = locked;
+      result->modulation = *modulation ? g_strdup (modulation) : NULL;
+      result->signal_strength = signal_strength;
+      result->signal_quality = signal_quality;
+      result->scanned_at = scanned_at;
+
+      while (g_variant_iter_next (programs, "(qqq&s)",
+                                  &result->programs[i].program_number,
+                                  &result->programs[i].virtual_major,
+                                  &result->programs[i].virtual_minor,
+                                  &name))
+        result->programs[i++].name = g_strdup (name);
+
+      g_variant_iter_free (programs);
+      g_ptr_array_add (results, result);
+    }
+
+  return results;
+}
+
+static void
+save_data_free (SaveData *data)
+{
+  g_free (data->device_id);
+  g_ptr_array_unref (data->results);
+  g_free (data);
+}
+
+static void
+save_thread (GTask        *task,
+             gpointer      source_object,
+             gpointer      task_data,
+             GCancellable *cancellable)
+{
+  SaveData *data = task_data;
+  g_autofree char *path = get_cache_path (data->device_id);
+  g_autofree char *dir = g_path_get_dirname (path);
+  g_autoptr(GVariant) variant = NULL;
+  g_autoptr(GError) error = NULL;
+  GVariantBuilder builder;
+
+  (void)source_object; /* unused */
+  (void)cancellable; /* unused */
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(usbsuuxa(qqqs))"));
+  for (guint i = 0; i < data->results->len; i++)
+    {
+      const HdhomerunScanResult *result = g_ptr_array_index (data->results, i);
+      GVariantBuilder programs;
+
+      g_variant_builder_init (&programs, G_VARIANT_TYPE ("a(qqqs)"));
+      for (guint j = 0; j < result->n_programs; j++)
+        g_variant_builder_add (&programs, "(qqqs)",
+                               result->programs[j].program_number,
+                               result->programs[j].virtual_major,
+                               result->programs[j].virtual_minor,
+                               result->programs[j].name ? result->programs[j].name : "");
+
+      g_variant_builder_add (&builder, "(usbsuuxa(qqqs))",
+                             result->frequency,
+                             result->channel ? result->channel : "",
+                             result->locked,
+                             result->modulation ? result->modulation : "",
+                             result->signal_strength,
+                             result->signal_quality,
+                             result->scanned_at,
+                             &programs);
+    }
+
+  variant = g_variant_ref_sink (g_variant_new (CACHE_FORMAT, CACHE_VERSION, &builder));
+
+  if (g_mkdir_with_parents (dir, 0700) != 0)
+    {
+      int errsv = errno;
+
+      g_task_return_new_error (task, G_IO_ERROR, g_io_error_from_errno (errsv),
+                               "Failed to create %s: %s", dir, g_strerror (errsv));
+      return;
+    }
+
+  if (!g_file_set_contents (path, g_variant_get_data (variant), g_variant_get_size (variant), &error))
+    {
+      g_task_return_error (task, g_steal_pointer (&error));
+      return;
+    }
+
+  g_task_return_boolean (task, TRUE);
+}
+
+void
+hdhomerun_scan_cache_save_async (const char          *device_id,
+                                 GPtrArray           *results,
+                                 GCancellable        *cancellable,
+                                 GAsyncReadyCallback  callback,
+                                 gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+  SaveData *data;
+
+  g_return_if_fail (device_id != NULL);
+  g_return_if_fail (results != NULL);
+
+  data = g_new0 (SaveData, 1);
+  data->device_id = g_strdup (device_id);
+  data->results = g_ptr_array_ref (results);
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_source_tag (task, hdhomerun_scan_cache_save_async);
+  g_task_set_task_data (task, data, (GDestroyNotify) save_data_free);
+  g_task_run_in_thread (task, save_thread);
+}
+
+gboolean
+hdhomerun_scan_cache_save_finish (GAsyncResult  *result,
+                                  GError       **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, NULL), FALSE);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (result)) ==
+                        hdhomerun_scan_cache_save_async, FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
@@ -0,0 +1,39 @@
+/* hdhomerun-scan-cache.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* Per-frequency channel scan results of a device, kept in the user data
+ * dir so an interrupted or repeated scan only probes what it has to.
+ * Results are GPtrArrays of HdhomerunScanResult.
+ */
+GPtrArray *hdhomerun_scan_cache_load        (const char           *device_id,
+                                             GError              **error);
+void       hdhomerun_scan_cache_save_async  (const char           *device_id,
+                                             GPtrArray            *results,
+                                             GCancellable         *cancellable,
+                                             GAsyncReadyCallback   callback,
+                                             gpointer              user_data);
+gboolean   hdhomerun_scan_cache_save_finish (GAsyncResult         *result,
+                                             GError              **error);
+
+G_END_DECLS
@@ -0,0 +1,117 @@
+/* hdhomerun-signal-history.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-signal-history.h"
+
+struct _HdhomerunSignalHistory
+{
+  guint n_samples;
+  guint64 end;                        /* Number of the next sample */
+  HdhomerunSignalSample samples[];
+};
+
+/**
+ * hdhomerun_signal_history_new:
+ * @n_samples: how many samples to keep
+ *
+ * Returns: (transfer full): a new, empty #HdhomerunSignalHistory
+ */
+HdhomerunSignalHistory *
+hdhomerun_signal_history_new (guint n_samples)
+{
+  HdhomerunSignalHistory *history;
+
+  g_return_val_if_fail (n_samples > 0, NULL);
+
+  history = g_rc_box_alloc0 (sizeof *history + n_samples * sizeof (HdhomerunSignalSample));
+  history->n_samples = n_samples;
+
+  return history;
+}
+
+HdhomerunSignalHistory *
+hdhomerun_signal_history_ref (HdhomerunSignalHistory *history)
+{
+  g_return_val_if_fail (history != NULL, NULL);
+
+  return g_rc_box_acquire (history);
+}
+
+void
+hdhomerun_signal_history_unref (HdhomerunSignalHistory *history)
+{
+  g_return_if_fail (history != NULL);
+
+  g_rc_box_release (history);
+}
+
+void
+hdhomerun_signal_history_append (HdhomerunSignalHistory      *history,
+                                 const HdhomerunSignalSample *sample)
+{
+  g_return_if_fail (history != NULL);
+  g_return_if_fail (sample != NULL);
+
+  history->samples[history->end % history->n_samples] = *sample;
+  history->end++;
+}
+
+guint
+hdhomerun_signal_history_get_size (HdhomerunSignalHistory *history)
+{
+  g_return_val_if_fail (history != NULL, 0);
+
+  return history->n_samples;
+}
+
+/* The number of the oldest sample still held */
+guint64
+hdhomerun_signal_history_get_first (HdhomerunSignalHistory *history)
+{
+  g_return_val_if_fail (history != NULL, 0);
+
+  return history->end > history->n_samples ? history->end - history->n_samples : 0;
+}
+
+/* One past the number of the newest sample */
+guint64
+hdhomerun_signal_history_get_end (HdhomerunSignalHistory *history)
+{
+  g_return_val_if_fail (history != NULL, 0);
+
+  return history->end;
+}
+
+/**
+ * hdhomerun_signal_history_get_sample:
+ * @history: a #HdhomerunSignalHistory
+ * @number: a sample number from hdhomerun_signal_history_get_first() up
+ *   to but not including hdhomerun_signal_history_get_end()
+ *
+ * Returns: (transfer none): the sample
+ */
+const HdhomerunSignalSample *
+hdhomerun_signal_history_get_sample (HdhomerunSignalHistory *history,
+                                     guint64                 number)
+{
+  g_return_val_if_fail (history != NULL, NULL);
+  g_return_val_if_fail (number >= hdhomerun_signal_history_get_first (history), NULL);
+  g_return_val_if_fail (number < history->end, NULL);
+
+  return &history->samples[number % history->n_samples];
+}
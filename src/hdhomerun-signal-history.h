@@ -0,0 +1,58 @@
+/* hdhomerun-signal-history.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define HDHOMERUN_SIGNAL_HISTORY_DEFAULT_SIZE 256
+
+/* One status sample, four bytes so a few minutes of history for a
+ * hundred tuners stays in the hundreds of kilobytes
+ */
+typedef struct
+{
+  guint8 signal_strength;   /* Percent */
+  guint8 signal_quality;    /* Percent */
+  guint8 symbol_quality;    /* Percent */
+  guint8 locked;
+} HdhomerunSignalSample;
+
+typedef struct _HdhomerunSignalHistory HdhomerunSignalHistory;
+
+/* A fixed-size ring of samples for one tuner; the oldest sample is
+ * overwritten once it is full. Samples are numbered from the first ever
+ * appended, so a reader can tell what is new since it last looked.
+ * Only used from the main thread.
+ */
+HdhomerunSignalHistory      *hdhomerun_signal_history_new        (guint                        n_samples);
+HdhomerunSignalHistory      *hdhomerun_signal_history_ref        (HdhomerunSignalHistory      *history);
+void                         hdhomerun_signal_history_unref      (HdhomerunSignalHistory      *history);
+void                         hdhomerun_signal_history_append     (HdhomerunSignalHistory      *history,
+                                                                  const HdhomerunSignalSample *sample);
+guint                        hdhomerun_signal_history_get_size   (HdhomerunSignalHistory      *history);
+guint64                      hdhomerun_signal_history_get_first  (HdhomerunSignalHistory      *history);
+guint64                      hdhomerun_signal_history_get_end    (HdhomerunSignalHistory      *history);
+const HdhomerunSignalSample *hdhomerun_signal_history_get_sample (HdhomerunSignalHistory      *history,
+                                                                  guint64                      number);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (HdhomerunSignalHistory, hdhomerun_signal_history_unref)
+
+G_END_DECLS
@@ -0,0 +1,1414 @@
+/* hdhomerun-simulated-backend.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-simulated-backend.h"
+
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+
+/* A made-up fleet of tuners that answers discovery and device control
+ * the way real devices do, for exercising the window and the engines at
+ * a scale nobody has on their desk.
+ *
+ * Device i has ID 0x10000000 + i, and interface j of it the address
+ * 10.j.(i / 250).(i % 250 + 1). Nothing is sent to those addresses:
+ * every request sleeps for the configured latency instead, or for the
+ * timeout when it is lost, and is answered from the fleet state here.
+ *
+ * Every device carries the same us-bcast lineup. Two channels in three
+ * lock, with up to four programs each. A tuner locks LOCK_DELAY_MS after
+ * it is tuned, and with a target set it streams the PAT, PMTs and TVCT
+ * of its channel, then video and audio packets, at the configured
+ * bitrate to the target.
+ */
+
+#ifndef HDHOMERUN_IP_STRING_SIZE
+#define HDHOMERUN_IP_STRING_SIZE 64  /* Size required by libhdhomerun API */
+#endif
+
+#define DEVICE_ID_BASE 0x10000000
+#define MAX_DEVICES (250 * 256)
+#define MAX_TUNERS 16
+
+#define FIRST_CHANNEL 2
+#define LAST_CHANNEL 36
+#define LOCK_DELAY_MS 300
+#define DETECT_MS 100
+
+#define TS_SIZE 188
+#define PACKETS_PER_DATAGRAM 7
+#define PSI_INTERVAL 256
+#define SEND_TICK_MS 10
+#define PID_PAT 0x0000
+#define PID_PSIP 0x1ffb
+#define PID_PROGRAM_BASE 0x100   /* PMT, video and audio at + 0, 1 and 2 */
+#define PID_PROGRAM_STRIDE 0x10
+#define MAX_PROGRAMS 4
+
+#define RESOURCE_LOCKED "ERROR: resource locked"
+
+typedef struct _Sender Sender;
+
+typedef struct
+{
+  /* Guarded by fleet_lock */
+  guint32 frequency;                 /* 0 when not tuned */
+  guint program;                     /* 0 for the whole multiplex */
+  gint64 tuned_at;
+  char *target;                      /* NULL for none */
+  struct hdhomerun_device_t *lock_owner;
+  Sender *sender;
+} SimulatedTuner;
+
+struct hdhomerun_discover2_device_if_t
+{
+  struct hdhomerun_discover2_device_if_t *next;
+  struct sockaddr_storage ip_addr;
+  char ip_str[HDHOMERUN_IP_STRING_SIZE];
+};
+
+typedef struct
+{
+  guint index;
+  guint32 device_id;
+  char device_id_str[16];
+  const char *model;
+  struct hdhomerun_discover2_device_if_t *interfaces;
+  SimulatedTuner *tuners;
+} SimulatedDevice;
+
+/* One device as seen by one discovery socket */
+struct hdhomerun_discover2_device_t
+{
+  struct hdhomerun_discover2_device_t *next;
+  const SimulatedDevice *device;
+};
+
+struct hdhomerun_discover_t
+{
+  guint n_replies;
+  struct hdhomerun_discover2_device_t *replies;
+};
+
+/* Strings handed out stay valid until the next call on the handle, as
+ * with libhdhomerun.
+ */
+struct hdhomerun_device_t
+{
+  SimulatedDevice *device;
+  guint tuner;
+  char *value;
+  char *error;
+  guint scan_next;
+  guint scan_current;
+};
+
+struct _Sender
+{
+  GThread *thread;
+  gint running;
+  SimulatedDevice *device;
+  guint tuner;
+  GSocket *socket;
+  GSocketAddress *destination;
+};
+
+static const char * const models[] = {
+  "HDHR5-4US",
+  "HDHR5-4DT",
+  "HDFX-4K",
+  "HDVR-4US-1TB",
+};
+
+static GMutex fleet_lock;
+static HdhomerunSimulatedConfig config;
+static SimulatedDevice *fleet;
+static guint n_fleet;
+static gint n_online;
+static GHashTable *fleet_by_name;  /* Address or device ID -> SimulatedDevice */
+
+/**
+ * hdhomerun_simulated_config_init:
+ * @config: the configuration to fill in
+ *
+ * Fill @config with the defaults: 50 devices of 4 tuners on one
+ * interface each, 2 ms latency, no loss and ATSC bitrate streams.
+ */
+void
+hdhomerun_simulated_config_init (HdhomerunSimulatedConfig *config)
+{
+  g_return_if_fail (config != NULL);
+
+  config->n_devices = 50;
+  config->tuners_per_device = 4;
+  config->n_interfaces = 1;
+  config->latency_ms = 2;
+  config->loss = 0;
+  config->timeout_ms = 2500;
+  config->bitrate = 19392658;
+}
+
+static gboolean
+parse_number (const char  *key,
+              const char  *text,
+              guint        min,
+              guint        max,
+              guint       *value,
+              GError     **error)
+{
+  guint64 number;
+
+  if (!g_ascii_string_to_unsigned (text, 10, min, max, &number, NULL))
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                   "%s must be a number from %u to %u", key, min, max);
+      return FALSE;
+    }
+
+  *value = (guint) number;
+  return TRUE;
+}
+
+/**
+ * hdhomerun_simulated_config_parse:
+ * @config: the configuration to update
+ * @spec: comma separated settings such as "devices=200,latency=5,loss=0.01"
+ * @error: return location for a #GError
+ *
+ * The keys are devices, tuners, interfaces, latency and timeout in
+ * milliseconds, loss as a fraction and bitrate in bits per second. Keys
+ * not given keep their value. @config is left alone on error.
+ *
+ * Returns: %TRUE if @spec was valid
+ */
+gboolean
+hdhomerun_simulated_config_parse (HdhomerunSimulatedConfig  *config,
+                                  const char                *spec,
+                                  GError                   **error)
+{
+  HdhomerunSimulatedConfig parsed;
+  g_auto(GStrv) settings = NULL;
+
+  g_return_val_if_fail (config != NULL, FALSE);
+  g_return_val_if_fail (spec != NULL, FALSE);
+
+  parsed = *config;
+  settings = g_strsplit (spec, ",", -1);
+
+  for (guint i = 0; settings[i] != NULL; i++)
+    {
+      g_auto(GStrv) pair = g_strsplit (g_strstrip (settings[i]), "=", 2);
+      const char *key = pair[0];
+      const char *value = pair[1];
+      gboolean ok;
+
+      if (*key == '\0')
+        continue;
+
+      if (value == NULL)
+        {
+          g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                       "%s has no value", key);
+          return FALSE;
+        }
+
+      if (g_str_equal (key, "devices"))
+        ok = parse_number (key, value, 1, MAX_DEVICES, &parsed.n_devices, error);
+      else if (g_str_equal (key, "tuners"))
+        ok = parse_number (key, value, 1, MAX_TUNERS, &parsed.tuners_per_device, error);
+      else if (g_str_equal (key, "interfaces"))
+        ok = parse_number (key, value, 1, 255, &parsed.n_interfaces, error);
+      else if (g_str_equal (key, "latency"))
+        ok = parse_number (key, value, 0, 60000, &parsed.latency_ms, error);
+      else if (g_str_equal (key, "timeout"))
+        ok = parse_number (key, value, 0, 60000, &parsed.timeout_ms, error);
+      else if (g_str_equal (key, "bitrate"))
+        ok = parse_number (key, value, 0, 1000000000, &parsed.bitrate, error);
+      else if (g_str_equal (key, "loss"))
+        {
+          char *end = NULL;
+
+          parsed.loss = g_ascii_strtod (value, &end);
+          ok = end != value && *end == '\0' && parsed.loss >= 0 && parsed.loss <= 1;
+          if (!ok)
+            g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                         "loss must be a fraction from 0 to 1");
+        }
+      else
+        {
+          g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                       "Unknown setting %s", key);
+          ok = FALSE;
+        }
+
+      if (!ok)
+        return FALSE;
+    }
+
+  *config = parsed;
+  return TRUE;
+}
+
+/* The lineup */
+
+static guint32
+channel_frequency (guint channel)
+{
+  if (channel <= 4)
+    return 57000000 + (channel - 2) * 6000000;
+  if (channel <= 6)
+    return 79000000 + (channel - 5) * 6000000;
+  if (channel <= 13)
+    return 177000000 + (channel - 7) * 6000000;
+
+  return 473000000 + (channel - 14) * 6000000;
+}
+
+/* Returns 0 for a frequency off the channel map */
+static guint
+frequency_channel (guint32 frequency)
+{
+  for (guint channel = FIRST_CHANNEL; channel <= LAST_CHANNEL; channel++)
+    {
+      if (channel_frequency (channel) == frequency)
+        return channel;
+    }
+
+  return 0;
+}
+
+static guint
+channel_n_programs (guint channel)
+{
+  if (channel == 0 || channel % 3 == 1)
+    return 0;
+
+  return 1 + channel % MAX_PROGRAMS;
+}
+
+static void
+program_name (guint  channel,
+              guint  program,
+              char  *name,
+              gsize  size)
+{
+  g_snprintf (name, size, "KS%02u-%u", channel, program);
+}
+
+static guint
+signal_strength (const SimulatedDevice *device,
+                 guint                  channel)
+{
+  return 60 + (device->device_id + channel * 7) % 35;
+}
+
+/* Requests */
+
+static gboolean
+is_online (const SimulatedDevice *device)
+{
+  return device->index < (guint) g_atomic_int_get (&n_online);
+}
+
+static gboolean
+is_lost (void)
+{
+  return config.loss > 0 && g_random_double () < config.loss;
+}
+
+/* Takes as long as a round trip would; FALSE when nothing came back */
+static gboolean
+simulate_request (const SimulatedDevice *device)
+{
+  if (!is_online (device) || is_lost ())
+    {
+      if (config.timeout_ms > 0)
+        g_usleep (config.timeout_ms * G_TIME_SPAN_MILLISECOND);
+      return FALSE;
+    }
+
+  if (config.latency_ms > 0)
+    g_usleep (config.latency_ms * G_TIME_SPAN_MILLISECOND);
+
+  return TRUE;
+}
+
+static void
+set_reply (struct hdhomerun_device_t  *hd,
+           char                       *value,
+           const char                 *error,
+           char                      **pvalue,
+           char                      **perror)
+{
+  g_free (hd->value);
+  g_free (hd->error);
+  hd->value = value;
+  hd->error = g_strdup (error);
+
+  if (pvalue)
+    *pvalue = hd->value;
+  if (perror)
+    *perror = hd->error;
+}
+
+/* Called with fleet_lock held */
+static gboolean
+is_locked_against (const SimulatedTuner            *tuner,
+                   const struct hdhomerun_device_t *hd)
+{
+  return tuner->lock_owner != NULL && tuner->lock_owner != hd;
+}
+
+/* Called with fleet_lock held */
+static void
+fill_status (const SimulatedDevice           *device,
+             const SimulatedTuner            *tuner,
+             struct hdhomerun_tuner_status_t *status)
+{
+  guint channel = frequency_channel (tuner->frequency);
+  gint64 elapsed_ms = (g_get_monotonic_time () - tuner->tuned_at) / G_TIME_SPAN_MILLISECOND;
+
+  memset (status, 0, sizeof (*status));
+
+  if (tuner->frequency == 0)
+    {
+      g_strlcpy (status->channel, "none", sizeof (status->channel));
+      g_strlcpy (status->lock_str, "none", sizeof (status->lock_str));
+      return;
+    }
+
+  g_snprintf (status->channel, sizeof (status->channel), "auto:%u", tuner->frequency);
+
+  if (channel_n_programs (channel) == 0)
+    {
+      g_strlcpy (status->lock_str, "none", sizeof (status->lock_str));
+      status->signal_strength = 20;
+      return;
+    }
+
+  g_strlcpy (status->lock_str, "8vsb", sizeof (status->lock_str));
+  status->signal_present = TRUE;
+  status->lock_supported = TRUE;
+  status->signal_strength = signal_strength (device, channel);
+  status->signal_to_noise_quality = MIN (status->signal_strength + 5, 100);
+  status->symbol_error_quality = elapsed_ms >= LOCK_DELAY_MS ? 100 : (guint) (elapsed_ms * 100 / LOCK_DELAY_MS);
+  status->raw_bits_per_second = config.bitrate;
+  status->packets_per_second = tuner->target ? config.bitrate / (TS_SIZE * 8) : 0;
+}
+
+static char *
+format_status (const struct hdhomerun_tuner_status_t *status)
+{
+  return g_strdup_printf ("ch=%s lock=%s ss=%u snq=%u seq=%u bps=%u pps=%u",
+                          status->channel, status->lock_str,
+                          status->signal_strength, status->signal_to_noise_quality,
+                          status->symbol_error_quality,
+                          status->raw_bits_per_second, status->packets_per_second);
+}
+
+/* Called with fleet_lock held */
+static char *
+format_streaminfo (const SimulatedTuner *tuner)
+{
+  GString *info = g_string_new (NULL);
+  guint channel = frequency_channel (tuner->frequency);
+
+  for (guint i = 1; i <= channel_n_programs (channel); i++)
+    {
+      char name[16];
+
+      program_name (channel, i, name, sizeof (name));
+      g_string_append_printf (info, "%u: %u.%u %s\n", i, channel, i, name);
+    }
+
+  g_string_append (info, "tsid=0x0001\n");
+
+  return g_string_free (info, FALSE);
+}
+
+/* Streaming */
+
+typedef struct
+{
+  guint8 cc[0x2000];
+  guint64 n_datagrams;
+  guint64 position;                  /* In the audio and video packets */
+} Generator;
+
+static guint32
+crc32_mpeg (const guint8 *data,
+            gsize         len)
+{
+  guint32 crc = 0xffffffff;
+
+  for (gsize i = 0; i < len; i++)
+    {
+      crc ^= (guint32) data[i] << 24;
+      for (int bit = 0; bit < 8; bit++)
+        crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+    }
+
+  return crc;
+}
+
+static void
+write_header (Generator *gen,
+              guint8    *p,
+              guint16    pid,
+              gboolean   unit_start)
+{
+  p[0] = 0x47;
+  p[1] = (unit_start ? 0x40 : 0) | (pid >> 8);
+  p[2] = pid & 0xff;
+  p[3] = 0x10 | (gen->cc[pid]++ & 0x0f);
+}
+
+/* @section starts at its table ID, and its length field and CRC are
+ * filled in here
+ */
+static void
+write_section (Generator *gen,
+               guint8    *p,
+               guint16    pid,
+               guint8    *section,
+               gsize      len)
+{
+  gsize total = len + 4;
+  guint32 crc;
+
+  section[1] = 0xb0 | ((total - 3) >> 8);
+  section[2] = (total - 3) & 0xff;
+  crc = crc32_mpeg (section, len);
+
+  memset (p, 0xff, TS_SIZE);
+  write_header (gen, p, pid, TRUE);
+  p[4] = 0;
+  memcpy (p + 5, section, len);
+  p[5 + len] = crc >> 24;
+  p[6 + len] = crc >> 16;
+  p[7 + len] = crc >> 8;
+  p[8 + len] = crc;
+}
+
+static gsize
+write_long_header (guint8  *section,
+                   guint8   table_id,
+                   guint16  extension)
+{
+  section[0] = table_id;
+  section[3] = extension >> 8;
+  section[4] = extension & 0xff;
+  section[5] = 0xc1;            /* Version 0, current */
+  section[6] = 0;
+  section[7] = 0;
+
+  return 8;
+}
+
+static void
+write_pid (guint8  *p,
+           guint16  pid)
+{
+  p[0] = 0xe0 | (pid >> 8);
+  p[1] = pid & 0xff;
+}
+
+/* The tables of @channel, one packet each */
+static guint
+write_psi (Generator *gen,
+           guint8    *packets,
+           guint      channel,
+           guint      program)
+{
+  guint8 section[TS_SIZE];
+  guint first = program ? program : 1;
+  guint last = program ? program : channel_n_programs (channel);
+  guint n = 0;
+  gsize len;
+
+  len = write_long_header (section, 0x00, 1);
+  for (guint i = first; i <= last; i++)
+    {
+      section[len++] = 0;
+      section[len++] = i;
+      write_pid (section + len, PID_PROGRAM_BASE + i * PID_PROGRAM_STRIDE);
+      len += 2;
+    }
+  write_section (gen, packets + n++ * TS_SIZE, PID_PAT, section, len);
+
+  for (guint i = first; i <= last; i++)
+    {
+      guint16 base = PID_PROGRAM_BASE + i * PID_PROGRAM_STRIDE;
+
+      len = write_long_header (section, 0x02, i);
+      write_pid (section + len, base + 1);
+      section[len + 2] = 0xf0;
+      section[len + 3] = 0;
+      len += 4;
+
+      section[len] = 0x02;
+      write_pid (section + len + 1, base + 1);
+      section[len + 3] = 0xf0;
+      section[len + 4] = 0;
+      len += 5;
+
+      section[len] = 0x81;
+      write_pid (section + len + 1, base + 2);
+      section[len + 3] = 0xf0;
+      section[len + 4] = 0;
+      len += 5;
+
+      write_section (gen, packets + n++ * TS_SIZE, base, section, len);
+    }
+
+  /* Terrestrial VCT with the short names */
+  len = write_long_header (section, 0xc8, 1);
+  section[len++] = 0;
+  section[len++] = last - first + 1;
+  for (guint i = first; i <= last; i++)
+    {
+      guint8 *entry = section + len;
+      char name[16];
+
+      memset (entry, 0, 32);
+      program_name (channel, i, name, sizeof (name));
+      for (guint c = 0; c < 7 && name[c] != '\0'; c++)
+        entry[2 * c + 1] = name[c];
+      entry[14] = 0xf0 | (channel >> 6);
+      entry[15] = ((channel & 0x3f) << 2) | (i >> 8);
+      entry[16] = i & 0xff;
+      entry[17] = 0x04;
+      entry[24] = 0;
+      entry[25] = i;
+      entry[30] = 0xfc;
+      len += 32;
+    }
+  section[len++] = 0xfc;
+  section[len++] = 0;
+  write_section (gen, packets + n++ * TS_SIZE, PID_PSIP, section, len);
+
+  return n;
+}
+
+/* Fills a datagram, repeating the tables every PSI_INTERVAL packets */
+static void
+generate_datagram (Generator *gen,
+                   guint8    *datagram,
+                   guint      channel,
+                   guint      program)
+{
+  guint first = program ? program : 1;
+  guint n_programs = program ? 1 : channel_n_programs (channel);
+  guint n = 0;
+
+  if (gen->n_datagrams++ % (PSI_INTERVAL / PACKETS_PER_DATAGRAM) == 0)
+    n = write_psi (gen, datagram, channel, program);
+
+  for (; n < PACKETS_PER_DATAGRAM; n++, gen->position++)
+    {
+      guint8 *p = datagram + n * TS_SIZE;
+      guint16 base = PID_PROGRAM_BASE + (first + gen->position % n_programs) * PID_PROGRAM_STRIDE;
+      gboolean audio = gen->position % 8 == 0;
+
+      write_header (gen, p, base + (audio ? 2 : 1), gen->position % 64 == 0);
+      memset (p + 4, gen->position & 0xff, TS_SIZE - 4);
+    }
+}
+
+static gpointer
+sender_thread (gpointer data)
+{
+  Sender *sender = data;
+  g_autofree Generator *gen = g_new0 (Generator, 1);
+  guint8 datagram[TS_SIZE * PACKETS_PER_DATAGRAM];
+  gint64 start = g_get_monotonic_time ();
+  guint64 sent = 0;
+
+  while (g_atomic_int_get (&sender->running))
+    {
+      SimulatedTuner *tuner = &sender->device->tuners[sender->tuner];
+      guint64 due;
+      guint channel;
+      guint program;
+      gboolean locked;
+
+      g_usleep (SEND_TICK_MS * G_TIME_SPAN_MILLISECOND);
+
+      g_mutex_lock (&fleet_lock);
+      channel = frequency_channel (tuner->frequency);
+      program = tuner->program;
+      locked = channel_n_programs (channel) > 0 &&
+               g_get_monotonic_time () - tuner->tuned_at >= LOCK_DELAY_MS * G_TIME_SPAN_MILLISECOND;
+      g_mutex_unlock (&fleet_lock);
+
+      if (program > channel_n_programs (channel))
+        locked = FALSE;
+
+      /* Keep to the bitrate on average, whatever the scheduler does */
+      due = (guint64) (g_get_monotonic_time () - start) * config.bitrate /
+            ((guint64) G_USEC_PER_SEC * TS_SIZE * 8 * PACKETS_PER_DATAGRAM);
+
+      for (; sent < due; sent++)
+        {
+          if (!locked || !is_online (sender->device))
+            continue;
+
+          generate_datagram (gen, datagram, channel, program);
+          if (is_lost ())
+            continue;
+
+          g_socket_send_to (sender->socket, sender->destination,
+                            (const char *) datagram, sizeof (datagram), NULL, NULL);
+        }
+    }
+
+  return NULL;
+}
+
+static void
+sender_stop (Sender *sender)
+{
+  if (sender == NULL)
+    return;
+
+  g_atomic_int_set (&sender->running, FALSE);
+  g_thread_join (sender->thread);
+  g_object_unref (sender->socket);
+  g_object_unref (sender->destination);
+  g_free (sender);
+}
+
+/* Accepts udp:// and rtp:// targets with an IPv4 address and a port */
+static Sender *
+sender_start (SimulatedDevice *device,
+              guint            tuner,
+              const char      *target)
+{
+  g_autoptr(GError) error = NULL;
+  g_autofree char *host = NULL;
+  const char *address;
+  const char *colon;
+  guint64 port;
+  Sender *sender;
+
+  if (g_str_has_prefix (target, "udp://") || g_str_has_prefix (target, "rtp://"))
+    address = target + strlen ("udp://");
+  else
+    return NULL;
+
+  colon = strrchr (address, ':');
+  if (colon == NULL || !g_ascii_string_to_unsigned (colon + 1, 10, 1, G_MAXUINT16, &port, NULL))
+    return NULL;
+  host = g_strndup (address, colon - address);
+
+  sender = g_new0 (Sender, 1);
+  sender->device = device;
+  sender->tuner = tuner;
+  sender->running = TRUE;
+  sender->destination = g_inet_socket_address_new_from_string (host, (guint) port);
+  sender->socket = g_socket_new (G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_DATAGRAM,
+                                 G_SOCKET_PROTOCOL_UDP, &error);
+
+  if (sender->destination == NULL || sender->socket == NULL)
+    {
+      if (error != NULL)
+        g_warning ("Failed to open simulated stream socket: %s", error->message);
+      g_clear_object (&sender->destination);
+      g_clear_object (&sender->socket);
+      g_free (sender);
+      return NULL;
+    }
+
+  sender->thread = g_thread_new ("hdhomerun-simulated-stream", sender_thread, sender);
+
+  return sender;
+}
+
+/* The fleet */
+
+static void
+free_fleet (void)
+{
+  for (guint i = 0; i < n_fleet; i++)
+    {
+      for (guint j = 0; j < config.tuners_per_device; j++)
+        {
+          sender_stop (fleet[i].tuners[j].sender);
+          g_free (fleet[i].tuners[j].target);
+        }
+
+      g_free (fleet[i].tuners);
+      g_free (fleet[i].interfaces);
+    }
+
+  g_clear_pointer (&fleet, g_free);
+  g_clear_pointer (&fleet_by_name, g_hash_table_unref);
+  n_fleet = 0;
+}
+
+/**
+ * hdhomerun_simulated_backend_configure:
+ * @new_config: the fleet to simulate
+ *
+ * Replace the simulated fleet, with every device online. Streams of
+ * the previous fleet are stopped; none of its handles may still be open.
+ */
+void
+hdhomerun_simulated_backend_configure (const HdhomerunSimulatedConfig *new_config)
+{
+  g_return_if_fail (new_config != NULL);
+  g_return_if_fail (new_config->n_devices <= MAX_DEVICES);
+  g_return_if_fail (new_config->tuners_per_device > 0 && new_config->tuners_per_device <= MAX_TUNERS);
+  g_return_if_fail (new_config->n_interfaces > 0 && new_config->n_interfaces <= 255);
+
+  free_fleet ();
+
+  config = *new_config;
+  fleet = g_new0 (SimulatedDevice, config.n_devices);
+  n_fleet = config.n_devices;
+  g_atomic_int_set (&n_online, (gint) n_fleet);
+  fleet_by_name = g_hash_table_new (g_str_hash, g_str_equal);
+
+  for (guint i = 0; i < n_fleet; i++)
+    {
+      SimulatedDevice *device = &fleet[i];
+
+      device->index = i;
+      device->device_id = DEVICE_ID_BASE + i;
+      g_snprintf (device->device_id_str, sizeof (device->device_id_str), "%08X", device->device_id);
+      device->model = models[i % G_N_ELEMENTS (models)];
+      device->tuners = g_new0 (SimulatedTuner, config.tuners_per_device);
+      device->interfaces = g_new0 (struct hdhomerun_discover2_device_if_t, config.n_interfaces);
+
+      for (guint j = 0; j < config.n_interfaces; j++)
+        {
+          struct hdhomerun_discover2_device_if_t *device_if = &device->interfaces[j];
+          struct sockaddr_in *sin = (struct sockaddr_in *)&device_if->ip_addr;
+          guint8 bytes[4] = { 10, j, i / 250, i % 250 + 1 };
+
+          sin->sin_family = AF_INET;
+          memcpy (&sin->sin_addr, bytes, sizeof (bytes));
+          g_snprintf (device_if->ip_str, sizeof (device_if->ip_str), "%u.%u.%u.%u",
+                      bytes[0], bytes[1], bytes[2], bytes[3]);
+          device_if->next = j + 1 < config.n_interfaces ? &device->interfaces[j + 1] : NULL;
+
+          g_hash_table_insert (fleet_by_name, device_if->ip_str, device);
+        }
+
+      g_hash_table_insert (fleet_by_name, device->device_id_str, device);
+    }
+}
+
+/**
+ * hdhomerun_simulated_backend_set_n_online:
+ * @online: how many devices answer
+ *
+ * Take every device past the first @online offline, as if unplugged,
+ * and bring the others back.
+ */
+void
+hdhomerun_simulated_backend_set_n_online (guint online)
+{
+  g_atomic_int_set (&n_online, (gint) MIN (online, n_fleet));
+}
+
+/* Discovery */
+
+static void
+discover_clear (struct hdhomerun_discover_t *ds)
+{
+  g_clear_pointer (&ds->replies, g_free);
+  ds->n_replies = 0;
+}
+
+static void
+discover_add_reply (struct hdhomerun_discover_t *ds,
+                    const SimulatedDevice       *device)
+{
+  struct hdhomerun_discover2_device_t *reply = &ds->replies[ds->n_replies++];
+
+  reply->device = device;
+  if (ds->n_replies > 1)
+    ds->replies[ds->n_replies - 2].next = reply;
+}
+
+static struct hdhomerun_discover_t *
+discover_create (void)
+{
+  return g_new0 (struct hdhomerun_discover_t, 1);
+}
+
+static void
+discover_destroy (struct hdhomerun_discover_t *ds)
+{
+  discover_clear (ds);
+  g_free (ds);
+}
+
+static int
+discover_find_devices_broadcast (struct hdhomerun_discover_t *ds,
+                                 uint32_t                     flags,
+                                 uint32_t const               device_types[],
+                                 size_t                       device_types_count)
+{
+  (void)device_types; /* unused */
+  (void)device_types_count; /* unused */
+
+  discover_clear (ds);
+
+  if (config.latency_ms > 0)
+    g_usleep (config.latency_ms * G_TIME_SPAN_MILLISECOND);
+
+  /* The fleet only has IPv4 addresses */
+  if (!(flags & HDHOMERUN_DISCOVER_FLAGS_IPV4_GENERAL))
+    return 0;
+
+  ds->replies = g_new0 (struct hdhomerun_discover2_device_t, MAX (n_fleet, 1));
+  for (guint i = 0; i < n_fleet; i++)
+    {
+      if (is_online (&fleet[i]) && !is_lost ())
+        discover_add_reply (ds, &fleet[i]);
+    }
+
+  return (int) ds->n_replies;
+}
+
+static int
+discover_find_devices_targeted (struct hdhomerun_discover_t *ds,
+                                const struct sockaddr       *target_addr,
+                                uint32_t const               device_types[],
+                                size_t                       device_types_count)
+{
+  char ip_str[HDHOMERUN_IP_STRING_SIZE];
+  const SimulatedDevice *device;
+
+  (void)device_types; /* unused */
+  (void)device_types_count; /* unused */
+
+  discover_clear (ds);
+
+  hdhomerun_sock_sockaddr_to_ip_str (ip_str, target_addr, FALSE);
+  device = fleet_by_name ? g_hash_table_lookup (fleet_by_name, ip_str) : NULL;
+  if (device == NULL || !simulate_request (device))
+    return 0;
+
+  ds->replies = g_new0 (struct hdhomerun_discover2_device_t, 1);
+  discover_add_reply (ds, device);
+
+  return 1;
+}
+
+static struct hdhomerun_discover2_device_t *
+discover_iter_device_first (struct hdhomerun_discover_t *ds)
+{
+  return ds->n_replies > 0 ? &ds->replies[0] : NULL;
+}
+
+static struct hdhomerun_discover2_device_t *
+discover_iter_device_next (struct hdhomerun_discover2_device_t *device)
+{
+  return device->next;
+}
+
+static struct hdhomerun_discover2_device_if_t *
+discover_iter_device_if_first (struct hdhomerun_discover2_device_t *device)
+{
+  return device->device->interfaces;
+}
+
+static struct hdhomerun_discover2_device_if_t *
+discover_iter_device_if_next (struct hdhomerun_discover2_device_if_t *device_if)
+{
+  return device_if->next;
+}
+
+static uint32_t
+discover_device_get_device_id (struct hdhomerun_discover2_device_t *device)
+{
+  return device->device->device_id;
+}
+
+static uint8_t
+discover_device_get_tuner_count (struct hdhomerun_discover2_device_t *device)
+{
+  (void)device; /* unused */
+
+  return (uint8_t) config.tuners_per_device;
+}
+
+static void
+discover_device_if_get_ip_addr (struct hdhomerun_discover2_device_if_t *device_if,
+                                struct sockaddr_storage                *ip_addr)
+{
+  *ip_addr = device_if->ip_addr;
+}
+
+/* Device control */
+
+static struct hdhomerun_device_t *
+device_create_from_str (const char *device_str)
+{
+  struct hdhomerun_device_t *hd;
+  SimulatedDevice *device;
+
+  device = fleet_by_name ? g_hash_table_lookup (fleet_by_name, device_str) : NULL;
+  if (device == NULL)
+    return NULL;
+
+  hd = g_new0 (struct hdhomerun_device_t, 1);
+  hd->device = device;
+
+  return hd;
+}
+
+static void
+device_destroy (struct hdhomerun_device_t *hd)
+{
+  SimulatedTuner *tuner = &hd->device->tuners[hd->tuner];
+
+  /* A real lockkey outlives the socket; dropping it keeps tests moving */
+  g_mutex_lock (&fleet_lock);
+  if (tuner->lock_owner == hd)
+    tuner->lock_owner = NULL;
+  g_mutex_unlock (&fleet_lock);
+
+  g_free (hd->value);
+  g_free (hd->error);
+  g_free (hd);
+}
+
+static int
+device_set_tuner (struct hdhomerun_device_t *hd,
+                  unsigned int               tuner)
+{
+  if (tuner >= config.tuners_per_device)
+    return 0;
+
+  hd->tuner = tuner;
+  return 1;
+}
+
+static const char *
+device_get_model_str (struct hdhomerun_device_t *hd)
+{
+  if (!simulate_request (hd->device))
+    return NULL;
+
+  return hd->device->model;
+}
+
+static uint32_t
+device_get_local_machine_addr (struct hdhomerun_device_t *hd)
+{
+  (void)hd; /* unused */
+
+  /* Simulated streams come from this process */
+  return 0x7f000001;
+}
+
+/* Called with fleet_lock held */
+static char *
+get_tuner_var (const SimulatedDevice *device,
+               const SimulatedTuner  *tuner,
+               const char            *name)
+{
+  if (g_str_equal (name, "status"))
+    {
+      struct hdhomerun_tuner_status_t status;
+
+      fill_status (device, tuner, &status);
+      return format_status (&status);
+    }
+  if (g_str_equal (name, "channel"))
+    return tuner->frequency ? g_strdup_printf ("auto:%u", tuner->frequency) : g_strdup ("none");
+  if (g_str_equal (name, "program"))
+    return g_strdup_printf ("%u", tuner->program);
+  if (g_str_equal (name, "target"))
+    return g_strdup (tuner->target ? tuner->target : "none");
+  if (g_str_equal (name, "lockkey"))
+    return g_strdup (tuner->lock_owner ? "locked" : "none");
+  if (g_str_equal (name, "channelmap"))
+    return g_strdup ("us-bcast");
+  if (g_str_equal (name, "streaminfo"))
+    return format_streaminfo (tuner);
+
+  return NULL;
+}
+
+static int
+device_get_var (struct hdhomerun_device_t  *hd,
+                const char                 *name,
+                char                      **pvalue,
+                char                      **perror)
+{
+  char *value = NULL;
+  char field[16];
+  guint index;
+
+  if (!simulate_request (hd->device))
+    return -1;
+
+  g_mutex_lock (&fleet_lock);
+  if (g_str_equal (name, "/sys/model"))
+    value = g_strdup (hd->device->model);
+  else if (g_str_equal (name, "/sys/version"))
+    value = g_strdup ("20250101");
+  else if (sscanf (name, "/tuner%u/%15s", &index, field) == 2 && index < config.tuners_per_device)
+    value = get_tuner_var (hd->device, &hd->device->tuners[index], field);
+  g_mutex_unlock (&fleet_lock);
+
+  set_reply (hd, value, value ? NULL : "ERROR: unknown getset variable", pvalue, perror);
+  return 1;
+}
+
+static int
+device_get_tuner_status (struct hdhomerun_device_t        *hd,
+                         char                            **pstatus_str,
+                         struct hdhomerun_tuner_status_t  *status)
+{
+  struct hdhomerun_tuner_status_t filled;
+
+  if (!simulate_request (hd->device))
+    return -1;
+
+  g_mutex_lock (&fleet_lock);
+  fill_status (hd->device, &hd->device->tuners[hd->tuner], &filled);
+  g_mutex_unlock (&fleet_lock);
+
+  if (status)
+    *status = filled;
+  set_reply (hd, format_status (&filled), NULL, pstatus_str, NULL);
+  return 1;
+}
+
+static int
+device_set_tuner_channel (struct hdhomerun_device_t *hd,
+                          const char                *channel)
+{
+  SimulatedTuner *tuner = &hd->device->tuners[hd->tuner];
+  guint32 frequency = 0;
+  const char *colon;
+  int ret = 1;
+
+  if (!simulate_request (hd->device))
+    return -1;
+
+  colon = strchr (channel, ':');
+  if (!g_str_equal (channel, "none"))
+    {
+      guint64 value = 0;
+
+      if (colon == NULL || !g_ascii_string_to_unsigned (colon + 1, 10, 1, G_MAXUINT32, &value, NULL))
+        return 0;
+
+      /* Channel numbers as in "us-bcast:7", frequencies otherwise */
+      frequency = value <= LAST_CHANNEL ? (value >= FIRST_CHANNEL ? channel_frequency (value) : 0)
+                                        : (guint32) value;
+      if (frequency == 0)
+        return 0;
+    }
+
+  g_mutex_lock (&fleet_lock);
+  if (is_locked_against (tuner, hd))
+    {
+      ret = 0;
+    }
+  else
+    {
+      tuner->frequency = frequency;
+      tuner->program = 0;
+      tuner->tuned_at = g_get_monotonic_time ();
+    }
+  g_mutex_unlock (&fleet_lock);
+
+  set_reply (hd, NULL, ret > 0 ? NULL : RESOURCE_LOCKED, NULL, NULL);
+  return ret;
+}
+
+static int
+device_set_tuner_program (struct hdhomerun_device_t *hd,
+                          const char                *program)
+{
+  SimulatedTuner *tuner = &hd->device->tuners[hd->tuner];
+  guint64 number;
+  int ret = 1;
+
+  if (!simulate_request (hd->device))
+    return -1;
+
+  if (g_str_equal (program, "none"))
+    number = 0;
+  else if (!g_ascii_string_to_unsigned (program, 10, 0, G_MAXUINT16, &number, NULL))
+    return 0;
+
+  g_mutex_lock (&fleet_lock);
+  if (is_locked_against (tuner, hd))
+    ret = 0;
+  else
+    tuner->program = (guint) number;
+  g_mutex_unlock (&fleet_lock);
+
+  return ret;
+}
+
+static int
+device_get_tuner_target (struct hdhomerun_device_t  *hd,
+                         char                      **ptarget)
+{
+  char *target;
+
+  if (!simulate_request (hd->device))
+    return -1;
+
+  g_mutex_lock (&fleet_lock);
+  target = g_strdup (hd->device->tuners[hd->tuner].target ? hd->device->tuners[hd->tuner].target : "none");
+  g_mutex_unlock (&fleet_lock);
+
+  set_reply (hd, target, NULL, ptarget, NULL);
+  return 1;
+}
+
+static int
+device_set_tuner_target (struct hdhomerun_device_t *hd,
+                         const char                *target)
+{
+  SimulatedTuner *tuner = &hd->device->tuners[hd->tuner];
+  Sender *old = NULL;
+  Sender *sender = NULL;
+  gboolean none = g_str_equal (target, "none");
+  int ret = 1;
+
+  if (!simulate_request (hd->device))
+    return -1;
+
+  if (!none)
+    {
+      sender = sender_start (hd->device, hd->tuner, target);
+      if (sender == NULL)
+        return 0;
+    }
+
+  g_mutex_lock (&fleet_lock);
+  if (is_locked_against (tuner, hd))
+    {
+      ret = 0;
+      old = sender;
+    }
+  else
+    {
+      old = tuner->sender;
+      tuner->sender = sender;
+      g_free (tuner->target);
+      tuner->target = none ? NULL : g_strdup (target);
+    }
+  g_mutex_unlock (&fleet_lock);
+
+  /* Joined outside the lock, which the sender takes every tick */
+  sender_stop (old);
+
+  return ret;
+}
+
+static int
+device_get_tuner_channelmap (struct hdhomerun_device_t  *hd,
+                             char                      **pchannelmap)
+{
+  if (!simulate_request (hd->device))
+    return -1;
+
+  set_reply (hd, g_strdup ("us-bcast"), NULL, pchannelmap, NULL);
+  return 1;
+}
+
+static int
+device_tuner_lockkey_request (struct hdhomerun_device_t  *hd,
+                              char                      **perror)
+{
+  SimulatedTuner *tuner = &hd->device->tuners[hd->tuner];
+  int ret = 1;
+
+  if (!simulate_request (hd->device))
+    return -1;
+
+  g_mutex_lock (&fleet_lock);
+  if (is_locked_against (tuner, hd))
+    ret = 0;
+  else
+    tuner->lock_owner = hd;
+  g_mutex_unlock (&fleet_lock);
+
+  set_reply (hd, NULL, ret > 0 ? NULL : RESOURCE_LOCKED, NULL, perror);
+  return ret;
+}
+
+static int
+device_tuner_lockkey_release (struct hdhomerun_device_t *hd)
+{
+  SimulatedTuner *tuner = &hd->device->tuners[hd->tuner];
+
+  if (!simulate_request (hd->device))
+    return -1;
+
+  g_mutex_lock (&fleet_lock);
+  if (tuner->lock_owner == hd)
+    tuner->lock_owner = NULL;
+  g_mutex_unlock (&fleet_lock);
+
+  return 1;
+}
+
+static int
+device_channelscan_init (struct hdhomerun_device_t *hd,
+                         const char                *channelmap)
+{
+  if (!simulate_request (hd->device))
+    return -1;
+
+  if (!g_str_equal (channelmap, "us-bcast"))
+    return 0;
+
+  hd->scan_next = FIRST_CHANNEL;
+  hd->scan_current = 0;
+  return 1;
+}
+
+static int
+device_channelscan_advance (struct hdhomerun_device_t            *hd,
+                            struct hdhomerun_channelscan_result_t *result)
+{
+  SimulatedTuner *tuner = &hd->device->tuners[hd->tuner];
+
+  if (hd->scan_next == 0 || hd->scan_next > LAST_CHANNEL)
+    return 0;
+
+  if (!simulate_request (hd->device))
+    return -1;
+
+  hd->scan_current = hd->scan_next++;
+
+  memset (result, 0, sizeof (*result));
+  g_snprintf (result->channel_str, sizeof (result->channel_str), "us-bcast:%u", hd->scan_current);
+  result->frequency = channel_frequency (hd->scan_current);
+
+  g_mutex_lock (&fleet_lock);
+  tuner->frequency = result->frequency;
+  tuner->program = 0;
+  tuner->tuned_at = g_get_monotonic_time ();
+  g_mutex_unlock (&fleet_lock);
+
+  return 1;
+}
+
+static int
+device_channelscan_detect (struct hdhomerun_device_t            *hd,
+                           struct hdhomerun_channelscan_result_t *result)
+{
+  guint channel = hd->scan_current;
+
+  if (channel == 0)
+    return 0;
+
+  g_usleep (DETECT_MS * G_TIME_SPAN_MILLISECOND);
+  if (!simulate_request (hd->device))
+    return -1;
+
+  /* Detection waits for lock, so report the status as it is once locked */
+  g_mutex_lock (&fleet_lock);
+  hd->device->tuners[hd->tuner].tuned_at -= LOCK_DELAY_MS * G_TIME_SPAN_MILLISECOND;
+  fill_status (hd->device, &hd->device->tuners[hd->tuner], &result->status);
+  g_mutex_unlock (&fleet_lock);
+
+  result->program_count = (int) channel_n_programs (channel);
+  for (int i = 0; i < result->program_count; i++)
+    {
+      struct hdhomerun_channelscan_program_t *program = &result->programs[i];
+
+      program->program_number = i + 1;
+      program->virtual_major = channel;
+      program->virtual_minor = i + 1;
+      program_name (channel, i + 1, program->name, sizeof (program->name));
+      g_snprintf (program->program_str, sizeof (program->program_str), "%u: %u.%u %s",
+                  program->program_number, program->virtual_major, program->virtual_minor,
+                  program->name);
+    }
+
+  if (result->program_count > 0)
+    {
+      result->transport_stream_id_detected = TRUE;
+      result->transport_stream_id = 1;
+    }
+
+  return 1;
+}
+
+static uint8_t
+device_channelscan_get_progress (struct hdhomerun_device_t *hd)
+{
+  if (hd->scan_current == 0)
+    return 0;
+
+  return (uint8_t) ((hd->scan_current - FIRST_CHANNEL + 1) * 100 / (LAST_CHANNEL - FIRST_CHANNEL + 1));
+}
+
+static const HdhomerunBackend simulated_backend = {
+  .name = "simulated",
+
+  .discover_create = discover_create,
+  .discover_destroy = discover_destroy,
+  .discover_find_devices_broadcast = discover_find_devices_broadcast,
+  .discover_find_devices_targeted = discover_find_devices_targeted,
+  .discover_iter_device_first = discover_iter_device_first,
+  .discover_iter_device_next = discover_iter_device_next,
+  .discover_iter_device_if_first = discover_iter_device_if_first,
+  .discover_iter_device_if_next = discover_iter_device_if_next,
+  .discover_device_get_device_id = discover_device_get_device_id,
+  .discover_device_get_tuner_count = discover_device_get_tuner_count,
+  .discover_device_if_get_ip_addr = discover_device_if_get_ip_addr,
+
+  .device_create_from_str = device_create_from_str,
+  .device_destroy = device_destroy,
+  .device_set_tuner = device_set_tuner,
+  .device_get_model_str = device_get_model_str,
+  .device_get_local_machine_addr = device_get_local_machine_addr,
+  .device_get_var = device_get_var,
+  .device_get_tuner_status = device_get_tuner_status,
+  .device_set_tuner_channel = device_set_tuner_channel,
+  .device_set_tuner_program = device_set_tuner_program,
+  .device_get_tuner_target = device_get_tuner_target,
+  .device_set_tuner_target = device_set_tuner_target,
+  .device_get_tuner_channelmap = device_get_tuner_channelmap,
+  .device_tuner_lockkey_request = device_tuner_lockkey_request,
+  .device_tuner_lockkey_release = device_tuner_lockkey_release,
+  .device_channelscan_init = device_channelscan_init,
+  .device_channelscan_advance = device_channelscan_advance,
+  .device_channelscan_detect = device_channelscan_detect,
+  .device_channelscan_get_progress = device_channelscan_get_progress,
+};
+
+/**
+ * hdhomerun_simulated_backend_get:
+ *
+ * Returns: (transfer none): the backend answering for the simulated
+ *   fleet, which must have been configured first
+ */
+const HdhomerunBackend *
+hdhomerun_simulated_backend_get (void)
+{
+  return &simulated_backend;
+}
@@ -0,0 +1,49 @@
+/* hdhomerun-simulated-backend.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "hdhomerun-backend.h"
+
+G_BEGIN_DECLS
+
+typedef struct
+{
+  guint  n_devices;
+  guint  tuners_per_device;
+  guint  n_interfaces;       /* Per device */
+  guint  latency_ms;         /* Per request and per discovery pass */
+  double loss;               /* Probability that a request, reply or datagram is lost */
+  guint  timeout_ms;         /* How long a lost request takes to fail */
+  guint  bitrate;            /* Bits per second of every stream */
+} HdhomerunSimulatedConfig;
+
+void                    hdhomerun_simulated_config_init       (HdhomerunSimulatedConfig  *config);
+gboolean                hdhomerun_simulated_config_parse      (HdhomerunSimulatedConfig  *config,
+                                                               const char                *spec,
+                                                               GError                   **error);
+
+/* Replaces the fleet; no handle of the previous one may still be open */
+void                    hdhomerun_simulated_backend_configure (const HdhomerunSimulatedConfig *config);
+void                    hdhomerun_simulated_backend_set_n_online
+                                                              (guint                      n_online);
+const HdhomerunBackend *hdhomerun_simulated_backend_get       (void);
+
+G_END_DECLS
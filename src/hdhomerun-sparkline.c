@@ -0,0 +1,278 @@
+/* hdhomerun-sparkline.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-sparkline.h"
+
+/* HdhomerunSparkline draws a signal history as one bar per sample: signal
+ * strength faintly behind, signal quality in front while locked.
+ *
+ * Bars are plain color nodes, so nothing is tessellated. They are built
+ * in chunks of CHUNK_SAMPLES; a full chunk is kept as a render node and
+ * reused until it scrolls out, so a new sample only rebuilds the open
+ * chunk at the end. Scrolling is a translation of the cached nodes. The
+ * cache is dropped when the size, color or history changes.
+ */
+
+#define CHUNK_SAMPLES    32
+#define NATURAL_HEIGHT   48
+
+struct _HdhomerunSparkline
+{
+  GtkWidget parent_instance;
+
+  HdhomerunSignalHistory *history;
+
+  /* Cached nodes; x is (sample number - origin) * step */
+  GPtrArray *chunks;              /* GskRenderNode, full chunks */
+  guint64 chunk_base;             /* Number of the first sample of chunks[0] */
+  GskRenderNode *tail;            /* The open chunk */
+  guint64 tail_end;
+  guint64 origin;
+  int width;
+  int height;
+  GdkRGBA color;
+};
+
+G_DEFINE_FINAL_TYPE (HdhomerunSparkline, hdhomerun_sparkline, GTK_TYPE_WIDGET)
+
+static void
+clear_cache (HdhomerunSparkline *self)
+{
+  g_ptr_array_set_size (self->chunks, 0);
+  g_clear_pointer (&self->tail, gsk_render_node_unref);
+  self->width = 0;
+  self->height = 0;
+}
+
+static GskRenderNode *
+build_node (HdhomerunSparkline *self,
+            guint64             from,
+            guint64             to)
+{
+  GtkSnapshot *snapshot = gtk_snapshot_new ();
+  float step = (float) self->width / hdhomerun_signal_history_get_size (self->history);
+  GdkRGBA faint = self->color;
+
+  faint.alpha *= 0.25f;
+
+  for (guint64 n = from; n < to; n++)
+    {
+      const HdhomerunSignalSample *sample = hdhomerun_signal_history_get_sample (self->history, n);
+      float x = (float) (n - self->origin) * step;
+      float h;
+
+      h = self->height * sample->signal_strength / 100.0f;
+      gtk_snapshot_append_color (snapshot, &faint,
+                                 &GRAPHENE_RECT_INIT (x, self->height - h, step, h));
+
+      if (!sample->locked)
+        continue;
+
+      h = self->height * sample->signal_quality / 100.0f;
+      gtk_snapshot_append_color (snapshot, &self->color,
+                                 &GRAPHENE_RECT_INIT (x, self->height - h, step, h));
+    }
+
+  return gtk_snapshot_free_to_node (snapshot);
+}
+
+static void
+update_cache (HdhomerunSparkline *self,
+              int                 width,
+              int                 height,
+              const GdkRGBA      *color)
+{
+  guint64 first = hdhomerun_signal_history_get_first (self->history);
+  guint64 end = hdhomerun_signal_history_get_end (self->history);
+  guint64 open_start;
+
+  if (width != self->width || height != self->height || !gdk_rgba_equal (color, &self->color))
+    {
+      clear_cache (self);
+      self->width = width;
+      self->height = height;
+      self->color = *color;
+      self->origin = first;
+      self->chunk_base = first;
+    }
+
+  /* Chunks that have scrolled out entirely */
+  while (self->chunks->len > 0 && self->chunk_base + CHUNK_SAMPLES <= first)
+    {
+      g_ptr_array_remove_index (self->chunks, 0);
+      self->chunk_base += CHUNK_SAMPLES;
+    }
+  if (self->chunks->len == 0 && self->chunk_base < first)
+    self->chunk_base = first;
+
+  /* Close chunks that have filled up since the last frame */
+  while (self->chunk_base + (self->chunks->len + 1) * CHUNK_SAMPLES <= end)
+    {
+      guint64 from = self->chunk_base + self->chunks->len * CHUNK_SAMPLES;
+
+      g_ptr_array_add (self->chunks, build_node (self, from, from + CHUNK_SAMPLES));
+      g_clear_pointer (&self->tail, gsk_render_node_unref);
+    }
+
+  open_start = self->chunk_base + self->chunks->len * CHUNK_SAMPLES;
+  if (self->tail == NULL || self->tail_end != end)
+    {
+      g_clear_pointer (&self->tail, gsk_render_node_unref);
+      if (open_start < end)
+        self->tail = build_node (self, open_start, end);
+      self->tail_end = end;
+    }
+}
+
+static void
+hdhomerun_sparkline_snapshot (GtkWidget   *widget,
+                              GtkSnapshot *snapshot)
+{
+  HdhomerunSparkline *self = HDHOMERUN_SPARKLINE (widget);
+  int width = gtk_widget_get_width (widget);
+  int height = gtk_widget_get_height (widget);
+  GdkRGBA color;
+  float step;
+  guint64 end;
+
+  if (self->history == NULL || width <= 0 || height <= 0)
+    return;
+
+  gtk_widget_get_color (widget, &color);
+  update_cache (self, width, height, &color);
+
+  /* Newest sample at the right edge */
+  step = (float) width / hdhomerun_signal_history_get_size (self->history);
+  end = hdhomerun_signal_history_get_end (self->history);
+
+  gtk_snapshot_push_clip (snapshot, &GRAPHENE_RECT_INIT (0, 0, width, height));
+  gtk_snapshot_save (snapshot);
+  gtk_snapshot_translate (snapshot, &GRAPHENE_POINT_INIT (width - (float) (end - self->origin) * step, 0));
+
+  for (guint i = 0; i < self->chunks->len; i++)
+    gtk_snapshot_append_node (snapshot, g_ptr_array_index (self->chunks, i));
+  if (self->tail != NULL)
+    gtk_snapshot_append_node (snapshot, self->tail);
+
+  gtk_snapshot_restore (snapshot);
+  gtk_snapshot_pop (snapshot);
+}
+
+static void
+hdhomerun_sparkline_measure (GtkWidget      *widget,
+                             GtkOrientation  orientation,
+                             int             for_size,
+                             int            *minimum,
+                             int            *natural,
+                             int            *minimum_baseline,
+                             int            *natural_baseline)
+{
+  (void)widget; /* unused */
+  (void)for_size; /* unused */
+
+  *minimum = 0;
+  *natural = orientation == GTK_ORIENTATION_VERTICAL ? NATURAL_HEIGHT : 0;
+  *minimum_baseline = -1;
+  *natural_baseline = -1;
+}
+
+GtkWidget *
+hdhomerun_sparkline_new (void)
+{
+  return g_object_new (HDHOMERUN_TYPE_SPARKLINE, NULL);
+}
+
+/**
+ * hdhomerun_sparkline_set_history:
+ * @self: a #HdhomerunSparkline
+ * @history: (nullable): the samples to draw
+ */
+void
+hdhomerun_sparkline_set_history (HdhomerunSparkline     *self,
+                                 HdhomerunSignalHistory *history)
+{
+  g_return_if_fail (HDHOMERUN_IS_SPARKLINE (self));
+
+  if (self->history == history)
+    return;
+
+  g_clear_pointer (&self->history, hdhomerun_signal_history_unref);
+  if (history)
+    self->history = hdhomerun_signal_history_ref (history);
+
+  clear_cache (self);
+  gtk_widget_queue_draw (GTK_WIDGET (self));
+}
+
+/**
+ * hdhomerun_sparkline_update:
+ * @self: a #HdhomerunSparkline
+ *
+ * Redraw on the next frame if samples were appended since the last one.
+ */
+void
+hdhomerun_sparkline_update (HdhomerunSparkline *self)
+{
+  g_return_if_fail (HDHOMERUN_IS_SPARKLINE (self));
+
+  if (self->history != NULL &&
+      (self->tail_end != hdhomerun_signal_history_get_end (self->history) || self->width == 0))
+    gtk_widget_queue_draw (GTK_WIDGET (self));
+}
+
+static void
+hdhomerun_sparkline_dispose (GObject *object)
+{
+  HdhomerunSparkline *self = (HdhomerunSparkline *)object;
+
+  g_clear_pointer (&self->history, hdhomerun_signal_history_unref);
+  g_clear_pointer (&self->tail, gsk_render_node_unref);
+
+  G_OBJECT_CLASS (hdhomerun_sparkline_parent_class)->dispose (object);
+}
+
+static void
+hdhomerun_sparkline_finalize (GObject *object)
+{
+  HdhomerunSparkline *self = (HdhomerunSparkline *)object;
+
+  g_clear_pointer (&self->chunks, g_ptr_array_unref);
+
+  G_OBJECT_CLASS (hdhomerun_sparkline_parent_class)->finalize (object);
+}
+
+static void
+hdhomerun_sparkline_class_init (HdhomerunSparklineClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+
+  object_class->dispose = hdhomerun_sparkline_dispose;
+  object_class->finalize = hdhomerun_sparkline_finalize;
+
+  widget_class->snapshot = hdhomerun_sparkline_snapshot;
+  widget_class->measure = hdhomerun_sparkline_measure;
+
+  gtk_widget_class_set_css_name (widget_class, "sparkline");
+}
+
+static void
+hdhomerun_sparkline_init (HdhomerunSparkline *self)
+{
+  self->chunks = g_ptr_array_new_with_free_func ((GDestroyNotify) gsk_render_node_unref);
+}
@@ -0,0 +1,36 @@
+/* hdhomerun-sparkline.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <adwaita.h>
+
+#include "hdhomerun-signal-history.h"
+
+G_BEGIN_DECLS
+
+#define HDHOMERUN_TYPE_SPARKLINE (hdhomerun_sparkline_get_type())
+
+G_DECLARE_FINAL_TYPE (HdhomerunSparkline, hdhomerun_sparkline, HDHOMERUN, SPARKLINE, GtkWidget)
+
+GtkWidget *hdhomerun_sparkline_new         (void);
+void       hdhomerun_sparkline_set_history (HdhomerunSparkline     *self,
+                                            HdhomerunSignalHistory *history);
+void       hdhomerun_sparkline_update      (HdhomerunSparkline     *self);
+
+G_END_DECLS
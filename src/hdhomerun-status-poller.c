@@ -0,0 +1,602 @@
+/* hdhomerun-status-poller.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-status-poller.h"
+#include "hdhomerun-backend.h"
+#include "hdhomerun-connection-pool.h"
+#include "hdhomerun-dispatcher.h"
+
+/* HdhomerunStatusPoller keeps the status of watched tuner items current.
+ *
+ * Items are watched while they are bound to a row, so tuners that are
+ * scrolled off-screen cost nothing. On every tick each device with
+ * watched tuners gets one pass on a worker thread that reads all of
+ * them back to back over the control connection of tuner 0, instead of
+ * one connection and one wakeup per tuner. A device whose previous pass
+ * has not finished is skipped for that tick. Passes hand their results
+ * to the HdhomerunDispatcher, so every device that answered within a
+ * frame is applied in one batch.
+ *
+ * Results are stored with hdhomerun_tuner_item_set_status(), so only
+ * items whose values changed notify. Every result is also appended to
+ * the signal history of its tuner, which outlives the item so it keeps
+ * covering the last few minutes while the row is off-screen.
+ */
+
+#define DEFAULT_INTERVAL_MS 1000
+#define MIN_INTERVAL_MS     250
+#define MAX_POLL_THREADS    16
+
+typedef struct
+{
+  char *device_id;
+  GPtrArray *items;                 /* HdhomerunTunerItem, watched */
+  HdhomerunConnection *connection;  /* Acquired on the first pass */
+  guint generation;                 /* Tells a rewatched device apart */
+  gboolean busy;
+} DevicePoll;
+
+typedef struct
+{
+  HdhomerunStatusPoller *self;      /* Held */
+  char *device_id;
+  guint generation;                 /* Of the DevicePoll that started it */
+  HdhomerunConnection *connection;  /* Held */
+  GArray *tuners;                   /* guint */
+  GArray *statuses;                 /* HdhomerunTunerStatus, same order */
+  gboolean reached;
+} PollData;
+
+struct _HdhomerunStatusPoller
+{
+  GObject parent_instance;
+
+  HdhomerunDeviceStore *devices;
+  GThreadPool *pool;                /* Runs a PollData per pass */
+  GHashTable *polls;                /* device ID -> DevicePoll */
+  GHashTable *histories;            /* "ID:tuner" -> HdhomerunSignalHistory */
+  guint interval;
+  gboolean active;
+  guint timeout_id;
+  guint next_generation;
+};
+
+G_DEFINE_FINAL_TYPE (HdhomerunStatusPoller, hdhomerun_status_poller, G_TYPE_OBJECT)
+
+enum {
+  PROP_0,
+  PROP_INTERVAL,
+  PROP_ACTIVE,
+  N_PROPS
+};
+
+enum {
+  SAMPLED,
+  N_SIGNALS
+};
+
+static GParamSpec *properties [N_PROPS];
+static guint signals [N_SIGNALS];
+
+static char *
+history_key (const char *device_id,
+             guint       tuner_index)
+{
+  return g_strdup_printf ("%s:%u", device_id, tuner_index);
+}
+
+static HdhomerunSignalHistory *
+ensure_history (HdhomerunStatusPoller *self,
+                const char            *device_id,
+                guint                  tuner_index)
+{
+  g_autofree char *key = history_key (device_id, tuner_index);
+  HdhomerunSignalHistory *history;
+
+  history = g_hash_table_lookup (self->histories, key);
+  if (history == NULL)
+    {
+      history = hdhomerun_signal_history_new (HDHOMERUN_SIGNAL_HISTORY_DEFAULT_SIZE);
+      g_hash_table_insert (self->histories, g_steal_pointer (&key), history);
+    }
+
+  return history;
+}
+
+static void
+device_poll_free (DevicePoll *poll)
+{
+  if (poll->connection)
+    hdhomerun_connection_pool_release (hdhomerun_connection_pool_get_default (),
+                                       poll->connection);
+  g_ptr_array_unref (poll->items);
+  g_free (poll->device_id);
+  g_free (poll);
+}
+
+static void
+poll_data_free (PollData *data)
+{
+  hdhomerun_connection_pool_release (hdhomerun_connection_pool_get_default (),
+                                     data->connection);
+  g_array_unref (data->tuners);
+  g_array_unref (data->statuses);
+  g_free (data->device_id);
+  g_object_unref (data->self);
+  g_free (data);
+}
+
+static void apply_poll (gpointer user_data);
+
+static void
+poll_thread (gpointer data_,
+             gpointer user_data)
+{
+  PollData *data = data_;
+  struct hdhomerun_device_t *hd;
+
+  (void)user_data; /* unused */
+
+  hd = hdhomerun_connection_lock (data->connection);
+  if (hd == NULL)
+    {
+      hdhomerun_dispatcher_push (hdhomerun_dispatcher_get_default (), apply_poll,
+                                 data, (GDestroyNotify) poll_data_free);
+      return;
+    }
+
+  /* One connection and one lock for the whole device */
+  for (guint i = 0; i < data->tuners->len; i++)
+    {
+      HdhomerunTunerStatus *status = &g_array_index (data->statuses, HdhomerunTunerStatus, i);
+      char path[32];
+      char *value = NULL;
+      char *error = NULL;
+
+      g_snprintf (path, sizeof path, "/tuner%u/status", g_array_index (data->tuners, guint, i));
+      if (hdhomerun_backend_get_default ()->device_get_var (hd, path, &value, &error) > 0 && error == NULL && value != NULL)
+        hdhomerun_tuner_status_parse (value, status);
+    }
+
+  hdhomerun_connection_unlock (data->connection);
+  data->reached = TRUE;
+
+  hdhomerun_dispatcher_push (hdhomerun_dispatcher_get_default (), apply_poll,
+                             data, (GDestroyNotify) poll_data_free);
+}
+
+static void
+apply_poll (gpointer user_data)
+{
+  PollData *data = user_data;
+  HdhomerunStatusPoller *self = data->self;
+  DevicePoll *poll;
+
+  /* Every watched item may have been unwatched meanwhile, and the device
+   * watched again with a pass of its own in flight; only that pass can
+   * clear busy.
+   */
+  poll = g_hash_table_lookup (self->polls, data->device_id);
+  if (poll != NULL && poll->generation == data->generation)
+    poll->busy = FALSE;
+
+  if (!data->reached)
+    {
+      g_debug ("Status poll failed: Could not reach device %s", data->device_id);
+      return;
+    }
+
+  for (guint i = 0; i < data->tuners->len; i++)
+    {
+      const HdhomerunTunerStatus *status = &g_array_index (data->statuses, HdhomerunTunerStatus, i);
+      guint tuner_index = g_array_index (data->tuners, guint, i);
+      g_autofree char *key = history_key (data->device_id, tuner_index);
+      HdhomerunSignalHistory *history;
+      HdhomerunSignalSample sample;
+
+      if (!status->valid)
+        continue;
+
+      /* Not brought back for a tuner forgotten during the pass */
+      history = g_hash_table_lookup (self->histories, key);
+      if (history == NULL)
+        continue;
+
+      sample.signal_strength = MIN (status->signal_strength, 100);
+      sample.signal_quality = MIN (status->signal_quality, 100);
+      sample.symbol_quality = MIN (status->symbol_quality, 100);
+      sample.locked = !g_str_equal (status->lock, "none");
+      hdhomerun_signal_history_append (history, &sample);
+      g_signal_emit (self, signals [SAMPLED], 0, data->device_id, tuner_index);
+    }
+
+  if (poll == NULL)
+    return;
+
+  for (guint i = 0; i < poll->items->len; i++)
+    {
+      HdhomerunTunerItem *item = g_ptr_array_index (poll->items, i);
+      guint tuner_index = hdhomerun_tuner_item_get_tuner_index (item);
+
+      for (guint j = 0; j < data->tuners->len; j++)
+        {
+          const HdhomerunTunerStatus *status;
+
+          if (g_array_index (data->tuners, guint, j) != tuner_index)
+            continue;
+
+          status = &g_array_index (data->statuses, HdhomerunTunerStatus, j);
+          if (status->valid)
+            hdhomerun_tuner_item_set_status (item, status);
+          break;
+        }
+    }
+}
+
+static void
+poll_device (HdhomerunStatusPoller *self,
+             DevicePoll            *poll)
+{
+  HdhomerunConnectionPool *pool = hdhomerun_connection_pool_get_default ();
+  const HdhomerunDeviceInfo *info;
+  PollData *data;
+
+  if (poll->busy || poll->items->len == 0)
+    return;
+
+  info = hdhomerun_device_store_lookup_device (self->devices, poll->device_id);
+  if (info == NULL || info->control_address == NULL)
+    return;
+
+  if (poll->connection == NULL)
+    poll->connection = hdhomerun_connection_pool_acquire (pool, poll->device_id, 0,
+                                                          info->control_address);
+
+  data = g_new0 (PollData, 1);
+  data->self = g_object_ref (self);
+  data->device_id = g_strdup (poll->device_id);
+  data->generation = poll->generation;
+  data->connection = poll->connection;
+  hdhomerun_connection_pool_hold (pool, data->connection);
+  data->tuners = g_array_sized_new (FALSE, FALSE, sizeof (guint), poll->items->len);
+  data->statuses = g_array_sized_new (FALSE, TRUE, sizeof (HdhomerunTunerStatus), poll->items->len);
+
+  /* Several rows may show the same tuner */
+  for (guint i = 0; i < poll->items->len; i++)
+    {
+      guint tuner_index = hdhomerun_tuner_item_get_tuner_index (g_ptr_array_index (poll->items, i));
+      gboolean seen = FALSE;
+
+      for (guint j = 0; j < data->tuners->len && !seen; j++)
+        seen = g_array_index (data->tuners, guint, j) == tuner_index;
+
+      if (!seen)
+        g_array_append_val (data->tuners, tuner_index);
+    }
+  g_array_set_size (data->statuses, data->tuners->len);
+
+  poll->busy = TRUE;
+
+  g_thread_pool_push (self->pool, data, NULL);
+}
+
+static gboolean
+on_timeout (gpointer user_data)
+{
+  HdhomerunStatusPoller *self = user_data;
+  GHashTableIter iter;
+  DevicePoll *poll;
+
+  g_hash_table_iter_init (&iter, self->polls);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &poll))
+    poll_device (self, poll);
+
+  return G_SOURCE_CONTINUE;
+}
+
+/* Only touch a running timer when it has to start or stop, so a list
+ * that keeps binding rows while scrolling does not keep postponing it
+ */
+static void
+update_timeout (HdhomerunStatusPoller *self)
+{
+  gboolean wanted = self->active && g_hash_table_size (self->polls) > 0;
+
+  if (!wanted)
+    g_clear_handle_id (&self->timeout_id, g_source_remove);
+  else if (self->timeout_id == 0)
+    self->timeout_id = g_timeout_add (self->interval, on_timeout, self);
+}
+
+/**
+ * hdhomerun_status_poller_watch:
+ * @self: a #HdhomerunStatusPoller
+ * @item: the tuner to keep current
+ *
+ * Start polling the tuner of @item. Each call needs a matching
+ * hdhomerun_status_poller_unwatch().
+ */
+void
+hdhomerun_status_poller_watch (HdhomerunStatusPoller *self,
+                               HdhomerunTunerItem    *item)
+{
+  const char *device_id;
+  DevicePoll *poll;
+
+  g_return_if_fail (HDHOMERUN_IS_STATUS_POLLER (self));
+  g_return_if_fail (HDHOMERUN_IS_TUNER_ITEM (item));
+
+  device_id = hdhomerun_tuner_item_get_device_id (item);
+  poll = g_hash_table_lookup (self->polls, device_id);
+  if (poll == NULL)
+    {
+      poll = g_new0 (DevicePoll, 1);
+      poll->device_id = g_strdup (device_id);
+      poll->items = g_ptr_array_new_with_free_func (g_object_unref);
+      poll->generation = self->next_generation++;
+      g_hash_table_insert (self->polls, poll->device_id, poll);
+    }
+
+  g_ptr_array_add (poll->items, g_object_ref (item));
+  ensure_history (self, device_id, hdhomerun_tuner_item_get_tuner_index (item));
+  update_timeout (self);
+
+  /* Fill in a row that has never had a status without waiting a tick */
+  if (self->active && !hdhomerun_tuner_item_get_status (item)->valid)
+    poll_device (self, poll);
+}
+
+void
+hdhomerun_status_poller_unwatch (HdhomerunStatusPoller *self,
+                                 HdhomerunTunerItem    *item)
+{
+  DevicePoll *poll;
+
+  g_return_if_fail (HDHOMERUN_IS_STATUS_POLLER (self));
+  g_return_if_fail (HDHOMERUN_IS_TUNER_ITEM (item));
+
+  poll = g_hash_table_lookup (self->polls, hdhomerun_tuner_item_get_device_id (item));
+  if (poll == NULL || !g_ptr_array_remove_fast (poll->items, item))
+    return;
+
+  if (poll->items->len == 0)
+    g_hash_table_remove (self->polls, poll->device_id);
+
+  update_timeout (self);
+}
+
+/**
+ * hdhomerun_status_poller_forget:
+ * @self: a #HdhomerunStatusPoller
+ * @device_id: a device that went away or lost tuners
+ * @n_tuners: how many of its tuners are left, 0 if it went away
+ *
+ * Drop the histories of the tuners of @device_id from @n_tuners up, and
+ * with @n_tuners 0 stop polling the device. A pass still running adds
+ * nothing for them once it is done.
+ */
+void
+hdhomerun_status_poller_forget (HdhomerunStatusPoller *self,
+                                const char            *device_id,
+                                guint                  n_tuners)
+{
+  g_autofree char *prefix = NULL;
+  gsize prefix_len;
+  GHashTableIter iter;
+  const char *key;
+
+  g_return_if_fail (HDHOMERUN_IS_STATUS_POLLER (self));
+  g_return_if_fail (device_id != NULL);
+
+  prefix = g_strconcat (device_id, ":", NULL);
+  prefix_len = strlen (prefix);
+  g_hash_table_iter_init (&iter, self->histories);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &key, NULL))
+    {
+      if (g_str_has_prefix (key, prefix) &&
+          g_ascii_strtoull (key + prefix_len, NULL, 10) >= n_tuners)
+        g_hash_table_iter_remove (&iter);
+    }
+
+  if (n_tuners == 0)
+    {
+      g_hash_table_remove (self->polls, device_id);
+      update_timeout (self);
+    }
+}
+
+/**
+ * hdhomerun_status_poller_get_history:
+ * @self: a #HdhomerunStatusPoller
+ * @device_id: the device
+ * @tuner_index: the tuner on that device
+ *
+ * Histories are created when a tuner is first watched and kept until
+ * hdhomerun_status_poller_forget() drops them.
+ *
+ * Returns: (transfer none) (nullable): the samples taken of the tuner
+ */
+HdhomerunSignalHistory *
+hdhomerun_status_poller_get_history (HdhomerunStatusPoller *self,
+                                     const char            *device_id,
+                                     guint                  tuner_index)
+{
+  g_autofree char *key = NULL;
+
+  g_return_val_if_fail (HDHOMERUN_IS_STATUS_POLLER (self), NULL);
+  g_return_val_if_fail (device_id != NULL, NULL);
+
+  key = history_key (device_id, tuner_index);
+
+  return g_hash_table_lookup (self->histories, key);
+}
+
+/**
+ * hdhomerun_status_poller_new:
+ * @devices: where to look up device addresses
+ *
+ * Returns: (transfer full): a new #HdhomerunStatusPoller
+ */
+HdhomerunStatusPoller *
+hdhomerun_status_poller_new (HdhomerunDeviceStore *devices)
+{
+  HdhomerunStatusPoller *self;
+
+  g_return_val_if_fail (HDHOMERUN_IS_DEVICE_STORE (devices), NULL);
+
+  self = g_object_new (HDHOMERUN_TYPE_STATUS_POLLER, NULL);
+  self->devices = g_object_ref (devices);
+
+  return self;
+}
+
+static void
+hdhomerun_status_poller_dispose (GObject *object)
+{
+  HdhomerunStatusPoller *self = (HdhomerunStatusPoller *)object;
+
+  g_clear_handle_id (&self->timeout_id, g_source_remove);
+  g_hash_table_remove_all (self->polls);
+  g_clear_object (&self->devices);
+
+  G_OBJECT_CLASS (hdhomerun_status_poller_parent_class)->dispose (object);
+}
+
+static void
+hdhomerun_status_poller_finalize (GObject *object)
+{
+  HdhomerunStatusPoller *self = (HdhomerunStatusPoller *)object;
+
+  /* Every pass holds a reference, so none is left running by now */
+  g_thread_pool_free (self->pool, FALSE, TRUE);
+  g_clear_pointer (&self->polls, g_hash_table_unref);
+  g_clear_pointer (&self->histories, g_hash_table_unref);
+
+  G_OBJECT_CLASS (hdhomerun_status_poller_parent_class)->finalize (object);
+}
+
+static void
+hdhomerun_status_poller_get_property (GObject    *object,
+                                      guint       prop_id,
+                                      GValue     *value,
+                                      GParamSpec *pspec)
+{
+  HdhomerunStatusPoller *self = HDHOMERUN_STATUS_POLLER (object);
+
+  switch (prop_id)
+    {
+    case PROP_INTERVAL:
+      g_value_set_uint (value, self->interval);
+      break;
+    case PROP_ACTIVE:
+      g_value_set_boolean (value, self->active);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+hdhomerun_status_poller_set_property (GObject      *object,
+                                      guint         prop_id,
+                                      const GValue *value,
+                                      GParamSpec   *pspec)
+{
+  HdhomerunStatusPoller *self = HDHOMERUN_STATUS_POLLER (object);
+
+  switch (prop_id)
+    {
+    case PROP_INTERVAL:
+      if (self->interval != g_value_get_uint (value))
+        {
+          self->interval = g_value_get_uint (value);
+          g_clear_handle_id (&self->timeout_id, g_source_remove);
+          update_timeout (self);
+          g_object_notify_by_pspec (object, pspec);
+        }
+      break;
+    case PROP_ACTIVE:
+      if (self->active != g_value_get_boolean (value))
+        {
+          self->active = g_value_get_boolean (value);
+          update_timeout (self);
+          g_object_notify_by_pspec (object, pspec);
+
+          /* Values went stale while inactive */
+          if (self->active)
+            on_timeout (self);
+        }
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+hdhomerun_status_poller_class_init (HdhomerunStatusPollerClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = hdhomerun_status_poller_dispose;
+  object_class->finalize = hdhomerun_status_poller_finalize;
+  object_class->get_property = hdhomerun_status_poller_get_property;
+  object_class->set_property = hdhomerun_status_poller_set_property;
+
+  properties [PROP_INTERVAL] =
+    g_param_spec_uint ("interval",
+                       "Interval",
+                       "Milliseconds between status passes",
+                       MIN_INTERVAL_MS,
+                       G_MAXUINT,
+                       DEFAULT_INTERVAL_MS,
+                       (G_PARAM_READWRITE |
+                        G_PARAM_EXPLICIT_NOTIFY |
+                        G_PARAM_STATIC_STRINGS));
+
+  properties [PROP_ACTIVE] =
+    g_param_spec_boolean ("active",
+                          "Active",
+                          "Whether anyone is looking, polling stops when not",
+                          TRUE,
+                          (G_PARAM_READWRITE |
+                           G_PARAM_EXPLICIT_NOTIFY |
+                           G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_properties (object_class, N_PROPS, properties);
+
+  signals [SAMPLED] =
+    g_signal_new ("sampled",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL, NULL,
+                  G_TYPE_NONE, 2,
+                  G_TYPE_STRING | G_SIGNAL_TYPE_STATIC_SCOPE,
+                  G_TYPE_UINT);
+}
+
+static void
+hdhomerun_status_poller_init (HdhomerunStatusPoller *self)
+{
+  self->polls = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                       NULL, (GDestroyNotify) device_poll_free);
+  self->histories = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                           g_free, (GDestroyNotify) hdhomerun_signal_history_unref);
+  self->pool = g_thread_pool_new (poll_thread, NULL, MAX_POLL_THREADS, FALSE, NULL);
+  self->interval = DEFAULT_INTERVAL_MS;
+  self->active = TRUE;
+}
@@ -0,0 +1,46 @@
+/* hdhomerun-status-poller.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "hdhomerun-device-store.h"
+#include "hdhomerun-signal-history.h"
+#include "hdhomerun-tuner-item.h"
+
+G_BEGIN_DECLS
+
+#define HDHOMERUN_TYPE_STATUS_POLLER (hdhomerun_status_poller_get_type())
+
+G_DECLARE_FINAL_TYPE (HdhomerunStatusPoller, hdhomerun_status_poller, HDHOMERUN, STATUS_POLLER, GObject)
+
+HdhomerunStatusPoller *hdhomerun_status_poller_new     (HdhomerunDeviceStore  *devices);
+void                   hdhomerun_status_poller_watch   (HdhomerunStatusPoller *self,
+                                                        HdhomerunTunerItem    *item);
+void                   hdhomerun_status_poller_unwatch (HdhomerunStatusPoller *self,
+                                                        HdhomerunTunerItem    *item);
+void                   hdhomerun_status_poller_forget  (HdhomerunStatusPoller *self,
+                                                        const char            *device_id,
+                                                        guint                  n_tuners);
+HdhomerunSignalHistory *hdhomerun_status_poller_get_history
+                                                       (HdhomerunStatusPoller *self,
+                                                        const char            *device_id,
+                                                        guint                  tuner_index);
+
+G_END_DECLS
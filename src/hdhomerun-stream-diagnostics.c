@@ -0,0 +1,422 @@
+/* hdhomerun-stream-diagnostics.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-stream-diagnostics.h"
+#include "hdhomerun-ts-ring.h"
+
+#include <glib/gi18n.h>
+#include <string.h>
+
+/* HdhomerunStreamDiagnostics shows the per-PID counters of a demuxer as
+ * a table: bitrate, continuity errors and transport errors.
+ *
+ * The counters are sampled on every frame while the widget is mapped.
+ * They are plain atomics written by the receive thread, so sampling all
+ * 8192 of them is a few tens of thousands of loads and never makes the
+ * stream path wait. Bitrates are worked out over RATE_WINDOW_US so they
+ * do not flicker; error counts show up on the frame after they happen.
+ *
+ * Each column is a single layout with one line per PID, rebuilt only
+ * when a figure changed.
+ */
+
+#define RATE_WINDOW_US   (500 * G_USEC_PER_SEC / 1000)
+#define COLUMN_SPACING   24
+
+enum {
+  COLUMN_PID,
+  COLUMN_KIND,
+  COLUMN_BITRATE,
+  COLUMN_CONTINUITY,
+  COLUMN_TRANSPORT,
+  N_COLUMNS
+};
+
+typedef struct
+{
+  HdhomerunTsPidStats stats;
+  guint32 window_packets;          /* At the start of the rate window */
+  guint64 bits_per_second;
+} PidSample;
+
+struct _HdhomerunStreamDiagnostics
+{
+  GtkWidget parent_instance;
+
+  HdhomerunTsDemux *demux;
+  PidSample *samples;              /* HDHOMERUN_TS_N_PIDS */
+  gint64 window_start;
+  guint tick_id;
+
+  PangoLayout *columns[N_COLUMNS];
+  PangoLayout *empty;
+  guint n_rows;
+};
+
+G_DEFINE_FINAL_TYPE (HdhomerunStreamDiagnostics, hdhomerun_stream_diagnostics, GTK_TYPE_WIDGET)
+
+static const char *
+describe_pid (guint pid)
+{
+  switch (pid)
+    {
+    case 0x0000:
+      return "PAT";
+    case 0x0011:
+      return "SDT";
+    case 0x1ffb:
+      return "PSIP";
+    case 0x1fff:
+      return _("Null");
+    default:
+      return "";
+    }
+}
+
+static void
+append_bitrate (GString *column,
+                guint64  bits_per_second)
+{
+  if (bits_per_second >= 1000000)
+    g_string_append_printf (column, "\n%.2f Mb/s", bits_per_second / 1e6);
+  else
+    g_string_append_printf (column, "\n%.0f kb/s", bits_per_second / 1e3);
+}
+
+static void
+rebuild_layouts (HdhomerunStreamDiagnostics *self)
+{
+  GString *text[N_COLUMNS];
+  guint64 total_bps = 0;
+  guint32 total_continuity = 0;
+  guint32 total_transport = 0;
+  guint n_rows = 0;
+
+  text[COLUMN_PID] = g_string_new ("<b>PID</b>\n<b>");
+  text[COLUMN_KIND] = g_string_new ("<b></b>\n");
+  text[COLUMN_BITRATE] = g_string_new (NULL);
+  text[COLUMN_CONTINUITY] = g_string_new (NULL);
+  text[COLUMN_TRANSPORT] = g_string_new (NULL);
+
+  g_string_append_printf (text[COLUMN_BITRATE], "<b>%s</b>", _("Bitrate"));
+  g_string_append_printf (text[COLUMN_CONTINUITY], "<b>%s</b>", _("CC Errors"));
+  g_string_append_printf (text[COLUMN_TRANSPORT], "<b>%s</b>", _("TEI Errors"));
+  g_string_append_printf (text[COLUMN_PID], "%s</b>", _("All"));
+
+  for (guint pid = 0; pid < HDHOMERUN_TS_N_PIDS; pid++)
+    {
+      const PidSample *sample = &self->samples[pid];
+
+      total_bps += sample->bits_per_second;
+      total_continuity += sample->stats.continuity_errors;
+      total_transport += sample->stats.transport_errors;
+    }
+
+  append_bitrate (text[COLUMN_BITRATE], total_bps);
+  g_string_append_printf (text[COLUMN_CONTINUITY], "\n%u", total_continuity);
+  g_string_append_printf (text[COLUMN_TRANSPORT], "\n%u", total_transport);
+
+  for (guint pid = 0; pid < HDHOMERUN_TS_N_PIDS; pid++)
+    {
+      const PidSample *sample = &self->samples[pid];
+
+      if (sample->stats.packets == 0)
+        continue;
+
+      g_string_append_printf (text[COLUMN_PID], "\n0x%04x (%u)", pid, pid);
+      g_string_append_printf (text[COLUMN_KIND], "\n%s", describe_pid (pid));
+      append_bitrate (text[COLUMN_BITRATE], sample->bits_per_second);
+      g_string_append_printf (text[COLUMN_CONTINUITY], "\n%u", sample->stats.continuity_errors);
+      g_string_append_printf (text[COLUMN_TRANSPORT], "\n%u", sample->stats.transport_errors);
+      n_rows++;
+    }
+
+  for (guint i = 0; i < N_COLUMNS; i++)
+    {
+      g_clear_object (&self->columns[i]);
+      self->columns[i] = gtk_widget_create_pango_layout (GTK_WIDGET (self), NULL);
+      pango_layout_set_markup (self->columns[i], text[i]->str, -1);
+      if (i >= COLUMN_BITRATE)
+        pango_layout_set_alignment (self->columns[i], PANGO_ALIGN_RIGHT);
+      g_string_free (text[i], TRUE);
+    }
+
+  if (n_rows != self->n_rows)
+    {
+      self->n_rows = n_rows;
+      gtk_widget_queue_resize (GTK_WIDGET (self));
+    }
+  gtk_widget_queue_draw (GTK_WIDGET (self));
+}
+
+static gboolean
+sample_counters (HdhomerunStreamDiagnostics *self,
+                 gint64                      now)
+{
+  gint64 elapsed = now - self->window_start;
+  gboolean close_window = elapsed >= RATE_WINDOW_US;
+  gboolean changed = FALSE;
+
+  for (guint pid = 0; pid < HDHOMERUN_TS_N_PIDS; pid++)
+    {
+      PidSample *sample = &self->samples[pid];
+      HdhomerunTsPidStats stats;
+
+      hdhomerun_ts_demux_get_pid_stats (self->demux, pid, &stats);
+
+      if (stats.continuity_errors != sample->stats.continuity_errors ||
+          stats.transport_errors != sample->stats.transport_errors ||
+          (stats.packets != 0) != (sample->stats.packets != 0))
+        changed = TRUE;
+      sample->stats = stats;
+
+      if (close_window)
+        {
+          /* Counters wrap, so only the difference is meaningful */
+          guint64 bits = (guint64) (stats.packets - sample->window_packets) *
+                         HDHOMERUN_TS_PACKET_SIZE * 8;
+          guint64 bits_per_second = bits * G_USEC_PER_SEC / elapsed;
+
+          if (bits_per_second != sample->bits_per_second)
+            changed = TRUE;
+          sample->bits_per_second = bits_per_second;
+          sample->window_packets = stats.packets;
+        }
+    }
+
+  if (close_window)
+    self->window_start = now;
+
+  return changed;
+}
+
+static gboolean
+on_tick (GtkWidget     *widget,
+         GdkFrameClock *frame_clock,
+         gpointer       user_data)
+{
+  HdhomerunStreamDiagnostics *self = HDHOMERUN_STREAM_DIAGNOSTICS (widget);
+
+  (void)user_data; /* unused */
+
+  if (self->demux != NULL &&
+      sample_counters (self, gdk_frame_clock_get_frame_time (frame_clock)))
+    rebuild_layouts (self);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static int
+get_column_width (PangoLayout *layout)
+{
+  int width;
+
+  pango_layout_get_pixel_size (layout, &width, NULL);
+  return width;
+}
+
+static void
+hdhomerun_stream_diagnostics_snapshot (GtkWidget   *widget,
+                                       GtkSnapshot *snapshot)
+{
+  HdhomerunStreamDiagnostics *self = HDHOMERUN_STREAM_DIAGNOSTICS (widget);
+  GdkRGBA color;
+  float x = 0;
+
+  gtk_widget_get_color (widget, &color);
+
+  if (self->n_rows == 0)
+    {
+      color.alpha *= 0.55f;
+      gtk_snapshot_append_layout (snapshot, self->empty, &color);
+      return;
+    }
+
+  for (guint i = 0; i < N_COLUMNS; i++)
+    {
+      gtk_snapshot_save (snapshot);
+      gtk_snapshot_translate (snapshot, &GRAPHENE_POINT_INIT (x, 0));
+      gtk_snapshot_append_layout (snapshot, self->columns[i], &color);
+      gtk_snapshot_restore (snapshot);
+
+      x += get_column_width (self->columns[i]) + COLUMN_SPACING;
+    }
+}
+
+static void
+hdhomerun_stream_diagnostics_measure (GtkWidget      *widget,
+                                      GtkOrientation  orientation,
+                                      int             for_size,
+                                      int            *minimum,
+                                      int            *natural,
+                                      int            *minimum_baseline,
+                                      int            *natural_baseline)
+{
+  HdhomerunStreamDiagnostics *self = HDHOMERUN_STREAM_DIAGNOSTICS (widget);
+  int width = 0;
+  int height;
+
+  (void)for_size; /* unused */
+
+  if (self->n_rows == 0)
+    {
+      pango_layout_get_pixel_size (self->empty, &width, &height);
+    }
+  else
+    {
+      for (guint i = 0; i < N_COLUMNS; i++)
+        width += get_column_width (self->columns[i]) + (i > 0 ? COLUMN_SPACING : 0);
+      pango_layout_get_pixel_size (self->columns[COLUMN_PID], NULL, &height);
+    }
+
+  *minimum = *natural = orientation == GTK_ORIENTATION_HORIZONTAL ? width : height;
+  *minimum_baseline = -1;
+  *natural_baseline = -1;
+}
+
+static void
+hdhomerun_stream_diagnostics_map (GtkWidget *widget)
+{
+  HdhomerunStreamDiagnostics *self = HDHOMERUN_STREAM_DIAGNOSTICS (widget);
+
+  GTK_WIDGET_CLASS (hdhomerun_stream_diagnostics_parent_class)->map (widget);
+
+  /* Nobody looks at the figures while unmapped */
+  self->tick_id = gtk_widget_add_tick_callback (widget, on_tick, NULL, NULL);
+}
+
+static void
+hdhomerun_stream_diagnostics_unmap (GtkWidget *widget)
+{
+  HdhomerunStreamDiagnostics *self = HDHOMERUN_STREAM_DIAGNOSTICS (widget);
+
+  if (self->tick_id != 0)
+    {
+      gtk_widget_remove_tick_callback (widget, self->tick_id);
+      self->tick_id = 0;
+    }
+
+  GTK_WIDGET_CLASS (hdhomerun_stream_diagnostics_parent_class)->unmap (widget);
+}
+
+GtkWidget *
+hdhomerun_stream_diagnostics_new (void)
+{
+  return g_object_new (HDHOMERUN_TYPE_STREAM_DIAGNOSTICS, NULL);
+}
+
+/* Open the first rate window at what the demuxer has already counted,
+ * on the clock the tick callback reads.
+ */
+static void
+start_window (HdhomerunStreamDiagnostics *self)
+{
+  GdkFrameClock *frame_clock = gtk_widget_get_frame_clock (GTK_WIDGET (self));
+
+  memset (self->samples, 0, HDHOMERUN_TS_N_PIDS * sizeof (PidSample));
+
+  if (self->demux != NULL)
+    {
+      for (guint pid = 0; pid < HDHOMERUN_TS_N_PIDS; pid++)
+        {
+          PidSample *sample = &self->samples[pid];
+
+          hdhomerun_ts_demux_get_pid_stats (self->demux, pid, &sample->stats);
+          sample->window_packets = sample->stats.packets;
+        }
+    }
+
+  self->window_start = frame_clock != NULL ? gdk_frame_clock_get_frame_time (frame_clock)
+                                           : g_get_monotonic_time ();
+}
+
+/**
+ * hdhomerun_stream_diagnostics_set_demux:
+ * @self: a #HdhomerunStreamDiagnostics
+ * @demux: (nullable): the demuxer whose counters to show
+ */
+void
+hdhomerun_stream_diagnostics_set_demux (HdhomerunStreamDiagnostics *self,
+                                        HdhomerunTsDemux           *demux)
+{
+  g_return_if_fail (HDHOMERUN_IS_STREAM_DIAGNOSTICS (self));
+
+  if (self->demux == demux)
+    return;
+
+  g_clear_pointer (&self->demux, hdhomerun_ts_demux_unref);
+  if (demux)
+    self->demux = hdhomerun_ts_demux_ref (demux);
+
+  start_window (self);
+  rebuild_layouts (self);
+}
+
+static void
+hdhomerun_stream_diagnostics_dispose (GObject *object)
+{
+  HdhomerunStreamDiagnostics *self = (HdhomerunStreamDiagnostics *)object;
+
+  g_clear_pointer (&self->demux, hdhomerun_ts_demux_unref);
+  for (guint i = 0; i < N_COLUMNS; i++)
+    g_clear_object (&self->columns[i]);
+  g_clear_object (&self->empty);
+
+  G_OBJECT_CLASS (hdhomerun_stream_diagnostics_parent_class)->dispose (object);
+}
+
+static void
+hdhomerun_stream_diagnostics_finalize (GObject *object)
+{
+  HdhomerunStreamDiagnostics *self = (HdhomerunStreamDiagnostics *)object;
+
+  g_free (self->samples);
+
+  G_OBJECT_CLASS (hdhomerun_stream_diagnostics_parent_class)->finalize (object);
+}
+
+static void
+hdhomerun_stream_diagnostics_class_init (HdhomerunStreamDiagnosticsClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+
+  object_class->dispose = hdhomerun_stream_diagnostics_dispose;
+  object_class->finalize = hdhomerun_stream_diagnostics_finalize;
+
+  widget_class->snapshot = hdhomerun_stream_diagnostics_snapshot;
+  widget_class->measure = hdhomerun_stream_diagnostics_measure;
+  widget_class->map = hdhomerun_stream_diagnostics_map;
+  widget_class->unmap = hdhomerun_stream_diagnostics_unmap;
+
+  gtk_widget_class_set_css_name (widget_class, "streamdiagnostics");
+}
+
+static void
+hdhomerun_stream_diagnostics_init (HdhomerunStreamDiagnostics *self)
+{
+  self->samples = g_new0 (PidSample, HDHOMERUN_TS_N_PIDS);
+  self->window_start = g_get_monotonic_time ();
+  self->empty = gtk_widget_create_pango_layout (GTK_WIDGET (self),
+                                                _("Start the preview to see stream statistics"));
+
+  /* Digits that line up from row to row */
+  gtk_widget_add_css_class (GTK_WIDGET (self), "numeric");
+
+  rebuild_layouts (self);
+}
@@ -0,0 +1,35 @@
+/* hdhomerun-stream-diagnostics.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <adwaita.h>
+
+#include "hdhomerun-ts-demux.h"
+
+G_BEGIN_DECLS
+
+#define HDHOMERUN_TYPE_STREAM_DIAGNOSTICS (hdhomerun_stream_diagnostics_get_type())
+
+G_DECLARE_FINAL_TYPE (HdhomerunStreamDiagnostics, hdhomerun_stream_diagnostics, HDHOMERUN, STREAM_DIAGNOSTICS, GtkWidget)
+
+GtkWidget *hdhomerun_stream_diagnostics_new       (void);
+void       hdhomerun_stream_diagnostics_set_demux (HdhomerunStreamDiagnostics *self,
+                                                   HdhomerunTsDemux           *demux);
+
+G_END_DECLS
@@ -0,0 +1,285 @@
+/* hdhomerun-stream-manager.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-stream-manager.h"
+
+#include <errno.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+/* HdhomerunStreamManager runs the receive side of every stream on one
+ * thread. Stream sockets are registered with an epoll instance and the
+ * thread calls back whichever are readable, so sixteen tuners cost one
+ * thread and one wakeup per batch of ready sockets, not sixteen threads
+ * polling on their own.
+ *
+ * The lock is not held while a callback runs, so callbacks may take
+ * locks of their own that are also held around add. Removal waits for a
+ * running callback of the socket to return, after which it is never
+ * called again.
+ */
+
+#define MAX_EVENTS 32
+
+typedef struct
+{
+  int fd;
+  HdhomerunSocketReadyFunc func;
+  gpointer user_data;
+  gboolean dispatching;
+} Registration;
+
+struct _HdhomerunStreamManager
+{
+  GObject parent_instance;
+
+  int epoll_fd;
+  GThread *thread;
+
+  GMutex lock;
+  GCond dispatched;
+  GHashTable *registrations;    /* fd -> Registration */
+};
+
+G_DEFINE_FINAL_TYPE (HdhomerunStreamManager, hdhomerun_stream_manager, G_TYPE_OBJECT)
+
+static gpointer
+receive_thread (gpointer user_data)
+{
+  HdhomerunStreamManager *self = user_data;
+  struct epoll_event events[MAX_EVENTS];
+
+  for (;;)
+    {
+      int n = epoll_wait (self->epoll_fd, events, MAX_EVENTS, -1);
+
+      if (n < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          g_warning ("Stream receive thread failed: %s", g_strerror (errno));
+          break;
+        }
+
+      for (int i = 0; i < n; i++)
+        {
+          int fd = events[i].data.fd;
+          Registration *reg;
+          gboolean keep;
+
+          /* Removed since epoll_wait() returned */
+          g_mutex_lock (&self->lock);
+          reg = g_hash_table_lookup (self->registrations, GINT_TO_POINTER (fd));
+          if (reg != NULL)
+            reg->dispatching = TRUE;
+          g_mutex_unlock (&self->lock);
+
+          if (reg == NULL)
+            continue;
+
+          keep = reg->func (fd, reg->user_data);
+
+          g_mutex_lock (&self->lock);
+          reg->dispatching = FALSE;
+          if (!keep && g_hash_table_lookup (self->registrations, GINT_TO_POINTER (fd)) == reg)
+            {
+              epoll_ctl (self->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+              g_hash_table_remove (self->registrations, GINT_TO_POINTER (fd));
+            }
+          g_cond_broadcast (&self->dispatched);
+          g_mutex_unlock (&self->lock);
+        }
+    }
+
+  return NULL;
+}
+
+/**
+ * hdhomerun_stream_manager_add:
+ * @self: a #HdhomerunStreamManager
+ * @fd: a non-blocking datagram socket
+ * @func: called on the receive thread when @fd is readable
+ * @user_data: data for @func
+ * @error: return location for a #GError
+ *
+ * Start receiving on @fd. The receive thread is started on first use.
+ *
+ * Returns: %TRUE if @fd was registered
+ */
+gboolean
+hdhomerun_stream_manager_add (HdhomerunStreamManager    *self,
+                              int                        fd,
+                              HdhomerunSocketReadyFunc   func,
+                              gpointer                   user_data,
+                              GError                   **error)
+{
+  struct epoll_event event = { .events = EPOLLIN, .data.fd = fd };
+  Registration *reg;
+
+  g_return_val_if_fail (HDHOMERUN_IS_STREAM_MANAGER (self), FALSE);
+  g_return_val_if_fail (fd >= 0, FALSE);
+  g_return_val_if_fail (func != NULL, FALSE);
+
+  if (self->epoll_fd < 0)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                   "Stream receiving is not available");
+      return FALSE;
+    }
+
+  reg = g_new0 (Registration, 1);
+  reg->fd = fd;
+  reg->func = func;
+  reg->user_data = user_data;
+
+  g_mutex_lock (&self->lock);
+
+  if (epoll_ctl (self->epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+    {
+      int errsv = errno;
+
+      g_mutex_unlock (&self->lock);
+      g_free (reg);
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errsv),
+                   "Failed to watch stream socket: %s", g_strerror (errsv));
+      return FALSE;
+    }
+
+  g_hash_table_insert (self->registrations, GINT_TO_POINTER (fd), reg);
+
+  if (self->thread == NULL)
+    self->thread = g_thread_new ("hdhomerun-streams", receive_thread, self);
+
+  g_mutex_unlock (&self->lock);
+
+  return TRUE;
+}
+
+/**
+ * hdhomerun_stream_manager_remove:
+ * @self: a #HdhomerunStreamManager
+ * @fd: a socket passed to hdhomerun_stream_manager_add()
+ *
+ * Stop receiving on @fd, waiting for its callback if it is running.
+ * Once this returns @fd may be closed. Must not be called from the
+ * callback itself; return %FALSE from it instead.
+ */
+void
+hdhomerun_stream_manager_remove (HdhomerunStreamManager *self,
+                                 int                     fd)
+{
+  Registration *reg;
+
+  g_return_if_fail (HDHOMERUN_IS_STREAM_MANAGER (self));
+  g_return_if_fail (g_thread_self () != self->thread);
+
+  g_mutex_lock (&self->lock);
+
+  reg = g_hash_table_lookup (self->registrations, GINT_TO_POINTER (fd));
+  if (reg != NULL)
+    {
+      epoll_ctl (self->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+      g_hash_table_steal (self->registrations, GINT_TO_POINTER (fd));
+
+      while (reg->dispatching)
+        g_cond_wait (&self->dispatched, &self->lock);
+
+      g_free (reg);
+    }
+
+  g_mutex_unlock (&self->lock);
+}
+
+/**
+ * hdhomerun_stream_manager_get_n_sockets:
+ * @self: a #HdhomerunStreamManager
+ *
+ * Returns: the number of sockets being received on
+ */
+guint
+hdhomerun_stream_manager_get_n_sockets (HdhomerunStreamManager *self)
+{
+  guint n;
+
+  g_return_val_if_fail (HDHOMERUN_IS_STREAM_MANAGER (self), 0);
+
+  g_mutex_lock (&self->lock);
+  n = g_hash_table_size (self->registrations);
+  g_mutex_unlock (&self->lock);
+
+  return n;
+}
+
+/**
+ * hdhomerun_stream_manager_get_default:
+ *
+ * Returns: (transfer none): the manager shared by the whole process
+ */
+HdhomerunStreamManager *
+hdhomerun_stream_manager_get_default (void)
+{
+  static HdhomerunStreamManager *default_manager;
+  static gsize initialized;
+
+  if (g_once_init_enter (&initialized))
+    {
+      default_manager = g_object_new (HDHOMERUN_TYPE_STREAM_MANAGER, NULL);
+      g_once_init_leave (&initialized, 1);
+    }
+
+  return default_manager;
+}
+
+static void
+hdhomerun_stream_manager_finalize (GObject *object)
+{
+  HdhomerunStreamManager *self = (HdhomerunStreamManager *)object;
+
+  /* The default manager lives as long as the process; nothing else is
+   * ever finalized with the thread running.
+   */
+  g_warn_if_fail (self->thread == NULL);
+
+  if (self->epoll_fd >= 0)
+    close (self->epoll_fd);
+  g_hash_table_unref (self->registrations);
+  g_cond_clear (&self->dispatched);
+  g_mutex_clear (&self->lock);
+
+  G_OBJECT_CLASS (hdhomerun_stream_manager_parent_class)->finalize (object);
+}
+
+static void
+hdhomerun_stream_manager_class_init (HdhomerunStreamManagerClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = hdhomerun_stream_manager_finalize;
+}
+
+static void
+hdhomerun_stream_manager_init (HdhomerunStreamManager *self)
+{
+  g_mutex_init (&self->lock);
+  g_cond_init (&self->dispatched);
+  self->registrations = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+
+  self->epoll_fd = epoll_create1 (EPOLL_CLOEXEC);
+  if (self->epoll_fd < 0)
+    g_warning ("Failed to create epoll instance: %s", g_strerror (errno));
+}
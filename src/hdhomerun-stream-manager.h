@@ -0,0 +1,47 @@
+/* hdhomerun-stream-manager.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define HDHOMERUN_TYPE_STREAM_MANAGER (hdhomerun_stream_manager_get_type())
+
+G_DECLARE_FINAL_TYPE (HdhomerunStreamManager, hdhomerun_stream_manager, HDHOMERUN, STREAM_MANAGER, GObject)
+
+/* Called on the receive thread whenever the socket is readable. It must
+ * not block, and must drain what it can since others share the thread.
+ * Returning FALSE unregisters the socket.
+ */
+typedef gboolean (*HdhomerunSocketReadyFunc) (int      fd,
+                                              gpointer user_data);
+
+HdhomerunStreamManager *hdhomerun_stream_manager_get_default (void);
+gboolean                hdhomerun_stream_manager_add         (HdhomerunStreamManager    *self,
+                                                              int                        fd,
+                                                              HdhomerunSocketReadyFunc   func,
+                                                              gpointer                   user_data,
+                                                              GError                   **error);
+void                    hdhomerun_stream_manager_remove      (HdhomerunStreamManager    *self,
+                                                              int                        fd);
+guint                   hdhomerun_stream_manager_get_n_sockets
+                                                             (HdhomerunStreamManager    *self);
+
+G_END_DECLS
@@ -0,0 +1,692 @@
+/* hdhomerun-stream.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-stream.h"
+#include "hdhomerun-backend.h"
+#include "hdhomerun-stream-manager.h"
+#include "hdhomerun-trace.h"
+#include "hdhomerun-ts-fanout.h"
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/* HdhomerunStream receives the MPEG-TS stream of a tuner. The tuner is
+ * told to send UDP to a socket of our own, and the receive thread of the
+ * HdhomerunStreamManager, shared by all streams, receives datagrams in
+ * batches through a HdhomerunTsFanout. The tuner only ever streams once,
+ * however many consumers there are.
+ *
+ * The stream's own ring is read in place or copied out of with
+ * hdhomerun_stream_read(), by the preview. It is sized for a couple of
+ * seconds of a full ATSC multiplex. When the reader falls behind, new
+ * datagrams are dropped and counted rather than blocking the receive
+ * thread. It can be switched off while only other consumers are wanted,
+ * so nothing fills it up and counts drops.
+ *
+ * Other consumers, such as a recorder, add rings of their own. Each
+ * gets a reference to the same batches and drops on its own when behind.
+ * The stream can also be published to a multicast group.
+ *
+ * A demuxer set on the stream sees every datagram in place on the
+ * receive thread.
+ *
+ * With a profiler attached when the stream starts, its received packets
+ * and dropped datagrams are exported as Sysprof counters, sampled at
+ * most every COUNTER_INTERVAL_MS.
+ */
+
+#define RING_DATAGRAMS      4096
+#define SOCKET_RCVBUF       (1024 * 1024)
+#define COUNTER_INTERVAL_MS 100
+
+struct _HdhomerunStream
+{
+  GObject parent_instance;
+
+  HdhomerunConnection *connection;  /* Held for the lifetime of the stream */
+
+  GMutex lock;
+  guint generation;                 /* Bumped by every start and stop */
+  int sock;                         /* Registered with the manager when set */
+
+  HdhomerunTsRing *ring;
+  gsize read_offset;                /* Into the datagram at the ring head */
+
+  /* Under lock, which the receive callback holds around each batch */
+  HdhomerunTsFanout *fanout;
+  gboolean reading;                 /* Whether ring is a consumer */
+  HdhomerunTsDemux *demux;
+  guint64 received;                 /* Datagrams */
+  guint64 packets;                  /* Whole TS packets in them */
+  guint packets_counter;            /* Sysprof counter IDs, 0 when not traced */
+  guint drops_counter;
+  gint64 counters_updated;
+};
+
+G_DEFINE_FINAL_TYPE (HdhomerunStream, hdhomerun_stream, G_TYPE_OBJECT)
+
+/* Called with the lock held */
+static void
+update_counters (HdhomerunStream *self)
+{
+  gint64 now;
+
+  if (self->packets_counter == 0)
+    return;
+
+  now = g_get_monotonic_time ();
+  if (now - self->counters_updated < COUNTER_INTERVAL_MS * G_TIME_SPAN_MILLISECOND)
+    return;
+  self->counters_updated = now;
+
+  hdhomerun_trace_set_counter (self->packets_counter, (gint64) self->packets);
+  hdhomerun_trace_set_counter (self->drops_counter,
+                               (gint64) hdhomerun_ts_ring_get_dropped (self->ring));
+}
+
+/* Called with the lock held */
+static void
+define_counters (HdhomerunStream *self)
+{
+  g_autofree char *name = NULL;
+
+  if (self->packets_counter != 0)
+    return;
+
+  name = g_strdup_printf ("%s-%u packets",
+                          hdhomerun_connection_get_device_id (self->connection),
+                          hdhomerun_connection_get_tuner_index (self->connection));
+  self->packets_counter = hdhomerun_trace_define_counter ("Streams", name,
+                                                          "TS packets received");
+  if (self->packets_counter == 0)
+    return;
+
+  g_free (name);
+  name = g_strdup_printf ("%s-%u drops",
+                          hdhomerun_connection_get_device_id (self->connection),
+                          hdhomerun_connection_get_tuner_index (self->connection));
+  self->drops_counter = hdhomerun_trace_define_counter ("Streams", name,
+                                                        "Datagrams dropped with the reader behind");
+}
+
+/* Runs on the stream manager's receive thread */
+static gboolean
+on_socket_ready (int      fd,
+                 gpointer user_data)
+{
+  HdhomerunStream *self = user_data;
+  HdhomerunTsBatch *batch = NULL;
+  gssize received;
+
+  /* Receiving does not block, so this is only held for one batch */
+  g_mutex_lock (&self->lock);
+  received = hdhomerun_ts_fanout_receive (self->fanout, fd, &batch);
+
+  for (gssize i = 0; i < received; i++)
+    {
+      const guint8 *packets;
+      gsize n_packets;
+
+      packets = hdhomerun_ts_batch_get_datagram (batch, (guint) i, &n_packets);
+      self->packets += n_packets;
+      if (self->demux != NULL)
+        hdhomerun_ts_demux_feed_packets (self->demux, packets, n_packets);
+    }
+
+  if (received > 0)
+    {
+      self->received += (guint64) received;
+      update_counters (self);
+    }
+  g_mutex_unlock (&self->lock);
+
+  if (received < 0)
+    {
+      g_warning ("Stream receive failed: %s", g_strerror (errno));
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static int
+open_socket (guint16  *port,
+             GError  **error)
+{
+  struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl (INADDR_ANY) };
+  socklen_t addr_len = sizeof addr;
+  int rcvbuf = SOCKET_RCVBUF;
+  int sock;
+
+  sock = socket (AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (sock < 0)
+    goto fail;
+
+  /* Best effort; the kernel may clamp it */
+  setsockopt (sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf);
+
+  if (bind (sock, (struct sockaddr *)&addr, sizeof addr) < 0 ||
+      getsockname (sock, (struct sockaddr *)&addr, &addr_len) < 0)
+    goto fail;
+
+  *port = ntohs (addr.sin_port);
+  return sock;
+
+fail:
+  g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+               "Failed to open stream socket: %s", g_strerror (errno));
+  if (sock >= 0)
+    close (sock);
+  return -1;
+}
+
+static gboolean
+set_target (HdhomerunConnection  *connection,
+            guint16               port,
+            GError              **error)
+{
+  struct hdhomerun_device_t *hd;
+  g_autofree char *target = NULL;
+  int ret;
+
+  hd = hdhomerun_connection_lock (connection);
+  if (hd == NULL)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_HOST_UNREACHABLE,
+                   "Device %s is not reachable",
+                   hdhomerun_connection_get_device_id (connection));
+      return FALSE;
+    }
+
+  if (port != 0)
+    {
+      guint32 local = hdhomerun_backend_get_default ()->device_get_local_machine_addr (hd);
+
+      target = g_strdup_printf ("udp://%u.%u.%u.%u:%u",
+                                (local >> 24) & 0xff, (local >> 16) & 0xff,
+                                (local >> 8) & 0xff, local & 0xff, port);
+    }
+
+  ret = hdhomerun_backend_get_default ()->device_set_tuner_target (hd, target ? target : "none");
+  hdhomerun_connection_unlock (connection);
+
+  if (ret <= 0)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                   "Device %s rejected the stream target",
+                   hdhomerun_connection_get_device_id (connection));
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+start_thread (GTask        *task,
+              gpointer      source_object,
+              gpointer      task_data,
+              GCancellable *cancellable)
+{
+  HdhomerunStream *self = source_object;
+  guint generation = GPOINTER_TO_UINT (task_data);
+  gint64 trace = hdhomerun_trace_begin ();
+  GError *error = NULL;
+  guint16 port;
+  int sock;
+
+  (void)cancellable; /* unused */
+
+  sock = open_socket (&port, &error);
+  if (sock < 0)
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  if (!set_target (self->connection, port, &error))
+    {
+      close (sock);
+      g_task_return_error (task, error);
+      return;
+    }
+
+  g_mutex_lock (&self->lock);
+
+  /* Stopped or restarted while the device was being set up */
+  if (generation != self->generation)
+    {
+      g_mutex_unlock (&self->lock);
+      set_target (self->connection, 0, NULL);
+      close (sock);
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_CANCELLED,
+                               "Stream was stopped");
+      return;
+    }
+
+  /* The manager never holds its lock while calling back, so this nests */
+  if (!hdhomerun_stream_manager_add (hdhomerun_stream_manager_get_default (), sock,
+                                     on_socket_ready, self, &error))
+    {
+      g_mutex_unlock (&self->lock);
+      set_target (self->connection, 0, NULL);
+      close (sock);
+      g_task_return_error (task, error);
+      return;
+    }
+  self->sock = sock;
+  define_counters (self);
+
+  g_mutex_unlock (&self->lock);
+
+  hdhomerun_trace_end (trace, "stream-start", "%s tuner %u on port %u",
+                       hdhomerun_connection_get_device_id (self->connection),
+                       hdhomerun_connection_get_tuner_index (self->connection),
+                       port);
+  g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * hdhomerun_stream_start_async:
+ * @self: a #HdhomerunStream
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: called once the tuner is streaming
+ * @user_data: data for @callback
+ *
+ * Open a receive socket and point the tuner at it. Calling
+ * hdhomerun_stream_stop() before this completes makes it fail with
+ * %G_IO_ERROR_CANCELLED.
+ */
+void
+hdhomerun_stream_start_async (HdhomerunStream     *self,
+                              GCancellable        *cancellable,
+                              GAsyncReadyCallback  callback,
+                              gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+  guint generation;
+
+  g_return_if_fail (HDHOMERUN_IS_STREAM (self));
+
+  hdhomerun_stream_stop (self);
+
+  g_mutex_lock (&self->lock);
+  generation = ++self->generation;
+  hdhomerun_ts_ring_reset (self->ring);
+  self->read_offset = 0;
+  g_mutex_unlock (&self->lock);
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, hdhomerun_stream_start_async);
+  g_task_set_task_data (task, GUINT_TO_POINTER (generation), NULL);
+  g_task_run_in_thread (task, start_thread);
+}
+
+gboolean
+hdhomerun_stream_start_finish (HdhomerunStream  *self,
+                               GAsyncResult     *result,
+                               GError          **error)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_STREAM (self), FALSE);
+  g_return_val_if_fail (g_task_is_valid (result, self), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+static void
+clear_target_thread (GTask        *task,
+                     gpointer      source_object,
+                     gpointer      task_data,
+                     GCancellable *cancellable)
+{
+  HdhomerunConnection *connection = task_data;
+
+  (void)source_object; /* unused */
+  (void)cancellable; /* unused */
+
+  set_target (connection, 0, NULL);
+  hdhomerun_connection_pool_release (hdhomerun_connection_pool_get_default (), connection);
+
+  g_task_return_boolean (task, TRUE);
+}
+
+/**
+ * hdhomerun_stream_stop:
+ * @self: a #HdhomerunStream
+ *
+ * Stop receiving and wake up any blocked reader, which then sees the end
+ * of the stream. The tuner is told to stop sending in the background.
+ */
+void
+hdhomerun_stream_stop (HdhomerunStream *self)
+{
+  g_autoptr(GTask) task = NULL;
+  int sock;
+
+  g_return_if_fail (HDHOMERUN_IS_STREAM (self));
+
+  g_mutex_lock (&self->lock);
+  self->generation++;
+  sock = self->sock;
+  self->sock = -1;
+  hdhomerun_ts_fanout_close (self->fanout);
+  g_mutex_unlock (&self->lock);
+
+  hdhomerun_ts_ring_close (self->ring);
+
+  if (sock < 0)
+    return;
+
+  /* Outside the lock, since a running callback may be waiting for it */
+  hdhomerun_stream_manager_remove (hdhomerun_stream_manager_get_default (), sock);
+  close (sock);
+
+  /* The clear holds its own reference on the connection */
+  hdhomerun_connection_pool_hold (hdhomerun_connection_pool_get_default (), self->connection);
+  task = g_task_new (NULL, NULL, NULL, NULL);
+  g_task_set_source_tag (task, hdhomerun_stream_stop);
+  g_task_set_task_data (task, self->connection, NULL);
+  g_task_run_in_thread (task, clear_target_thread);
+}
+
+/**
+ * hdhomerun_stream_read:
+ * @self: a #HdhomerunStream
+ * @buffer: (out caller-allocates): where to store the data
+ * @size: the size of @buffer
+ *
+ * Copy stream data out of the ring, blocking until some is available.
+ * Meant for decoders that insist on their own buffer; it must not be
+ * mixed with reading the ring directly.
+ *
+ * Returns: the number of bytes read, or 0 once the stream has stopped
+ */
+gssize
+hdhomerun_stream_read (HdhomerunStream *self,
+                       guint8          *buffer,
+                       gsize            size)
+{
+  gsize len = 0;
+
+  g_return_val_if_fail (HDHOMERUN_IS_STREAM (self), -1);
+
+  while (len < size)
+    {
+      const guint8 *packets;
+      gsize n_packets;
+      gsize chunk;
+
+      packets = hdhomerun_ts_ring_peek (self->ring, &n_packets);
+      if (packets == NULL)
+        {
+          /* Hand over what we have rather than wait for a full buffer */
+          if (len > 0 || !hdhomerun_ts_ring_wait (self->ring, -1))
+            break;
+          continue;
+        }
+
+      chunk = MIN (size - len, n_packets * HDHOMERUN_TS_PACKET_SIZE - self->read_offset);
+      memcpy (buffer + len, packets + self->read_offset, chunk);
+      len += chunk;
+      self->read_offset += chunk;
+
+      if (self->read_offset == n_packets * HDHOMERUN_TS_PACKET_SIZE)
+        {
+          hdhomerun_ts_ring_advance (self->ring);
+          self->read_offset = 0;
+        }
+    }
+
+  return len;
+}
+
+/**
+ * hdhomerun_stream_get_ring:
+ * @self: a #HdhomerunStream
+ *
+ * Get the stream's own ring, for a consumer that reads packets in place.
+ * There can only be one such consumer; others add a ring of their own.
+ *
+ * Returns: (transfer none): the ring
+ */
+HdhomerunTsRing *
+hdhomerun_stream_get_ring (HdhomerunStream *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_STREAM (self), NULL);
+
+  return self->ring;
+}
+
+/**
+ * hdhomerun_stream_set_reading:
+ * @self: a #HdhomerunStream
+ * @reading: whether the ring is read
+ *
+ * Turning reading off closes the ring, so a blocked reader wakes up and
+ * sees the end of the stream, and stops filling it while the stream
+ * keeps running for other consumers. Turning it back on empties and
+ * reopens the ring; the previous reader must be gone by then.
+ */
+void
+hdhomerun_stream_set_reading (HdhomerunStream *self,
+                              gboolean         reading)
+{
+  g_return_if_fail (HDHOMERUN_IS_STREAM (self));
+
+  g_mutex_lock (&self->lock);
+  if (self->reading != !!reading)
+    {
+      self->reading = !!reading;
+      if (reading)
+        {
+          hdhomerun_ts_ring_reset (self->ring);
+          self->read_offset = 0;
+          hdhomerun_ts_fanout_add_consumer (self->fanout, self->ring);
+        }
+      else
+        {
+          hdhomerun_ts_fanout_remove_consumer (self->fanout, self->ring);
+          hdhomerun_ts_ring_close (self->ring);
+        }
+    }
+  g_mutex_unlock (&self->lock);
+}
+
+/**
+ * hdhomerun_stream_add_consumer:
+ * @self: a #HdhomerunStream
+ * @ring: the ring of another consumer, such as a recorder
+ *
+ * Hand @ring a reference to everything received from now on. The stream
+ * keeps a reference and closes @ring when it stops. A consumer that lets
+ * its ring fill up only drops datagrams of its own.
+ */
+void
+hdhomerun_stream_add_consumer (HdhomerunStream *self,
+                               HdhomerunTsRing *ring)
+{
+  g_return_if_fail (HDHOMERUN_IS_STREAM (self));
+  g_return_if_fail (ring != NULL && ring != self->ring);
+
+  g_mutex_lock (&self->lock);
+  hdhomerun_ts_fanout_add_consumer (self->fanout, ring);
+  g_mutex_unlock (&self->lock);
+}
+
+/**
+ * hdhomerun_stream_remove_consumer:
+ * @self: a #HdhomerunStream
+ * @ring: a ring added with hdhomerun_stream_add_consumer()
+ *
+ * Once this returns the receive thread no longer touches @ring.
+ */
+void
+hdhomerun_stream_remove_consumer (HdhomerunStream *self,
+                                  HdhomerunTsRing *ring)
+{
+  g_return_if_fail (HDHOMERUN_IS_STREAM (self));
+  g_return_if_fail (ring != NULL && ring != self->ring);
+
+  g_mutex_lock (&self->lock);
+  hdhomerun_ts_fanout_remove_consumer (self->fanout, ring);
+  g_mutex_unlock (&self->lock);
+}
+
+/**
+ * hdhomerun_stream_set_publish_address:
+ * @self: a #HdhomerunStream
+ * @address: (nullable): an IPv4 multicast group and port, or %NULL
+ * @error: return location for a #GError
+ *
+ * Re-publish everything received to @address, for other hosts on the
+ * local network, or stop publishing.
+ *
+ * Returns: %FALSE if @address cannot be published to
+ */
+gboolean
+hdhomerun_stream_set_publish_address (HdhomerunStream     *self,
+                                      GInetSocketAddress  *address,
+                                      GError             **error)
+{
+  gboolean ret;
+
+  g_return_val_if_fail (HDHOMERUN_IS_STREAM (self), FALSE);
+
+  g_mutex_lock (&self->lock);
+  ret = hdhomerun_ts_fanout_set_publish_address (self->fanout, address, error);
+  g_mutex_unlock (&self->lock);
+
+  return ret;
+}
+
+/**
+ * hdhomerun_stream_set_demux:
+ * @self: a #HdhomerunStream
+ * @demux: (nullable): a demuxer to feed everything received
+ *
+ * Set a demuxer that the receive thread feeds, so its callback runs on
+ * that thread. The stream keeps a reference; once this returns with
+ * another demuxer or %NULL the old one is no longer fed.
+ */
+void
+hdhomerun_stream_set_demux (HdhomerunStream  *self,
+                            HdhomerunTsDemux *demux)
+{
+  HdhomerunTsDemux *old;
+
+  g_return_if_fail (HDHOMERUN_IS_STREAM (self));
+
+  g_mutex_lock (&self->lock);
+  old = g_steal_pointer (&self->demux);
+  if (demux)
+    self->demux = hdhomerun_ts_demux_ref (demux);
+  g_mutex_unlock (&self->lock);
+
+  g_clear_pointer (&old, hdhomerun_ts_demux_unref);
+}
+
+/**
+ * hdhomerun_stream_get_dropped:
+ * @self: a #HdhomerunStream
+ *
+ * Returns: the number of datagrams dropped because the reader fell behind
+ */
+guint64
+hdhomerun_stream_get_dropped (HdhomerunStream *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_STREAM (self), 0);
+
+  return hdhomerun_ts_ring_get_dropped (self->ring);
+}
+
+/**
+ * hdhomerun_stream_get_received:
+ * @self: a #HdhomerunStream
+ *
+ * Returns: the number of datagrams received since the stream was created
+ */
+guint64
+hdhomerun_stream_get_received (HdhomerunStream *self)
+{
+  guint64 received;
+
+  g_return_val_if_fail (HDHOMERUN_IS_STREAM (self), 0);
+
+  g_mutex_lock (&self->lock);
+  received = self->received;
+  g_mutex_unlock (&self->lock);
+
+  return received;
+}
+
+/**
+ * hdhomerun_stream_new:
+ * @connection: the connection of the tuner to stream from
+ *
+ * Returns: (transfer full): a new, stopped #HdhomerunStream
+ */
+HdhomerunStream *
+hdhomerun_stream_new (HdhomerunConnection *connection)
+{
+  HdhomerunStream *self;
+
+  g_return_val_if_fail (connection != NULL, NULL);
+
+  self = g_object_new (HDHOMERUN_TYPE_STREAM, NULL);
+  self->connection = connection;
+  hdhomerun_connection_pool_hold (hdhomerun_connection_pool_get_default (), connection);
+
+  return self;
+}
+
+static void
+hdhomerun_stream_finalize (GObject *object)
+{
+  HdhomerunStream *self = (HdhomerunStream *)object;
+
+  hdhomerun_stream_stop (self);
+  hdhomerun_connection_pool_release (hdhomerun_connection_pool_get_default (), self->connection);
+
+  g_clear_pointer (&self->fanout, hdhomerun_ts_fanout_free);
+  g_clear_pointer (&self->ring, hdhomerun_ts_ring_unref);
+  g_clear_pointer (&self->demux, hdhomerun_ts_demux_unref);
+  g_mutex_clear (&self->lock);
+
+  G_OBJECT_CLASS (hdhomerun_stream_parent_class)->finalize (object);
+}
+
+static void
+hdhomerun_stream_class_init (HdhomerunStreamClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = hdhomerun_stream_finalize;
+}
+
+static void
+hdhomerun_stream_init (HdhomerunStream *self)
+{
+  self->sock = -1;
+  self->ring = hdhomerun_ts_ring_new (RING_DATAGRAMS);
+  self->fanout = hdhomerun_ts_fanout_new ();
+  self->reading = TRUE;
+  hdhomerun_ts_fanout_add_consumer (self->fanout, self->ring);
+  g_mutex_init (&self->lock);
+}
@@ -0,0 +1,62 @@
+/* hdhomerun-stream.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "hdhomerun-connection-pool.h"
+#include "hdhomerun-ts-demux.h"
+#include "hdhomerun-ts-ring.h"
+
+G_BEGIN_DECLS
+
+#define HDHOMERUN_TYPE_STREAM (hdhomerun_stream_get_type())
+
+G_DECLARE_FINAL_TYPE (HdhomerunStream, hdhomerun_stream, HDHOMERUN, STREAM, GObject)
+
+HdhomerunStream *hdhomerun_stream_new          (HdhomerunConnection  *connection);
+void             hdhomerun_stream_start_async  (HdhomerunStream      *self,
+                                                GCancellable         *cancellable,
+                                                GAsyncReadyCallback   callback,
+                                                gpointer              user_data);
+gboolean         hdhomerun_stream_start_finish (HdhomerunStream      *self,
+                                                GAsyncResult         *result,
+                                                GError              **error);
+void             hdhomerun_stream_stop         (HdhomerunStream      *self);
+gssize           hdhomerun_stream_read         (HdhomerunStream      *self,
+                                                guint8               *buffer,
+                                                gsize                 size);
+HdhomerunTsRing *hdhomerun_stream_get_ring     (HdhomerunStream      *self);
+void             hdhomerun_stream_set_reading  (HdhomerunStream      *self,
+                                                gboolean              reading);
+void             hdhomerun_stream_add_consumer (HdhomerunStream      *self,
+                                                HdhomerunTsRing      *ring);
+void             hdhomerun_stream_remove_consumer
+                                               (HdhomerunStream      *self,
+                                                HdhomerunTsRing      *ring);
+gboolean         hdhomerun_stream_set_publish_address
+                                               (HdhomerunStream      *self,
+                                                GInetSocketAddress   *address,
+                                                GError              **error);
+void             hdhomerun_stream_set_demux    (HdhomerunStream      *self,
+                                                HdhomerunTsDemux     *demux);
+guint64          hdhomerun_stream_get_dropped  (HdhomerunStream      *self);
+guint64          hdhomerun_stream_get_received (HdhomerunStream      *self);
+
+G_END_DECLS
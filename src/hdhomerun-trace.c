@@ -0,0 +1,114 @@
+/* hdhomerun-trace.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-config-gtk-config.h"
+
+#include "hdhomerun-trace.h"
+
+#if HAVE_SYSPROF
+#include <sysprof-capture.h>
+#endif
+
+/* Marks and counters for Sysprof, built with -Dtracing=enabled. The
+ * collector finds the profiler through the environment Sysprof starts
+ * us with, or attaches when Sysprof is pointed at a running process, so
+ * nothing needs turning on at runtime. Without the option every call
+ * here is empty.
+ */
+
+#define TRACE_GROUP "hdhomerun"
+
+gint64
+hdhomerun_trace_begin (void)
+{
+#if HAVE_SYSPROF
+  if (sysprof_collector_is_active ())
+    return SYSPROF_CAPTURE_CURRENT_TIME;
+#endif
+
+  return 0;
+}
+
+void
+hdhomerun_trace_end (gint64      begin,
+                     const char *name,
+                     const char *format,
+                     ...)
+{
+#if HAVE_SYSPROF
+  va_list args;
+
+  if (begin == 0)
+    return;
+
+  va_start (args, format);
+  sysprof_collector_mark_vprintf (begin, SYSPROF_CAPTURE_CURRENT_TIME - begin,
+                                  TRACE_GROUP, name, format, args);
+  va_end (args);
+#else
+  (void)begin; /* unused */
+  (void)name; /* unused */
+  (void)format; /* unused */
+#endif
+}
+
+guint
+hdhomerun_trace_define_counter (const char *category,
+                                const char *name,
+                                const char *description)
+{
+#if HAVE_SYSPROF
+  SysprofCaptureCounter counter = { 0 };
+
+  if (!sysprof_collector_is_active ())
+    return 0;
+
+  counter.id = sysprof_collector_request_counters (1);
+  counter.type = SYSPROF_CAPTURE_COUNTER_INT64;
+  g_strlcpy (counter.category, category, sizeof (counter.category));
+  g_strlcpy (counter.name, name, sizeof (counter.name));
+  g_strlcpy (counter.description, description, sizeof (counter.description));
+  sysprof_collector_define_counters (&counter, 1);
+
+  return counter.id;
+#else
+  (void)category; /* unused */
+  (void)name; /* unused */
+  (void)description; /* unused */
+
+  return 0;
+#endif
+}
+
+void
+hdhomerun_trace_set_counter (guint  id,
+                             gint64 value)
+{
+#if HAVE_SYSPROF
+  SysprofCaptureCounterValue counter_value;
+
+  if (id == 0)
+    return;
+
+  counter_value.v64 = value;
+  sysprof_collector_set_counters (&id, &counter_value, 1);
+#else
+  (void)id; /* unused */
+  (void)value; /* unused */
+#endif
+}
@@ -0,0 +1,45 @@
+/* hdhomerun-trace.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/* Marks span hdhomerun_trace_begin() to hdhomerun_trace_end() and show
+ * up in Sysprof under the "hdhomerun" group. Begin returns 0 unless a
+ * profiler is attached, and end does nothing for 0, so tracing costs a
+ * check per mark when nobody is looking.
+ */
+gint64   hdhomerun_trace_begin          (void);
+void     hdhomerun_trace_end            (gint64      begin,
+                                         const char *name,
+                                         const char *format,
+                                         ...) G_GNUC_PRINTF (3, 4);
+
+/* Counter IDs are 0 when no profiler is attached, and setting counter 0
+ * does nothing.
+ */
+guint    hdhomerun_trace_define_counter (const char *category,
+                                         const char *name,
+                                         const char *description);
+void     hdhomerun_trace_set_counter    (guint       id,
+                                         gint64      value);
+
+G_END_DECLS
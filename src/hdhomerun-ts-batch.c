@@ -0,0 +1,173 @@
+/* hdhomerun-ts-batch.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE  /* recvmmsg() */
+
+#include "hdhomerun-ts-batch.h"
+
+#include <errno.h>
+#include <sys/socket.h>
+
+/* Batches are carved out of larger blocks. Each receive lands in the
+ * block of the batch before it for as long as there is room, so a
+ * wakeup that finds a single datagram queued costs one small allocation
+ * for the batch rather than a whole block. A block is freed once the
+ * last batch in it is.
+ *
+ * Only the producer ever writes to a block, and only past the last
+ * batch it handed out, so consumers read their batches without a lock.
+ */
+
+#define BLOCK_DATAGRAMS 64
+
+typedef struct
+{
+  guint8 data[BLOCK_DATAGRAMS * HDHOMERUN_TS_DATAGRAM_SIZE];
+  guint16 lengths[BLOCK_DATAGRAMS];  /* A whole number of packets */
+} Block;
+
+struct _HdhomerunTsBatch
+{
+  Block *block;
+  guint first;
+  guint n_datagrams;
+};
+
+static void
+ts_batch_free (HdhomerunTsBatch *batch)
+{
+  g_atomic_rc_box_release (batch->block);
+}
+
+/**
+ * hdhomerun_ts_batch_receive:
+ * @fd: a datagram socket
+ * @previous: (nullable): the batch received from @fd last
+ * @batch: (out) (transfer full): the batch received
+ *
+ * Receive whatever datagrams are queued on @fd, several per system call,
+ * into the space left after @previous or into a new block. @batch is
+ * only set when something was received.
+ *
+ * Returns: the number of datagrams received, or -1 with errno set
+ */
+gssize
+hdhomerun_ts_batch_receive (int                fd,
+                            HdhomerunTsBatch  *previous,
+                            HdhomerunTsBatch **batch)
+{
+  struct mmsghdr msgs[HDHOMERUN_TS_BATCH_MAX_DATAGRAMS];
+  struct iovec iov[HDHOMERUN_TS_BATCH_MAX_DATAGRAMS];
+  Block *block = NULL;
+  guint first = 0;
+  guint n_slots;
+  int received;
+
+  g_return_val_if_fail (batch != NULL, -1);
+
+  if (previous != NULL && previous->first + previous->n_datagrams < BLOCK_DATAGRAMS)
+    {
+      block = g_atomic_rc_box_acquire (previous->block);
+      first = previous->first + previous->n_datagrams;
+    }
+  else
+    {
+      block = g_atomic_rc_box_new (Block);
+    }
+
+  n_slots = MIN (BLOCK_DATAGRAMS - first, HDHOMERUN_TS_BATCH_MAX_DATAGRAMS);
+  for (guint i = 0; i < n_slots; i++)
+    {
+      iov[i].iov_base = block->data + (gsize) (first + i) * HDHOMERUN_TS_DATAGRAM_SIZE;
+      iov[i].iov_len = HDHOMERUN_TS_DATAGRAM_SIZE;
+      msgs[i].msg_hdr = (struct msghdr) { .msg_iov = &iov[i], .msg_iovlen = 1 };
+    }
+
+  received = recvmmsg (fd, msgs, n_slots, MSG_DONTWAIT, NULL);
+  if (received <= 0)
+    {
+      int saved_errno = errno;
+
+      g_atomic_rc_box_release (block);
+      errno = saved_errno;
+
+      if (received == 0 || errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+        return 0;
+      return -1;
+    }
+
+  /* A trailing partial packet cannot be decoded, so it is left out */
+  for (int i = 0; i < received; i++)
+    block->lengths[first + i] = msgs[i].msg_len - msgs[i].msg_len % HDHOMERUN_TS_PACKET_SIZE;
+
+  *batch = g_atomic_rc_box_new (HdhomerunTsBatch);
+  (*batch)->block = block;
+  (*batch)->first = first;
+  (*batch)->n_datagrams = (guint) received;
+
+  return received;
+}
+
+HdhomerunTsBatch *
+hdhomerun_ts_batch_ref (HdhomerunTsBatch *batch)
+{
+  g_return_val_if_fail (batch != NULL, NULL);
+
+  return g_atomic_rc_box_acquire (batch);
+}
+
+void
+hdhomerun_ts_batch_unref (HdhomerunTsBatch *batch)
+{
+  g_return_if_fail (batch != NULL);
+
+  g_atomic_rc_box_release_full (batch, (GDestroyNotify) ts_batch_free);
+}
+
+guint
+hdhomerun_ts_batch_get_n_datagrams (HdhomerunTsBatch *batch)
+{
+  g_return_val_if_fail (batch != NULL, 0);
+
+  return batch->n_datagrams;
+}
+
+/**
+ * hdhomerun_ts_batch_get_datagram:
+ * @batch: a #HdhomerunTsBatch
+ * @index: which datagram, oldest first
+ * @n_packets: (out): the number of packets in the datagram, which is 0
+ *   for a runt that carried no whole packet
+ *
+ * Returns: the packets of the datagram, valid as long as @batch is
+ */
+const guint8 *
+hdhomerun_ts_batch_get_datagram (HdhomerunTsBatch *batch,
+                                 guint             index,
+                                 gsize            *n_packets)
+{
+  guint slot;
+
+  g_return_val_if_fail (batch != NULL, NULL);
+  g_return_val_if_fail (index < batch->n_datagrams, NULL);
+
+  slot = batch->first + index;
+  *n_packets = batch->block->lengths[slot] / HDHOMERUN_TS_PACKET_SIZE;
+
+  return batch->block->data + (gsize) slot * HDHOMERUN_TS_DATAGRAM_SIZE;
+}
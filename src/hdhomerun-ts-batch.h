@@ -0,0 +1,48 @@
+/* hdhomerun-ts-batch.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define HDHOMERUN_TS_PACKET_SIZE          188
+#define HDHOMERUN_TS_PACKETS_PER_DATAGRAM 7
+#define HDHOMERUN_TS_DATAGRAM_SIZE        (HDHOMERUN_TS_PACKET_SIZE * HDHOMERUN_TS_PACKETS_PER_DATAGRAM)
+#define HDHOMERUN_TS_BATCH_MAX_DATAGRAMS  32
+
+typedef struct _HdhomerunTsBatch HdhomerunTsBatch;
+
+/* An immutable, reference-counted run of TS datagrams received in one
+ * go. Every consumer of a stream holds a reference to the same batch
+ * instead of a copy, and the memory goes away with the last of them.
+ */
+gssize           hdhomerun_ts_batch_receive        (int                fd,
+                                                    HdhomerunTsBatch  *previous,
+                                                    HdhomerunTsBatch **batch);
+HdhomerunTsBatch *hdhomerun_ts_batch_ref           (HdhomerunTsBatch  *batch);
+void             hdhomerun_ts_batch_unref          (HdhomerunTsBatch  *batch);
+guint            hdhomerun_ts_batch_get_n_datagrams (HdhomerunTsBatch *batch);
+const guint8    *hdhomerun_ts_batch_get_datagram   (HdhomerunTsBatch  *batch,
+                                                    guint              index,
+                                                    gsize             *n_packets);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (HdhomerunTsBatch, hdhomerun_ts_batch_unref)
+
+G_END_DECLS
@@ -0,0 +1,887 @@
+/* hdhomerun-ts-demux.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-ts-demux.h"
+#include "hdhomerun-ts-ring.h"
+
+#include <string.h>
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+# include <arm_neon.h>
+#endif
+
+/* HdhomerunTsDemux reads the program tables out of a transport stream
+ * and counts packets per PID, cheaply enough to sit on the receive thread
+ * and see every packet.
+ *
+ * Packets are looked at where they lie. Only the PIDs that carry tables
+ * we want (PAT, the PMTs it points at, the ATSC VCT and the DVB SDT) are
+ * looked into; a section that fits in its packet is parsed in place and
+ * only one that spans packets is gathered into a per-PID buffer. A table
+ * whose version has not changed is skipped after its CRC, so a steady
+ * stream costs a header check per packet.
+ *
+ * Input that is not packet aligned, or that lost sync, is resynced by
+ * looking for a sync byte with another one a packet further on, sixteen
+ * positions at a time where SSE2 or NEON is available.
+ *
+ * Counters are written by the feeding thread only and read with atomics,
+ * so telemetry can sample them from anywhere.
+ */
+
+#define TS_SIZE          HDHOMERUN_TS_PACKET_SIZE
+#define SYNC_BYTE        0x47
+#define MAX_SECTION      4096
+#define NO_CC            0xff
+
+#define PID_PAT          0x0000
+#define PID_SDT          0x0011
+#define PID_PSIP         0x1ffb
+#define PID_NULL         0x1fff
+
+#define TABLE_PAT        0x00
+#define TABLE_PMT        0x02
+#define TABLE_SDT        0x42
+#define TABLE_TVCT       0xc8
+#define TABLE_CVCT       0xc9
+
+#define DESCRIPTOR_SERVICE 0x48
+
+typedef struct
+{
+  guint16 program_number;
+  guint16 pmt_pid;
+} PatEntry;
+
+typedef struct
+{
+  guint16 pcr_pid;
+  guint n_streams;
+  HdhomerunTsElementaryStream streams[HDHOMERUN_TS_MAX_STREAMS];
+} PmtInfo;
+
+typedef struct
+{
+  guint16 major;
+  guint16 minor;
+  char name[64];
+} VctInfo;
+
+typedef struct
+{
+  guint16 pid;
+  gsize len;
+  gsize need;                    /* 0 while no section is being gathered */
+  guint8 data[MAX_SECTION];
+} Section;
+
+struct _HdhomerunTsDemux
+{
+  HdhomerunTsProgramsFunc func;
+  gpointer user_data;
+  GDestroyNotify destroy;
+
+  /* Feeding thread only */
+  guint8 partial[TS_SIZE];
+  gsize partial_len;
+  guint8 last_cc[HDHOMERUN_TS_N_PIDS];
+  guint8 psi_pids[HDHOMERUN_TS_N_PIDS / 8];
+  GHashTable *sections;          /* pid -> Section */
+  GHashTable *versions;          /* table key -> version + 1 */
+  GArray *pat;                   /* PatEntry */
+  GHashTable *pmts;              /* program number -> PmtInfo */
+  GHashTable *vct;               /* program number -> VctInfo */
+  GHashTable *sdt;               /* program number -> name */
+  gboolean changed;
+
+  /* Atomic */
+  gint sync_losses;
+  gint packets[HDHOMERUN_TS_N_PIDS];
+  gint continuity_errors[HDHOMERUN_TS_N_PIDS];
+  gint transport_errors[HDHOMERUN_TS_N_PIDS];
+  gint scrambled[HDHOMERUN_TS_N_PIDS];
+};
+
+static guint32 crc_table[256];
+
+static void
+init_crc_table (void)
+{
+  static gsize initialized;
+
+  if (g_once_init_enter (&initialized))
+    {
+      for (guint i = 0; i < 256; i++)
+        {
+          guint32 crc = (guint32) i << 24;
+
+          for (guint bit = 0; bit < 8; bit++)
+            crc = (crc & 0x80000000) ? (crc << 1) ^ 0x04c11db7 : crc << 1;
+          crc_table[i] = crc;
+        }
+      g_once_init_leave (&initialized, 1);
+    }
+}
+
+/* MPEG-2 CRC; a section including its CRC sums to zero */
+static guint32
+crc32_mpeg (const guint8 *data,
+            gsize         len)
+{
+  guint32 crc = 0xffffffff;
+
+  for (gsize i = 0; i < len; i++)
+    crc = (crc << 8) ^ crc_table[(crc >> 24) ^ data[i]];
+
+  return crc;
+}
+
+static inline void
+counter_inc (gint *counter)
+{
+  /* Only the feeding thread writes, so no read-modify-write is needed */
+  g_atomic_int_set (counter, g_atomic_int_get (counter) + 1);
+}
+
+static inline guint16
+read_pid (const guint8 *p)
+{
+  return ((p[0] & 0x1f) << 8) | p[1];
+}
+
+static inline gboolean
+is_psi_pid (HdhomerunTsDemux *demux,
+            guint16           pid)
+{
+  return demux->psi_pids[pid >> 3] & (1 << (pid & 7));
+}
+
+static void
+watch_pid (HdhomerunTsDemux *demux,
+           guint16           pid)
+{
+  Section *section;
+
+  if (is_psi_pid (demux, pid))
+    return;
+
+  demux->psi_pids[pid >> 3] |= 1 << (pid & 7);
+
+  section = g_new (Section, 1);
+  section->pid = pid;
+  section->len = 0;
+  section->need = 0;
+  g_hash_table_insert (demux->sections, GUINT_TO_POINTER (pid), section);
+}
+
+/**
+ * hdhomerun_ts_find_sync:
+ * @data: bytes of a transport stream
+ * @len: the length of @data
+ *
+ * Find where packets start: the first sync byte that is followed by
+ * another one a packet further on, or that is too close to the end of
+ * @data to be checked.
+ *
+ * Returns: the offset of the first packet, or @len if there is none
+ */
+gsize
+hdhomerun_ts_find_sync (const guint8 *data,
+                        gsize         len)
+{
+  gsize i = 0;
+
+#if defined(__SSE2__)
+  const __m128i sync = _mm_set1_epi8 (SYNC_BYTE);
+
+  for (; i + 16 + TS_SIZE <= len; i += 16)
+    {
+      __m128i here = _mm_loadu_si128 ((const __m128i *) (data + i));
+      __m128i next = _mm_loadu_si128 ((const __m128i *) (data + i + TS_SIZE));
+      int mask = _mm_movemask_epi8 (_mm_and_si128 (_mm_cmpeq_epi8 (here, sync),
+                                                   _mm_cmpeq_epi8 (next, sync)));
+
+      if (mask != 0)
+        return i + (gsize) __builtin_ctz ((unsigned int) mask);
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  const uint8x16_t sync = vdupq_n_u8 (SYNC_BYTE);
+
+  for (; i + 16 + TS_SIZE <= len; i += 16)
+    {
+      uint8x16_t match = vandq_u8 (vceqq_u8 (vld1q_u8 (data + i), sync),
+                                   vceqq_u8 (vld1q_u8 (data + i + TS_SIZE), sync));
+
+      /* The scalar loop below finds which lane it was */
+      if (vmaxvq_u8 (match) != 0)
+        break;
+    }
+#endif
+
+  for (; i < len; i++)
+    if (data[i] == SYNC_BYTE && (i + TS_SIZE >= len || data[i + TS_SIZE] == SYNC_BYTE))
+      return i;
+
+  return len;
+}
+
+static gboolean
+is_current (HdhomerunTsDemux *demux,
+            guint8            table_id,
+            guint16           extension,
+            guint8            section_number,
+            guint8            version)
+{
+  guint32 key = ((guint32) table_id << 24) | ((guint32) extension << 8) | section_number;
+  gpointer old = g_hash_table_lookup (demux->versions, GUINT_TO_POINTER (key));
+
+  if (GPOINTER_TO_UINT (old) == (guint) version + 1)
+    return TRUE;
+
+  g_hash_table_insert (demux->versions, GUINT_TO_POINTER (key), GUINT_TO_POINTER (version + 1));
+  return FALSE;
+}
+
+static void
+parse_pat (HdhomerunTsDemux *demux,
+           const guint8     *body,
+           gsize             len)
+{
+  g_array_set_size (demux->pat, 0);
+
+  for (gsize i = 0; i + 4 <= len; i += 4)
+    {
+      PatEntry entry;
+
+      entry.program_number = (body[i] << 8) | body[i + 1];
+      entry.pmt_pid = read_pid (body + i + 2);
+
+      /* Program 0 points at the NIT */
+      if (entry.program_number == 0)
+        continue;
+
+      g_array_append_val (demux->pat, entry);
+      watch_pid (demux, entry.pmt_pid);
+    }
+}
+
+static void
+parse_pmt (HdhomerunTsDemux *demux,
+           guint16           program_number,
+           const guint8     *body,
+           gsize             len)
+{
+  PmtInfo *info;
+  gsize i;
+
+  if (len < 4)
+    return;
+
+  info = g_new0 (PmtInfo, 1);
+  info->pcr_pid = read_pid (body);
+
+  for (i = 4 + (((body[2] & 0x0f) << 8) | body[3]); i + 5 <= len;
+       i += 5 + (((body[i + 3] & 0x0f) << 8) | body[i + 4]))
+    {
+      if (info->n_streams == HDHOMERUN_TS_MAX_STREAMS)
+        break;
+
+      info->streams[info->n_streams].stream_type = body[i];
+      info->streams[info->n_streams].pid = read_pid (body + i + 1);
+      info->n_streams++;
+    }
+
+  g_hash_table_insert (demux->pmts, GUINT_TO_POINTER (program_number), info);
+}
+
+/* Seven UTF-16BE code units, padded with nuls */
+static void
+read_short_name (const guint8 *data,
+                 char         *name,
+                 gsize         size)
+{
+  gunichar2 units[7];
+  g_autofree char *utf8 = NULL;
+
+  for (guint i = 0; i < G_N_ELEMENTS (units); i++)
+    units[i] = (data[2 * i] << 8) | data[2 * i + 1];
+
+  utf8 = g_utf16_to_utf8 (units, G_N_ELEMENTS (units), NULL, NULL, NULL);
+  g_strlcpy (name, utf8 ? g_strchomp (utf8) : "", size);
+}
+
+static void
+parse_vct (HdhomerunTsDemux *demux,
+           const guint8     *body,
+           gsize             len)
+{
+  guint n_channels;
+  gsize i = 2;
+
+  if (len < 2)
+    return;
+
+  n_channels = body[1];
+
+  for (guint c = 0; c < n_channels && i + 32 <= len; c++)
+    {
+      const guint8 *channel = body + i;
+      guint16 program_number = (channel[24] << 8) | channel[25];
+      VctInfo *info;
+
+      i += 32 + (((channel[30] & 0x03) << 8) | channel[31]);
+
+      /* Analog and inactive channels */
+      if (program_number == 0 || program_number == 0xffff)
+        continue;
+
+      info = g_new0 (VctInfo, 1);
+      info->major = ((channel[14] & 0x0f) << 6) | (channel[15] >> 2);
+      info->minor = ((channel[15] & 0x03) << 8) | channel[16];
+      read_short_name (channel, info->name, sizeof info->name);
+      g_hash_table_insert (demux->vct, GUINT_TO_POINTER (program_number), info);
+    }
+}
+
+/* DVB strings lead with a character table selector. Names we care about
+ * are Latin or UTF-8, so anything else is read as Latin-1.
+ */
+static char *
+read_dvb_string (const guint8 *data,
+                 gsize         len)
+{
+  g_autofree char *converted = NULL;
+
+  if (len > 0 && data[0] == 0x15)
+    return g_utf8_make_valid ((const char *) data + 1, len - 1);
+
+  if (len >= 3 && data[0] == 0x10)
+    {
+      data += 3;
+      len -= 3;
+    }
+  else if (len > 0 && data[0] < 0x20)
+    {
+      data++;
+      len--;
+    }
+
+  converted = g_convert ((const char *) data, len, "UTF-8", "ISO-8859-1", NULL, NULL, NULL);
+  return g_utf8_make_valid (converted ? converted : "", -1);
+}
+
+static void
+parse_sdt (HdhomerunTsDemux *demux,
+           const guint8     *body,
+           gsize             len)
+{
+  gsize i = 3;  /* original_network_id, reserved */
+
+  while (i + 5 <= len)
+    {
+      guint16 service_id = (body[i] << 8) | body[i + 1];
+      gsize end = MIN (i + 5 + (((body[i + 3] & 0x0f) << 8) | body[i + 4]), len);
+      gsize j = i + 5;
+
+      for (; j + 2 <= end && j + 2 + body[j + 1] <= end; j += 2 + body[j + 1])
+        {
+          const guint8 *descriptor = body + j + 2;
+          guint8 descriptor_len = body[j + 1];
+          guint8 provider_len, name_len;
+
+          if (body[j] != DESCRIPTOR_SERVICE || descriptor_len < 3)
+            continue;
+
+          provider_len = descriptor[1];
+          if (2 + provider_len >= descriptor_len)
+            continue;
+          name_len = MIN (descriptor[2 + provider_len], descriptor_len - 3 - provider_len);
+
+          g_hash_table_insert (demux->sdt, GUINT_TO_POINTER (service_id),
+                               read_dvb_string (descriptor + 3 + provider_len, name_len));
+        }
+
+      i = end;
+    }
+}
+
+static void
+parse_section (HdhomerunTsDemux *demux,
+               guint16           pid,
+               const guint8     *data,
+               gsize             len)
+{
+  guint8 table_id = data[0];
+  guint16 extension;
+
+  /* All the tables we read use the long form with a CRC */
+  if (len < 12 || !(data[1] & 0x80) || !(data[5] & 0x01))
+    return;
+
+  if (pid == PID_PAT && table_id == TABLE_PAT)
+    extension = 0;
+  else if (table_id == TABLE_PMT && pid != PID_PAT && pid != PID_SDT && pid != PID_PSIP)
+    extension = (data[3] << 8) | data[4];
+  else if (pid == PID_PSIP && (table_id == TABLE_TVCT || table_id == TABLE_CVCT))
+    extension = 0;
+  else if (pid == PID_SDT && table_id == TABLE_SDT)
+    extension = 0;
+  else
+    return;
+
+  if (crc32_mpeg (data, len) != 0)
+    return;
+
+  if (is_current (demux, table_id, extension, data[6], (data[5] >> 1) & 0x1f))
+    return;
+
+  switch (table_id)
+    {
+    case TABLE_PAT:
+      parse_pat (demux, data + 8, len - 12);
+      break;
+    case TABLE_PMT:
+      parse_pmt (demux, extension, data + 8, len - 12);
+      break;
+    case TABLE_TVCT:
+    case TABLE_CVCT:
+      parse_vct (demux, data + 8, len - 12);
+      break;
+    case TABLE_SDT:
+      parse_sdt (demux, data + 8, len - 12);
+      break;
+    default:
+      g_assert_not_reached ();
+    }
+
+  demux->changed = TRUE;
+}
+
+/* Returns whether the section was completed or given up on */
+static gboolean
+gather (HdhomerunTsDemux *demux,
+        Section          *section,
+        const guint8     *data,
+        gsize             len)
+{
+  gsize n = MIN (len, section->need - section->len);
+
+  memcpy (section->data + section->len, data, n);
+  section->len += n;
+
+  if (section->len < section->need)
+    return FALSE;
+
+  parse_section (demux, section->pid, section->data, section->need);
+  section->need = 0;
+  return TRUE;
+}
+
+static void
+feed_section (HdhomerunTsDemux *demux,
+              Section          *section,
+              const guint8     *data,
+              gsize             len,
+              gboolean          unit_start)
+{
+  guint8 pointer;
+
+  if (!unit_start)
+    {
+      if (section->need > 0)
+        gather (demux, section, data, len);
+      return;
+    }
+
+  /* The pointer field says where the first new section starts */
+  pointer = data[0];
+  data++;
+  len--;
+  if (pointer > len)
+    {
+      section->need = 0;
+      return;
+    }
+
+  if (section->need > 0 && !gather (demux, section, data, pointer))
+    section->need = 0;
+  data += pointer;
+  len -= pointer;
+
+  /* Stuffing after the last section is 0xff */
+  while (len >= 3 && data[0] != 0xff)
+    {
+      gsize total = 3 + (((data[1] & 0x0f) << 8) | data[2]);
+
+      if (total > MAX_SECTION)
+        break;
+
+      if (total > len)
+        {
+          memcpy (section->data, data, len);
+          section->len = len;
+          section->need = total;
+          break;
+        }
+
+      parse_section (demux, section->pid, data, total);
+      data += total;
+      len -= total;
+    }
+}
+
+static void
+feed_packet (HdhomerunTsDemux *demux,
+             const guint8     *p)
+{
+  guint16 pid = read_pid (p + 1);
+  guint control = (p[3] >> 4) & 0x3;
+  gboolean discontinuity = FALSE;
+  gsize offset = 4;
+  Section *section;
+
+  counter_inc (&demux->packets[pid]);
+
+  /* Transport error; nothing in it can be trusted */
+  if (p[1] & 0x80)
+    {
+      counter_inc (&demux->transport_errors[pid]);
+      return;
+    }
+
+  if (p[3] & 0xc0)
+    counter_inc (&demux->scrambled[pid]);
+
+  if (control & 0x2)
+    offset += 1 + p[4];
+
+  if ((control & 0x1) && pid != PID_NULL)
+    {
+      guint8 cc = p[3] & 0x0f;
+      guint8 last = demux->last_cc[pid];
+      gboolean flagged = (control & 0x2) && p[4] > 0 && (p[5] & 0x80);
+
+      demux->last_cc[pid] = cc;
+
+      /* A duplicate repeats the previous payload */
+      if (last == cc)
+        return;
+
+      if (last != NO_CC && cc != ((last + 1) & 0x0f) && !flagged)
+        {
+          counter_inc (&demux->continuity_errors[pid]);
+          discontinuity = TRUE;
+        }
+    }
+
+  if (!(control & 0x1) || offset >= TS_SIZE || !is_psi_pid (demux, pid))
+    return;
+
+  section = g_hash_table_lookup (demux->sections, GUINT_TO_POINTER (pid));
+  if (discontinuity)
+    section->need = 0;
+  feed_section (demux, section, p + offset, TS_SIZE - offset, (p[1] & 0x40) != 0);
+}
+
+static GArray *
+build_programs (HdhomerunTsDemux *demux)
+{
+  GArray *programs = g_array_sized_new (FALSE, TRUE, sizeof (HdhomerunTsProgram), demux->pat->len);
+
+  for (guint i = 0; i < demux->pat->len; i++)
+    {
+      const PatEntry *entry = &g_array_index (demux->pat, PatEntry, i);
+      gpointer key = GUINT_TO_POINTER (entry->program_number);
+      const PmtInfo *pmt = g_hash_table_lookup (demux->pmts, key);
+      const VctInfo *vct = g_hash_table_lookup (demux->vct, key);
+      const char *sdt_name = g_hash_table_lookup (demux->sdt, key);
+      HdhomerunTsProgram program = { 0 };
+
+      program.program_number = entry->program_number;
+      program.pmt_pid = entry->pmt_pid;
+
+      if (pmt != NULL)
+        {
+          program.pcr_pid = pmt->pcr_pid;
+          program.n_streams = pmt->n_streams;
+          memcpy (program.streams, pmt->streams, sizeof pmt->streams);
+        }
+
+      if (vct != NULL)
+        {
+          program.virtual_major = vct->major;
+          program.virtual_minor = vct->minor;
+          g_strlcpy (program.name, vct->name, sizeof program.name);
+        }
+      else if (sdt_name != NULL)
+        {
+          g_strlcpy (program.name, sdt_name, sizeof program.name);
+        }
+
+      g_array_append_val (programs, program);
+    }
+
+  return programs;
+}
+
+static void
+notify_changed (HdhomerunTsDemux *demux)
+{
+  g_autoptr(GArray) programs = NULL;
+
+  if (!demux->changed)
+    return;
+
+  demux->changed = FALSE;
+
+  if (demux->func == NULL)
+    return;
+
+  programs = build_programs (demux);
+  demux->func (demux, programs, demux->user_data);
+}
+
+/**
+ * hdhomerun_ts_demux_feed:
+ * @demux: a #HdhomerunTsDemux
+ * @data: bytes of a transport stream
+ * @len: the length of @data
+ *
+ * Feed a stretch of stream that need not start or end on a packet
+ * boundary. A packet split across two calls is put back together; lost
+ * sync is found again and counted.
+ */
+void
+hdhomerun_ts_demux_feed (HdhomerunTsDemux *demux,
+                         const guint8     *data,
+                         gsize             len)
+{
+  g_return_if_fail (demux != NULL);
+  g_return_if_fail (data != NULL || len == 0);
+
+  if (demux->partial_len > 0)
+    {
+      gsize n = MIN (TS_SIZE - demux->partial_len, len);
+
+      memcpy (demux->partial + demux->partial_len, data, n);
+      demux->partial_len += n;
+      data += n;
+      len -= n;
+
+      if (demux->partial_len < TS_SIZE)
+        return;
+
+      feed_packet (demux, demux->partial);
+      demux->partial_len = 0;
+    }
+
+  while (len > 0)
+    {
+      if (data[0] != SYNC_BYTE)
+        {
+          gsize skip = hdhomerun_ts_find_sync (data, len);
+
+          counter_inc (&demux->sync_losses);
+          data += skip;
+          len -= skip;
+          continue;
+        }
+
+      if (len < TS_SIZE)
+        {
+          memcpy (demux->partial, data, len);
+          demux->partial_len = len;
+          break;
+        }
+
+      feed_packet (demux, data);
+      data += TS_SIZE;
+      len -= TS_SIZE;
+    }
+
+  notify_changed (demux);
+}
+
+/**
+ * hdhomerun_ts_demux_feed_packets:
+ * @demux: a #HdhomerunTsDemux
+ * @packets: whole packets, such as a datagram from a #HdhomerunTsRing
+ * @n_packets: the number of packets
+ *
+ * Feed packets that are known to be aligned. Packets without a sync
+ * byte are skipped and counted as lost sync.
+ */
+void
+hdhomerun_ts_demux_feed_packets (HdhomerunTsDemux *demux,
+                                 const guint8     *packets,
+                                 gsize             n_packets)
+{
+  g_return_if_fail (demux != NULL);
+  g_return_if_fail (packets != NULL || n_packets == 0);
+
+  for (gsize i = 0; i < n_packets; i++)
+    {
+      const guint8 *p = packets + i * TS_SIZE;
+
+      if (G_LIKELY (p[0] == SYNC_BYTE))
+        feed_packet (demux, p);
+      else
+        counter_inc (&demux->sync_losses);
+    }
+
+  notify_changed (demux);
+}
+
+/**
+ * hdhomerun_ts_demux_get_pid_stats:
+ * @demux: a #HdhomerunTsDemux
+ * @pid: a PID
+ * @stats: (out caller-allocates): where to store the counters
+ *
+ * Sample the counters of @pid. May be called from any thread.
+ */
+void
+hdhomerun_ts_demux_get_pid_stats (HdhomerunTsDemux    *demux,
+                                  guint16              pid,
+                                  HdhomerunTsPidStats *stats)
+{
+  g_return_if_fail (demux != NULL);
+  g_return_if_fail (pid < HDHOMERUN_TS_N_PIDS);
+  g_return_if_fail (stats != NULL);
+
+  stats->packets = (guint32) g_atomic_int_get (&demux->packets[pid]);
+  stats->continuity_errors = (guint32) g_atomic_int_get (&demux->continuity_errors[pid]);
+  stats->transport_errors = (guint32) g_atomic_int_get (&demux->transport_errors[pid]);
+  stats->scrambled = (guint32) g_atomic_int_get (&demux->scrambled[pid]);
+}
+
+/**
+ * hdhomerun_ts_demux_get_sync_losses:
+ * @demux: a #HdhomerunTsDemux
+ *
+ * Returns: how many times the stream had to be resynced
+ */
+guint
+hdhomerun_ts_demux_get_sync_losses (HdhomerunTsDemux *demux)
+{
+  g_return_val_if_fail (demux != NULL, 0);
+
+  return (guint) g_atomic_int_get (&demux->sync_losses);
+}
+
+/**
+ * hdhomerun_ts_demux_reset:
+ * @demux: a #HdhomerunTsDemux
+ *
+ * Forget all tables and counters, such as after tuning elsewhere. Only
+ * call this while nothing is feeding @demux.
+ */
+void
+hdhomerun_ts_demux_reset (HdhomerunTsDemux *demux)
+{
+  g_return_if_fail (demux != NULL);
+
+  demux->partial_len = 0;
+  memset (demux->last_cc, NO_CC, sizeof demux->last_cc);
+  memset (demux->psi_pids, 0, sizeof demux->psi_pids);
+  g_hash_table_remove_all (demux->sections);
+  g_hash_table_remove_all (demux->versions);
+  g_array_set_size (demux->pat, 0);
+  g_hash_table_remove_all (demux->pmts);
+  g_hash_table_remove_all (demux->vct);
+  g_hash_table_remove_all (demux->sdt);
+  demux->changed = FALSE;
+
+  g_atomic_int_set (&demux->sync_losses, 0);
+  for (guint pid = 0; pid < HDHOMERUN_TS_N_PIDS; pid++)
+    {
+      g_atomic_int_set (&demux->packets[pid], 0);
+      g_atomic_int_set (&demux->continuity_errors[pid], 0);
+      g_atomic_int_set (&demux->transport_errors[pid], 0);
+      g_atomic_int_set (&demux->scrambled[pid], 0);
+    }
+
+  watch_pid (demux, PID_PAT);
+  watch_pid (demux, PID_SDT);
+  watch_pid (demux, PID_PSIP);
+}
+
+static void
+ts_demux_free (HdhomerunTsDemux *demux)
+{
+  if (demux->destroy)
+    demux->destroy (demux->user_data);
+
+  g_hash_table_unref (demux->sections);
+  g_hash_table_unref (demux->versions);
+  g_array_unref (demux->pat);
+  g_hash_table_unref (demux->pmts);
+  g_hash_table_unref (demux->vct);
+  g_hash_table_unref (demux->sdt);
+}
+
+/**
+ * hdhomerun_ts_demux_new:
+ * @func: (nullable): called when the programs change
+ * @user_data: data for @func
+ * @destroy: (nullable): frees @user_data with the demuxer
+ *
+ * Returns: (transfer full): a new #HdhomerunTsDemux
+ */
+HdhomerunTsDemux *
+hdhomerun_ts_demux_new (HdhomerunTsProgramsFunc func,
+                        gpointer                user_data,
+                        GDestroyNotify          destroy)
+{
+  HdhomerunTsDemux *demux;
+
+  init_crc_table ();
+
+  demux = g_atomic_rc_box_new0 (HdhomerunTsDemux);
+  demux->func = func;
+  demux->user_data = user_data;
+  demux->destroy = destroy;
+  demux->sections = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+  demux->versions = g_hash_table_new (NULL, NULL);
+  demux->pat = g_array_new (FALSE, FALSE, sizeof (PatEntry));
+  demux->pmts = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+  demux->vct = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+  demux->sdt = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+
+  hdhomerun_ts_demux_reset (demux);
+
+  return demux;
+}
+
+HdhomerunTsDemux *
+hdhomerun_ts_demux_ref (HdhomerunTsDemux *demux)
+{
+  g_return_val_if_fail (demux != NULL, NULL);
+
+  return g_atomic_rc_box_acquire (demux);
+}
+
+void
+hdhomerun_ts_demux_unref (HdhomerunTsDemux *demux)
+{
+  g_return_if_fail (demux != NULL);
+
+  g_atomic_rc_box_release_full (demux, (GDestroyNotify) ts_demux_free);
+}
@@ -0,0 +1,101 @@
+/* hdhomerun-ts-demux.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define HDHOMERUN_TS_N_PIDS        8192
+#define HDHOMERUN_TS_MAX_STREAMS   16
+
+typedef struct
+{
+  guint16 pid;
+  guint8 stream_type;
+} HdhomerunTsElementaryStream;
+
+/* What the tables of one transport stream say about a program. The
+ * virtual channel and name come from the ATSC VCT or, failing that, the
+ * DVB SDT, and are zero and empty when the stream carries neither.
+ */
+typedef struct
+{
+  guint16 program_number;
+  guint16 pmt_pid;
+  guint16 pcr_pid;
+  guint16 virtual_major;
+  guint16 virtual_minor;
+  char name[64];                    /* UTF-8 */
+  guint n_streams;
+  HdhomerunTsElementaryStream streams[HDHOMERUN_TS_MAX_STREAMS];
+} HdhomerunTsProgram;
+
+/* Counters wrap; readers look at differences between two samples */
+typedef struct
+{
+  guint32 packets;
+  guint32 continuity_errors;
+  guint32 transport_errors;
+  guint32 scrambled;
+} HdhomerunTsPidStats;
+
+typedef struct _HdhomerunTsDemux HdhomerunTsDemux;
+
+/**
+ * HdhomerunTsProgramsFunc:
+ * @demux: the demuxer
+ * @programs: (element-type HdhomerunTsProgram): the programs of the stream
+ * @user_data: data passed to hdhomerun_ts_demux_new()
+ *
+ * Called on the feeding thread whenever a table changed what is known
+ * about the programs. @programs is only valid for the call; take a
+ * reference to keep it.
+ */
+typedef void (*HdhomerunTsProgramsFunc) (HdhomerunTsDemux *demux,
+                                         GArray           *programs,
+                                         gpointer          user_data);
+
+HdhomerunTsDemux *hdhomerun_ts_demux_new          (HdhomerunTsProgramsFunc  func,
+                                                   gpointer                 user_data,
+                                                   GDestroyNotify           destroy);
+HdhomerunTsDemux *hdhomerun_ts_demux_ref          (HdhomerunTsDemux        *demux);
+void              hdhomerun_ts_demux_unref        (HdhomerunTsDemux        *demux);
+void              hdhomerun_ts_demux_reset        (HdhomerunTsDemux        *demux);
+
+/* Feeding side, one thread at a time */
+void              hdhomerun_ts_demux_feed         (HdhomerunTsDemux        *demux,
+                                                   const guint8            *data,
+                                                   gsize                    len);
+void              hdhomerun_ts_demux_feed_packets (HdhomerunTsDemux        *demux,
+                                                   const guint8            *packets,
+                                                   gsize                    n_packets);
+
+/* Any thread */
+void              hdhomerun_ts_demux_get_pid_stats (HdhomerunTsDemux    *demux,
+                                                    guint16              pid,
+                                                    HdhomerunTsPidStats *stats);
+guint             hdhomerun_ts_demux_get_sync_losses (HdhomerunTsDemux  *demux);
+
+gsize             hdhomerun_ts_find_sync          (const guint8            *data,
+                                                   gsize                    len);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (HdhomerunTsDemux, hdhomerun_ts_demux_unref)
+
+G_END_DECLS
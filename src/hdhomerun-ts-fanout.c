@@ -0,0 +1,328 @@
+/* hdhomerun-ts-fanout.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE  /* sendmmsg() */
+
+#include "hdhomerun-ts-fanout.h"
+
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/* Every consumer of a stream, such as the preview and a recording, gets
+ * a ring of its own that is handed a reference to each batch received.
+ * A consumer that falls behind only fills its own ring and drops batches
+ * there, so a recorder stalled on the disk never holds up the preview.
+ *
+ * Publishing sends each datagram on to a multicast group as it was
+ * received, so other hosts on the network can watch a tuner without it
+ * streaming to them too. The socket never blocks; datagrams the kernel
+ * has no room for are counted and dropped like those of a slow consumer.
+ */
+
+#define PUBLISH_TTL    1
+#define SOCKET_SNDBUF  (1024 * 1024)
+
+struct _HdhomerunTsFanout
+{
+  GPtrArray *consumers;         /* HdhomerunTsRing */
+  HdhomerunTsBatch *last;       /* So the next receive can share its block */
+
+  int publish_fd;
+  char *publish_address;
+  guint64 published;            /* Datagrams */
+  guint64 publish_dropped;
+  gboolean publish_failed;      /* Warned about already */
+};
+
+/**
+ * hdhomerun_ts_fanout_new:
+ *
+ * Returns: (transfer full): a new fan-out with no consumers
+ */
+HdhomerunTsFanout *
+hdhomerun_ts_fanout_new (void)
+{
+  HdhomerunTsFanout *fanout = g_new0 (HdhomerunTsFanout, 1);
+
+  fanout->consumers = g_ptr_array_new_with_free_func ((GDestroyNotify) hdhomerun_ts_ring_unref);
+  fanout->publish_fd = -1;
+
+  return fanout;
+}
+
+void
+hdhomerun_ts_fanout_free (HdhomerunTsFanout *fanout)
+{
+  g_return_if_fail (fanout != NULL);
+
+  hdhomerun_ts_fanout_set_publish_address (fanout, NULL, NULL);
+  g_clear_pointer (&fanout->last, hdhomerun_ts_batch_unref);
+  g_ptr_array_unref (fanout->consumers);
+  g_free (fanout);
+}
+
+/**
+ * hdhomerun_ts_fanout_add_consumer:
+ * @fanout: a #HdhomerunTsFanout
+ * @ring: the ring of a consumer
+ *
+ * Hand @ring everything received from now on. The fan-out keeps a
+ * reference until the consumer is removed.
+ */
+void
+hdhomerun_ts_fanout_add_consumer (HdhomerunTsFanout *fanout,
+                                  HdhomerunTsRing   *ring)
+{
+  g_return_if_fail (fanout != NULL);
+  g_return_if_fail (ring != NULL);
+
+  if (!g_ptr_array_find (fanout->consumers, ring, NULL))
+    g_ptr_array_add (fanout->consumers, hdhomerun_ts_ring_ref (ring));
+}
+
+/**
+ * hdhomerun_ts_fanout_remove_consumer:
+ * @fanout: a #HdhomerunTsFanout
+ * @ring: the ring of a consumer
+ *
+ * Stop handing @ring batches. What it holds already stays readable.
+ */
+void
+hdhomerun_ts_fanout_remove_consumer (HdhomerunTsFanout *fanout,
+                                     HdhomerunTsRing   *ring)
+{
+  g_return_if_fail (fanout != NULL);
+
+  g_ptr_array_remove_fast (fanout->consumers, ring);
+}
+
+/**
+ * hdhomerun_ts_fanout_close:
+ * @fanout: a #HdhomerunTsFanout
+ *
+ * Close the ring of every consumer, which then sees the end of the
+ * stream once it has drained it. The consumers stay attached.
+ */
+void
+hdhomerun_ts_fanout_close (HdhomerunTsFanout *fanout)
+{
+  g_return_if_fail (fanout != NULL);
+
+  for (guint i = 0; i < fanout->consumers->len; i++)
+    hdhomerun_ts_ring_close (g_ptr_array_index (fanout->consumers, i));
+}
+
+static int
+open_publish_socket (GInetSocketAddress  *address,
+                     GError             **error)
+{
+  struct sockaddr_in addr;
+  int ttl = PUBLISH_TTL;
+  int sndbuf = SOCKET_SNDBUF;
+  int sock;
+
+  if (!g_socket_address_to_native (G_SOCKET_ADDRESS (address), &addr, sizeof addr, error))
+    return -1;
+
+  sock = socket (AF_INET, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  if (sock < 0)
+    goto fail;
+
+  /* Best effort; the kernel may clamp it */
+  setsockopt (sock, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof sndbuf);
+
+  /* Keep the stream on the local network */
+  if (setsockopt (sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof ttl) < 0 ||
+      connect (sock, (struct sockaddr *)&addr, sizeof addr) < 0)
+    goto fail;
+
+  return sock;
+
+fail:
+  g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+               "Failed to open publish socket: %s", g_strerror (errno));
+  if (sock >= 0)
+    close (sock);
+  return -1;
+}
+
+/**
+ * hdhomerun_ts_fanout_set_publish_address:
+ * @fanout: a #HdhomerunTsFanout
+ * @address: (nullable): an IPv4 multicast group and port, or %NULL to
+ *   stop publishing
+ * @error: return location for a #GError
+ *
+ * Send everything received on to @address as well.
+ *
+ * Returns: %FALSE if @address is not a multicast group or could not
+ *   be sent to, in which case nothing is published
+ */
+gboolean
+hdhomerun_ts_fanout_set_publish_address (HdhomerunTsFanout   *fanout,
+                                         GInetSocketAddress  *address,
+                                         GError             **error)
+{
+  GInetAddress *group;
+  int sock;
+
+  g_return_val_if_fail (fanout != NULL, FALSE);
+  g_return_val_if_fail (address == NULL || G_IS_INET_SOCKET_ADDRESS (address), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (fanout->publish_fd >= 0)
+    {
+      g_debug ("Stopped publishing to %s after %" G_GUINT64_FORMAT " datagrams, %"
+               G_GUINT64_FORMAT " dropped", fanout->publish_address,
+               fanout->published, fanout->publish_dropped);
+      close (fanout->publish_fd);
+      fanout->publish_fd = -1;
+    }
+  g_clear_pointer (&fanout->publish_address, g_free);
+  fanout->published = 0;
+  fanout->publish_dropped = 0;
+  fanout->publish_failed = FALSE;
+
+  if (address == NULL)
+    return TRUE;
+
+  group = g_inet_socket_address_get_address (address);
+  if (g_inet_address_get_family (group) != G_SOCKET_FAMILY_IPV4 ||
+      !g_inet_address_get_is_multicast (group))
+    {
+      g_autofree char *name = g_inet_address_to_string (group);
+
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                   "%s is not an IPv4 multicast group", name);
+      return FALSE;
+    }
+
+  sock = open_publish_socket (address, error);
+  if (sock < 0)
+    return FALSE;
+
+  fanout->publish_fd = sock;
+  fanout->publish_address = g_socket_connectable_to_string (G_SOCKET_CONNECTABLE (address));
+
+  return TRUE;
+}
+
+static void
+publish (HdhomerunTsFanout *fanout,
+         HdhomerunTsBatch  *batch)
+{
+  struct mmsghdr msgs[HDHOMERUN_TS_BATCH_MAX_DATAGRAMS];
+  struct iovec iov[HDHOMERUN_TS_BATCH_MAX_DATAGRAMS];
+  guint n_datagrams = hdhomerun_ts_batch_get_n_datagrams (batch);
+  int sent;
+
+  for (guint i = 0; i < n_datagrams; i++)
+    {
+      gsize n_packets;
+
+      iov[i].iov_base = (guint8 *) hdhomerun_ts_batch_get_datagram (batch, i, &n_packets);
+      iov[i].iov_len = n_packets * HDHOMERUN_TS_PACKET_SIZE;
+      msgs[i].msg_hdr = (struct msghdr) { .msg_iov = &iov[i], .msg_iovlen = 1 };
+    }
+
+  sent = sendmmsg (fanout->publish_fd, msgs, n_datagrams, MSG_DONTWAIT);
+  if (sent < 0)
+    {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR && !fanout->publish_failed)
+        {
+          g_warning ("Publishing to %s failed: %s", fanout->publish_address, g_strerror (errno));
+          fanout->publish_failed = TRUE;
+        }
+      sent = 0;
+    }
+
+  fanout->published += (guint) sent;
+  fanout->publish_dropped += n_datagrams - (guint) sent;
+}
+
+/**
+ * hdhomerun_ts_fanout_receive:
+ * @fanout: a #HdhomerunTsFanout
+ * @fd: a datagram socket
+ * @batch: (out) (transfer none) (optional): the batch received, for the
+ *   caller to look at in place until the next receive
+ *
+ * Receive whatever datagrams are queued on @fd and hand them to every
+ * consumer. The socket is drained even when no consumer has room.
+ *
+ * Returns: the number of datagrams received, or -1 with errno set
+ */
+gssize
+hdhomerun_ts_fanout_receive (HdhomerunTsFanout  *fanout,
+                             int                 fd,
+                             HdhomerunTsBatch  **batch)
+{
+  HdhomerunTsBatch *received_batch = NULL;
+  gssize received;
+
+  g_return_val_if_fail (fanout != NULL, -1);
+
+  received = hdhomerun_ts_batch_receive (fd, fanout->last, &received_batch);
+  if (received <= 0)
+    return received;
+
+  g_clear_pointer (&fanout->last, hdhomerun_ts_batch_unref);
+  fanout->last = received_batch;
+
+  for (guint i = 0; i < fanout->consumers->len; i++)
+    hdhomerun_ts_ring_push (g_ptr_array_index (fanout->consumers, i), received_batch);
+
+  if (fanout->publish_fd >= 0)
+    publish (fanout, received_batch);
+
+  if (batch != NULL)
+    *batch = received_batch;
+
+  return received;
+}
+
+/**
+ * hdhomerun_ts_fanout_get_published:
+ * @fanout: a #HdhomerunTsFanout
+ *
+ * Returns: the number of datagrams sent to the multicast group
+ */
+guint64
+hdhomerun_ts_fanout_get_published (HdhomerunTsFanout *fanout)
+{
+  g_return_val_if_fail (fanout != NULL, 0);
+
+  return fanout->published;
+}
+
+/**
+ * hdhomerun_ts_fanout_get_publish_dropped:
+ * @fanout: a #HdhomerunTsFanout
+ *
+ * Returns: the number of datagrams the multicast group missed because
+ *   the socket had no room for them
+ */
+guint64
+hdhomerun_ts_fanout_get_publish_dropped (HdhomerunTsFanout *fanout)
+{
+  g_return_val_if_fail (fanout != NULL, 0);
+
+  return fanout->publish_dropped;
+}
@@ -0,0 +1,53 @@
+/* hdhomerun-ts-fanout.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "hdhomerun-ts-batch.h"
+#include "hdhomerun-ts-ring.h"
+
+G_BEGIN_DECLS
+
+typedef struct _HdhomerunTsFanout HdhomerunTsFanout;
+
+/* Receives the datagrams of one stream once and hands every batch to
+ * each consumer ring and, optionally, a multicast group. The caller
+ * serializes all calls, so receiving and changing consumers never race.
+ */
+HdhomerunTsFanout *hdhomerun_ts_fanout_new                 (void);
+void               hdhomerun_ts_fanout_free                (HdhomerunTsFanout  *fanout);
+
+void               hdhomerun_ts_fanout_add_consumer        (HdhomerunTsFanout  *fanout,
+                                                            HdhomerunTsRing    *ring);
+void               hdhomerun_ts_fanout_remove_consumer     (HdhomerunTsFanout  *fanout,
+                                                            HdhomerunTsRing    *ring);
+void               hdhomerun_ts_fanout_close               (HdhomerunTsFanout  *fanout);
+gboolean           hdhomerun_ts_fanout_set_publish_address (HdhomerunTsFanout  *fanout,
+                                                            GInetSocketAddress *address,
+                                                            GError            **error);
+
+gssize             hdhomerun_ts_fanout_receive             (HdhomerunTsFanout  *fanout,
+                                                            int                 fd,
+                                                            HdhomerunTsBatch  **batch);
+
+guint64            hdhomerun_ts_fanout_get_published       (HdhomerunTsFanout  *fanout);
+guint64            hdhomerun_ts_fanout_get_publish_dropped (HdhomerunTsFanout  *fanout);
+
+G_END_DECLS
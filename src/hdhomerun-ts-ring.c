@@ -0,0 +1,331 @@
+/* hdhomerun-ts-ring.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-ts-ring.h"
+
+/* The write and read indices run freely and are masked into the slot
+ * array, so a full ring and an empty one are told apart without a spare
+ * slot. Each index is written by one side only and lives on its own cache
+ * line.
+ *
+ * Every batch holds at least one datagram, so with as many slots as
+ * datagrams the ring fills up on its datagram count alone; a ring of
+ * small batches does not buffer any less than one of large ones. The
+ * consumer lets go of each batch as soon as it has read past it.
+ *
+ * The mutex is only taken to wake a consumer that found the ring empty
+ * and went to sleep.
+ */
+
+#define CACHE_LINE 64
+
+struct _HdhomerunTsRing
+{
+  HdhomerunTsBatch **batches;
+  guint n_slots;         /* A power of two */
+  guint capacity;        /* Datagrams */
+
+  gint write_index;      /* Producer */
+  char write_pad[CACHE_LINE - sizeof (gint)];
+  gint read_index;       /* Consumer */
+  guint position;        /* Consumer: datagram in the batch at read_index */
+  char read_pad[CACHE_LINE - sizeof (gint) - sizeof (guint)];
+
+  gint queued;           /* Datagrams pushed and not yet read past */
+  gint waiting;          /* Consumer is asleep, or about to be */
+  gint closed;
+  guint64 dropped;       /* Datagrams; 64-bit atomic, GLib has no such API */
+
+  GMutex lock;
+  GCond cond;
+};
+
+static void
+clear_batches (HdhomerunTsRing *ring)
+{
+  guint write = (guint) g_atomic_int_get (&ring->write_index);
+
+  for (guint i = (guint) g_atomic_int_get (&ring->read_index); i != write; i++)
+    g_clear_pointer (&ring->batches[i & (ring->n_slots - 1)], hdhomerun_ts_batch_unref);
+}
+
+static void
+ts_ring_free (HdhomerunTsRing *ring)
+{
+  clear_batches (ring);
+  g_free (ring->batches);
+  g_cond_clear (&ring->cond);
+  g_mutex_clear (&ring->lock);
+}
+
+/**
+ * hdhomerun_ts_ring_new:
+ * @n_datagrams: the number of datagrams to hold
+ *
+ * Returns: (transfer full): a new, empty ring
+ */
+HdhomerunTsRing *
+hdhomerun_ts_ring_new (guint n_datagrams)
+{
+  HdhomerunTsRing *ring;
+  guint n_slots = 1;
+
+  g_return_val_if_fail (n_datagrams > 0 && n_datagrams <= G_MAXINT / 2, NULL);
+
+  while (n_slots < n_datagrams)
+    n_slots <<= 1;
+
+  ring = g_atomic_rc_box_new0 (HdhomerunTsRing);
+  ring->n_slots = n_slots;
+  ring->capacity = n_datagrams;
+  ring->batches = g_new0 (HdhomerunTsBatch *, n_slots);
+  g_mutex_init (&ring->lock);
+  g_cond_init (&ring->cond);
+
+  return ring;
+}
+
+HdhomerunTsRing *
+hdhomerun_ts_ring_ref (HdhomerunTsRing *ring)
+{
+  g_return_val_if_fail (ring != NULL, NULL);
+
+  return g_atomic_rc_box_acquire (ring);
+}
+
+void
+hdhomerun_ts_ring_unref (HdhomerunTsRing *ring)
+{
+  g_return_if_fail (ring != NULL);
+
+  g_atomic_rc_box_release_full (ring, (GDestroyNotify) ts_ring_free);
+}
+
+/**
+ * hdhomerun_ts_ring_reset:
+ * @ring: a #HdhomerunTsRing
+ *
+ * Empty and reopen @ring. Only call this while neither side is using it.
+ */
+void
+hdhomerun_ts_ring_reset (HdhomerunTsRing *ring)
+{
+  g_return_if_fail (ring != NULL);
+
+  clear_batches (ring);
+  ring->position = 0;
+  g_atomic_int_set (&ring->write_index, 0);
+  g_atomic_int_set (&ring->read_index, 0);
+  g_atomic_int_set (&ring->queued, 0);
+  g_atomic_int_set (&ring->closed, 0);
+}
+
+/**
+ * hdhomerun_ts_ring_close:
+ * @ring: a #HdhomerunTsRing
+ *
+ * Mark the end of the stream. A waiting consumer wakes up and drains
+ * what is left.
+ */
+void
+hdhomerun_ts_ring_close (HdhomerunTsRing *ring)
+{
+  g_return_if_fail (ring != NULL);
+
+  g_atomic_int_set (&ring->closed, 1);
+
+  g_mutex_lock (&ring->lock);
+  g_cond_broadcast (&ring->cond);
+  g_mutex_unlock (&ring->lock);
+}
+
+static void
+wake_consumer (HdhomerunTsRing *ring)
+{
+  if (g_atomic_int_get (&ring->waiting))
+    {
+      g_mutex_lock (&ring->lock);
+      g_cond_signal (&ring->cond);
+      g_mutex_unlock (&ring->lock);
+    }
+}
+
+/**
+ * hdhomerun_ts_ring_push:
+ * @ring: a #HdhomerunTsRing
+ * @batch: the datagrams to hand to the consumer
+ *
+ * Queue a reference to @batch. When the consumer is too far behind to
+ * take all of it, the whole batch is dropped and its datagrams counted
+ * instead; the producer never waits.
+ *
+ * Returns: %TRUE if @batch was queued
+ */
+gboolean
+hdhomerun_ts_ring_push (HdhomerunTsRing  *ring,
+                        HdhomerunTsBatch *batch)
+{
+  guint write = (guint) g_atomic_int_get (&ring->write_index);
+  guint read = (guint) g_atomic_int_get (&ring->read_index);
+  guint n_datagrams = hdhomerun_ts_batch_get_n_datagrams (batch);
+
+  if (write - read == ring->n_slots ||
+      (guint) g_atomic_int_get (&ring->queued) + n_datagrams > ring->capacity)
+    {
+      __atomic_fetch_add (&ring->dropped, (guint64) n_datagrams, __ATOMIC_RELAXED);
+      return FALSE;
+    }
+
+  ring->batches[write & (ring->n_slots - 1)] = hdhomerun_ts_batch_ref (batch);
+  g_atomic_int_add (&ring->queued, (gint) n_datagrams);
+  g_atomic_int_set (&ring->write_index, (gint) (write + 1));
+  wake_consumer (ring);
+
+  return TRUE;
+}
+
+/* Consumer only: let go of the batch at the head and move on */
+static void
+finish_batch (HdhomerunTsRing *ring,
+              guint            read)
+{
+  HdhomerunTsBatch **slot = &ring->batches[read & (ring->n_slots - 1)];
+
+  g_atomic_int_add (&ring->queued, -(gint) hdhomerun_ts_batch_get_n_datagrams (*slot));
+  g_clear_pointer (slot, hdhomerun_ts_batch_unref);
+  ring->position = 0;
+  g_atomic_int_set (&ring->read_index, (gint) (read + 1));
+}
+
+/**
+ * hdhomerun_ts_ring_peek:
+ * @ring: a #HdhomerunTsRing
+ * @n_packets: (out): the number of packets in the datagram
+ *
+ * Look at the oldest datagram without copying it. The packets stay valid
+ * until hdhomerun_ts_ring_advance().
+ *
+ * Returns: (nullable): the packets of the oldest datagram, or %NULL if
+ *   the ring is empty
+ */
+const guint8 *
+hdhomerun_ts_ring_peek (HdhomerunTsRing *ring,
+                        gsize           *n_packets)
+{
+  for (;;)
+    {
+      guint read = (guint) g_atomic_int_get (&ring->read_index);
+      HdhomerunTsBatch *batch;
+      const guint8 *packets;
+
+      if (read == (guint) g_atomic_int_get (&ring->write_index))
+        return NULL;
+
+      batch = ring->batches[read & (ring->n_slots - 1)];
+      if (ring->position == hdhomerun_ts_batch_get_n_datagrams (batch))
+        {
+          finish_batch (ring, read);
+          continue;
+        }
+
+      /* Skip runt datagrams that carried no whole packet */
+      packets = hdhomerun_ts_batch_get_datagram (batch, ring->position, n_packets);
+      if (*n_packets == 0)
+        {
+          ring->position++;
+          continue;
+        }
+
+      return packets;
+    }
+}
+
+/**
+ * hdhomerun_ts_ring_advance:
+ * @ring: a #HdhomerunTsRing
+ *
+ * Move past the datagram returned by hdhomerun_ts_ring_peek(), handing
+ * its batch back once it has all been read.
+ */
+void
+hdhomerun_ts_ring_advance (HdhomerunTsRing *ring)
+{
+  guint read = (guint) g_atomic_int_get (&ring->read_index);
+
+  if (++ring->position == hdhomerun_ts_batch_get_n_datagrams (ring->batches[read & (ring->n_slots - 1)]))
+    finish_batch (ring, read);
+}
+
+static gboolean
+is_empty (HdhomerunTsRing *ring)
+{
+  return g_atomic_int_get (&ring->read_index) == g_atomic_int_get (&ring->write_index);
+}
+
+/**
+ * hdhomerun_ts_ring_wait:
+ * @ring: a #HdhomerunTsRing
+ * @timeout_us: how long to wait, or -1 to wait until data or close
+ *
+ * Block the consumer until a datagram is available.
+ *
+ * Returns: %TRUE if a datagram is available, %FALSE on timeout or when
+ *   the ring was closed and has been drained
+ */
+gboolean
+hdhomerun_ts_ring_wait (HdhomerunTsRing *ring,
+                        gint64           timeout_us)
+{
+  gint64 end_time = g_get_monotonic_time () + timeout_us;
+
+  if (!is_empty (ring))
+    return TRUE;
+
+  /* Announce the wait before the final check, so the producer either sees
+   * it or the check sees the producer's datagram.
+   */
+  g_atomic_int_set (&ring->waiting, 1);
+
+  g_mutex_lock (&ring->lock);
+  while (is_empty (ring) && !g_atomic_int_get (&ring->closed))
+    {
+      if (timeout_us < 0)
+        g_cond_wait (&ring->cond, &ring->lock);
+      else if (!g_cond_wait_until (&ring->cond, &ring->lock, end_time))
+        break;
+    }
+  g_mutex_unlock (&ring->lock);
+
+  g_atomic_int_set (&ring->waiting, 0);
+
+  return !is_empty (ring);
+}
+
+/**
+ * hdhomerun_ts_ring_get_dropped:
+ * @ring: a #HdhomerunTsRing
+ *
+ * Returns: the number of datagrams dropped because the ring was full
+ */
+guint64
+hdhomerun_ts_ring_get_dropped (HdhomerunTsRing *ring)
+{
+  g_return_val_if_fail (ring != NULL, 0);
+
+  return __atomic_load_n (&ring->dropped, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,56 @@
+/* hdhomerun-ts-ring.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "hdhomerun-ts-batch.h"
+
+G_BEGIN_DECLS
+
+typedef struct _HdhomerunTsRing HdhomerunTsRing;
+
+/* A single-producer, single-consumer ring of TS datagrams, one per
+ * consumer of a stream. The producer pushes references to the batches it
+ * received and the consumer reads their packets in place, a datagram of
+ * up to seven packets at a time, so no data is copied and neither side
+ * takes a lock while the other is keeping up.
+ */
+HdhomerunTsRing *hdhomerun_ts_ring_new      (guint             n_datagrams);
+HdhomerunTsRing *hdhomerun_ts_ring_ref      (HdhomerunTsRing  *ring);
+void             hdhomerun_ts_ring_unref    (HdhomerunTsRing  *ring);
+void             hdhomerun_ts_ring_reset    (HdhomerunTsRing  *ring);
+void             hdhomerun_ts_ring_close    (HdhomerunTsRing  *ring);
+
+/* Producer side */
+gboolean         hdhomerun_ts_ring_push     (HdhomerunTsRing  *ring,
+                                             HdhomerunTsBatch *batch);
+
+/* Consumer side */
+const guint8    *hdhomerun_ts_ring_peek     (HdhomerunTsRing  *ring,
+                                             gsize            *n_packets);
+void             hdhomerun_ts_ring_advance  (HdhomerunTsRing  *ring);
+gboolean         hdhomerun_ts_ring_wait     (HdhomerunTsRing  *ring,
+                                             gint64            timeout_us);
+
+guint64          hdhomerun_ts_ring_get_dropped (HdhomerunTsRing *ring);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (HdhomerunTsRing, hdhomerun_ts_ring_unref)
+
+G_END_DECLS
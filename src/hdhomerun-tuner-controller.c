@@ -0,0 +1,1116 @@
+/* hdhomerun-tuner-controller.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-tuner-controller.h"
+#include "hdhomerun-channel-scan.h"
+#include "hdhomerun-connection-pool.h"
+#include "hdhomerun-dispatcher.h"
+#include "hdhomerun-scan-cache.h"
+
+/* HdhomerunTunerController is everything the tuner page knows about one
+ * tuner: its pooled connection, the last tune and how it locked, the
+ * channel picked, the stream and its demuxer, a recording and a scan.
+ *
+ * One lives for every tuner that has been shown, so the page switching
+ * between tuners only rebinds to another controller. Nothing is torn
+ * down or asked of the device again, and a stream or recording keeps
+ * running on the tuner left behind; its preview reader is shut off
+ * while it is not on screen, see hdhomerun_tuner_controller_set_previewed().
+ *
+ * The preview and a recording share one stream, which can also be
+ * published to a multicast group for other hosts.
+ */
+
+struct _HdhomerunTunerController
+{
+  GObject parent_instance;
+
+  HdhomerunDeviceInfo *device;
+  guint tuner_index;
+  HdhomerunConnection *connection;  /* Held for the controller's life */
+  HdhomerunChannelStore *channels;  /* Shared by the tuners of the device */
+  GCancellable *cancellable;
+
+  HdhomerunTuner *tuner;
+  HdhomerunTuneState state;
+  guint32 tuned_frequency;          /* Last locked, or 0 */
+  guint signal_strength;
+  guint signal_quality;
+  guint32 selected_frequency;       /* Channel picked, or 0 */
+  guint selected_program;
+
+  gboolean playing;
+  gboolean previewed;
+  HdhomerunStream *stream;
+  gboolean stream_ready;            /* Started, or shared with the recording */
+  HdhomerunTsDemux *demux;          /* Fed by the stream */
+  GInetSocketAddress *publish_address;
+
+  HdhomerunRecorder *recorder;
+
+  HdhomerunChannelScan *scan;
+  GCancellable *scan_cancellable;
+  GError *scan_error;               /* Of the last scan, NULL if it succeeded */
+};
+
+G_DEFINE_FINAL_TYPE (HdhomerunTunerController, hdhomerun_tuner_controller, G_TYPE_OBJECT)
+
+enum {
+  PROP_0,
+  PROP_STATE,
+  PROP_PLAYING,
+  PROP_STREAM,
+  PROP_DEMUX,
+  PROP_RECORDING,
+  PROP_SCAN_PROGRESS,
+  N_PROPS
+};
+
+static GParamSpec *properties [N_PROPS];
+
+/* Show what the stream itself says about the programs of the locked
+ * frequency.
+ */
+static void
+apply_programs (HdhomerunTunerController *self,
+                GArray                   *programs)
+{
+  g_autoptr(HdhomerunScanResult) result = NULL;
+  HdhomerunScanResult *known;
+
+  if (self->tuned_frequency == 0)
+    return;
+
+  known = hdhomerun_channel_store_lookup (self->channels, self->tuned_frequency);
+  result = hdhomerun_scan_result_new_from_programs (known, self->tuned_frequency, programs);
+  if (result != NULL)
+    hdhomerun_channel_store_set_result (self->channels, result);
+}
+
+typedef struct
+{
+  HdhomerunTsDemux *demux;
+  GWeakRef *controller;             /* Owned by demux */
+  GArray *programs;
+} ProgramsUpdate;
+
+static void
+programs_update_free (gpointer data)
+{
+  ProgramsUpdate *update = data;
+
+  g_array_unref (update->programs);
+  hdhomerun_ts_demux_unref (update->demux);
+  g_free (update);
+}
+
+static void
+apply_programs_update (gpointer data)
+{
+  ProgramsUpdate *update = data;
+  g_autoptr(HdhomerunTunerController) self = g_weak_ref_get (update->controller);
+
+  /* Programs of a demuxer that has since been replaced are stale */
+  if (self != NULL && self->demux == update->demux)
+    apply_programs (self, update->programs);
+}
+
+/* Runs on the stream receive thread, so the update is only handed over.
+ * Tables that change again before the next frame replace it.
+ */
+static void
+on_programs (HdhomerunTsDemux *demux,
+             GArray           *programs,
+             gpointer          user_data)
+{
+  ProgramsUpdate *update = g_new0 (ProgramsUpdate, 1);
+
+  update->demux = hdhomerun_ts_demux_ref (demux);
+  update->controller = user_data;
+  update->programs = g_array_ref (programs);
+
+  hdhomerun_dispatcher_push_keyed (hdhomerun_dispatcher_get_default (), demux,
+                                   apply_programs_update, update, programs_update_free);
+}
+
+static void
+free_weak_ref (gpointer data)
+{
+  g_weak_ref_clear (data);
+  g_free (data);
+}
+
+/* A fresh demuxer for every lock, so tables of the last multiplex with
+ * the same version numbers are not taken as already known.
+ */
+static void
+attach_demux (HdhomerunTunerController *self)
+{
+  GWeakRef *controller = g_new0 (GWeakRef, 1);
+
+  g_weak_ref_init (controller, self);
+  g_clear_pointer (&self->demux, hdhomerun_ts_demux_unref);
+  self->demux = hdhomerun_ts_demux_new (on_programs, controller, free_weak_ref);
+
+  if (self->stream != NULL)
+    hdhomerun_stream_set_demux (self->stream, self->demux);
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_DEMUX]);
+}
+
+static void
+set_stream_ready (HdhomerunTunerController *self,
+                  gboolean                  ready)
+{
+  if (self->stream_ready == ready)
+    return;
+
+  self->stream_ready = ready;
+  g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_STREAM]);
+}
+
+/* The stream is stopped before the preview is told to let go of it, so
+ * a decoder blocked on it wakes up. A stream that is being recorded
+ * keeps running with only its reader shut off.
+ */
+static void
+stop_stream (HdhomerunTunerController *self)
+{
+  if (self->stream == NULL)
+    return;
+
+  hdhomerun_stream_set_demux (self->stream, NULL);
+  if (self->recorder != NULL && hdhomerun_recorder_get_stream (self->recorder) == self->stream)
+    hdhomerun_stream_set_reading (self->stream, FALSE);
+  else
+    hdhomerun_stream_stop (self->stream);
+  g_clear_object (&self->stream);
+  set_stream_ready (self, FALSE);
+}
+
+static void
+set_playing (HdhomerunTunerController *self,
+             gboolean                  playing)
+{
+  if (self->playing == playing)
+    return;
+
+  self->playing = playing;
+  g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_PLAYING]);
+}
+
+static void
+on_stream_started (GObject      *source,
+                   GAsyncResult *result,
+                   gpointer      user_data)
+{
+  HdhomerunStream *stream = HDHOMERUN_STREAM (source);
+  HdhomerunTunerController *self;
+  g_autoptr(GError) error = NULL;
+
+  if (!hdhomerun_stream_start_finish (stream, result, &error))
+    {
+      /* Stopped, or the controller is gone */
+      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        return;
+
+      self = HDHOMERUN_TUNER_CONTROLLER (user_data);
+      g_warning ("Failed to start stream: %s", error->message);
+      if (stream == self->stream)
+        {
+          g_clear_object (&self->stream);
+          set_playing (self, FALSE);
+        }
+      return;
+    }
+
+  self = HDHOMERUN_TUNER_CONTROLLER (user_data);
+  if (stream == self->stream)
+    set_stream_ready (self, TRUE);
+}
+
+static void
+publish_stream (HdhomerunTunerController *self,
+                HdhomerunStream          *stream)
+{
+  g_autoptr(GError) error = NULL;
+
+  if (!hdhomerun_stream_set_publish_address (stream, self->publish_address, &error))
+    g_warning ("Failed to publish %s tuner %u: %s", self->device->device_id_str,
+               self->tuner_index, error->message);
+}
+
+static HdhomerunStream *
+create_stream (HdhomerunTunerController *self)
+{
+  HdhomerunStream *stream = hdhomerun_stream_new (self->connection);
+
+  if (self->publish_address != NULL)
+    publish_stream (self, stream);
+
+  return stream;
+}
+
+static void
+start_stream (HdhomerunTunerController *self)
+{
+  stop_stream (self);
+
+  /* The tuner can only stream to one place, so share the recording's */
+  if (self->recorder != NULL)
+    {
+      self->stream = g_object_ref (hdhomerun_recorder_get_stream (self->recorder));
+      hdhomerun_stream_set_reading (self->stream, self->previewed);
+      attach_demux (self);
+      set_stream_ready (self, TRUE);
+      return;
+    }
+
+  self->stream = create_stream (self);
+  hdhomerun_stream_set_reading (self->stream, self->previewed);
+  attach_demux (self);
+  hdhomerun_stream_start_async (self->stream, self->cancellable, on_stream_started, self);
+}
+
+static void
+on_tune_state_changed (HdhomerunTuner           *tuner,
+                       GParamSpec               *pspec,
+                       HdhomerunTunerController *self)
+{
+  HdhomerunTuneState state = hdhomerun_tuner_get_state (tuner);
+
+  (void)pspec; /* unused */
+
+  /* Locks are taken in by on_tuned() along with the signal figures */
+  if (state == HDHOMERUN_TUNE_STATE_LOCKED || state == self->state)
+    return;
+
+  self->state = state;
+  g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_STATE]);
+}
+
+static void
+on_tuned (HdhomerunTuner           *tuner,
+          guint                     frequency,
+          guint                     signal_strength,
+          guint                     signal_quality,
+          guint                     symbol_quality,
+          HdhomerunTunerController *self)
+{
+  if (hdhomerun_tuner_get_state (tuner) != HDHOMERUN_TUNE_STATE_LOCKED)
+    return;
+
+  self->tuned_frequency = frequency;
+  self->signal_strength = signal_strength;
+  self->signal_quality = signal_quality;
+  self->state = HDHOMERUN_TUNE_STATE_LOCKED;
+  if (self->stream != NULL)
+    attach_demux (self);
+
+  g_message ("Locked %u Hz: ss=%u snq=%u seq=%u",
+             frequency, signal_strength, signal_quality, symbol_quality);
+  g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_STATE]);
+}
+
+/**
+ * hdhomerun_tuner_controller_new:
+ * @info: the device
+ * @tuner_index: the tuner on that device
+ * @channels: the channels known for the device
+ *
+ * The pooled control connection for the tuner is opened in the
+ * background so the first request is a single round trip.
+ *
+ * Returns: (transfer full): a new #HdhomerunTunerController
+ */
+HdhomerunTunerController *
+hdhomerun_tuner_controller_new (const HdhomerunDeviceInfo *info,
+                                guint                      tuner_index,
+                                HdhomerunChannelStore     *channels)
+{
+  HdhomerunConnectionPool *pool = hdhomerun_connection_pool_get_default ();
+  HdhomerunTunerController *self;
+
+  g_return_val_if_fail (info != NULL, NULL);
+  g_return_val_if_fail (info->control_address != NULL, NULL);
+  g_return_val_if_fail (HDHOMERUN_IS_CHANNEL_STORE (channels), NULL);
+
+  self = g_object_new (HDHOMERUN_TYPE_TUNER_CONTROLLER, NULL);
+  self->device = hdhomerun_device_info_ref ((HdhomerunDeviceInfo *) info);
+  self->tuner_index = tuner_index;
+  self->channels = g_object_ref (channels);
+
+  self->connection = hdhomerun_connection_pool_acquire (pool, info->device_id_str, tuner_index,
+                                                        info->control_address);
+  self->tuner = hdhomerun_tuner_new (self->connection);
+  g_signal_connect (self->tuner, "notify::state",
+                    G_CALLBACK (on_tune_state_changed), self);
+  g_signal_connect (self->tuner, "tuned", G_CALLBACK (on_tuned), self);
+
+  hdhomerun_connection_pool_warm_up (pool, self->connection);
+
+  return self;
+}
+
+/**
+ * hdhomerun_tuner_controller_update_device:
+ * @self: a #HdhomerunTunerController
+ * @info: a newer record of the device
+ *
+ * Pick up a changed address or model without touching the tuner. The
+ * connection follows the address through the pool by itself. Records of
+ * other devices are ignored.
+ */
+void
+hdhomerun_tuner_controller_update_device (HdhomerunTunerController  *self,
+                                          const HdhomerunDeviceInfo *info)
+{
+  g_return_if_fail (HDHOMERUN_IS_TUNER_CONTROLLER (self));
+  g_return_if_fail (info != NULL);
+
+  if (self->device->device_id != info->device_id || self->device == info)
+    return;
+
+  g_clear_pointer (&self->device, hdhomerun_device_info_unref);
+  self->device = hdhomerun_device_info_ref ((HdhomerunDeviceInfo *) info);
+}
+
+/**
+ * hdhomerun_tuner_controller_get_device:
+ * @self: a #HdhomerunTunerController
+ *
+ * Returns: (transfer none): the latest record of the device
+ */
+const HdhomerunDeviceInfo *
+hdhomerun_tuner_controller_get_device (HdhomerunTunerController *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_TUNER_CONTROLLER (self), NULL);
+
+  return self->device;
+}
+
+guint
+hdhomerun_tuner_controller_get_tuner_index (HdhomerunTunerController *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_TUNER_CONTROLLER (self), 0);
+
+  return self->tuner_index;
+}
+
+/**
+ * hdhomerun_tuner_controller_get_channels:
+ * @self: a #HdhomerunTunerController
+ *
+ * Returns: (transfer none): the channels known for the device
+ */
+HdhomerunChannelStore *
+hdhomerun_tuner_controller_get_channels (HdhomerunTunerController *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_TUNER_CONTROLLER (self), NULL);
+
+  return self->channels;
+}
+
+/**
+ * hdhomerun_tuner_controller_select_channel:
+ * @self: a #HdhomerunTunerController
+ * @item: a row of the channel store
+ *
+ * Tune a scanned channel and remember it as the one picked.
+ */
+void
+hdhomerun_tuner_controller_select_channel (HdhomerunTunerController *self,
+                                           HdhomerunChannelItem     *item)
+{
+  const HdhomerunScanProgram *program;
+
+  g_return_if_fail (HDHOMERUN_IS_TUNER_CONTROLLER (self));
+  g_return_if_fail (HDHOMERUN_IS_CHANNEL_ITEM (item));
+
+  program = hdhomerun_channel_item_get_program (item);
+  self->selected_frequency = hdhomerun_channel_item_get_result (item)->frequency;
+  self->selected_program = program ? program->program_number : 0;
+
+  hdhomerun_tuner_tune (self->tuner, self->selected_frequency, self->selected_program);
+}
+
+/**
+ * hdhomerun_tuner_controller_get_selected:
+ * @self: a #HdhomerunTunerController
+ *
+ * Find the channel picked last, which moves as scans and the stream
+ * fill in the store.
+ *
+ * Returns: its position in the channel store, or %G_MAXUINT
+ */
+guint
+hdhomerun_tuner_controller_get_selected (HdhomerunTunerController *self)
+{
+  guint n_items;
+
+  g_return_val_if_fail (HDHOMERUN_IS_TUNER_CONTROLLER (self), G_MAXUINT);
+
+  if (self->selected_frequency == 0)
+    return G_MAXUINT;
+
+  n_items = g_list_model_get_n_items (G_LIST_MODEL (self->channels));
+  for (guint i = 0; i < n_items; i++)
+    {
+      g_autoptr(HdhomerunChannelItem) row = g_list_model_get_item (G_LIST_MODEL (self->channels), i);
+      const HdhomerunScanProgram *program = hdhomerun_channel_item_get_program (row);
+
+      if (hdhomerun_channel_item_get_result (row)->frequency == self->selected_frequency &&
+          (program ? program->program_number : 0) == self->selected_program)
+        return i;
+    }
+
+  return G_MAXUINT;
+}
+
+/**
+ * hdhomerun_tuner_controller_tune:
+ * @self: a #HdhomerunTunerController
+ * @frequency: in Hz
+ *
+ * Tune a frequency that is not in the channel store, leaving the picked
+ * channel alone.
+ */
+void
+hdhomerun_tuner_controller_tune (HdhomerunTunerController *self,
+                                 guint32                   frequency)
+{
+  g_return_if_fail (HDHOMERUN_IS_TUNER_CONTROLLER (self));
+
+  hdhomerun_tuner_tune (self->tuner, frequency, 0);
+}
+
+HdhomerunTuneState
+hdhomerun_tuner_controller_get_state (HdhomerunTunerController *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_TUNER_CONTROLLER (self), HDHOMERUN_TUNE_STATE_IDLE);
+
+  return self->state;
+}
+
+/**
+ * hdhomerun_tuner_controller_get_signal:
+ * @self: a #HdhomerunTunerController
+ * @signal_strength: (out) (optional): percent
+ * @signal_quality: (out) (optional): signal to noise, percent
+ *
+ * Get how the tuner locked, as reported when it did.
+ *
+ * Returns: the locked frequency in Hz, or 0 unless the tuner is locked
+ */
+guint32
+hdhomerun_tuner_controller_get_signal (HdhomerunTunerController *self,
+                                       guint                    *signal_strength,
+                                       guint                    *signal_quality)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_TUNER_CONTROLLER (self), 0);
+
+  if (self->state != HDHOMERUN_TUNE_STATE_LOCKED)
+    return 0;
+
+  if (signal_strength != NULL)
+    *signal_strength = self->signal_strength;
+  if (signal_quality != NULL)
+    *signal_quality = self->signal_quality;
+
+  return self->tuned_frequency;
+}
+
+/**
+ * hdhomerun_tuner_controller_set_playing:
+ * @self: a #HdhomerunTunerController
+ * @playing: whether to stream the tuner
+ *
+ * #HdhomerunTunerController:stream is set once the stream is running.
+ */
+void
+hdhomerun_tuner_controller_set_playing (HdhomerunTunerController *self,
+                                        gboolean                  playing)
+{
+  g_return_if_fail (HDHOMERUN_IS_TUNER_CONTROLLER (self));
+
+  playing = !!playing;
+  if (self->playing == playing)
+    return;
+
+  set_playing (self, playing);
+  if (playing)
+    start_stream (self);
+  else
+    stop_stream (self);
+}
+
+gboolean
+hdhomerun_tuner_controller_get_playing (HdhomerunTunerController *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_TUNER_CONTROLLER (self), FALSE);
+
+  return self->playing;
+}
+
+/**
+ * hdhomerun_tuner_controller_set_previewed:
+ * @self: a #HdhomerunTunerController
+ * @previewed: whether something reads the stream
+ *
+ * A stream nobody reads only feeds its demuxer and any recording, rather
+ * than filling its ring and counting drops.
+ */
+void
+hdhomerun_tuner_controller_set_previewed (HdhomerunTunerController *self,
+                                          gboolean                  previewed)
+{
+  g_return_if_fail (HDHOMERUN_IS_TUNER_CONTROLLER (self));
+
+  self->previewed = !!previewed;
+  if (self->stream != NULL)
+    hdhomerun_stream_set_reading (self->stream, self->previewed);
+}
+
+/**
+ * hdhomerun_tuner_controller_get_stream:
+ * @self: a #HdhomerunTunerController
+ *
+ * Returns: (transfer none) (nullable): the running stream while playing
+ */
+HdhomerunStream *
+hdhomerun_tuner_controller_get_stream (HdhomerunTunerController *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_TUNER_CONTROLLER (self), NULL);
+
+  return self->stream_ready ? self->stream : NULL;
+}
+
+/**
+ * hdhomerun_tuner_controller_get_demux:
+ * @self: a #HdhomerunTunerController
+ *
+ * Get the demuxer of the stream, which is replaced every time the tuner
+ * locks; see #HdhomerunTunerController:demux.
+ *
+ * Returns: (transfer none) (nullable): the demuxer
+ */
+HdhomerunTsDemux *
+hdhomerun_tuner_controller_get_demux (HdhomerunTunerController *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_TUNER_CONTROLLER (self), NULL);
+
+  return self->demux;
+}
+
+/**
+ * hdhomerun_tuner_controller_set_publish_address:
+ * @self: a #HdhomerunTunerController
+ * @address: (nullable): an IPv4 multicast group and port, or %NULL
+ *
+ * Re-publish the stream of the tuner to @address whenever it runs, for
+ * other hosts on the local network, or stop publishing it.
+ */
+void
+hdhomerun_tuner_controller_set_publish_address (HdhomerunTunerController *self,
+                                                GInetSocketAddress       *address)
+{
+  HdhomerunStream *stream;
+
+  g_return_if_fail (HDHOMERUN_IS_TUNER_CONTROLLER (self));
+  g_return_if_fail (address == NULL || G_IS_INET_SOCKET_ADDRESS (address));
+
+  if (!g_set_object (&self->publish_address, address))
+    return;
+
+  if (address != NULL)
+    {
+      g_autofree char *name = g_socket_connectable_to_string (G_SOCKET_CONNECTABLE (address));
+
+      g_message ("Publishing %s tuner %u to %s", self->device->device_id_str,
+                 self->tuner_index, name);
+    }
+
+  stream = self->recorder != NULL ? hdhomerun_recorder_get_stream (self->recorder) : self->stream;
+  if (stream != NULL)
+    publish_stream (self, stream);
+}
+
+static void
+on_record_stream_started (GObject      *source,
+                          GAsyncResult *result,
+                          gpointer      user_data)
+{
+  HdhomerunStream *stream = HDHOMERUN_STREAM (source);
+  HdhomerunTunerController *self;
+  g_autoptr(GError) error = NULL;
+
+  if (hdhomerun_stream_start_finish (stream, result, &error) ||
+      g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    return;
+
+  self = HDHOMERUN_TUNER_CONTROLLER (user_data);
+  g_warning ("Failed to start recording: %s", error->message);
+
+  if (self->recorder != NULL && hdhomerun_recorder_get_stream (self->recorder) == stream)
+    hdhomerun_tuner_controller_stop_recording (self);
+}
+
+static char *
+build_recording_path (HdhomerunTunerController *self)
+{
+  g_autoptr(GDateTime) now = g_date_time_new_now_local ();
+  g_autofree char *stamp = g_date_time_format (now, "%Y%m%d-%H%M%S");
+  g_autofree char *name = NULL;
+  const char *dir;
+
+  dir = g_get_user_special_dir (G_USER_DIRECTORY_VIDEOS);
+  if (dir == NULL)
+    dir = g_get_home_dir ();
+
+  name = g_strdup_printf ("%s-tuner%u-%s.ts", self->device->device_id_str,
+                          self->tuner_index, stamp);
+
+  return g_build_filename (dir, name, NULL);
+}
+
+/**
+ * hdhomerun_tuner_controller_start_recording:
+ * @self: a #HdhomerunTunerController
+ * @error: return location for a #GError
+ *
+ * Record what is being played into the user's videos directory, or
+ * start a stream nobody reads when nothing is.
+ *
+ * Returns: %TRUE if the recording started
+ */
+gboolean
+hdhomerun_tuner_controller_start_recording (HdhomerunTunerController  *self,
+                                            GError                   **error)
+{
+  g_autoptr(HdhomerunStream) stream = NULL;
+  g_autofree char *path = NULL;
+
+  g_return_val_if_fail (HDHOMERUN_IS_TUNER_CONTROLLER (self), FALSE);
+  g_return_val_if_fail (self->recorder == NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (self->stream != NULL)
+    {
+      stream = g_object_ref (self->stream);
+    }
+  else
+    {
+      stream = create_stream (self);
+      hdhomerun_stream_set_reading (stream, FALSE);
+      hdhomerun_stream_start_async (stream, self->cancellable, on_record_stream_started, self);
+    }
+
+  path = build_recording_path (self);
+  self->recorder = hdhomerun_recorder_new (stream, path, error);
+  if (self->recorder == NULL)
+    {
+      if (stream != self->stream)
+        hdhomerun_stream_stop (stream);
+      return FALSE;
+    }
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_RECORDING]);
+
+  return TRUE;
+}
+
+/**
+ * hdhomerun_tuner_controller_stop_recording:
+ * @self: a #HdhomerunTunerController
+ *
+ * Finish the recording, if there is one. Its stream keeps running while
+ * it is also being played.
+ */
+void
+hdhomerun_tuner_controller_stop_recording (HdhomerunTunerController *self)
+{
+  g_autoptr(HdhomerunRecorder) recorder = NULL;
+  g_autoptr(GError) error = NULL;
+  HdhomerunStream *stream;
+
+  g_return_if_fail (HDHOMERUN_IS_TUNER_CONTROLLER (self));
+
+  recorder = g_steal_pointer (&self->recorder);
+  if (recorder == NULL)
+    return;
+
+  if (!hdhomerun_recorder_stop (recorder, &error))
+    g_warning ("Recording failed: %s", error->message);
+  else
+    g_message ("Saved %s (%.1f MB)", hdhomerun_recorder_get_path (recorder),
+               hdhomerun_recorder_get_bytes_written (recorder) / 1e6);
+
+  stream = hdhomerun_recorder_get_stream (recorder);
+  if (stream != self->stream)
+    hdhomerun_stream_stop (stream);
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_RECORDING]);
+}
+
+/**
+ * hdhomerun_tuner_controller_get_recorder:
+ * @self: a #HdhomerunTunerController
+ *
+ * Returns: (transfer none) (nullable): the running recording
+ */
+HdhomerunRecorder *
+hdhomerun_tuner_controller_get_recorder (HdhomerunTunerController *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_TUNER_CONTROLLER (self), NULL);
+
+  return self->recorder;
+}
+
+static void
+on_frequency_scanned (HdhomerunChannelScan      *scan,
+                      const HdhomerunScanResult *result,
+                      HdhomerunTunerController  *self)
+{
+  (void)scan; /* unused */
+
+  hdhomerun_channel_store_set_result (self->channels, (HdhomerunScanResult *) result);
+}
+
+static void
+on_scan_progress (HdhomerunChannelScan     *scan,
+                  GParamSpec               *pspec,
+                  HdhomerunTunerController *self)
+{
+  (void)scan; /* unused */
+  (void)pspec; /* unused */
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_SCAN_PROGRESS]);
+}
+
+static void
+clear_scan (HdhomerunTunerController *self)
+{
+  if (self->scan)
+    g_signal_handlers_disconnect_by_data (self->scan, self);
+
+  g_clear_object (&self->scan);
+  g_clear_object (&self->scan_cancellable);
+}
+
+static void
+on_scan_saved (GObject      *source,
+               GAsyncResult *result,
+               gpointer      user_data)
+{
+  g_autoptr(GError) error = NULL;
+
+  (void)source; /* unused */
+  (void)user_data; /* unused */
+
+  if (!hdhomerun_scan_cache_save_finish (result, &error))
+    g_warning ("Failed to save scan results: %s", error->message);
+}
+
+static void
+on_scan_finished (GObject      *source,
+                  GAsyncResult *result,
+                  gpointer      user_data)
+{
+  g_autoptr(HdhomerunTunerController) self = user_data;
+  HdhomerunChannelScan *scan = HDHOMERUN_CHANNEL_SCAN (source);
+  g_autoptr(GPtrArray) results = NULL;
+  g_autoptr(GError) error = NULL;
+
+  if (!hdhomerun_channel_scan_run_finish (scan, result, &error) &&
+      !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    g_warning ("Channel scan failed: %s", error->message);
+
+  /* Whoever waits on the progress reads it when the scan is cleared */
+  g_clear_error (&self->scan_error);
+  self->scan_error = g_steal_pointer (&error);
+
+  /* Saved even when interrupted, so the next scan resumes */
+  results = hdhomerun_channel_scan_get_results (scan);
+  if (results->len > 0)
+    hdhomerun_scan_cache_save_async (self->device->device_id_str, results,
+                                     NULL, on_scan_saved, NULL);
+
+  /* Already torn down if the controller was disposed */
+  if (self->scan != NULL)
+    {
+      clear_scan (self);
+      g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_SCAN_PROGRESS]);
+    }
+
+  g_message ("Channel scan finished");
+}
+
+/**
+ * hdhomerun_tuner_controller_start_scan:
+ * @self: a #HdhomerunTunerController
+ *
+ * Scan for channels with every idle tuner of the device, resuming from
+ * the scan cache. Results go into the channel store as they come in.
+ */
+void
+hdhomerun_tuner_controller_start_scan (HdhomerunTunerController *self)
+{
+  HdhomerunConnectionPool *pool = hdhomerun_connection_pool_get_default ();
+  g_autoptr(GPtrArray) known = NULL;
+  g_autoptr(GError) error = NULL;
+
+  g_return_if_fail (HDHOMERUN_IS_TUNER_CONTROLLER (self));
+
+  if (self->scan != NULL)
+    return;
+
+  g_clear_error (&self->scan_error);
+
+  /* Every tuner on the device is offered, only idle ones take part */
+  self->scan = hdhomerun_channel_scan_new ();
+  for (guint i = 0; i < self->device->tuner_count; i++)
+    {
+      HdhomerunConnection *connection;
+
+      connection = hdhomerun_connection_pool_acquire (pool, self->device->device_id_str, i,
+                                                      self->device->control_address);
+      hdhomerun_channel_scan_add_tuner (self->scan, connection);
+      hdhomerun_connection_pool_release (pool, connection);
+    }
+
+  known = hdhomerun_scan_cache_load (self->device->device_id_str, &error);
+  if (known != NULL)
+    hdhomerun_channel_scan_add_known_results (self->scan, known);
+  else if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+    g_message ("Ignoring scan cache: %s", error->message);
+
+  g_signal_connect (self->scan, "frequency-scanned",
+                    G_CALLBACK (on_frequency_scanned), self);
+  g_signal_connect (self->scan, "notify::progress",
+                    G_CALLBACK (on_scan_progress), self);
+
+  self->scan_cancellable = g_cancellable_new ();
+  hdhomerun_channel_scan_run_async (self->scan, self->scan_cancellable,
+                                    on_scan_finished, g_object_ref (self));
+  g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_SCAN_PROGRESS]);
+  g_message ("Starting channel scan");
+}
+
+void
+hdhomerun_tuner_controller_cancel_scan (HdhomerunTunerController *self)
+{
+  g_return_if_fail (HDHOMERUN_IS_TUNER_CONTROLLER (self));
+
+  g_cancellable_cancel (self->scan_cancellable);
+}
+
+/**
+ * hdhomerun_tuner_controller_get_scan_error:
+ * @self: a #HdhomerunTunerController
+ *
+ * Returns: (nullable): why the last scan failed or was cancelled, or
+ *   %NULL if it succeeded or none has finished
+ */
+const GError *
+hdhomerun_tuner_controller_get_scan_error (HdhomerunTunerController *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_TUNER_CONTROLLER (self), NULL);
+
+  return self->scan_error;
+}
+
+/**
+ * hdhomerun_tuner_controller_get_scan_progress:
+ * @self: a #HdhomerunTunerController
+ *
+ * Returns: how far the scan is, from 0 to 1, or -1 when not scanning
+ */
+double
+hdhomerun_tuner_controller_get_scan_progress (HdhomerunTunerController *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_TUNER_CONTROLLER (self), -1);
+
+  if (self->scan == NULL)
+    return -1;
+
+  return hdhomerun_channel_scan_get_progress (self->scan);
+}
+
+static void
+hdhomerun_tuner_controller_dispose (GObject *object)
+{
+  HdhomerunTunerController *self = (HdhomerunTunerController *)object;
+
+  g_cancellable_cancel (self->cancellable);
+  g_cancellable_cancel (self->scan_cancellable);
+  stop_stream (self);
+  if (self->recorder != NULL)
+    hdhomerun_tuner_controller_stop_recording (self);
+  clear_scan (self);
+
+  if (self->tuner)
+    g_signal_handlers_disconnect_by_data (self->tuner, self);
+  g_clear_object (&self->tuner);
+  g_clear_pointer (&self->demux, hdhomerun_ts_demux_unref);
+  g_clear_object (&self->publish_address);
+
+  if (self->connection)
+    hdhomerun_connection_pool_release (hdhomerun_connection_pool_get_default (),
+                                       g_steal_pointer (&self->connection));
+
+  G_OBJECT_CLASS (hdhomerun_tuner_controller_parent_class)->dispose (object);
+}
+
+static void
+hdhomerun_tuner_controller_finalize (GObject *object)
+{
+  HdhomerunTunerController *self = (HdhomerunTunerController *)object;
+
+  g_clear_object (&self->cancellable);
+  g_clear_object (&self->channels);
+  g_clear_error (&self->scan_error);
+  g_clear_pointer (&self->device, hdhomerun_device_info_unref);
+
+  G_OBJECT_CLASS (hdhomerun_tuner_controller_parent_class)->finalize (object);
+}
+
+static void
+hdhomerun_tuner_controller_get_property (GObject    *object,
+                                         guint       prop_id,
+                                         GValue     *value,
+                                         GParamSpec *pspec)
+{
+  HdhomerunTunerController *self = HDHOMERUN_TUNER_CONTROLLER (object);
+
+  switch (prop_id)
+    {
+    case PROP_STATE:
+      g_value_set_enum (value, self->state);
+      break;
+    case PROP_PLAYING:
+      g_value_set_boolean (value, self->playing);
+      break;
+    case PROP_STREAM:
+      g_value_set_object (value, hdhomerun_tuner_controller_get_stream (self));
+      break;
+    case PROP_DEMUX:
+      g_value_set_pointer (value, self->demux);
+      break;
+    case PROP_RECORDING:
+      g_value_set_boolean (value, self->recorder != NULL);
+      break;
+    case PROP_SCAN_PROGRESS:
+      g_value_set_double (value, hdhomerun_tuner_controller_get_scan_progress (self));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+hdhomerun_tuner_controller_set_property (GObject      *object,
+                                         guint         prop_id,
+                                         const GValue *value,
+                                         GParamSpec   *pspec)
+{
+  HdhomerunTunerController *self = HDHOMERUN_TUNER_CONTROLLER (object);
+
+  switch (prop_id)
+    {
+    case PROP_PLAYING:
+      hdhomerun_tuner_controller_set_playing (self, g_value_get_boolean (value));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+hdhomerun_tuner_controller_class_init (HdhomerunTunerControllerClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = hdhomerun_tuner_controller_dispose;
+  object_class->finalize = hdhomerun_tuner_controller_finalize;
+  object_class->get_property = hdhomerun_tuner_controller_get_property;
+  object_class->set_property = hdhomerun_tuner_controller_set_property;
+
+  properties [PROP_STATE] =
+    g_param_spec_enum ("state",
+                       "State",
+                       "Where the latest tune is, notified again with every lock",
+                       HDHOMERUN_TYPE_TUNE_STATE,
+                       HDHOMERUN_TUNE_STATE_IDLE,
+                       (G_PARAM_READABLE |
+                        G_PARAM_EXPLICIT_NOTIFY |
+                        G_PARAM_STATIC_STRINGS));
+
+  properties [PROP_PLAYING] =
+    g_param_spec_boolean ("playing",
+                          "Playing",
+                          "Whether the tuner is being streamed",
+                          FALSE,
+                          (G_PARAM_READWRITE |
+                           G_PARAM_EXPLICIT_NOTIFY |
+                           G_PARAM_STATIC_STRINGS));
+
+  properties [PROP_STREAM] =
+    g_param_spec_object ("stream",
+                         "Stream",
+                         "The running stream while playing",
+                         HDHOMERUN_TYPE_STREAM,
+                         (G_PARAM_READABLE |
+                          G_PARAM_EXPLICIT_NOTIFY |
+                          G_PARAM_STATIC_STRINGS));
+
+  properties [PROP_DEMUX] =
+    g_param_spec_pointer ("demux",
+                          "Demux",
+                          "The HdhomerunTsDemux of the stream",
+                          (G_PARAM_READABLE |
+                           G_PARAM_EXPLICIT_NOTIFY |
+                           G_PARAM_STATIC_STRINGS));
+
+  properties [PROP_RECORDING] =
+    g_param_spec_boolean ("recording",
+                          "Recording",
+                          "Whether the tuner is being recorded",
+                          FALSE,
+                          (G_PARAM_READABLE |
+                           G_PARAM_EXPLICIT_NOTIFY |
+                           G_PARAM_STATIC_STRINGS));
+
+  properties [PROP_SCAN_PROGRESS] =
+    g_param_spec_double ("scan-progress",
+                         "Scan Progress",
+                         "How far the channel scan is, or -1 when not scanning",
+                         -1, 1, -1,
+                         (G_PARAM_READABLE |
+                          G_PARAM_EXPLICIT_NOTIFY |
+                          G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_properties (object_class, N_PROPS, properties);
+}
+
+static void
+hdhomerun_tuner_controller_init (HdhomerunTunerController *self)
+{
+  self->state = HDHOMERUN_TUNE_STATE_IDLE;
+  self->previewed = TRUE;
+  self->cancellable = g_cancellable_new ();
+}
@@ -0,0 +1,78 @@
+/* hdhomerun-tuner-controller.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "hdhomerun-channel-item.h"
+#include "hdhomerun-channel-store.h"
+#include "hdhomerun-discovery.h"
+#include "hdhomerun-recorder.h"
+#include "hdhomerun-stream.h"
+#include "hdhomerun-ts-demux.h"
+#include "hdhomerun-tuner.h"
+
+G_BEGIN_DECLS
+
+#define HDHOMERUN_TYPE_TUNER_CONTROLLER (hdhomerun_tuner_controller_get_type())
+
+G_DECLARE_FINAL_TYPE (HdhomerunTunerController, hdhomerun_tuner_controller, HDHOMERUN, TUNER_CONTROLLER, GObject)
+
+HdhomerunTunerController  *hdhomerun_tuner_controller_new             (const HdhomerunDeviceInfo *info,
+                                                                        guint                      tuner_index,
+                                                                        HdhomerunChannelStore     *channels);
+void                       hdhomerun_tuner_controller_update_device   (HdhomerunTunerController  *self,
+                                                                        const HdhomerunDeviceInfo *info);
+const HdhomerunDeviceInfo *hdhomerun_tuner_controller_get_device      (HdhomerunTunerController  *self);
+guint                      hdhomerun_tuner_controller_get_tuner_index (HdhomerunTunerController  *self);
+HdhomerunChannelStore     *hdhomerun_tuner_controller_get_channels    (HdhomerunTunerController  *self);
+
+void                       hdhomerun_tuner_controller_select_channel  (HdhomerunTunerController  *self,
+                                                                        HdhomerunChannelItem      *item);
+guint                      hdhomerun_tuner_controller_get_selected    (HdhomerunTunerController  *self);
+void                       hdhomerun_tuner_controller_tune            (HdhomerunTunerController  *self,
+                                                                        guint32                    frequency);
+HdhomerunTuneState         hdhomerun_tuner_controller_get_state       (HdhomerunTunerController  *self);
+guint32                    hdhomerun_tuner_controller_get_signal      (HdhomerunTunerController  *self,
+                                                                        guint                     *signal_strength,
+                                                                        guint                     *signal_quality);
+
+void                       hdhomerun_tuner_controller_set_playing     (HdhomerunTunerController  *self,
+                                                                        gboolean                   playing);
+gboolean                   hdhomerun_tuner_controller_get_playing     (HdhomerunTunerController  *self);
+void                       hdhomerun_tuner_controller_set_previewed   (HdhomerunTunerController  *self,
+                                                                        gboolean                   previewed);
+HdhomerunStream           *hdhomerun_tuner_controller_get_stream      (HdhomerunTunerController  *self);
+HdhomerunTsDemux          *hdhomerun_tuner_controller_get_demux       (HdhomerunTunerController  *self);
+void                       hdhomerun_tuner_controller_set_publish_address
+                                                                       (HdhomerunTunerController  *self,
+                                                                        GInetSocketAddress        *address);
+
+gboolean                   hdhomerun_tuner_controller_start_recording (HdhomerunTunerController  *self,
+                                                                        GError                   **error);
+void                       hdhomerun_tuner_controller_stop_recording  (HdhomerunTunerController  *self);
+HdhomerunRecorder         *hdhomerun_tuner_controller_get_recorder    (HdhomerunTunerController  *self);
+
+void                       hdhomerun_tuner_controller_start_scan      (HdhomerunTunerController  *self);
+void                       hdhomerun_tuner_controller_cancel_scan     (HdhomerunTunerController  *self);
+const GError              *hdhomerun_tuner_controller_get_scan_error  (HdhomerunTunerController  *self);
+double                     hdhomerun_tuner_controller_get_scan_progress
+                                                                       (HdhomerunTunerController  *self);
+
+G_END_DECLS
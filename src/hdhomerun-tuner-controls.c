@@ -17,36 +17,336 @@
  */
 
 #include "hdhomerun-tuner-controls.h"
+#include "hdhomerun-channel-item.h"
+#include "hdhomerun-channel-store.h"
+#include "hdhomerun-sparkline.h"
+#include "hdhomerun-trace.h"
+#include "hdhomerun-video-preview.h"
 #include <glib/gi18n.h>
 
+/* The tuner page is a view of whichever HdhomerunTunerController is
+ * selected. Everything about the tuner lives in the controller; the
+ * controls only show it and pass clicks on, so switching tuners is a
+ * rebind of the widgets below.
+ */
+
 struct _HdhomerunTunerControls
 {
   GtkBox parent_instance;
 
   /* Template widgets */
-  GtkDrawingArea *video_preview;
+  AdwBin *video_bin;
+  GtkLabel *placeholder_label;
   GtkButton *play_button;
   GtkButton *stop_button;
+  GtkButton *record_button;
   GtkButton *scan_button;
+  AdwActionRow *scan_row;
   GtkDropDown *channel_dropdown;
   GtkEntry *frequency_entry;
   GtkButton *tune_button;
+  AdwActionRow *tune_row;
+  HdhomerunSparkline *sparkline;
   
   /* State */
-  gboolean playing;
+  HdhomerunTunerController *controller;
+  HdhomerunChannelStore *channels;  /* The controller's, in the dropdown */
+  gboolean updating_channels;       /* Selection moves are not user picks */
+  HdhomerunVideoPreview *preview;
+  HdhomerunStatusPoller *poller;
 };
 
 G_DEFINE_FINAL_TYPE (HdhomerunTunerControls, hdhomerun_tuner_controls, GTK_TYPE_BOX)
 
+enum {
+  PROP_0,
+  PROP_DEMUX,
+  N_PROPS
+};
+
+static GParamSpec *properties [N_PROPS];
+
+/**
+ * hdhomerun_tuner_controls_get_demux:
+ * @self: a #HdhomerunTunerControls
+ *
+ * Get the demuxer of the shown tuner's stream, which is replaced every
+ * time the tuner locks; see #HdhomerunTunerControls:demux.
+ *
+ * Returns: (transfer none) (nullable): the demuxer
+ */
+HdhomerunTsDemux *
+hdhomerun_tuner_controls_get_demux (HdhomerunTunerControls *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_TUNER_CONTROLS (self), NULL);
+
+  if (self->controller == NULL)
+    return NULL;
+
+  return hdhomerun_tuner_controller_get_demux (self->controller);
+}
+
+static void
+on_preview_invalidated (GdkPaintable           *paintable,
+                        HdhomerunTunerControls *self)
+{
+  gtk_widget_set_visible (GTK_WIDGET (self->placeholder_label),
+                          !hdhomerun_video_preview_has_frame (HDHOMERUN_VIDEO_PREVIEW (paintable)));
+}
+
+/* The decoder and its picture are only set up for the first preview */
+static void
+ensure_preview (HdhomerunTunerControls *self)
+{
+  GtkWidget *picture;
+  gint64 trace;
+
+  if (self->preview != NULL)
+    return;
+
+  trace = hdhomerun_trace_begin ();
+
+  self->preview = hdhomerun_video_preview_new ();
+  g_signal_connect (self->preview, "invalidate-contents",
+                    G_CALLBACK (on_preview_invalidated), self);
+
+  picture = gtk_picture_new_for_paintable (GDK_PAINTABLE (self->preview));
+  gtk_picture_set_content_fit (GTK_PICTURE (picture), GTK_CONTENT_FIT_CONTAIN);
+
+#if GTK_CHECK_VERSION (4, 14, 0)
+  /* Only dmabuf frames are offloaded; others are composited as before */
+  adw_bin_set_child (self->video_bin, gtk_graphics_offload_new (picture));
+#else
+  adw_bin_set_child (self->video_bin, picture);
+#endif
+
+  hdhomerun_trace_end (trace, "create-preview", "HdhomerunVideoPreview");
+}
+
+static void
+update_preview (HdhomerunTunerControls *self)
+{
+  HdhomerunStream *stream = NULL;
+
+  if (self->controller != NULL)
+    stream = hdhomerun_tuner_controller_get_stream (self->controller);
+
+  if (stream != NULL)
+    ensure_preview (self);
+  if (self->preview != NULL)
+    hdhomerun_video_preview_set_stream (self->preview, stream);
+}
+
+static void
+update_playing (HdhomerunTunerControls *self)
+{
+  gboolean playing = FALSE;
+
+  if (self->controller != NULL)
+    playing = hdhomerun_tuner_controller_get_playing (self->controller);
+
+  gtk_widget_set_sensitive (GTK_WIDGET (self->play_button), !playing);
+  gtk_widget_set_sensitive (GTK_WIDGET (self->stop_button), playing);
+}
+
+static void
+update_record_button (HdhomerunTunerControls *self)
+{
+  gboolean recording = FALSE;
+
+  if (self->controller != NULL)
+    recording = hdhomerun_tuner_controller_get_recorder (self->controller) != NULL;
+
+  gtk_widget_set_tooltip_text (GTK_WIDGET (self->record_button),
+                               recording ? _("Stop Recording") : _("Record"));
+  if (recording)
+    gtk_widget_add_css_class (GTK_WIDGET (self->record_button), "destructive-action");
+  else
+    gtk_widget_remove_css_class (GTK_WIDGET (self->record_button), "destructive-action");
+}
+
+static void
+update_scan_row (HdhomerunTunerControls *self)
+{
+  g_autofree char *subtitle = NULL;
+  double progress = -1;
+
+  if (self->controller != NULL)
+    progress = hdhomerun_tuner_controller_get_scan_progress (self->controller);
+
+  if (progress < 0)
+    {
+      gtk_button_set_label (self->scan_button, _("Start Scan"));
+      adw_action_row_set_subtitle (self->scan_row, _("Search for available channels"));
+      return;
+    }
+
+  subtitle = g_strdup_printf (_("Scanning… %.0f%%"), 100.0 * progress);
+  gtk_button_set_label (self->scan_button, _("Cancel Scan"));
+  adw_action_row_set_subtitle (self->scan_row, subtitle);
+}
+
+static void
+update_tune_row (HdhomerunTunerControls *self)
+{
+  g_autofree char *subtitle = NULL;
+  guint signal_strength = 0;
+  guint signal_quality = 0;
+  guint32 frequency;
+
+  if (self->controller == NULL)
+    {
+      adw_action_row_set_subtitle (self->tune_row, "");
+      return;
+    }
+
+  switch (hdhomerun_tuner_controller_get_state (self->controller))
+    {
+    case HDHOMERUN_TUNE_STATE_LOCKING:
+      adw_action_row_set_subtitle (self->tune_row, _("Locking…"));
+      break;
+    case HDHOMERUN_TUNE_STATE_NO_LOCK:
+      adw_action_row_set_subtitle (self->tune_row, _("No signal"));
+      break;
+    case HDHOMERUN_TUNE_STATE_FAILED:
+      adw_action_row_set_subtitle (self->tune_row, _("Tuning failed"));
+      break;
+    case HDHOMERUN_TUNE_STATE_LOCKED:
+      frequency = hdhomerun_tuner_controller_get_signal (self->controller,
+                                                         &signal_strength, &signal_quality);
+      subtitle = g_strdup_printf (_("Locked at %.3f MHz, signal %u%%, SNR %u%%"),
+                                  frequency / 1e6, signal_strength, signal_quality);
+      adw_action_row_set_subtitle (self->tune_row, subtitle);
+      break;
+    case HDHOMERUN_TUNE_STATE_IDLE:
+    default:
+      adw_action_row_set_subtitle (self->tune_row, "");
+      break;
+    }
+}
+
+static void
+update_history (HdhomerunTunerControls *self)
+{
+  HdhomerunSignalHistory *history = NULL;
+
+  if (self->poller != NULL && self->controller != NULL)
+    {
+      const HdhomerunDeviceInfo *info = hdhomerun_tuner_controller_get_device (self->controller);
+
+      history = hdhomerun_status_poller_get_history (self->poller, info->device_id_str,
+                                                     hdhomerun_tuner_controller_get_tuner_index (self->controller));
+    }
+
+  hdhomerun_sparkline_set_history (self->sparkline, history);
+}
+
+/* Put the dropdown back on the controller's channel, wherever the store
+ * has moved it.
+ */
+static void
+sync_selection (HdhomerunTunerControls *self)
+{
+  guint position = GTK_INVALID_LIST_POSITION;
+
+  if (self->controller != NULL)
+    position = hdhomerun_tuner_controller_get_selected (self->controller);
+
+  self->updating_channels = TRUE;
+  gtk_drop_down_set_selected (self->channel_dropdown,
+                              position == G_MAXUINT ? GTK_INVALID_LIST_POSITION : position);
+  self->updating_channels = FALSE;
+}
+
+/* Connected before the dropdown's own handlers, so whatever it does to
+ * the selection while the store changes is not taken as a pick.
+ */
+static void
+on_channels_changing (GListModel             *model,
+                      guint                   position,
+                      guint                   removed,
+                      guint                   added,
+                      HdhomerunTunerControls *self)
+{
+  (void)model; /* unused */
+  (void)position; /* unused */
+  (void)removed; /* unused */
+  (void)added; /* unused */
+
+  self->updating_channels = TRUE;
+}
+
+static void
+on_channels_changed (GListModel             *model,
+                     guint                   position,
+                     guint                   removed,
+                     guint                   added,
+                     HdhomerunTunerControls *self)
+{
+  (void)model; /* unused */
+  (void)position; /* unused */
+  (void)removed; /* unused */
+  (void)added; /* unused */
+
+  sync_selection (self);
+}
+
+static void
+set_channels (HdhomerunTunerControls *self,
+              HdhomerunChannelStore  *channels)
+{
+  if (self->channels == channels)
+    return;
+
+  if (self->channels != NULL)
+    g_signal_handlers_disconnect_by_data (self->channels, self);
+  g_set_object (&self->channels, channels);
+  if (self->channels != NULL)
+    {
+      g_signal_connect (self->channels, "items-changed",
+                        G_CALLBACK (on_channels_changing), self);
+      g_signal_connect_after (self->channels, "items-changed",
+                              G_CALLBACK (on_channels_changed), self);
+    }
+
+  self->updating_channels = TRUE;
+  gtk_drop_down_set_model (self->channel_dropdown, G_LIST_MODEL (self->channels));
+  self->updating_channels = FALSE;
+}
+
+static void
+on_record_clicked (GtkButton *button,
+                   HdhomerunTunerControls *self)
+{
+  g_autoptr(GError) error = NULL;
+
+  (void)button; /* unused */
+
+  if (self->controller == NULL)
+    {
+      g_message ("No tuner selected");
+      return;
+    }
+
+  if (hdhomerun_tuner_controller_get_recorder (self->controller) != NULL)
+    hdhomerun_tuner_controller_stop_recording (self->controller);
+  else if (!hdhomerun_tuner_controller_start_recording (self->controller, &error))
+    g_warning ("Failed to start recording: %s", error->message);
+}
+
 static void
 on_play_clicked (GtkButton *button,
                  HdhomerunTunerControls *self)
 {
   (void)button; /* unused */
-  
-  self->playing = TRUE;
-  gtk_widget_set_sensitive (GTK_WIDGET (self->play_button), FALSE);
-  gtk_widget_set_sensitive (GTK_WIDGET (self->stop_button), TRUE);
+
+  if (self->controller == NULL)
+    {
+      g_message ("No tuner selected");
+      return;
+    }
+
+  hdhomerun_tuner_controller_set_playing (self->controller, TRUE);
   g_message ("Starting playback");
 }
 
@@ -55,10 +355,9 @@ on_stop_clicked (GtkButton *button,
                  HdhomerunTunerControls *self)
 {
   (void)button; /* unused */
-  
-  self->playing = FALSE;
-  gtk_widget_set_sensitive (GTK_WIDGET (self->play_button), TRUE);
-  gtk_widget_set_sensitive (GTK_WIDGET (self->stop_button), FALSE);
+
+  if (self->controller != NULL)
+    hdhomerun_tuner_controller_set_playing (self->controller, FALSE);
   g_message ("Stopping playback");
 }
 
@@ -67,24 +366,41 @@ on_scan_clicked (GtkButton *button,
                  HdhomerunTunerControls *self)
 {
   (void)button; /* unused */
-  (void)self; /* unused */
-  
-  g_message ("Starting channel scan");
+
+  if (self->controller == NULL)
+    {
+      g_message ("No tuner selected");
+      return;
+    }
+
+  if (hdhomerun_tuner_controller_get_scan_progress (self->controller) >= 0)
+    hdhomerun_tuner_controller_cancel_scan (self->controller);
+  else
+    hdhomerun_tuner_controller_start_scan (self->controller);
 }
 
-static gboolean
-is_valid_frequency_string (const char *str)
+static void
+tune_selected_channel (HdhomerunTunerControls *self)
 {
-  if (!str || !*str)
-    return FALSE;
-  
-  /* Check that the string contains only digits, decimal point, and whitespace */
-  for (const char *p = str; *p; p++) {
-    if (!g_ascii_isdigit (*p) && *p != '.' && *p != ' ')
-      return FALSE;
-  }
-  
-  return TRUE;
+  HdhomerunChannelItem *item;
+
+  item = gtk_drop_down_get_selected_item (self->channel_dropdown);
+  if (item == NULL || self->controller == NULL)
+    return;
+
+  hdhomerun_tuner_controller_select_channel (self->controller, item);
+}
+
+static void
+on_channel_selected (GtkDropDown            *dropdown,
+                     GParamSpec             *pspec,
+                     HdhomerunTunerControls *self)
+{
+  (void)dropdown; /* unused */
+  (void)pspec; /* unused */
+
+  if (!self->updating_channels)
+    tune_selected_channel (self);
 }
 
 static void
@@ -92,34 +408,309 @@ on_tune_clicked (GtkButton *button,
                  HdhomerunTunerControls *self)
 {
   const char *frequency;
+  guint position;
+  guint32 hz;
   
   (void)button; /* unused */
+
+  if (self->controller == NULL)
+    {
+      g_message ("No tuner selected");
+      return;
+    }
   
   frequency = gtk_editable_get_text (GTK_EDITABLE (self->frequency_entry));
+
+  /* A known channel, callsign or frequency tunes the scanned channel */
+  position = hdhomerun_channel_store_find (self->channels, frequency);
+  if (position != G_MAXUINT)
+    {
+      if (gtk_drop_down_get_selected (self->channel_dropdown) == position)
+        tune_selected_channel (self);
+      else
+        gtk_drop_down_set_selected (self->channel_dropdown, position);
+      return;
+    }
   
-  /* Validate frequency input to prevent format string issues */
-  if (is_valid_frequency_string (frequency)) {
-    g_message ("Tuning to frequency: %s", frequency);
-  } else {
-    g_message ("Invalid or empty frequency entered");
-  }
+  if (!hdhomerun_tuner_parse_frequency (frequency, &hz))
+    {
+      g_message ("Invalid or empty frequency entered");
+      return;
+    }
+
+  hdhomerun_tuner_controller_tune (self->controller, hz);
+}
+
+static void
+on_sampled (HdhomerunStatusPoller  *poller,
+            const char             *device_id,
+            guint                   tuner_index,
+            HdhomerunTunerControls *self)
+{
+  (void)poller; /* unused */
+
+  if (self->controller != NULL &&
+      tuner_index == hdhomerun_tuner_controller_get_tuner_index (self->controller) &&
+      g_str_equal (device_id, hdhomerun_tuner_controller_get_device (self->controller)->device_id_str))
+    hdhomerun_sparkline_update (self->sparkline);
+}
+
+static void
+on_state_changed (HdhomerunTunerController *controller,
+                  GParamSpec               *pspec,
+                  HdhomerunTunerControls   *self)
+{
+  (void)controller; /* unused */
+  (void)pspec; /* unused */
+
+  update_tune_row (self);
+}
+
+static void
+on_playing_changed (HdhomerunTunerController *controller,
+                    GParamSpec               *pspec,
+                    HdhomerunTunerControls   *self)
+{
+  (void)controller; /* unused */
+  (void)pspec; /* unused */
+
+  update_playing (self);
+}
+
+static void
+on_stream_changed (HdhomerunTunerController *controller,
+                   GParamSpec               *pspec,
+                   HdhomerunTunerControls   *self)
+{
+  (void)controller; /* unused */
+  (void)pspec; /* unused */
+
+  update_preview (self);
+}
+
+static void
+on_demux_changed (HdhomerunTunerController *controller,
+                  GParamSpec               *pspec,
+                  HdhomerunTunerControls   *self)
+{
+  (void)controller; /* unused */
+  (void)pspec; /* unused */
+
+  g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_DEMUX]);
+}
+
+static void
+on_recording_changed (HdhomerunTunerController *controller,
+                      GParamSpec               *pspec,
+                      HdhomerunTunerControls   *self)
+{
+  (void)controller; /* unused */
+  (void)pspec; /* unused */
+
+  update_record_button (self);
+}
+
+static void
+on_scan_progress_changed (HdhomerunTunerController *controller,
+                          GParamSpec               *pspec,
+                          HdhomerunTunerControls   *self)
+{
+  (void)controller; /* unused */
+  (void)pspec; /* unused */
+
+  update_scan_row (self);
+}
+
+HdhomerunTunerControls *
+hdhomerun_tuner_controls_new (void)
+{
+  return g_object_new (HDHOMERUN_TYPE_TUNER_CONTROLS, NULL);
+}
+
+/**
+ * hdhomerun_tuner_controls_set_status_poller:
+ * @self: a #HdhomerunTunerControls
+ * @poller: (nullable): where signal history comes from
+ *
+ * The shown tuner needs to be watched on @poller for its history to
+ * fill in.
+ */
+void
+hdhomerun_tuner_controls_set_status_poller (HdhomerunTunerControls *self,
+                                            HdhomerunStatusPoller  *poller)
+{
+  g_return_if_fail (HDHOMERUN_IS_TUNER_CONTROLS (self));
+
+  if (self->poller == poller)
+    return;
+
+  if (self->poller)
+    g_signal_handlers_disconnect_by_func (self->poller, on_sampled, self);
+  g_set_object (&self->poller, poller);
+  if (self->poller)
+    g_signal_connect (self->poller, "sampled", G_CALLBACK (on_sampled), self);
+
+  update_history (self);
+}
+
+/**
+ * hdhomerun_tuner_controls_set_controller:
+ * @self: a #HdhomerunTunerControls
+ * @controller: (nullable): the tuner to show
+ *
+ * Show another tuner. The one left keeps its tune, stream and any
+ * recording or scan; only the preview stops reading its stream.
+ */
+void
+hdhomerun_tuner_controls_set_controller (HdhomerunTunerControls   *self,
+                                         HdhomerunTunerController *controller)
+{
+  gint64 trace;
+
+  g_return_if_fail (HDHOMERUN_IS_TUNER_CONTROLS (self));
+  g_return_if_fail (controller == NULL || HDHOMERUN_IS_TUNER_CONTROLLER (controller));
+
+  if (self->controller == controller)
+    return;
+
+  trace = hdhomerun_trace_begin ();
+
+  if (self->controller != NULL)
+    {
+      g_signal_handlers_disconnect_by_data (self->controller, self);
+      hdhomerun_tuner_controller_set_previewed (self->controller, FALSE);
+    }
+  g_set_object (&self->controller, controller);
+  if (self->controller != NULL)
+    {
+      hdhomerun_tuner_controller_set_previewed (self->controller, TRUE);
+      g_signal_connect (self->controller, "notify::state",
+                        G_CALLBACK (on_state_changed), self);
+      g_signal_connect (self->controller, "notify::playing",
+                        G_CALLBACK (on_playing_changed), self);
+      g_signal_connect (self->controller, "notify::stream",
+                        G_CALLBACK (on_stream_changed), self);
+      g_signal_connect (self->controller, "notify::demux",
+                        G_CALLBACK (on_demux_changed), self);
+      g_signal_connect (self->controller, "notify::recording",
+                        G_CALLBACK (on_recording_changed), self);
+      g_signal_connect (self->controller, "notify::scan-progress",
+                        G_CALLBACK (on_scan_progress_changed), self);
+    }
+
+  set_channels (self, self->controller ? hdhomerun_tuner_controller_get_channels (self->controller) : NULL);
+  sync_selection (self);
+  update_preview (self);
+  update_playing (self);
+  update_record_button (self);
+  update_scan_row (self);
+  update_tune_row (self);
+  update_history (self);
+  g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_DEMUX]);
+
+  hdhomerun_trace_end (trace, "bind-controller", "tuner %u",
+                       controller ? hdhomerun_tuner_controller_get_tuner_index (controller) : 0);
+}
+
+/**
+ * hdhomerun_tuner_controls_get_controller:
+ * @self: a #HdhomerunTunerControls
+ *
+ * Returns: (transfer none) (nullable): the tuner shown
+ */
+HdhomerunTunerController *
+hdhomerun_tuner_controls_get_controller (HdhomerunTunerControls *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_TUNER_CONTROLS (self), NULL);
+
+  return self->controller;
+}
+
+static void
+hdhomerun_tuner_controls_dispose (GObject *object)
+{
+  HdhomerunTunerControls *self = (HdhomerunTunerControls *)object;
+
+  if (self->controller != NULL)
+    {
+      g_signal_handlers_disconnect_by_data (self->controller, self);
+      hdhomerun_tuner_controller_set_previewed (self->controller, FALSE);
+    }
+  g_clear_object (&self->controller);
+
+  if (self->channels)
+    g_signal_handlers_disconnect_by_data (self->channels, self);
+  g_clear_object (&self->channels);
+
+  if (self->poller)
+    g_signal_handlers_disconnect_by_func (self->poller, on_sampled, self);
+  g_clear_object (&self->poller);
+
+  if (self->preview)
+    {
+      g_signal_handlers_disconnect_by_func (self->preview, on_preview_invalidated, self);
+      hdhomerun_video_preview_set_stream (self->preview, NULL);
+    }
+  g_clear_object (&self->preview);
+
+  G_OBJECT_CLASS (hdhomerun_tuner_controls_parent_class)->dispose (object);
+}
+
+static void
+hdhomerun_tuner_controls_get_property (GObject    *object,
+                                       guint       prop_id,
+                                       GValue     *value,
+                                       GParamSpec *pspec)
+{
+  HdhomerunTunerControls *self = HDHOMERUN_TUNER_CONTROLS (object);
+
+  switch (prop_id)
+    {
+    case PROP_DEMUX:
+      g_value_set_pointer (value, hdhomerun_tuner_controls_get_demux (self));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
 }
 
 static void
 hdhomerun_tuner_controls_class_init (HdhomerunTunerControlsClass *klass)
 {
   GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = hdhomerun_tuner_controls_dispose;
+  object_class->get_property = hdhomerun_tuner_controls_get_property;
+
+  properties [PROP_DEMUX] =
+    g_param_spec_pointer ("demux",
+                          "Demux",
+                          "The HdhomerunTsDemux of the shown tuner's stream",
+                          (G_PARAM_READABLE |
+                           G_PARAM_EXPLICIT_NOTIFY |
+                           G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_properties (object_class, N_PROPS, properties);
+
+  g_type_ensure (HDHOMERUN_TYPE_SPARKLINE);
 
   gtk_widget_class_set_template_from_resource (widget_class, "/com/github/andrewstclair/HDHomeRunConfig/hdhomerun-tuner-controls.ui");
-  gtk_widget_class_bind_template_child (widget_class, HdhomerunTunerControls, video_preview);
+  gtk_widget_class_bind_template_child (widget_class, HdhomerunTunerControls, video_bin);
+  gtk_widget_class_bind_template_child (widget_class, HdhomerunTunerControls, placeholder_label);
   gtk_widget_class_bind_template_child (widget_class, HdhomerunTunerControls, play_button);
   gtk_widget_class_bind_template_child (widget_class, HdhomerunTunerControls, stop_button);
+  gtk_widget_class_bind_template_child (widget_class, HdhomerunTunerControls, record_button);
   gtk_widget_class_bind_template_child (widget_class, HdhomerunTunerControls, scan_button);
+  gtk_widget_class_bind_template_child (widget_class, HdhomerunTunerControls, scan_row);
   gtk_widget_class_bind_template_child (widget_class, HdhomerunTunerControls, channel_dropdown);
   gtk_widget_class_bind_template_child (widget_class, HdhomerunTunerControls, frequency_entry);
   gtk_widget_class_bind_template_child (widget_class, HdhomerunTunerControls, tune_button);
+  gtk_widget_class_bind_template_child (widget_class, HdhomerunTunerControls, tune_row);
+  gtk_widget_class_bind_template_child (widget_class, HdhomerunTunerControls, sparkline);
   gtk_widget_class_bind_template_callback (widget_class, on_play_clicked);
   gtk_widget_class_bind_template_callback (widget_class, on_stop_clicked);
+  gtk_widget_class_bind_template_callback (widget_class, on_record_clicked);
   gtk_widget_class_bind_template_callback (widget_class, on_scan_clicked);
   gtk_widget_class_bind_template_callback (widget_class, on_tune_clicked);
 }
@@ -127,8 +718,22 @@ hdhomerun_tuner_controls_class_init (HdhomerunTunerControlsClass *klass)
 static void
 hdhomerun_tuner_controls_init (HdhomerunTunerControls *self)
 {
+  gint64 trace = hdhomerun_trace_begin ();
+
   gtk_widget_init_template (GTK_WIDGET (self));
+  hdhomerun_trace_end (trace, "init-template", "HdhomerunTunerControls");
   
-  self->playing = FALSE;
-  gtk_widget_set_sensitive (GTK_WIDGET (self->stop_button), FALSE);
+  update_playing (self);
+
+  /* The dropdown filters the store through its own GtkFilterListModel */
+  gtk_drop_down_set_expression (self->channel_dropdown,
+                                gtk_property_expression_new (HDHOMERUN_TYPE_CHANNEL_ITEM,
+                                                             NULL, "label"));
+  gtk_drop_down_set_enable_search (self->channel_dropdown, TRUE);
+#if GTK_CHECK_VERSION (4, 12, 0)
+  gtk_drop_down_set_search_match_mode (self->channel_dropdown,
+                                       GTK_STRING_FILTER_MATCH_MODE_SUBSTRING);
+#endif
+  g_signal_connect (self->channel_dropdown, "notify::selected",
+                    G_CALLBACK (on_channel_selected), self);
 }
@@ -20,10 +20,22 @@
 
 #include <adwaita.h>
 
+#include "hdhomerun-status-poller.h"
+#include "hdhomerun-ts-demux.h"
+#include "hdhomerun-tuner-controller.h"
+
 G_BEGIN_DECLS
 
 #define HDHOMERUN_TYPE_TUNER_CONTROLS (hdhomerun_tuner_controls_get_type())
 
 G_DECLARE_FINAL_TYPE (HdhomerunTunerControls, hdhomerun_tuner_controls, HDHOMERUN, TUNER_CONTROLS, GtkBox)
 
+HdhomerunTunerControls   *hdhomerun_tuner_controls_new               (void);
+void                      hdhomerun_tuner_controls_set_controller    (HdhomerunTunerControls   *self,
+                                                                      HdhomerunTunerController *controller);
+HdhomerunTunerController *hdhomerun_tuner_controls_get_controller    (HdhomerunTunerControls   *self);
+void                      hdhomerun_tuner_controls_set_status_poller (HdhomerunTunerControls   *self,
+                                                                      HdhomerunStatusPoller    *poller);
+HdhomerunTsDemux         *hdhomerun_tuner_controls_get_demux         (HdhomerunTunerControls   *self);
+
 G_END_DECLS
@@ -0,0 +1,312 @@
+/* hdhomerun-tuner-item.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-tuner-item.h"
+
+#include <string.h>
+
+/* HdhomerunTunerItem is the object HdhomerunDeviceStore hands out for a
+ * tuner record. Items are created on demand, so only tuners that are
+ * currently bound to a row or selected have one.
+ */
+struct _HdhomerunTunerItem
+{
+  GObject parent_instance;
+
+  char *device_id;
+  guint tuner_index;
+  HdhomerunTunerStatus status;
+  HdhomerunDeviceHealth health;
+};
+
+G_DEFINE_FINAL_TYPE (HdhomerunTunerItem, hdhomerun_tuner_item, G_TYPE_OBJECT)
+
+G_DEFINE_ENUM_TYPE (HdhomerunDeviceHealth, hdhomerun_device_health,
+                    G_DEFINE_ENUM_VALUE (HDHOMERUN_DEVICE_HEALTH_UNKNOWN, "unknown"),
+                    G_DEFINE_ENUM_VALUE (HDHOMERUN_DEVICE_HEALTH_GOOD, "good"),
+                    G_DEFINE_ENUM_VALUE (HDHOMERUN_DEVICE_HEALTH_DEGRADED, "degraded"),
+                    G_DEFINE_ENUM_VALUE (HDHOMERUN_DEVICE_HEALTH_UNREACHABLE, "unreachable"))
+
+enum {
+  PROP_0,
+  PROP_DEVICE_ID,
+  PROP_TUNER_INDEX,
+  PROP_STATUS,
+  PROP_HEALTH,
+  N_PROPS
+};
+
+static GParamSpec *properties [N_PROPS];
+
+HdhomerunTunerItem *
+hdhomerun_tuner_item_new (const char *device_id,
+                          guint       tuner_index)
+{
+  return g_object_new (HDHOMERUN_TYPE_TUNER_ITEM,
+                       "device-id", device_id,
+                       "tuner-index", tuner_index,
+                       NULL);
+}
+
+const char *
+hdhomerun_tuner_item_get_device_id (HdhomerunTunerItem *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_TUNER_ITEM (self), NULL);
+
+  return self->device_id;
+}
+
+guint
+hdhomerun_tuner_item_get_tuner_index (HdhomerunTunerItem *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_TUNER_ITEM (self), 0);
+
+  return self->tuner_index;
+}
+
+/**
+ * hdhomerun_tuner_item_get_status:
+ * @self: a #HdhomerunTunerItem
+ *
+ * Returns: (transfer none): the last status set, with valid unset if
+ *   there has been none
+ */
+const HdhomerunTunerStatus *
+hdhomerun_tuner_item_get_status (HdhomerunTunerItem *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_TUNER_ITEM (self), NULL);
+
+  return &self->status;
+}
+
+/**
+ * hdhomerun_tuner_status_parse:
+ * @value: a "/tunerN/status" value such as
+ *   "ch=8vsb:177000000 lock=8vsb ss=87 snq=92 seq=100 bps=19394080 pps=0"
+ * @status: (out): where to store the parsed status
+ *
+ * Fields missing from @value are left at zero.
+ */
+void
+hdhomerun_tuner_status_parse (const char           *value,
+                              HdhomerunTunerStatus *status)
+{
+  g_auto(GStrv) fields = NULL;
+
+  g_return_if_fail (value != NULL);
+  g_return_if_fail (status != NULL);
+
+  fields = g_strsplit (value, " ", -1);
+
+  memset (status, 0, sizeof *status);
+  status->valid = TRUE;
+  g_strlcpy (status->lock, "none", sizeof status->lock);
+
+  for (guint i = 0; fields[i] != NULL; i++)
+    {
+      const char *field = fields[i];
+      const char *eq = strchr (field, '=');
+      guint64 number;
+
+      if (eq == NULL)
+        continue;
+
+      number = g_ascii_strtoull (eq + 1, NULL, 10);
+
+      if (g_str_has_prefix (field, "lock="))
+        g_strlcpy (status->lock, eq + 1, sizeof status->lock);
+      else if (g_str_has_prefix (field, "ss="))
+        status->signal_strength = (guint) number;
+      else if (g_str_has_prefix (field, "snq="))
+        status->signal_quality = (guint) number;
+      else if (g_str_has_prefix (field, "seq="))
+        status->symbol_quality = (guint) number;
+      else if (g_str_has_prefix (field, "bps="))
+        status->bits_per_second = (guint) MIN (number, G_MAXUINT);
+    }
+}
+
+/**
+ * hdhomerun_tuner_item_set_status:
+ * @self: a #HdhomerunTunerItem
+ * @status: the status just read from the tuner
+ *
+ * Store @status, notifying #HdhomerunTunerItem:status only if it differs
+ * from the previous one.
+ *
+ * Returns: %TRUE if the status changed
+ */
+gboolean
+hdhomerun_tuner_item_set_status (HdhomerunTunerItem         *self,
+                                 const HdhomerunTunerStatus *status)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_TUNER_ITEM (self), FALSE);
+  g_return_val_if_fail (status != NULL, FALSE);
+
+  if (memcmp (&self->status, status, sizeof *status) == 0)
+    return FALSE;
+
+  self->status = *status;
+  g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_STATUS]);
+
+  return TRUE;
+}
+
+HdhomerunDeviceHealth
+hdhomerun_tuner_item_get_health (HdhomerunTunerItem *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_TUNER_ITEM (self), HDHOMERUN_DEVICE_HEALTH_UNKNOWN);
+
+  return self->health;
+}
+
+/**
+ * hdhomerun_tuner_item_set_health:
+ * @self: a #HdhomerunTunerItem
+ * @health: how well the device of the tuner answers
+ *
+ * Set by the device store for every tuner of a device at once.
+ */
+void
+hdhomerun_tuner_item_set_health (HdhomerunTunerItem    *self,
+                                 HdhomerunDeviceHealth  health)
+{
+  g_return_if_fail (HDHOMERUN_IS_TUNER_ITEM (self));
+
+  if (self->health == health)
+    return;
+
+  self->health = health;
+  g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_HEALTH]);
+}
+
+static void
+hdhomerun_tuner_item_finalize (GObject *object)
+{
+  HdhomerunTunerItem *self = (HdhomerunTunerItem *)object;
+
+  g_clear_pointer (&self->device_id, g_free);
+
+  G_OBJECT_CLASS (hdhomerun_tuner_item_parent_class)->finalize (object);
+}
+
+static void
+hdhomerun_tuner_item_get_property (GObject    *object,
+                                   guint       prop_id,
+                                   GValue     *value,
+                                   GParamSpec *pspec)
+{
+  HdhomerunTunerItem *self = HDHOMERUN_TUNER_ITEM (object);
+
+  switch (prop_id)
+    {
+    case PROP_DEVICE_ID:
+      g_value_set_string (value, self->device_id);
+      break;
+    case PROP_TUNER_INDEX:
+      g_value_set_uint (value, self->tuner_index);
+      break;
+    case PROP_STATUS:
+      g_value_set_pointer (value, &self->status);
+      break;
+    case PROP_HEALTH:
+      g_value_set_enum (value, self->health);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+hdhomerun_tuner_item_set_property (GObject      *object,
+                                   guint         prop_id,
+                                   const GValue *value,
+                                   GParamSpec   *pspec)
+{
+  HdhomerunTunerItem *self = HDHOMERUN_TUNER_ITEM (object);
+
+  switch (prop_id)
+    {
+    case PROP_DEVICE_ID:
+      g_free (self->device_id);
+      self->device_id = g_value_dup_string (value);
+      break;
+    case PROP_TUNER_INDEX:
+      self->tuner_index = g_value_get_uint (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+hdhomerun_tuner_item_class_init (HdhomerunTunerItemClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = hdhomerun_tuner_item_finalize;
+  object_class->get_property = hdhomerun_tuner_item_get_property;
+  object_class->set_property = hdhomerun_tuner_item_set_property;
+
+  properties [PROP_DEVICE_ID] =
+    g_param_spec_string ("device-id",
+                         "Device ID",
+                         "The device ID",
+                         NULL,
+                         (G_PARAM_READWRITE |
+                          G_PARAM_CONSTRUCT_ONLY |
+                          G_PARAM_STATIC_STRINGS));
+
+  properties [PROP_TUNER_INDEX] =
+    g_param_spec_uint ("tuner-index",
+                       "Tuner Index",
+                       "The tuner index",
+                       0,
+                       G_MAXUINT,
+                       0,
+                       (G_PARAM_READWRITE |
+                        G_PARAM_CONSTRUCT_ONLY |
+                        G_PARAM_STATIC_STRINGS));
+
+  /* Only here to be notified; read it with hdhomerun_tuner_item_get_status() */
+  properties [PROP_STATUS] =
+    g_param_spec_pointer ("status",
+                          "Status",
+                          "The last status read from the tuner",
+                          (G_PARAM_READABLE |
+                           G_PARAM_EXPLICIT_NOTIFY |
+                           G_PARAM_STATIC_STRINGS));
+
+  properties [PROP_HEALTH] =
+    g_param_spec_enum ("health",
+                       "Health",
+                       "How well the device of the tuner answers",
+                       HDHOMERUN_TYPE_DEVICE_HEALTH,
+                       HDHOMERUN_DEVICE_HEALTH_UNKNOWN,
+                       (G_PARAM_READABLE |
+                        G_PARAM_EXPLICIT_NOTIFY |
+                        G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_properties (object_class, N_PROPS, properties);
+}
+
+static void
+hdhomerun_tuner_item_init (HdhomerunTunerItem *self)
+{
+  (void)self; /* unused */
+}
@@ -0,0 +1,68 @@
+/* hdhomerun-tuner-item.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define HDHOMERUN_TYPE_TUNER_ITEM (hdhomerun_tuner_item_get_type())
+#define HDHOMERUN_TYPE_DEVICE_HEALTH (hdhomerun_device_health_get_type())
+
+/* How well the control channel of the device answers */
+typedef enum
+{
+  HDHOMERUN_DEVICE_HEALTH_UNKNOWN,      /* Not probed yet */
+  HDHOMERUN_DEVICE_HEALTH_GOOD,
+  HDHOMERUN_DEVICE_HEALTH_DEGRADED,     /* Slow or losing requests */
+  HDHOMERUN_DEVICE_HEALTH_UNREACHABLE,
+} HdhomerunDeviceHealth;
+
+GType hdhomerun_device_health_get_type (void) G_GNUC_CONST;
+
+/* The last status read from the tuner; plain data so it compares with memcmp */
+typedef struct
+{
+  gboolean valid;             /* FALSE until the first status arrives */
+  char     lock[16];          /* Modulation when locked, "none" otherwise */
+  guint    signal_strength;   /* Percent */
+  guint    signal_quality;    /* Signal to noise, percent */
+  guint    symbol_quality;    /* Percent */
+  guint    bits_per_second;
+} HdhomerunTunerStatus;
+
+void hdhomerun_tuner_status_parse (const char           *value,
+                                   HdhomerunTunerStatus *status);
+
+G_DECLARE_FINAL_TYPE (HdhomerunTunerItem, hdhomerun_tuner_item, HDHOMERUN, TUNER_ITEM, GObject)
+
+HdhomerunTunerItem *hdhomerun_tuner_item_new             (const char         *device_id,
+                                                          guint               tuner_index);
+const char         *hdhomerun_tuner_item_get_device_id   (HdhomerunTunerItem *self);
+guint               hdhomerun_tuner_item_get_tuner_index (HdhomerunTunerItem *self);
+const HdhomerunTunerStatus *
+                    hdhomerun_tuner_item_get_status      (HdhomerunTunerItem *self);
+gboolean            hdhomerun_tuner_item_set_status      (HdhomerunTunerItem         *self,
+                                                          const HdhomerunTunerStatus *status);
+HdhomerunDeviceHealth
+                    hdhomerun_tuner_item_get_health      (HdhomerunTunerItem *self);
+void                hdhomerun_tuner_item_set_health      (HdhomerunTunerItem    *self,
+                                                          HdhomerunDeviceHealth  health);
+
+G_END_DECLS
@@ -0,0 +1,441 @@
+/* hdhomerun-tuner-jobs.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-tuner-jobs.h"
+#include "hdhomerun-backend.h"
+#include "hdhomerun-connection-pool.h"
+#include "hdhomerun-tuner-item.h"
+
+/* Tuning, stopping and scanning go through the tuner's controller, so a
+ * bulk action leaves every tuner in the state it would be in had it been
+ * done on the tuner page, and the job finishes when the controller says
+ * the tune locked or the scan ended. Reading status needs no controller
+ * and is a blocking request on a worker thread.
+ */
+
+typedef struct
+{
+  HdhomerunTunerController *controller;
+  char *channel;
+} ControllerJob;
+
+static ControllerJob *
+controller_job_new (HdhomerunTunerController *controller,
+                    const char               *channel)
+{
+  ControllerJob *job = g_new0 (ControllerJob, 1);
+
+  job->controller = g_object_ref (controller);
+  job->channel = g_strdup (channel);
+
+  return job;
+}
+
+static void
+controller_job_free (gpointer data)
+{
+  ControllerJob *job = data;
+
+  g_object_unref (job->controller);
+  g_free (job->channel);
+  g_free (job);
+}
+
+static char *
+tuner_label (HdhomerunTunerController *controller)
+{
+  return g_strdup_printf ("%s tuner %u",
+                          hdhomerun_tuner_controller_get_device (controller)->device_id_str,
+                          hdhomerun_tuner_controller_get_tuner_index (controller));
+}
+
+/* A job waiting on a property of its controller */
+typedef struct
+{
+  GTask *task;
+  HdhomerunTunerController *controller;
+  gulong notify_id;
+  GCancellable *cancellable;
+  gulong cancelled_id;
+} Wait;
+
+static Wait *
+wait_new (GTask                    *task,
+          HdhomerunTunerController *controller,
+          GCancellable             *cancellable)
+{
+  Wait *wait = g_new0 (Wait, 1);
+
+  wait->task = g_object_ref (task);
+  wait->controller = g_object_ref (controller);
+  wait->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
+
+  return wait;
+}
+
+static void
+wait_finish (Wait *wait)
+{
+  g_clear_signal_handler (&wait->notify_id, wait->controller);
+  if (wait->cancellable != NULL)
+    g_cancellable_disconnect (wait->cancellable, wait->cancelled_id);
+  g_clear_object (&wait->cancellable);
+  g_object_unref (wait->controller);
+  g_object_unref (wait->task);
+  g_free (wait);
+}
+
+static void
+on_tune_state (HdhomerunTunerController *controller,
+               GParamSpec               *pspec,
+               Wait                     *wait)
+{
+  guint signal_strength = 0;
+  guint signal_quality = 0;
+  guint32 frequency;
+
+  (void)pspec; /* unused */
+
+  switch (hdhomerun_tuner_controller_get_state (controller))
+    {
+    case HDHOMERUN_TUNE_STATE_LOCKED:
+      frequency = hdhomerun_tuner_controller_get_signal (controller, &signal_strength,
+                                                         &signal_quality);
+      g_task_return_pointer (wait->task,
+                             g_strdup_printf ("Locked at %.3f MHz, signal %u%%, SNR %u%%",
+                                              frequency / 1e6, signal_strength, signal_quality),
+                             g_free);
+      break;
+    case HDHOMERUN_TUNE_STATE_NO_LOCK:
+      g_task_return_new_error (wait->task, G_IO_ERROR, G_IO_ERROR_FAILED, "No signal");
+      break;
+    case HDHOMERUN_TUNE_STATE_FAILED:
+      g_task_return_new_error (wait->task, G_IO_ERROR, G_IO_ERROR_FAILED, "Tuning failed");
+      break;
+    case HDHOMERUN_TUNE_STATE_IDLE:
+    case HDHOMERUN_TUNE_STATE_LOCKING:
+    default:
+      return;
+    }
+
+  wait_finish (wait);
+}
+
+/* Cancelling does not interrupt a tune in flight, it has to settle
+ * before the next one can go anyway; the job then reports cancelled.
+ */
+static void
+tune_job (GTask        *task,
+          gpointer      user_data,
+          GCancellable *cancellable)
+{
+  ControllerJob *job = user_data;
+  HdhomerunChannelStore *channels = hdhomerun_tuner_controller_get_channels (job->controller);
+  g_autoptr(HdhomerunChannelItem) item = NULL;
+  Wait *wait;
+  guint position;
+  guint32 hz = 0;
+
+  (void)cancellable; /* unused */
+
+  position = hdhomerun_channel_store_find (channels, job->channel);
+  if (position != G_MAXUINT)
+    item = g_list_model_get_item (G_LIST_MODEL (channels), position);
+  else if (!hdhomerun_tuner_parse_frequency (job->channel, &hz))
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                               "“%s” is neither a known channel nor a frequency", job->channel);
+      return;
+    }
+
+  wait = wait_new (task, job->controller, NULL);
+  wait->notify_id = g_signal_connect (job->controller, "notify::state",
+                                      G_CALLBACK (on_tune_state), wait);
+
+  if (item != NULL)
+    hdhomerun_tuner_controller_select_channel (job->controller, item);
+  else
+    hdhomerun_tuner_controller_tune (job->controller, hz);
+}
+
+/**
+ * hdhomerun_tuner_jobs_add_tune:
+ * @scheduler: a #HdhomerunJobScheduler
+ * @controller: the tuner
+ * @channel: a channel, callsign or frequency, as typed on the tuner page
+ *
+ * The job finishes once the tuner locks or gives up.
+ */
+void
+hdhomerun_tuner_jobs_add_tune (HdhomerunJobScheduler    *scheduler,
+                               HdhomerunTunerController *controller,
+                               const char               *channel)
+{
+  g_autofree char *label = NULL;
+
+  g_return_if_fail (HDHOMERUN_IS_JOB_SCHEDULER (scheduler));
+  g_return_if_fail (HDHOMERUN_IS_TUNER_CONTROLLER (controller));
+  g_return_if_fail (channel != NULL);
+
+  label = tuner_label (controller);
+  hdhomerun_job_scheduler_add (scheduler,
+                               hdhomerun_tuner_controller_get_device (controller)->device_id_str,
+                               label, tune_job,
+                               controller_job_new (controller, channel), controller_job_free);
+}
+
+static void
+stop_job (GTask        *task,
+          gpointer      user_data,
+          GCancellable *cancellable)
+{
+  ControllerJob *job = user_data;
+  gboolean recording;
+
+  (void)cancellable; /* unused */
+
+  recording = hdhomerun_tuner_controller_get_recorder (job->controller) != NULL;
+  if (!hdhomerun_tuner_controller_get_playing (job->controller) && !recording)
+    {
+      g_task_return_pointer (task, g_strdup ("Not streaming"), g_free);
+      return;
+    }
+
+  hdhomerun_tuner_controller_stop_recording (job->controller);
+  hdhomerun_tuner_controller_set_playing (job->controller, FALSE);
+  g_task_return_pointer (task, g_strdup (recording ? "Stopped, recording saved" : "Stopped"),
+                         g_free);
+}
+
+/**
+ * hdhomerun_tuner_jobs_add_stop:
+ * @scheduler: a #HdhomerunJobScheduler
+ * @controller: the tuner
+ *
+ * Stop the tuner's stream and any recording of it.
+ */
+void
+hdhomerun_tuner_jobs_add_stop (HdhomerunJobScheduler    *scheduler,
+                               HdhomerunTunerController *controller)
+{
+  g_autofree char *label = NULL;
+
+  g_return_if_fail (HDHOMERUN_IS_JOB_SCHEDULER (scheduler));
+  g_return_if_fail (HDHOMERUN_IS_TUNER_CONTROLLER (controller));
+
+  label = tuner_label (controller);
+  hdhomerun_job_scheduler_add (scheduler,
+                               hdhomerun_tuner_controller_get_device (controller)->device_id_str,
+                               label, stop_job,
+                               controller_job_new (controller, NULL), controller_job_free);
+}
+
+static void
+on_scan_progress (HdhomerunTunerController *controller,
+                  GParamSpec               *pspec,
+                  Wait                     *wait)
+{
+  const GError *error;
+  guint n_channels;
+
+  (void)pspec; /* unused */
+
+  if (hdhomerun_tuner_controller_get_scan_progress (controller) >= 0)
+    return;
+
+  /* Cancelled scans come back as G_IO_ERROR_CANCELLED, like the job */
+  error = hdhomerun_tuner_controller_get_scan_error (controller);
+  if (error != NULL)
+    {
+      g_task_return_error (wait->task, g_error_copy (error));
+      wait_finish (wait);
+      return;
+    }
+
+  n_channels = g_list_model_get_n_items (G_LIST_MODEL (hdhomerun_tuner_controller_get_channels (controller)));
+  g_task_return_pointer (wait->task, g_strdup_printf ("%u channels", n_channels), g_free);
+  wait_finish (wait);
+}
+
+static void
+on_scan_cancelled (GCancellable *cancellable,
+                   Wait         *wait)
+{
+  (void)cancellable; /* unused */
+
+  hdhomerun_tuner_controller_cancel_scan (wait->controller);
+}
+
+static void
+scan_job (GTask        *task,
+          gpointer      user_data,
+          GCancellable *cancellable)
+{
+  ControllerJob *job = user_data;
+  Wait *wait;
+
+  /* A scan already running on the device is waited for, not restarted */
+  if (hdhomerun_tuner_controller_get_scan_progress (job->controller) < 0)
+    hdhomerun_tuner_controller_start_scan (job->controller);
+
+  wait = wait_new (task, job->controller, cancellable);
+  wait->notify_id = g_signal_connect (job->controller, "notify::scan-progress",
+                                      G_CALLBACK (on_scan_progress), wait);
+  if (cancellable != NULL)
+    wait->cancelled_id = g_cancellable_connect (cancellable, G_CALLBACK (on_scan_cancelled),
+                                                wait, NULL);
+}
+
+/**
+ * hdhomerun_tuner_jobs_add_scan:
+ * @scheduler: a #HdhomerunJobScheduler
+ * @controller: any tuner of the device
+ *
+ * Scan the device's channels with all of its idle tuners.
+ */
+void
+hdhomerun_tuner_jobs_add_scan (HdhomerunJobScheduler    *scheduler,
+                               HdhomerunTunerController *controller)
+{
+  const char *device_id;
+
+  g_return_if_fail (HDHOMERUN_IS_JOB_SCHEDULER (scheduler));
+  g_return_if_fail (HDHOMERUN_IS_TUNER_CONTROLLER (controller));
+
+  device_id = hdhomerun_tuner_controller_get_device (controller)->device_id_str;
+  hdhomerun_job_scheduler_add (scheduler, device_id, device_id, scan_job,
+                               controller_job_new (controller, NULL), controller_job_free);
+}
+
+typedef struct
+{
+  char *device_id;
+  char *address;
+  guint tuner_index;
+} StatusJob;
+
+static void
+status_job_free (gpointer data)
+{
+  StatusJob *job = data;
+
+  g_free (job->device_id);
+  g_free (job->address);
+  g_free (job);
+}
+
+static void
+status_thread (GTask        *task,
+               gpointer      source_object,
+               gpointer      task_data,
+               GCancellable *cancellable)
+{
+  HdhomerunConnectionPool *pool = hdhomerun_connection_pool_get_default ();
+  StatusJob *job = task_data;
+  HdhomerunTunerStatus status = { 0 };
+  HdhomerunConnection *connection;
+  struct hdhomerun_device_t *hd;
+  char path[32];
+  char *value = NULL;
+  char *error = NULL;
+  int ret;
+
+  (void)source_object; /* unused */
+  (void)cancellable; /* unused */
+
+  connection = hdhomerun_connection_pool_acquire (pool, job->device_id, job->tuner_index,
+                                                  job->address);
+  hd = hdhomerun_connection_lock (connection);
+  if (hd == NULL)
+    {
+      hdhomerun_connection_pool_release (pool, connection);
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_CONNECTED,
+                               "Could not reach device %s", job->device_id);
+      return;
+    }
+
+  g_snprintf (path, sizeof path, "/tuner%u/status", job->tuner_index);
+  ret = hdhomerun_backend_get_default ()->device_get_var (hd, path, &value, &error);
+  if (ret > 0 && error == NULL && value != NULL)
+    hdhomerun_tuner_status_parse (value, &status);
+
+  hdhomerun_connection_unlock (connection);
+  hdhomerun_connection_pool_release (pool, connection);
+
+  if (!status.valid)
+    {
+      g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED,
+                               "No status: %s", ret <= 0 ? "no reply" : "rejected");
+      return;
+    }
+
+  g_task_return_pointer (task,
+                         g_strdup_printf ("lock=%s ss=%u snq=%u seq=%u bps=%u",
+                                          status.lock, status.signal_strength,
+                                          status.signal_quality, status.symbol_quality,
+                                          status.bits_per_second),
+                         g_free);
+}
+
+static void
+status_job (GTask        *task,
+            gpointer      user_data,
+            GCancellable *cancellable)
+{
+  StatusJob *job = user_data;
+  StatusJob *copy = g_new0 (StatusJob, 1);
+
+  (void)cancellable; /* unused */
+
+  /* The thread gets its own copy, the scheduler frees its own */
+  copy->device_id = g_strdup (job->device_id);
+  copy->address = g_strdup (job->address);
+  copy->tuner_index = job->tuner_index;
+  g_task_set_task_data (task, copy, status_job_free);
+  g_task_run_in_thread (task, status_thread);
+}
+
+/**
+ * hdhomerun_tuner_jobs_add_status:
+ * @scheduler: a #HdhomerunJobScheduler
+ * @info: the device
+ * @tuner_index: the tuner on that device
+ *
+ * Read the tuner's status once; the job's summary is what it said.
+ */
+void
+hdhomerun_tuner_jobs_add_status (HdhomerunJobScheduler     *scheduler,
+                                 const HdhomerunDeviceInfo *info,
+                                 guint                      tuner_index)
+{
+  g_autofree char *label = NULL;
+  StatusJob *job;
+
+  g_return_if_fail (HDHOMERUN_IS_JOB_SCHEDULER (scheduler));
+  g_return_if_fail (info != NULL);
+  g_return_if_fail (info->control_address != NULL);
+
+  job = g_new0 (StatusJob, 1);
+  job->device_id = g_strdup (info->device_id_str);
+  job->address = g_strdup (info->control_address);
+  job->tuner_index = tuner_index;
+
+  label = g_strdup_printf ("%s tuner %u", info->device_id_str, tuner_index);
+  hdhomerun_job_scheduler_add (scheduler, info->device_id_str, label, status_job,
+                               job, status_job_free);
+}
@@ -0,0 +1,43 @@
+/* hdhomerun-tuner-jobs.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "hdhomerun-discovery.h"
+#include "hdhomerun-job-scheduler.h"
+#include "hdhomerun-tuner-controller.h"
+
+G_BEGIN_DECLS
+
+/* The actions that can be applied to many tuners at once, queued as
+ * jobs on a #HdhomerunJobScheduler.
+ */
+void hdhomerun_tuner_jobs_add_tune   (HdhomerunJobScheduler     *scheduler,
+                                      HdhomerunTunerController  *controller,
+                                      const char                *channel);
+void hdhomerun_tuner_jobs_add_stop   (HdhomerunJobScheduler     *scheduler,
+                                      HdhomerunTunerController  *controller);
+void hdhomerun_tuner_jobs_add_scan   (HdhomerunJobScheduler     *scheduler,
+                                      HdhomerunTunerController  *controller);
+void hdhomerun_tuner_jobs_add_status (HdhomerunJobScheduler     *scheduler,
+                                      const HdhomerunDeviceInfo *info,
+                                      guint                      tuner_index);
+
+G_END_DECLS
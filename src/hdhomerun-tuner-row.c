@@ -18,43 +18,218 @@
 
 #include "hdhomerun-tuner-row.h"
 
+#include <glib/gi18n.h>
+
+/* HdhomerunTunerRow is the widget GtkListView recycles for the tuners in
+ * HdhomerunDeviceStore. It is rebound to a different HdhomerunTunerItem
+ * as the list scrolls, so it holds no state of its own beyond the item.
+ *
+ * Status changes are applied on the next frame, so however many arrive
+ * in between the labels are only rewritten once. Devices that answer
+ * poorly get a warning icon, which health changes update straight away
+ * as they only come every few seconds.
+ */
 struct _HdhomerunTunerRow
 {
-  AdwActionRow parent_instance;
+  GtkBox parent_instance;
 
-  char *device_id;
-  guint tuner_index;
+  GtkLabel *title_label;
+  GtkLabel *status_label;
+  GtkImage *health_icon;
+  HdhomerunTunerItem *item;
+  guint tick_id;
 };
 
-G_DEFINE_FINAL_TYPE (HdhomerunTunerRow, hdhomerun_tuner_row, ADW_TYPE_ACTION_ROW)
+G_DEFINE_FINAL_TYPE (HdhomerunTunerRow, hdhomerun_tuner_row, GTK_TYPE_BOX)
 
 enum {
   PROP_0,
-  PROP_DEVICE_ID,
-  PROP_TUNER_INDEX,
+  PROP_ITEM,
   N_PROPS
 };
 
 static GParamSpec *properties [N_PROPS];
 
 HdhomerunTunerRow *
-hdhomerun_tuner_row_new (const char *device_id,
-                         guint tuner_index)
+hdhomerun_tuner_row_new (void)
+{
+  return g_object_new (HDHOMERUN_TYPE_TUNER_ROW, NULL);
+}
+
+static void
+update_title (HdhomerunTunerRow *self)
 {
-  return g_object_new (HDHOMERUN_TYPE_TUNER_ROW,
-                       "device-id", device_id,
-                       "tuner-index", tuner_index,
-                       NULL);
+  char *title;
+
+  if (!self->item)
+    {
+      gtk_label_set_label (self->title_label, NULL);
+      return;
+    }
+
+  title = g_strdup_printf ("%s - Tuner %u",
+                           hdhomerun_tuner_item_get_device_id (self->item),
+                           hdhomerun_tuner_item_get_tuner_index (self->item));
+  gtk_label_set_label (self->title_label, title);
+  g_free (title);
+}
+
+static void
+update_status (HdhomerunTunerRow *self)
+{
+  const HdhomerunTunerStatus *status;
+  g_autofree char *text = NULL;
+
+  status = self->item ? hdhomerun_tuner_item_get_status (self->item) : NULL;
+  if (status == NULL || !status->valid)
+    {
+      gtk_widget_set_visible (GTK_WIDGET (self->status_label), FALSE);
+      return;
+    }
+
+  if (g_str_equal (status->lock, "none"))
+    text = g_strdup (_("Idle"));
+  else
+    text = g_strdup_printf (_("%s · %u%% signal · %u%% SNR · %u%% symbol · %.1f Mbps"),
+                            status->lock,
+                            status->signal_strength,
+                            status->signal_quality,
+                            status->symbol_quality,
+                            status->bits_per_second / 1e6);
+
+  gtk_label_set_label (self->status_label, text);
+  gtk_widget_set_visible (GTK_WIDGET (self->status_label), TRUE);
 }
 
 static void
-hdhomerun_tuner_row_finalize (GObject *object)
+update_health (HdhomerunTunerRow *self)
+{
+  HdhomerunDeviceHealth health;
+
+  health = self->item ? hdhomerun_tuner_item_get_health (self->item)
+                      : HDHOMERUN_DEVICE_HEALTH_UNKNOWN;
+
+  switch (health)
+    {
+    case HDHOMERUN_DEVICE_HEALTH_DEGRADED:
+      gtk_image_set_from_icon_name (self->health_icon, "dialog-warning-symbolic");
+      gtk_widget_set_tooltip_text (GTK_WIDGET (self->health_icon),
+                                   _("Device is slow to answer or losing requests"));
+      gtk_widget_remove_css_class (GTK_WIDGET (self->health_icon), "error");
+      gtk_widget_add_css_class (GTK_WIDGET (self->health_icon), "warning");
+      gtk_widget_set_visible (GTK_WIDGET (self->health_icon), TRUE);
+      break;
+    case HDHOMERUN_DEVICE_HEALTH_UNREACHABLE:
+      gtk_image_set_from_icon_name (self->health_icon, "network-offline-symbolic");
+      gtk_widget_set_tooltip_text (GTK_WIDGET (self->health_icon),
+                                   _("Device is not answering"));
+      gtk_widget_remove_css_class (GTK_WIDGET (self->health_icon), "warning");
+      gtk_widget_add_css_class (GTK_WIDGET (self->health_icon), "error");
+      gtk_widget_set_visible (GTK_WIDGET (self->health_icon), TRUE);
+      break;
+    case HDHOMERUN_DEVICE_HEALTH_UNKNOWN:
+    case HDHOMERUN_DEVICE_HEALTH_GOOD:
+    default:
+      gtk_widget_set_visible (GTK_WIDGET (self->health_icon), FALSE);
+      break;
+    }
+}
+
+static void
+on_health_changed (HdhomerunTunerItem *item,
+                   GParamSpec         *pspec,
+                   HdhomerunTunerRow  *self)
+{
+  (void)item; /* unused */
+  (void)pspec; /* unused */
+
+  update_health (self);
+}
+
+static gboolean
+on_tick (GtkWidget     *widget,
+         GdkFrameClock *frame_clock,
+         gpointer       user_data)
+{
+  HdhomerunTunerRow *self = HDHOMERUN_TUNER_ROW (widget);
+
+  (void)frame_clock; /* unused */
+  (void)user_data; /* unused */
+
+  self->tick_id = 0;
+  update_status (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+on_status_changed (HdhomerunTunerItem *item,
+                   GParamSpec         *pspec,
+                   HdhomerunTunerRow  *self)
+{
+  (void)item; /* unused */
+  (void)pspec; /* unused */
+
+  if (self->tick_id == 0)
+    self->tick_id = gtk_widget_add_tick_callback (GTK_WIDGET (self), on_tick, NULL, NULL);
+}
+
+HdhomerunTunerItem *
+hdhomerun_tuner_row_get_item (HdhomerunTunerRow *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_TUNER_ROW (self), NULL);
+
+  return self->item;
+}
+
+void
+hdhomerun_tuner_row_set_item (HdhomerunTunerRow  *self,
+                              HdhomerunTunerItem *item)
+{
+  g_return_if_fail (HDHOMERUN_IS_TUNER_ROW (self));
+  g_return_if_fail (item == NULL || HDHOMERUN_IS_TUNER_ITEM (item));
+
+  if (self->item == item)
+    return;
+
+  if (self->item)
+    {
+      g_signal_handlers_disconnect_by_func (self->item, on_status_changed, self);
+      g_signal_handlers_disconnect_by_func (self->item, on_health_changed, self);
+    }
+
+  g_set_object (&self->item, item);
+
+  if (self->item)
+    {
+      g_signal_connect (self->item, "notify::status", G_CALLBACK (on_status_changed), self);
+      g_signal_connect (self->item, "notify::health", G_CALLBACK (on_health_changed), self);
+    }
+
+  update_title (self);
+  update_status (self);
+  update_health (self);
+  g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_ITEM]);
+}
+
+static void
+hdhomerun_tuner_row_dispose (GObject *object)
 {
   HdhomerunTunerRow *self = (HdhomerunTunerRow *)object;
 
-  g_clear_pointer (&self->device_id, g_free);
+  if (self->tick_id)
+    {
+      gtk_widget_remove_tick_callback (GTK_WIDGET (self), self->tick_id);
+      self->tick_id = 0;
+    }
+  if (self->item)
+    {
+      g_signal_handlers_disconnect_by_func (self->item, on_status_changed, self);
+      g_signal_handlers_disconnect_by_func (self->item, on_health_changed, self);
+    }
+  g_clear_object (&self->item);
 
-  G_OBJECT_CLASS (hdhomerun_tuner_row_parent_class)->finalize (object);
+  G_OBJECT_CLASS (hdhomerun_tuner_row_parent_class)->dispose (object);
 }
 
 static void
@@ -67,30 +242,14 @@ hdhomerun_tuner_row_get_property (GObject    *object,
 
   switch (prop_id)
     {
-    case PROP_DEVICE_ID:
-      g_value_set_string (value, self->device_id);
-      break;
-    case PROP_TUNER_INDEX:
-      g_value_set_uint (value, self->tuner_index);
+    case PROP_ITEM:
+      g_value_set_object (value, self->item);
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
     }
 }
 
-static void
-update_title (HdhomerunTunerRow *self)
-{
-  char *title;
-  
-  if (!self->device_id)
-    return;
-  
-  title = g_strdup_printf ("%s - Tuner %u", self->device_id, self->tuner_index);
-  adw_preferences_row_set_title (ADW_PREFERENCES_ROW (self), title);
-  g_free (title);
-}
-
 static void
 hdhomerun_tuner_row_set_property (GObject      *object,
                                   guint         prop_id,
@@ -101,14 +260,8 @@ hdhomerun_tuner_row_set_property (GObject      *object,
 
   switch (prop_id)
     {
-    case PROP_DEVICE_ID:
-      g_free (self->device_id);
-      self->device_id = g_value_dup_string (value);
-      update_title (self);
-      break;
-    case PROP_TUNER_INDEX:
-      self->tuner_index = g_value_get_uint (value);
-      update_title (self);
+    case PROP_ITEM:
+      hdhomerun_tuner_row_set_item (self, g_value_get_object (value));
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -120,42 +273,52 @@ hdhomerun_tuner_row_class_init (HdhomerunTunerRowClass *klass)
 {
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
-  object_class->finalize = hdhomerun_tuner_row_finalize;
+  object_class->dispose = hdhomerun_tuner_row_dispose;
   object_class->get_property = hdhomerun_tuner_row_get_property;
   object_class->set_property = hdhomerun_tuner_row_set_property;
 
-  properties [PROP_DEVICE_ID] =
-    g_param_spec_string ("device-id",
-                         "Device ID",
-                         "The device ID",
-                         NULL,
+  properties [PROP_ITEM] =
+    g_param_spec_object ("item",
+                         "Item",
+                         "The tuner shown by this row",
+                         HDHOMERUN_TYPE_TUNER_ITEM,
                          (G_PARAM_READWRITE |
-                          G_PARAM_CONSTRUCT_ONLY |
+                          G_PARAM_EXPLICIT_NOTIFY |
                           G_PARAM_STATIC_STRINGS));
 
-  properties [PROP_TUNER_INDEX] =
-    g_param_spec_uint ("tuner-index",
-                       "Tuner Index",
-                       "The tuner index",
-                       0,
-                       G_MAXUINT,
-                       0,
-                       (G_PARAM_READWRITE |
-                        G_PARAM_CONSTRUCT_ONLY |
-                        G_PARAM_STATIC_STRINGS));
-
   g_object_class_install_properties (object_class, N_PROPS, properties);
 }
 
 static void
 hdhomerun_tuner_row_init (HdhomerunTunerRow *self)
 {
+  GtkWidget *labels;
   GtkWidget *icon;
-  
+
+  gtk_box_set_spacing (GTK_BOX (self), 12);
+
+  labels = gtk_box_new (GTK_ORIENTATION_VERTICAL, 2);
+  gtk_widget_set_hexpand (labels, TRUE);
+  gtk_box_append (GTK_BOX (self), labels);
+
+  self->title_label = GTK_LABEL (gtk_label_new (NULL));
+  gtk_label_set_xalign (self->title_label, 0.0);
+  gtk_label_set_ellipsize (self->title_label, PANGO_ELLIPSIZE_END);
+  gtk_box_append (GTK_BOX (labels), GTK_WIDGET (self->title_label));
+
+  self->status_label = GTK_LABEL (gtk_label_new (NULL));
+  gtk_label_set_xalign (self->status_label, 0.0);
+  gtk_label_set_ellipsize (self->status_label, PANGO_ELLIPSIZE_END);
+  gtk_widget_add_css_class (GTK_WIDGET (self->status_label), "caption");
+  gtk_widget_add_css_class (GTK_WIDGET (self->status_label), "dim-label");
+  gtk_widget_set_visible (GTK_WIDGET (self->status_label), FALSE);
+  gtk_box_append (GTK_BOX (labels), GTK_WIDGET (self->status_label));
+
+  self->health_icon = GTK_IMAGE (gtk_image_new ());
+  gtk_widget_set_visible (GTK_WIDGET (self->health_icon), FALSE);
+  gtk_box_append (GTK_BOX (self), GTK_WIDGET (self->health_icon));
+
   /* Add a chevron icon to make the row visually activatable */
   icon = gtk_image_new_from_icon_name ("go-next-symbolic");
-  adw_action_row_add_suffix (ADW_ACTION_ROW (self), icon);
-  
-  /* Make the entire row activatable (clickable) */
-  gtk_list_box_row_set_activatable (GTK_LIST_BOX_ROW (self), TRUE);
+  gtk_box_append (GTK_BOX (self), icon);
 }
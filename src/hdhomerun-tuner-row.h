@@ -20,13 +20,17 @@
 
 #include <adwaita.h>
 
+#include "hdhomerun-tuner-item.h"
+
 G_BEGIN_DECLS
 
 #define HDHOMERUN_TYPE_TUNER_ROW (hdhomerun_tuner_row_get_type())
 
-G_DECLARE_FINAL_TYPE (HdhomerunTunerRow, hdhomerun_tuner_row, HDHOMERUN, TUNER_ROW, AdwActionRow)
+G_DECLARE_FINAL_TYPE (HdhomerunTunerRow, hdhomerun_tuner_row, HDHOMERUN, TUNER_ROW, GtkBox)
 
-HdhomerunTunerRow *hdhomerun_tuner_row_new (const char *device_id,
-                                             guint tuner_index);
+HdhomerunTunerRow  *hdhomerun_tuner_row_new      (void);
+HdhomerunTunerItem *hdhomerun_tuner_row_get_item (HdhomerunTunerRow  *self);
+void                hdhomerun_tuner_row_set_item (HdhomerunTunerRow  *self,
+                                                  HdhomerunTunerItem *item);
 
 G_END_DECLS
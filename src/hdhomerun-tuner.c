@@ -0,0 +1,431 @@
+/* hdhomerun-tuner.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-tuner.h"
+#include "hdhomerun-backend.h"
+#include "hdhomerun-trace.h"
+
+#include <string.h>
+
+/* HdhomerunTuner tunes a single tuner without blocking the caller.
+ *
+ * hdhomerun_tuner_tune() returns at once and the state goes to LOCKING.
+ * Only one request is on the wire at a time; requests made meanwhile
+ * replace each other, so when the one in flight completes only the
+ * latest is sent. A request waiting for lock gives up as soon as a newer
+ * one arrives, so flipping through channels never queues stale tunes.
+ *
+ * Lock is confirmed by polling the tuner status with the connection
+ * unlocked in between, rather than with hdhomerun_device_wait_for_lock(),
+ * which would hold the connection for the whole wait.
+ */
+
+#define LOCK_TIMEOUT_MS    2500
+#define LOCK_POLL_MS       100
+
+G_DEFINE_ENUM_TYPE (HdhomerunTuneState, hdhomerun_tune_state,
+                    G_DEFINE_ENUM_VALUE (HDHOMERUN_TUNE_STATE_IDLE, "idle"),
+                    G_DEFINE_ENUM_VALUE (HDHOMERUN_TUNE_STATE_LOCKING, "locking"),
+                    G_DEFINE_ENUM_VALUE (HDHOMERUN_TUNE_STATE_LOCKED, "locked"),
+                    G_DEFINE_ENUM_VALUE (HDHOMERUN_TUNE_STATE_NO_LOCK, "no-lock"),
+                    G_DEFINE_ENUM_VALUE (HDHOMERUN_TUNE_STATE_FAILED, "failed"))
+
+typedef struct
+{
+  guint32 frequency;
+  guint program_number;
+  guint generation;
+} TuneRequest;
+
+typedef struct
+{
+  HdhomerunTuneState state;
+  guint signal_strength;
+  guint signal_quality;
+  guint symbol_quality;
+} TuneOutcome;
+
+struct _HdhomerunTuner
+{
+  GObject parent_instance;
+
+  HdhomerunConnection *connection;  /* Held */
+  HdhomerunTuneState state;
+
+  gboolean in_flight;
+  gboolean has_pending;
+  TuneRequest pending;
+  gint generation;                  /* Atomic, bumped by every request */
+};
+
+G_DEFINE_FINAL_TYPE (HdhomerunTuner, hdhomerun_tuner, G_TYPE_OBJECT)
+
+enum {
+  PROP_0,
+  PROP_STATE,
+  N_PROPS
+};
+
+enum {
+  TUNED,
+  N_SIGNALS
+};
+
+static GParamSpec *properties [N_PROPS];
+static guint signals [N_SIGNALS];
+
+static void send_request (HdhomerunTuner    *self,
+                          const TuneRequest *request);
+
+static void
+set_state (HdhomerunTuner     *self,
+           HdhomerunTuneState  state)
+{
+  if (self->state == state)
+    return;
+
+  self->state = state;
+  g_object_notify_by_pspec (G_OBJECT (self), properties [PROP_STATE]);
+}
+
+static gboolean
+is_stale (HdhomerunTuner    *self,
+          const TuneRequest *request)
+{
+  return (guint) g_atomic_int_get (&self->generation) != request->generation;
+}
+
+static void
+return_outcome (GTask             *task,
+                TuneOutcome       *outcome,
+                HdhomerunTuner    *self,
+                const TuneRequest *request,
+                gint64             trace)
+{
+  if (trace != 0)
+    {
+      g_autofree char *state = g_enum_to_string (HDHOMERUN_TYPE_TUNE_STATE, outcome->state);
+
+      hdhomerun_trace_end (trace, "tune", "%s tuner %u, %u Hz program %u: %s",
+                           hdhomerun_connection_get_device_id (self->connection),
+                           hdhomerun_connection_get_tuner_index (self->connection),
+                           request->frequency, request->program_number, state);
+    }
+
+  g_task_return_pointer (task, outcome, g_free);
+}
+
+static void
+tune_thread (GTask        *task,
+             gpointer      source_object,
+             gpointer      task_data,
+             GCancellable *cancellable)
+{
+  HdhomerunTuner *self = source_object;
+  const TuneRequest *request = task_data;
+  TuneOutcome *outcome = g_new0 (TuneOutcome, 1);
+  gint64 trace = hdhomerun_trace_begin ();
+  struct hdhomerun_device_t *hd;
+  g_autofree char *channel = NULL;
+  gint64 deadline;
+  int ret;
+
+  (void)cancellable; /* unused */
+
+  channel = g_strdup_printf ("auto:%u", request->frequency);
+
+  hd = hdhomerun_connection_lock (self->connection);
+  if (hd == NULL)
+    {
+      outcome->state = HDHOMERUN_TUNE_STATE_FAILED;
+      return_outcome (task, outcome, self, request, trace);
+      return;
+    }
+
+  ret = hdhomerun_backend_get_default ()->device_set_tuner_channel (hd, channel);
+  if (ret > 0 && request->program_number > 0)
+    {
+      g_autofree char *program = g_strdup_printf ("%u", request->program_number);
+
+      ret = hdhomerun_backend_get_default ()->device_set_tuner_program (hd, program);
+    }
+  hdhomerun_connection_unlock (self->connection);
+
+  if (ret <= 0)
+    {
+      outcome->state = HDHOMERUN_TUNE_STATE_FAILED;
+      return_outcome (task, outcome, self, request, trace);
+      return;
+    }
+
+  outcome->state = HDHOMERUN_TUNE_STATE_NO_LOCK;
+  deadline = g_get_monotonic_time () + LOCK_TIMEOUT_MS * 1000;
+
+  while (!is_stale (self, request) && g_get_monotonic_time () < deadline)
+    {
+      struct hdhomerun_tuner_status_t status;
+
+      g_usleep (LOCK_POLL_MS * 1000);
+
+      hd = hdhomerun_connection_lock (self->connection);
+      if (hd == NULL)
+        break;
+      ret = hdhomerun_backend_get_default ()->device_get_tuner_status (hd, NULL, &status);
+      hdhomerun_connection_unlock (self->connection);
+
+      if (ret <= 0)
+        continue;
+
+      outcome->signal_strength = status.signal_strength;
+      outcome->signal_quality = status.signal_to_noise_quality;
+      outcome->symbol_quality = status.symbol_error_quality;
+
+      /* Any lock the tuner supports counts, however weak; the qualities
+       * above say how good it is.
+       */
+      if (status.lock_supported)
+        {
+          outcome->state = HDHOMERUN_TUNE_STATE_LOCKED;
+          break;
+        }
+
+      if (status.lock_unsupported)
+        break;
+    }
+
+  return_outcome (task, outcome, self, request, trace);
+}
+
+static void
+on_tune_finished (GObject      *source,
+                  GAsyncResult *result,
+                  gpointer      user_data)
+{
+  HdhomerunTuner *self = HDHOMERUN_TUNER (source);
+  const TuneRequest *request = g_task_get_task_data (G_TASK (result));
+  g_autofree TuneOutcome *outcome = NULL;
+
+  (void)user_data; /* unused */
+
+  outcome = g_task_propagate_pointer (G_TASK (result), NULL);
+  self->in_flight = FALSE;
+
+  /* Superseded; only the latest request gets reported */
+  if (self->has_pending)
+    {
+      self->has_pending = FALSE;
+      send_request (self, &self->pending);
+      return;
+    }
+
+  if (is_stale (self, request))
+    return;
+
+  set_state (self, outcome->state);
+  g_signal_emit (self, signals [TUNED], 0,
+                 request->frequency,
+                 outcome->signal_strength,
+                 outcome->signal_quality,
+                 outcome->symbol_quality);
+}
+
+static void
+send_request (HdhomerunTuner    *self,
+              const TuneRequest *request)
+{
+  g_autoptr(GTask) task = NULL;
+
+  self->in_flight = TRUE;
+
+  task = g_task_new (self, NULL, on_tune_finished, NULL);
+  g_task_set_source_tag (task, send_request);
+  g_task_set_task_data (task, g_memdup2 (request, sizeof *request), g_free);
+  g_task_run_in_thread (task, tune_thread);
+}
+
+/**
+ * hdhomerun_tuner_tune:
+ * @self: a #HdhomerunTuner
+ * @frequency: the frequency in Hz
+ * @program_number: the MPEG program to filter for, or 0 for the whole
+ *   transport stream
+ *
+ * Tune in the background. The state changes to
+ * %HDHOMERUN_TUNE_STATE_LOCKING right away and #HdhomerunTuner::tuned is
+ * emitted once lock is confirmed or given up on, unless a newer request
+ * replaced this one first.
+ */
+void
+hdhomerun_tuner_tune (HdhomerunTuner *self,
+                      guint32         frequency,
+                      guint           program_number)
+{
+  TuneRequest request;
+
+  g_return_if_fail (HDHOMERUN_IS_TUNER (self));
+
+  request.frequency = frequency;
+  request.program_number = program_number;
+  request.generation = (guint) g_atomic_int_add (&self->generation, 1) + 1;
+
+  set_state (self, HDHOMERUN_TUNE_STATE_LOCKING);
+
+  if (self->in_flight)
+    {
+      self->pending = request;
+      self->has_pending = TRUE;
+      return;
+    }
+
+  send_request (self, &request);
+}
+
+HdhomerunTuneState
+hdhomerun_tuner_get_state (HdhomerunTuner *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_TUNER (self), HDHOMERUN_TUNE_STATE_IDLE);
+
+  return self->state;
+}
+
+/**
+ * hdhomerun_tuner_parse_frequency:
+ * @text: a frequency typed by the user
+ * @frequency: (out): return location for the frequency in Hz
+ *
+ * Values below 1 MHz are taken to be MHz, as in
+ * hdhomerun_channel_store_find(), so "177", "177.0" and "177000000" are
+ * the same frequency.
+ *
+ * Returns: %TRUE if @text is a frequency
+ */
+gboolean
+hdhomerun_tuner_parse_frequency (const char *text,
+                                 guint32    *frequency)
+{
+  g_autofree char *stripped = NULL;
+  char *end = NULL;
+  double value;
+
+  g_return_val_if_fail (text != NULL, FALSE);
+  g_return_val_if_fail (frequency != NULL, FALSE);
+
+  stripped = g_strstrip (g_strdup (text));
+
+  /* Digits and a decimal point only; no signs, exponents or hex */
+  if (*stripped == '\0' || stripped[strspn (stripped, "0123456789.")] != '\0')
+    return FALSE;
+
+  value = g_ascii_strtod (stripped, &end);
+  if (*end != '\0' || value <= 0)
+    return FALSE;
+
+  if (value < 1e6)
+    value = value * 1e6 + 0.5;
+
+  if (value < 1 || value > G_MAXUINT32)
+    return FALSE;
+
+  *frequency = (guint32) value;
+  return TRUE;
+}
+
+/**
+ * hdhomerun_tuner_new:
+ * @connection: the connection of the tuner
+ *
+ * Returns: (transfer full): a new #HdhomerunTuner
+ */
+HdhomerunTuner *
+hdhomerun_tuner_new (HdhomerunConnection *connection)
+{
+  HdhomerunTuner *self;
+
+  g_return_val_if_fail (connection != NULL, NULL);
+
+  self = g_object_new (HDHOMERUN_TYPE_TUNER, NULL);
+  self->connection = connection;
+  hdhomerun_connection_pool_hold (hdhomerun_connection_pool_get_default (), connection);
+
+  return self;
+}
+
+static void
+hdhomerun_tuner_finalize (GObject *object)
+{
+  HdhomerunTuner *self = (HdhomerunTuner *)object;
+
+  hdhomerun_connection_pool_release (hdhomerun_connection_pool_get_default (), self->connection);
+
+  G_OBJECT_CLASS (hdhomerun_tuner_parent_class)->finalize (object);
+}
+
+static void
+hdhomerun_tuner_get_property (GObject    *object,
+                              guint       prop_id,
+                              GValue     *value,
+                              GParamSpec *pspec)
+{
+  HdhomerunTuner *self = HDHOMERUN_TUNER (object);
+
+  switch (prop_id)
+    {
+    case PROP_STATE:
+      g_value_set_enum (value, self->state);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+hdhomerun_tuner_class_init (HdhomerunTunerClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = hdhomerun_tuner_finalize;
+  object_class->get_property = hdhomerun_tuner_get_property;
+
+  properties [PROP_STATE] =
+    g_param_spec_enum ("state",
+                       "State",
+                       "Where the latest tune request is",
+                       HDHOMERUN_TYPE_TUNE_STATE,
+                       HDHOMERUN_TUNE_STATE_IDLE,
+                       (G_PARAM_READABLE |
+                        G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_properties (object_class, N_PROPS, properties);
+
+  signals [TUNED] =
+    g_signal_new ("tuned",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL, NULL,
+                  G_TYPE_NONE, 4,
+                  G_TYPE_UINT,   /* frequency */
+                  G_TYPE_UINT,   /* signal strength */
+                  G_TYPE_UINT,   /* signal to noise quality */
+                  G_TYPE_UINT);  /* symbol quality */
+}
+
+static void
+hdhomerun_tuner_init (HdhomerunTuner *self)
+{
+  self->state = HDHOMERUN_TUNE_STATE_IDLE;
+}
@@ -0,0 +1,52 @@
+/* hdhomerun-tuner.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+#include "hdhomerun-connection-pool.h"
+
+G_BEGIN_DECLS
+
+#define HDHOMERUN_TYPE_TUNE_STATE (hdhomerun_tune_state_get_type())
+#define HDHOMERUN_TYPE_TUNER (hdhomerun_tuner_get_type())
+
+typedef enum
+{
+  HDHOMERUN_TUNE_STATE_IDLE,
+  HDHOMERUN_TUNE_STATE_LOCKING,   /* Requested, lock not confirmed yet */
+  HDHOMERUN_TUNE_STATE_LOCKED,
+  HDHOMERUN_TUNE_STATE_NO_LOCK,
+  HDHOMERUN_TUNE_STATE_FAILED,
+} HdhomerunTuneState;
+
+GType hdhomerun_tune_state_get_type (void) G_GNUC_CONST;
+
+G_DECLARE_FINAL_TYPE (HdhomerunTuner, hdhomerun_tuner, HDHOMERUN, TUNER, GObject)
+
+HdhomerunTuner     *hdhomerun_tuner_new       (HdhomerunConnection *connection);
+void                hdhomerun_tuner_tune      (HdhomerunTuner      *self,
+                                               guint32              frequency,
+                                               guint                program_number);
+HdhomerunTuneState  hdhomerun_tuner_get_state (HdhomerunTuner      *self);
+
+gboolean            hdhomerun_tuner_parse_frequency (const char *text,
+                                                     guint32    *frequency);
+
+G_END_DECLS
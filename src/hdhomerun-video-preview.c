@@ -0,0 +1,464 @@
+/* hdhomerun-video-preview.c
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hdhomerun-config-gtk-config.h"
+
+#include "hdhomerun-video-preview.h"
+
+#if HAVE_LIBVLC
+#include <vlc/vlc.h>
+#endif
+
+/* HdhomerunVideoPreview decodes a HdhomerunStream with libvlc and shows
+ * the frames as a GdkPaintable.
+ *
+ * One libvlc instance is shared by the process and each preview keeps
+ * its media player, so switching tuners only swaps the media. The
+ * decoder renders at preview size straight into a small pool of frame
+ * buffers; a frame goes back to the pool when GTK drops the
+ * texture built on it, so steady-state playback does not allocate pixel
+ * memory. Frames that arrive while the previous one has not been shown
+ * yet replace it.
+ */
+
+#define PREVIEW_WIDTH  640
+#define PREVIEW_HEIGHT 360
+#define FRAME_STRIDE   (PREVIEW_WIDTH * 4)
+#define FRAME_SIZE     (FRAME_STRIDE * PREVIEW_HEIGHT)
+#define FRAME_POOL     4
+
+typedef struct _FramePool FramePool;
+
+typedef struct
+{
+  FramePool *pool;
+  guint8 *pixels;
+} Frame;
+
+/* Shared with textures, which may outlive the preview */
+struct _FramePool
+{
+  GMutex lock;
+  GPtrArray *free_frames;
+};
+
+struct _HdhomerunVideoPreview
+{
+  GObject parent_instance;
+
+  HdhomerunStream *stream;
+  GdkTexture *texture;
+
+  FramePool *pool;
+  Frame *drawing;    /* Decoder thread only */
+  Frame *pending;    /* Guarded by the pool lock */
+  guint present_id;  /* Guarded by the pool lock */
+
+#if HAVE_LIBVLC
+  libvlc_media_player_t *player;
+#endif
+};
+
+static void hdhomerun_video_preview_paintable_init (GdkPaintableInterface *iface);
+
+G_DEFINE_FINAL_TYPE_WITH_CODE (HdhomerunVideoPreview, hdhomerun_video_preview, G_TYPE_OBJECT,
+                               G_IMPLEMENT_INTERFACE (GDK_TYPE_PAINTABLE,
+                                                      hdhomerun_video_preview_paintable_init))
+
+static void
+frame_pool_free (FramePool *pool)
+{
+  g_ptr_array_unref (pool->free_frames);
+  g_mutex_clear (&pool->lock);
+}
+
+static void
+frame_free (Frame *frame)
+{
+  g_free (frame->pixels);
+  g_free (frame);
+}
+
+static FramePool *
+frame_pool_new (void)
+{
+  FramePool *pool = g_atomic_rc_box_new0 (FramePool);
+
+  g_mutex_init (&pool->lock);
+  pool->free_frames = g_ptr_array_new_with_free_func ((GDestroyNotify) frame_free);
+
+  for (guint i = 0; i < FRAME_POOL; i++)
+    {
+      Frame *frame = g_new0 (Frame, 1);
+
+      frame->pool = pool;
+      frame->pixels = g_malloc (FRAME_SIZE);
+      g_ptr_array_add (pool->free_frames, frame);
+    }
+
+  return pool;
+}
+
+static void
+frame_pool_unref (FramePool *pool)
+{
+  g_atomic_rc_box_release_full (pool, (GDestroyNotify) frame_pool_free);
+}
+
+static void
+frame_pool_give (Frame *frame)
+{
+  FramePool *pool = frame->pool;
+
+  g_mutex_lock (&pool->lock);
+  g_ptr_array_add (pool->free_frames, frame);
+  g_mutex_unlock (&pool->lock);
+
+  frame_pool_unref (pool);
+}
+
+#if HAVE_LIBVLC
+
+/* Returns NULL when every frame is in use */
+static Frame *
+frame_pool_take (FramePool *pool)
+{
+  Frame *frame = NULL;
+
+  g_mutex_lock (&pool->lock);
+  if (pool->free_frames->len > 0)
+    {
+      frame = g_ptr_array_steal_index_fast (pool->free_frames, pool->free_frames->len - 1);
+      g_atomic_rc_box_acquire (pool);
+    }
+  g_mutex_unlock (&pool->lock);
+
+  return frame;
+}
+
+static gboolean
+present_frame (gpointer user_data)
+{
+  HdhomerunVideoPreview *self = HDHOMERUN_VIDEO_PREVIEW (user_data);
+  g_autoptr(GBytes) bytes = NULL;
+  Frame *frame;
+
+  g_mutex_lock (&self->pool->lock);
+  frame = g_steal_pointer (&self->pending);
+  self->present_id = 0;
+  g_mutex_unlock (&self->pool->lock);
+
+  if (frame == NULL)
+    return G_SOURCE_REMOVE;
+
+  bytes = g_bytes_new_with_free_func (frame->pixels, FRAME_SIZE,
+                                      (GDestroyNotify) frame_pool_give, frame);
+
+  g_clear_object (&self->texture);
+  self->texture = gdk_memory_texture_new (PREVIEW_WIDTH, PREVIEW_HEIGHT,
+                                          GDK_MEMORY_B8G8R8A8,
+                                          bytes, FRAME_STRIDE);
+
+  gdk_paintable_invalidate_contents (GDK_PAINTABLE (self));
+
+  return G_SOURCE_REMOVE;
+}
+
+static libvlc_instance_t *
+get_vlc_instance (void)
+{
+  static libvlc_instance_t *instance;
+  static gsize initialized;
+
+  if (g_once_init_enter (&initialized))
+    {
+      const char * const args[] = {
+        "--quiet",
+        "--no-audio",
+        "--no-video-title-show",
+        "--avcodec-hw=any",
+        /* Start showing frames as soon as the first keyframe decodes */
+        "--network-caching=300",
+      };
+
+      instance = libvlc_new (G_N_ELEMENTS (args), args);
+      if (instance == NULL)
+        g_warning ("Failed to initialize libvlc, video preview is disabled");
+
+      g_once_init_leave (&initialized, 1);
+    }
+
+  return instance;
+}
+
+static int
+media_open (void      *opaque,
+            void     **datap,
+            uint64_t  *sizep)
+{
+  *datap = opaque;
+  *sizep = UINT64_MAX;
+
+  return 0;
+}
+
+static ssize_t
+media_read (void          *opaque,
+            unsigned char *buf,
+            size_t         len)
+{
+  return hdhomerun_stream_read (HDHOMERUN_STREAM (opaque), buf, len);
+}
+
+static void
+media_close (void *opaque)
+{
+  (void)opaque; /* unused */
+}
+
+static void *
+video_lock (void  *opaque,
+            void **planes)
+{
+  HdhomerunVideoPreview *self = opaque;
+
+  /* A frame libvlc dropped before display is reused as is */
+  if (self->drawing == NULL)
+    self->drawing = frame_pool_take (self->pool);
+
+  /* Every frame is still on screen or queued; decode into the pending
+   * one, which nobody has seen yet.
+   */
+  if (self->drawing == NULL)
+    {
+      g_mutex_lock (&self->pool->lock);
+      self->drawing = g_steal_pointer (&self->pending);
+      g_mutex_unlock (&self->pool->lock);
+    }
+
+  /* Nothing to draw into; libvlc tolerates a scratch plane */
+  if (self->drawing == NULL)
+    {
+      static guint8 scratch[FRAME_SIZE];
+
+      planes[0] = scratch;
+      return NULL;
+    }
+
+  planes[0] = self->drawing->pixels;
+  return self->drawing;
+}
+
+static void
+video_display (void *opaque,
+               void *picture)
+{
+  HdhomerunVideoPreview *self = opaque;
+  Frame *frame = picture;
+  Frame *replaced;
+
+  if (frame == NULL)
+    return;
+
+  self->drawing = NULL;
+
+  g_mutex_lock (&self->pool->lock);
+  replaced = g_steal_pointer (&self->pending);
+  self->pending = frame;
+  if (self->present_id == 0)
+    self->present_id = g_idle_add_full (G_PRIORITY_HIGH_IDLE, present_frame,
+                                        g_object_ref (self), g_object_unref);
+  g_mutex_unlock (&self->pool->lock);
+
+  if (replaced)
+    frame_pool_give (replaced);
+}
+
+static void
+ensure_player (HdhomerunVideoPreview *self)
+{
+  libvlc_instance_t *instance;
+
+  if (self->player)
+    return;
+
+  instance = get_vlc_instance ();
+  if (instance == NULL)
+    return;
+
+  self->player = libvlc_media_player_new (instance);
+  libvlc_video_set_callbacks (self->player, video_lock, NULL, video_display, self);
+  libvlc_video_set_format (self->player, "BGRA", PREVIEW_WIDTH, PREVIEW_HEIGHT, FRAME_STRIDE);
+}
+
+#endif /* HAVE_LIBVLC */
+
+/**
+ * hdhomerun_video_preview_set_stream:
+ * @self: a #HdhomerunVideoPreview
+ * @stream: (nullable): a started stream, or %NULL to stop decoding
+ *
+ * Decode @stream instead of the current one. The previous stream must
+ * have been stopped first so the decoder is not left waiting on it. The
+ * last frame of the previous stream stays up until the new one decodes.
+ */
+void
+hdhomerun_video_preview_set_stream (HdhomerunVideoPreview *self,
+                                    HdhomerunStream       *stream)
+{
+  g_return_if_fail (HDHOMERUN_IS_VIDEO_PREVIEW (self));
+  g_return_if_fail (stream == NULL || HDHOMERUN_IS_STREAM (stream));
+
+#if HAVE_LIBVLC
+  if (self->player)
+    libvlc_media_player_stop (self->player);
+#endif
+
+  g_set_object (&self->stream, stream);
+
+  if (stream == NULL)
+    return;
+
+#if HAVE_LIBVLC
+  ensure_player (self);
+
+  if (self->player)
+    {
+      libvlc_media_t *media;
+
+      media = libvlc_media_new_callbacks (get_vlc_instance (),
+                                          media_open, media_read, NULL, media_close,
+                                          stream);
+      libvlc_media_player_set_media (self->player, media);
+      libvlc_media_release (media);
+      libvlc_media_player_play (self->player);
+    }
+#else
+  g_message ("Built without libvlc, video preview is unavailable");
+#endif
+}
+
+/**
+ * hdhomerun_video_preview_has_frame:
+ * @self: a #HdhomerunVideoPreview
+ *
+ * Returns: %TRUE once a frame has been decoded
+ */
+gboolean
+hdhomerun_video_preview_has_frame (HdhomerunVideoPreview *self)
+{
+  g_return_val_if_fail (HDHOMERUN_IS_VIDEO_PREVIEW (self), FALSE);
+
+  return self->texture != NULL;
+}
+
+static void
+hdhomerun_video_preview_snapshot (GdkPaintable *paintable,
+                                  GdkSnapshot  *snapshot,
+                                  double        width,
+                                  double        height)
+{
+  HdhomerunVideoPreview *self = HDHOMERUN_VIDEO_PREVIEW (paintable);
+
+  if (self->texture)
+    gdk_paintable_snapshot (GDK_PAINTABLE (self->texture), snapshot, width, height);
+}
+
+static int
+hdhomerun_video_preview_get_intrinsic_width (GdkPaintable *paintable)
+{
+  (void)paintable; /* unused */
+
+  return PREVIEW_WIDTH;
+}
+
+static int
+hdhomerun_video_preview_get_intrinsic_height (GdkPaintable *paintable)
+{
+  (void)paintable; /* unused */
+
+  return PREVIEW_HEIGHT;
+}
+
+static GdkPaintableFlags
+hdhomerun_video_preview_get_flags (GdkPaintable *paintable)
+{
+  (void)paintable; /* unused */
+
+  return GDK_PAINTABLE_STATIC_SIZE;
+}
+
+static void
+hdhomerun_video_preview_paintable_init (GdkPaintableInterface *iface)
+{
+  iface->snapshot = hdhomerun_video_preview_snapshot;
+  iface->get_intrinsic_width = hdhomerun_video_preview_get_intrinsic_width;
+  iface->get_intrinsic_height = hdhomerun_video_preview_get_intrinsic_height;
+  iface->get_flags = hdhomerun_video_preview_get_flags;
+}
+
+HdhomerunVideoPreview *
+hdhomerun_video_preview_new (void)
+{
+  return g_object_new (HDHOMERUN_TYPE_VIDEO_PREVIEW, NULL);
+}
+
+static void
+hdhomerun_video_preview_dispose (GObject *object)
+{
+  HdhomerunVideoPreview *self = (HdhomerunVideoPreview *)object;
+
+#if HAVE_LIBVLC
+  /* Stopping joins the decoder, so no callback runs after this */
+  g_clear_pointer (&self->player, libvlc_media_player_release);
+#endif
+
+  g_clear_object (&self->stream);
+  g_clear_object (&self->texture);
+
+  G_OBJECT_CLASS (hdhomerun_video_preview_parent_class)->dispose (object);
+}
+
+static void
+hdhomerun_video_preview_finalize (GObject *object)
+{
+  HdhomerunVideoPreview *self = (HdhomerunVideoPreview *)object;
+
+  if (self->drawing)
+    frame_pool_give (g_steal_pointer (&self->drawing));
+  if (self->pending)
+    frame_pool_give (g_steal_pointer (&self->pending));
+  frame_pool_unref (self->pool);
+
+  G_OBJECT_CLASS (hdhomerun_video_preview_parent_class)->finalize (object);
+}
+
+static void
+hdhomerun_video_preview_class_init (HdhomerunVideoPreviewClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = hdhomerun_video_preview_dispose;
+  object_class->finalize = hdhomerun_video_preview_finalize;
+}
+
+static void
+hdhomerun_video_preview_init (HdhomerunVideoPreview *self)
+{
+  self->pool = frame_pool_new ();
+}
@@ -0,0 +1,36 @@
+/* hdhomerun-video-preview.h
+ *
+ * Copyright 2025 Andrew St. Clair
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <adwaita.h>
+
+#include "hdhomerun-stream.h"
+
+G_BEGIN_DECLS
+
+#define HDHOMERUN_TYPE_VIDEO_PREVIEW (hdhomerun_video_preview_get_type())
+
+G_DECLARE_FINAL_TYPE (HdhomerunVideoPreview, hdhomerun_video_preview, HDHOMERUN, VIDEO_PREVIEW, GObject)
+
+HdhomerunVideoPreview *hdhomerun_video_preview_new        (void);
+void                   hdhomerun_video_preview_set_stream (HdhomerunVideoPreview *self,
+                                                           HdhomerunStream       *stream);
+gboolean               hdhomerun_video_preview_has_frame  (HdhomerunVideoPreview *self);
+
+G_END_DECLS
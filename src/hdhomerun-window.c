@@ -18,14 +18,23 @@
 
 #include "hdhomerun-config-gtk-config.h"
 #include "hdhomerun-window.h"
-#include "hdhomerun-device-row.h"
+#include "hdhomerun-application.h"
+#include "hdhomerun-device-store.h"
+#include "hdhomerun-discovery-cache.h"
+#include "hdhomerun-discovery-monitor.h"
+#include "hdhomerun-dispatcher.h"
+#include "hdhomerun-health-prober.h"
+#include "hdhomerun-job-scheduler.h"
+#include "hdhomerun-scan-cache.h"
 #include "hdhomerun-tuner-row.h"
+#include "hdhomerun-status-poller.h"
+#include "hdhomerun-stream-diagnostics.h"
+#include "hdhomerun-tuner-controller.h"
 #include "hdhomerun-tuner-controls.h"
+#include "hdhomerun-tuner-jobs.h"
+#include "hdhomerun-trace.h"
 
 #include <glib/gi18n.h>
-#include <libhdhomerun/hdhomerun.h>
-
-#define HDHOMERUN_IP_STRING_SIZE 64  /* Size required by libhdhomerun API */
 
 struct _HdhomerunWindow
 {
@@ -34,22 +43,50 @@ struct _HdhomerunWindow
   /* Template widgets */
   AdwHeaderBar *header_bar;
   AdwNavigationSplitView *split_view;
-  GtkListBox *device_list;
+  GtkListView *device_list;
   GtkStack *content_stack;
   AdwStatusPage *placeholder_page;
-  HdhomerunTunerControls *tuner_controls;
+  GtkToggleButton *diagnostics_button;
   GtkButton *add_device_button;
   GtkButton *refresh_button;
+  AdwBanner *jobs_banner;
+
+  /* Pages built the first time they are needed */
+  HdhomerunTunerControls *tuner_controls;
+  HdhomerunStreamDiagnostics *diagnostics;
+
+  /* Startup timing, until the first frame is painted */
+  gint64 init_started;
+  gint64 template_done;
+  gint64 init_done;
+  GdkFrameClock *frame_clock;
+  gulong after_paint_id;
+  gboolean first_frame_seen;
+
+  /* Background results are applied at the start of a frame */
+  GdkFrameClock *update_clock;
+  gulong update_id;
   
   /* State */
   GSettings *settings;
-  GList *devices;
+  HdhomerunDeviceStore *devices;
+  HdhomerunDiscoveryMonitor *monitor;
+  HdhomerunStatusPoller *poller;
+  HdhomerunHealthProber *prober;
+  HdhomerunTunerItem *selected;     /* Watched while the controls show it */
+  GHashTable *controllers;          /* "ID:tuner" -> HdhomerunTunerController */
+  GHashTable *channels;             /* Device ID -> HdhomerunChannelStore */
+  GPtrArray *publish_order;         /* Controllers as made, each a port; NULL once forgotten */
+  GInetSocketAddress *publish_group; /* First published port, or NULL */
+  GtkSelectionModel *selection;     /* Tuners the bulk actions apply to */
+  HdhomerunJobScheduler *jobs;
+  const char *jobs_title;           /* What the running batch does */
 };
 
 G_DEFINE_FINAL_TYPE (HdhomerunWindow, hdhomerun_window, ADW_TYPE_APPLICATION_WINDOW)
 
 /* Forward declarations */
-static void on_tuner_row_activated (AdwActionRow *action_row, HdhomerunWindow *self);
+static void start_discovery (HdhomerunWindow *self);
 
 static void
 on_add_device_response (AdwAlertDialog *dialog,
@@ -58,6 +95,7 @@ on_add_device_response (AdwAlertDialog *dialog,
 {
   GtkWidget *entry;
   const char *ip_address;
+  g_auto(GStrv) targets = NULL;
   
   if (g_strcmp0 (response, "add") != 0)
     return;
@@ -80,12 +118,23 @@ on_add_device_response (AdwAlertDialog *dialog,
           return;
         }
       
-      HdhomerunDeviceRow *row;
-      
-      row = hdhomerun_device_row_new (ip_address, "Manual Device", ip_address);
-      gtk_list_box_append (self->device_list, GTK_WIDGET (row));
-      
       g_message ("Adding device at IP: %s", ip_address);
+
+      /* Probe the address directly alongside the broadcast from now on */
+      targets = g_settings_get_strv (self->settings, "discovery-targets");
+      if (!g_strv_contains ((const char * const *)targets, ip_address))
+        {
+          g_autoptr(GStrvBuilder) builder = g_strv_builder_new ();
+          g_auto(GStrv) new_targets = NULL;
+
+          g_strv_builder_addv (builder, (const char **)targets);
+          g_strv_builder_add (builder, ip_address);
+          new_targets = g_strv_builder_end (builder);
+          g_settings_set_strv (self->settings, "discovery-targets",
+                               (const char * const *)new_targets);
+        }
+
+      start_discovery (self);
     }
 }
 
@@ -116,123 +165,1056 @@ on_add_device_clicked (GtkButton *button,
   adw_dialog_present (dialog, GTK_WIDGET (self));
 }
 
+static void
+on_cache_saved (GObject      *source_object,
+                GAsyncResult *result,
+                gpointer      user_data)
+{
+  g_autoptr(GError) error = NULL;
+
+  (void)source_object; /* unused */
+  (void)user_data; /* unused */
+
+  if (!hdhomerun_discovery_cache_save_finish (result, &error))
+    g_warning ("Failed to save discovery cache: %s", error->message);
+}
+
+static void
+load_cached_devices (HdhomerunWindow *self)
+{
+  g_autoptr(GPtrArray) snapshot = NULL;
+  g_autoptr(GError) error = NULL;
+
+  snapshot = hdhomerun_discovery_cache_load (&error);
+  if (snapshot == NULL)
+    {
+      if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+        g_warning ("Failed to load discovery cache: %s", error->message);
+      return;
+    }
+
+  g_message ("Showing %u cached device(s) until discovery completes", snapshot->len);
+
+  hdhomerun_discovery_monitor_seed (self->monitor, snapshot);
+}
+
+static void
+on_device_added (HdhomerunDiscoveryMonitor *monitor,
+                 HdhomerunDeviceInfo       *info,
+                 HdhomerunWindow           *self)
+{
+  g_autoptr(HdhomerunDeviceInfo) stored = NULL;
+
+  (void)monitor; /* unused */
+
+  g_message ("Found device: %s at %s (%u interface(s)) with %u tuner(s)",
+             info->device_id_str,
+             info->control_address ? info->control_address : "unknown address",
+             g_strv_length (info->ip_addresses),
+             info->tuner_count);
+
+  stored = hdhomerun_health_prober_apply (self->prober, info);
+  hdhomerun_device_store_set_device (self->devices, stored);
+}
+
+/* Controllers keep their connection, which follows a new address by
+ * itself, so only their record of the device is swapped.
+ */
+static void
+update_controllers (HdhomerunWindow           *self,
+                    const HdhomerunDeviceInfo *info)
+{
+  GHashTableIter iter;
+  HdhomerunTunerController *controller;
+
+  g_hash_table_iter_init (&iter, self->controllers);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &controller))
+    hdhomerun_tuner_controller_update_device (controller, info);
+}
+
+static void
+on_device_changed (HdhomerunDiscoveryMonitor *monitor,
+                   HdhomerunDeviceInfo       *info,
+                   HdhomerunWindow           *self)
+{
+  g_autoptr(HdhomerunDeviceInfo) stored = NULL;
+
+  (void)monitor; /* unused */
+
+  g_message ("Device %s changed", info->device_id_str);
+
+  /* Keep the interface the prober settled on if it is still there */
+  stored = hdhomerun_health_prober_apply (self->prober, info);
+  hdhomerun_device_store_set_device (self->devices, stored);
+  update_controllers (self, stored);
+
+  /* Histories of tuners the device no longer has; 0 is not known yet */
+  if (stored->tuner_count > 0)
+    hdhomerun_status_poller_forget (self->poller, stored->device_id_str, stored->tuner_count);
+}
+
+/* Stop whatever the tuners of a device that went away were doing, so a
+ * device that comes back starts from fresh controllers. Dropping a
+ * controller releases its pooled connection.
+ */
+static void
+forget_controllers (HdhomerunWindow *self,
+                    const char      *device_id)
+{
+  GHashTableIter iter;
+  const char *key;
+  HdhomerunTunerController *controller;
+  g_autofree char *prefix = g_strconcat (device_id, ":", NULL);
+
+  if (self->selected != NULL &&
+      g_str_equal (hdhomerun_tuner_item_get_device_id (self->selected), device_id))
+    {
+      hdhomerun_status_poller_unwatch (self->poller, self->selected);
+      g_clear_object (&self->selected);
+      if (self->tuner_controls != NULL)
+        hdhomerun_tuner_controls_set_controller (self->tuner_controls, NULL);
+      gtk_toggle_button_set_active (self->diagnostics_button, FALSE);
+      gtk_widget_set_sensitive (GTK_WIDGET (self->diagnostics_button), FALSE);
+      gtk_stack_set_visible_child_name (self->content_stack, "placeholder");
+    }
+
+  g_hash_table_iter_init (&iter, self->controllers);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &key, (gpointer *) &controller))
+    {
+      guint index;
+
+      if (!g_str_has_prefix (key, prefix))
+        continue;
+
+      hdhomerun_tuner_controller_stop_recording (controller);
+      hdhomerun_tuner_controller_set_playing (controller, FALSE);
+      hdhomerun_tuner_controller_cancel_scan (controller);
+
+      /* Keep the other controllers on their ports */
+      if (g_ptr_array_find (self->publish_order, controller, &index))
+        g_ptr_array_index (self->publish_order, index) = NULL;
+
+      g_hash_table_iter_remove (&iter);
+    }
+}
+
+static void
+on_device_removed (HdhomerunDiscoveryMonitor *monitor,
+                   HdhomerunDeviceInfo       *info,
+                   HdhomerunWindow           *self)
+{
+  (void)monitor; /* unused */
+
+  g_message ("Device %s went away", info->device_id_str);
+
+  forget_controllers (self, info->device_id_str);
+  hdhomerun_health_prober_forget (self->prober, info->device_id_str);
+  hdhomerun_status_poller_forget (self->poller, info->device_id_str, 0);
+  hdhomerun_device_store_remove_device (self->devices, info->device_id_str);
+}
+
+static void
+on_interface_changed (HdhomerunHealthProber *prober,
+                      HdhomerunDeviceInfo   *info,
+                      HdhomerunWindow       *self)
+{
+  (void)prober; /* unused */
+
+  update_controllers (self, info);
+}
+
+static void
+on_scan_finished (HdhomerunDiscoveryMonitor *monitor,
+                  GPtrArray                 *snapshot,
+                  HdhomerunWindow           *self)
+{
+  (void)monitor; /* unused */
+  (void)self; /* unused */
+
+  /* Remember this pass so the next launch can show it straight away */
+  hdhomerun_discovery_cache_save_async (snapshot, NULL, on_cache_saved, NULL);
+}
+
+static void
+start_discovery (HdhomerunWindow *self)
+{
+  g_message ("Refreshing device list...");
+
+  hdhomerun_discovery_monitor_refresh (self->monitor);
+}
+
 static void
 on_refresh_clicked (GtkButton *button,
                    HdhomerunWindow *self)
 {
-  GtkWidget *child;
-  struct hdhomerun_discover_t *ds;
-  uint32_t flags;
-  uint32_t device_types[1];
-  struct hdhomerun_discover2_device_t *device = NULL;
-  
   (void)button; /* unused */
-  
-  /* Clear existing devices */
-  while ((child = gtk_widget_get_first_child (GTK_WIDGET (self->device_list))) != NULL)
+
+  start_discovery (self);
+}
+
+static void
+on_demux_changed (HdhomerunTunerControls *controls,
+                  GParamSpec             *pspec,
+                  HdhomerunWindow        *self)
+{
+  (void)pspec; /* unused */
+
+  if (self->diagnostics != NULL)
+    hdhomerun_stream_diagnostics_set_demux (self->diagnostics,
+                                            hdhomerun_tuner_controls_get_demux (controls));
+}
+
+/* Most of the startup cost of the window was this page, which nobody
+ * sees before picking a tuner.
+ */
+static void
+ensure_tuner_page (HdhomerunWindow *self)
+{
+  gint64 trace;
+
+  if (self->tuner_controls != NULL)
+    return;
+
+  trace = hdhomerun_trace_begin ();
+
+  self->tuner_controls = hdhomerun_tuner_controls_new ();
+  hdhomerun_tuner_controls_set_status_poller (self->tuner_controls, self->poller);
+  g_signal_connect (self->tuner_controls, "notify::demux",
+                    G_CALLBACK (on_demux_changed), self);
+  gtk_stack_add_named (self->content_stack, GTK_WIDGET (self->tuner_controls), "tuner");
+
+  hdhomerun_trace_end (trace, "create-page", "tuner");
+}
+
+static void
+ensure_diagnostics_page (HdhomerunWindow *self)
+{
+  GtkWidget *scrolled;
+
+  if (self->diagnostics != NULL)
+    return;
+
+  self->diagnostics = HDHOMERUN_STREAM_DIAGNOSTICS (hdhomerun_stream_diagnostics_new ());
+  gtk_widget_set_margin_start (GTK_WIDGET (self->diagnostics), 24);
+  gtk_widget_set_margin_end (GTK_WIDGET (self->diagnostics), 24);
+  gtk_widget_set_margin_top (GTK_WIDGET (self->diagnostics), 24);
+  gtk_widget_set_margin_bottom (GTK_WIDGET (self->diagnostics), 24);
+  gtk_widget_set_halign (GTK_WIDGET (self->diagnostics), GTK_ALIGN_CENTER);
+  gtk_widget_set_valign (GTK_WIDGET (self->diagnostics), GTK_ALIGN_START);
+
+  scrolled = gtk_scrolled_window_new ();
+  gtk_widget_set_vexpand (scrolled, TRUE);
+  gtk_scrolled_window_set_child (GTK_SCROLLED_WINDOW (scrolled), GTK_WIDGET (self->diagnostics));
+  gtk_stack_add_named (self->content_stack, scrolled, "diagnostics");
+
+  if (self->tuner_controls != NULL)
+    hdhomerun_stream_diagnostics_set_demux (self->diagnostics,
+                                            hdhomerun_tuner_controls_get_demux (self->tuner_controls));
+}
+
+static void
+on_diagnostics_toggled (GtkToggleButton *button,
+                        HdhomerunWindow *self)
+{
+  gboolean active = gtk_toggle_button_get_active (button);
+
+  if (active)
+    ensure_diagnostics_page (self);
+
+  gtk_stack_set_visible_child_name (self->content_stack, active ? "diagnostics" : "tuner");
+}
+
+/* The channels found by earlier scans of the device, shared by all of
+ * its tuners
+ */
+static HdhomerunChannelStore *
+lookup_channels (HdhomerunWindow *self,
+                 const char      *device_id)
+{
+  g_autoptr(GPtrArray) results = NULL;
+  g_autoptr(GError) error = NULL;
+  HdhomerunChannelStore *channels;
+
+  channels = g_hash_table_lookup (self->channels, device_id);
+  if (channels != NULL)
+    return channels;
+
+  results = hdhomerun_scan_cache_load (device_id, &error);
+  if (results == NULL)
     {
-      gtk_list_box_remove (self->device_list, child);
+      if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+        g_message ("Ignoring scan cache: %s", error->message);
+      results = g_ptr_array_new ();
     }
-  
-  g_message ("Refreshing device list...");
-  
-  /* Perform device discovery using libhdhomerun */
-  ds = hdhomerun_discover_create (NULL);
-  if (!ds)
+
+  channels = hdhomerun_channel_store_new ();
+  hdhomerun_channel_store_set_results (channels, results);
+  g_hash_table_insert (self->channels, g_strdup (device_id), channels);
+
+  return channels;
+}
+
+/* Each controller publishes to a port of its own, counted up from the
+ * configured one in the order the tuners were first shown.
+ */
+static GInetSocketAddress *
+publish_address_for (HdhomerunWindow *self,
+                     guint            offset)
+{
+  guint port;
+
+  if (self->publish_group == NULL)
+    return NULL;
+
+  port = g_inet_socket_address_get_port (self->publish_group) + offset;
+  if (port > G_MAXUINT16)
+    return NULL;
+
+  return G_INET_SOCKET_ADDRESS (g_inet_socket_address_new (g_inet_socket_address_get_address (self->publish_group),
+                                                           (guint16) port));
+}
+
+static GInetSocketAddress *
+parse_publish_group (const char *value)
+{
+  g_autoptr(GSocketConnectable) connectable = NULL;
+  g_autoptr(GInetAddress) group = NULL;
+  g_autoptr(GError) error = NULL;
+  guint16 port = 0;
+
+  connectable = g_network_address_parse (value, 0, &error);
+  if (connectable != NULL)
     {
-      g_warning ("Failed to initialize device discovery");
-      return;
+      group = g_inet_address_new_from_string (g_network_address_get_hostname (G_NETWORK_ADDRESS (connectable)));
+      port = g_network_address_get_port (G_NETWORK_ADDRESS (connectable));
     }
-  
-  flags = HDHOMERUN_DISCOVER_FLAGS_IPV4_GENERAL;
-  device_types[0] = HDHOMERUN_DEVICE_TYPE_TUNER;
-  
-  if (hdhomerun_discover2_find_devices_broadcast (ds, flags, device_types, 1) >= 0)
+
+  if (group == NULL || port == 0 ||
+      g_inet_address_get_family (group) != G_SOCKET_FAMILY_IPV4 ||
+      !g_inet_address_get_is_multicast (group))
     {
-      device = hdhomerun_discover2_iter_device_first (ds);
-      while (device)
-        {
-          struct hdhomerun_discover2_device_if_t *device_if;
-          struct sockaddr_storage ip_address;
-          char ip_address_str[HDHOMERUN_IP_STRING_SIZE];  /* Buffer for IPv4/IPv6 address string */
-          uint32_t device_id;
-          char device_id_str[9];    /* Buffer for 8-char hex ID plus null */
-          uint8_t tuner_count;
-          
-          device_id = hdhomerun_discover2_device_get_device_id (device);
-          g_snprintf (device_id_str, sizeof (device_id_str), "%08X", device_id);
-          
-          /* Get the number of tuners on this device */
-          tuner_count = hdhomerun_discover2_device_get_tuner_count (device);
-          
-          /* Iterate through all network interfaces for this device */
-          device_if = hdhomerun_discover2_iter_device_if_first (device);
-          while (device_if)
-            {
-              HdhomerunTunerRow *tuner_row;
-              
-              hdhomerun_discover2_device_if_get_ip_addr (device_if, &ip_address);
-              /* Convert IP address to string, FALSE omits port for display */
-              hdhomerun_sock_sockaddr_to_ip_str (ip_address_str, (struct sockaddr *)&ip_address, FALSE);
-              
-              g_message ("Found device: %s at %s", device_id_str, ip_address_str);
-              g_message ("Device has %u tuner(s)", tuner_count);
-              
-              /* Add tuner rows directly to the device list */
-              for (guint i = 0; i < tuner_count; i++)
-                {
-                  tuner_row = hdhomerun_tuner_row_new (device_id_str, i);
-                  gtk_list_box_append (self->device_list, GTK_WIDGET (tuner_row));
-                  
-                  /* Connect the activated signal for this tuner row */
-                  g_signal_connect (tuner_row, "activated", G_CALLBACK (on_tuner_row_activated), self);
-                  
-                  g_message ("Added tuner %u to device %s", i, device_id_str);
-                }
-              
-              device_if = hdhomerun_discover2_iter_device_if_next (device_if);
-            }
-          
-          device = hdhomerun_discover2_iter_device_next (device);
-        }
+      g_warning ("Not publishing streams: %s is not an IPv4 multicast group and port", value);
+      return NULL;
     }
-  
-  hdhomerun_discover_destroy (ds);
+
+  return G_INET_SOCKET_ADDRESS (g_inet_socket_address_new (group, port));
 }
 
 static void
-on_tuner_row_activated (AdwActionRow *action_row,
-                        HdhomerunWindow *self)
+on_publish_group_changed (GSettings       *settings,
+                          const char      *key,
+                          HdhomerunWindow *self)
+{
+  g_autofree char *value = g_settings_get_string (settings, key);
+
+  g_clear_object (&self->publish_group);
+  if (*value != '\0')
+    self->publish_group = parse_publish_group (value);
+
+  for (guint i = 0; i < self->publish_order->len; i++)
+    {
+      g_autoptr(GInetSocketAddress) address = NULL;
+
+      /* A port whose device went away */
+      if (g_ptr_array_index (self->publish_order, i) == NULL)
+        continue;
+
+      address = publish_address_for (self, i);
+      hdhomerun_tuner_controller_set_publish_address (g_ptr_array_index (self->publish_order, i),
+                                                      address);
+    }
+}
+
+/* A tuner gets its controller the first time it is shown and keeps it,
+ * so coming back to it picks up where it was left.
+ */
+static HdhomerunTunerController *
+lookup_controller (HdhomerunWindow           *self,
+                   const HdhomerunDeviceInfo *info,
+                   guint                      tuner_index)
+{
+  g_autofree char *key = g_strdup_printf ("%s:%u", info->device_id_str, tuner_index);
+  g_autoptr(GInetSocketAddress) address = NULL;
+  HdhomerunTunerController *controller;
+  guint offset;
+
+  controller = g_hash_table_lookup (self->controllers, key);
+  if (controller != NULL)
+    return controller;
+
+  controller = hdhomerun_tuner_controller_new (info, tuner_index,
+                                               lookup_channels (self, info->device_id_str));
+  g_hash_table_insert (self->controllers, g_steal_pointer (&key), controller);
+
+  /* Take the first port a forgotten device left */
+  if (g_ptr_array_find (self->publish_order, NULL, &offset))
+    g_ptr_array_index (self->publish_order, offset) = controller;
+  else
+    {
+      offset = self->publish_order->len;
+      g_ptr_array_add (self->publish_order, controller);
+    }
+
+  address = publish_address_for (self, offset);
+  if (address != NULL)
+    hdhomerun_tuner_controller_set_publish_address (controller, address);
+
+  return controller;
+}
+
+static void
+show_tuner (HdhomerunWindow    *self,
+            HdhomerunTunerItem *item)
 {
-  HdhomerunTunerRow *tuner_row = HDHOMERUN_TUNER_ROW (action_row);
-  char *device_id;
+  const HdhomerunDeviceInfo *info;
+  const char *device_id;
   guint tuner_index;
-  
+
   /* Get the tuner information */
-  g_object_get (tuner_row,
-                "device-id", &device_id,
-                "tuner-index", &tuner_index,
-                NULL);
-  
+  device_id = hdhomerun_tuner_item_get_device_id (item);
+  tuner_index = hdhomerun_tuner_item_get_tuner_index (item);
+
   g_message ("Selected tuner %u on device %s", tuner_index, device_id);
-  
-  /* Switch to the tuner controls view */
-  gtk_stack_set_visible_child_name (self->content_stack, "tuner");
-  
+
+  /* Keep the history of the shown tuner filling in when its row scrolls away */
+  if (self->selected != NULL)
+    hdhomerun_status_poller_unwatch (self->poller, self->selected);
+  g_set_object (&self->selected, item);
+  hdhomerun_status_poller_watch (self->poller, self->selected);
+
+  ensure_tuner_page (self);
+
+  /* Never leave the previous tuner's controller bound to this one's page */
+  info = hdhomerun_device_store_lookup_device (self->devices, device_id);
+  if (info != NULL && info->control_address != NULL)
+    hdhomerun_tuner_controls_set_controller (self->tuner_controls,
+                                             lookup_controller (self, info, tuner_index));
+  else
+    hdhomerun_tuner_controls_set_controller (self->tuner_controls, NULL);
+
+  /* Switch to the tuner controls view, unless diagnostics are up */
+  gtk_widget_set_sensitive (GTK_WIDGET (self->diagnostics_button), TRUE);
+  gtk_stack_set_visible_child_name (self->content_stack,
+                                    gtk_toggle_button_get_active (self->diagnostics_button) ?
+                                    "diagnostics" : "tuner");
+
   /* Show the split view content on mobile */
   adw_navigation_split_view_set_show_content (self->split_view, TRUE);
-  
-  g_free (device_id);
+}
+
+static void
+on_tuner_row_activated (GtkListView     *list_view,
+                        guint            position,
+                        HdhomerunWindow *self)
+{
+  g_autoptr(HdhomerunTunerItem) item = NULL;
+
+  (void)list_view; /* unused */
+
+  item = g_list_model_get_item (G_LIST_MODEL (self->devices), position);
+  if (item != NULL)
+    show_tuner (self, item);
 }
 
 static gboolean
-refresh_devices_async (gpointer user_data)
+is_shown (HdhomerunWindow    *self,
+          HdhomerunTunerItem *item)
 {
-  HdhomerunWindow *self = HDHOMERUN_WINDOW (user_data);
-  
-  on_refresh_clicked (NULL, self);
-  
-  return G_SOURCE_REMOVE;
+  return self->selected != NULL &&
+         hdhomerun_tuner_item_get_tuner_index (self->selected) == hdhomerun_tuner_item_get_tuner_index (item) &&
+         g_str_equal (hdhomerun_tuner_item_get_device_id (self->selected),
+                      hdhomerun_tuner_item_get_device_id (item));
+}
+
+/* A click selects a single row, which shows it; extending the selection
+ * leaves the page on the tuner it was on.
+ */
+static void
+on_selection_changed (GtkSelectionModel *selection,
+                      guint              position,
+                      guint              n_items,
+                      HdhomerunWindow   *self)
+{
+  g_autoptr(GtkBitset) selected = gtk_selection_model_get_selection (selection);
+  gboolean any = !gtk_bitset_is_empty (selected);
+  const char *actions[] = { "tune-selected", "stop-selected", "scan-selected", "status-selected" };
+
+  (void)position; /* unused */
+  (void)n_items; /* unused */
+
+  for (guint i = 0; i < G_N_ELEMENTS (actions); i++)
+    g_simple_action_set_enabled (G_SIMPLE_ACTION (g_action_map_lookup_action (G_ACTION_MAP (self),
+                                                                              actions[i])),
+                                 any);
+
+  if (gtk_bitset_get_size (selected) == 1)
+    {
+      g_autoptr(HdhomerunTunerItem) item = NULL;
+
+      item = g_list_model_get_item (G_LIST_MODEL (self->devices), gtk_bitset_get_minimum (selected));
+      if (item != NULL && !is_shown (self, item))
+        show_tuner (self, item);
+    }
+}
+
+/* Bulk actions */
+
+static void
+update_jobs_banner (HdhomerunWindow *self)
+{
+  g_autofree char *title = NULL;
+  guint n_jobs = hdhomerun_job_scheduler_get_n_jobs (self->jobs);
+  guint n_done = hdhomerun_job_scheduler_get_n_done (self->jobs);
+  guint n_failed = hdhomerun_job_scheduler_get_n_failed (self->jobs);
+  guint n_cancelled = hdhomerun_job_scheduler_get_n_cancelled (self->jobs);
+
+  if (self->jobs_title == NULL)
+    return;
+
+  if (hdhomerun_job_scheduler_is_busy (self->jobs))
+    {
+      /* Translators: e.g. "Tuning: 12 of 40 done, 2 failed" */
+      title = g_strdup_printf (_("%s: %u of %u done, %u failed"),
+                               self->jobs_title, n_done, n_jobs, n_failed);
+      adw_banner_set_button_label (self->jobs_banner, _("_Cancel"));
+    }
+  else if (n_cancelled > 0)
+    {
+      /* Translators: e.g. "Tuning finished: 30 of 40 succeeded, 8 cancelled" */
+      title = g_strdup_printf (_("%s finished: %u of %u succeeded, %u cancelled"),
+                               self->jobs_title, n_jobs - n_failed - n_cancelled, n_jobs,
+                               n_cancelled);
+      adw_banner_set_button_label (self->jobs_banner, _("_Dismiss"));
+    }
+  else
+    {
+      /* Translators: e.g. "Tuning finished: 38 of 40 succeeded" */
+      title = g_strdup_printf (_("%s finished: %u of %u succeeded"),
+                               self->jobs_title, n_jobs - n_failed, n_jobs);
+      adw_banner_set_button_label (self->jobs_banner, _("_Dismiss"));
+    }
+
+  adw_banner_set_title (self->jobs_banner, title);
+  adw_banner_set_revealed (self->jobs_banner, TRUE);
+}
+
+static void
+on_jobs_progress (HdhomerunJobScheduler *jobs,
+                  GParamSpec            *pspec,
+                  HdhomerunWindow       *self)
+{
+  (void)jobs; /* unused */
+  (void)pspec; /* unused */
+
+  update_jobs_banner (self);
+}
+
+static void
+on_job_finished (HdhomerunJobScheduler *jobs,
+                 const char            *label,
+                 const char            *summary,
+                 const GError          *error,
+                 HdhomerunWindow       *self)
+{
+  (void)jobs; /* unused */
+
+  if (error == NULL)
+    g_message ("%s %s: %s", self->jobs_title, label, summary ? summary : "done");
+  else if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    g_debug ("%s %s: %s", self->jobs_title, label, error->message);
+  else
+    g_warning ("%s %s failed: %s", self->jobs_title, label, error->message);
+}
+
+static void
+on_jobs_banner_clicked (AdwBanner       *banner,
+                        HdhomerunWindow *self)
+{
+  if (hdhomerun_job_scheduler_is_busy (self->jobs))
+    hdhomerun_job_scheduler_cancel (self->jobs);
+  else
+    adw_banner_set_revealed (banner, FALSE);
+}
+
+/* Tell the user why a bulk action did nothing, where its progress
+ * would have been.
+ */
+static void
+show_batch_notice (HdhomerunWindow *self,
+                   const char      *notice)
+{
+  g_message ("%s", notice);
+
+  adw_banner_set_title (self->jobs_banner, notice);
+  adw_banner_set_button_label (self->jobs_banner, _("_Dismiss"));
+  adw_banner_set_revealed (self->jobs_banner, TRUE);
+}
+
+/* Returns: (transfer container): the selected tuners whose devices can
+ * be reached, as HdhomerunTunerItems
+ */
+static GPtrArray *
+get_selected_tuners (HdhomerunWindow *self)
+{
+  g_autoptr(GtkBitset) selected = gtk_selection_model_get_selection (self->selection);
+  GPtrArray *items = g_ptr_array_new_with_free_func (g_object_unref);
+  GtkBitsetIter iter;
+  guint position;
+
+  if (gtk_bitset_iter_init_first (&iter, selected, &position))
+    {
+      do
+        {
+          HdhomerunTunerItem *item = g_list_model_get_item (G_LIST_MODEL (self->devices), position);
+          const HdhomerunDeviceInfo *info;
+
+          info = hdhomerun_device_store_lookup_device (self->devices,
+                                                       hdhomerun_tuner_item_get_device_id (item));
+          if (info != NULL && info->control_address != NULL)
+            g_ptr_array_add (items, item);
+          else
+            g_object_unref (item);
+        }
+      while (gtk_bitset_iter_next (&iter, &position));
+    }
+
+  return items;
+}
+
+/* A batch runs to the end before another can start, so each banner
+ * counts one action.
+ *
+ * Returns: (transfer container) (nullable): the tuners to run it on, or
+ *   %NULL when there are none or another batch is running
+ */
+static GPtrArray *
+begin_batch (HdhomerunWindow *self,
+             const char      *title)
+{
+  g_autoptr(GtkBitset) selected = NULL;
+  g_autoptr(GPtrArray) items = NULL;
+
+  if (hdhomerun_job_scheduler_is_busy (self->jobs))
+    {
+      g_message ("%s is still running", self->jobs_title);
+      return NULL;
+    }
+
+  selected = gtk_selection_model_get_selection (self->selection);
+  if (gtk_bitset_is_empty (selected))
+    {
+      show_batch_notice (self, _("Select one or more tuners first"));
+      return NULL;
+    }
+
+  items = get_selected_tuners (self);
+  if (items->len == 0)
+    {
+      show_batch_notice (self, _("None of the selected tuners can be reached"));
+      return NULL;
+    }
+
+  self->jobs_title = title;
+
+  return g_steal_pointer (&items);
+}
+
+static HdhomerunTunerController *
+lookup_item_controller (HdhomerunWindow    *self,
+                        HdhomerunTunerItem *item)
+{
+  const HdhomerunDeviceInfo *info;
+
+  info = hdhomerun_device_store_lookup_device (self->devices,
+                                               hdhomerun_tuner_item_get_device_id (item));
+
+  return lookup_controller (self, info, hdhomerun_tuner_item_get_tuner_index (item));
+}
+
+static void
+on_tune_selected_response (AdwAlertDialog  *dialog,
+                           char            *response,
+                           HdhomerunWindow *self)
+{
+  g_autoptr(GPtrArray) items = NULL;
+  GtkWidget *entry;
+  const char *channel;
+
+  if (g_strcmp0 (response, "tune") != 0)
+    return;
+
+  entry = g_object_get_data (G_OBJECT (dialog), "channel-entry");
+  channel = gtk_editable_get_text (GTK_EDITABLE (entry));
+  if (channel == NULL || *channel == '\0')
+    return;
+
+  /* The selection may have changed while the dialog was up */
+  items = begin_batch (self, _("Tuning"));
+  if (items == NULL)
+    return;
+
+  for (guint i = 0; i < items->len; i++)
+    hdhomerun_tuner_jobs_add_tune (self->jobs,
+                                   lookup_item_controller (self, g_ptr_array_index (items, i)),
+                                   channel);
+}
+
+static void
+tune_selected_action (GSimpleAction *action,
+                      GVariant      *parameter,
+                      gpointer       user_data)
+{
+  HdhomerunWindow *self = user_data;
+  g_autoptr(GtkBitset) selected = NULL;
+  AdwDialog *dialog;
+  GtkWidget *entry;
+
+  (void)action; /* unused */
+  (void)parameter; /* unused */
+
+  /* Do not ask for a channel nothing would be tuned to */
+  selected = gtk_selection_model_get_selection (self->selection);
+  if (gtk_bitset_is_empty (selected))
+    {
+      show_batch_notice (self, _("Select one or more tuners first"));
+      return;
+    }
+
+  dialog = adw_alert_dialog_new (_("Tune Selected Tuners"),
+                                 _("Enter a channel, callsign or frequency for every selected tuner."));
+
+  entry = gtk_entry_new ();
+  gtk_entry_set_placeholder_text (GTK_ENTRY (entry), "8.1");
+  gtk_entry_set_activates_default (GTK_ENTRY (entry), TRUE);
+  adw_alert_dialog_set_extra_child (ADW_ALERT_DIALOG (dialog), entry);
+  g_object_set_data (G_OBJECT (dialog), "channel-entry", entry);
+
+  adw_alert_dialog_add_response (ADW_ALERT_DIALOG (dialog), "cancel", _("_Cancel"));
+  adw_alert_dialog_add_response (ADW_ALERT_DIALOG (dialog), "tune", _("_Tune"));
+  adw_alert_dialog_set_response_appearance (ADW_ALERT_DIALOG (dialog), "tune", ADW_RESPONSE_SUGGESTED);
+  adw_alert_dialog_set_default_response (ADW_ALERT_DIALOG (dialog), "tune");
+
+  g_signal_connect (dialog, "response", G_CALLBACK (on_tune_selected_response), self);
+
+  adw_dialog_present (dialog, GTK_WIDGET (self));
+}
+
+static void
+stop_selected_action (GSimpleAction *action,
+                      GVariant      *parameter,
+                      gpointer       user_data)
+{
+  HdhomerunWindow *self = user_data;
+  g_autoptr(GPtrArray) items = NULL;
+  guint n_added = 0;
+
+  (void)action; /* unused */
+  (void)parameter; /* unused */
+
+  items = begin_batch (self, _("Stopping"));
+  if (items == NULL)
+    return;
+
+  /* Tuners never shown have no controller, so nothing of ours to stop */
+  for (guint i = 0; i < items->len; i++)
+    {
+      HdhomerunTunerItem *item = g_ptr_array_index (items, i);
+      g_autofree char *key = g_strdup_printf ("%s:%u", hdhomerun_tuner_item_get_device_id (item),
+                                              hdhomerun_tuner_item_get_tuner_index (item));
+      HdhomerunTunerController *controller = g_hash_table_lookup (self->controllers, key);
+
+      if (controller != NULL)
+        {
+          hdhomerun_tuner_jobs_add_stop (self->jobs, controller);
+          n_added++;
+        }
+    }
+
+  if (n_added == 0)
+    show_batch_notice (self, _("None of the selected tuners is streaming"));
+}
+
+static void
+scan_selected_action (GSimpleAction *action,
+                      GVariant      *parameter,
+                      gpointer       user_data)
+{
+  HdhomerunWindow *self = user_data;
+  g_autoptr(GPtrArray) items = NULL;
+  g_autoptr(GHashTable) devices = NULL;
+
+  (void)action; /* unused */
+  (void)parameter; /* unused */
+
+  items = begin_batch (self, _("Scanning"));
+  if (items == NULL)
+    return;
+
+  /* A scan uses every idle tuner of its device, so one per device */
+  devices = g_hash_table_new (g_str_hash, g_str_equal);
+  for (guint i = 0; i < items->len; i++)
+    {
+      HdhomerunTunerItem *item = g_ptr_array_index (items, i);
+      const char *device_id = hdhomerun_tuner_item_get_device_id (item);
+
+      if (g_hash_table_add (devices, (gpointer) device_id))
+        hdhomerun_tuner_jobs_add_scan (self->jobs, lookup_item_controller (self, item));
+    }
+}
+
+static void
+status_selected_action (GSimpleAction *action,
+                        GVariant      *parameter,
+                        gpointer       user_data)
+{
+  HdhomerunWindow *self = user_data;
+  g_autoptr(GPtrArray) items = NULL;
+
+  (void)action; /* unused */
+  (void)parameter; /* unused */
+
+  items = begin_batch (self, _("Reading status"));
+  if (items == NULL)
+    return;
+
+  for (guint i = 0; i < items->len; i++)
+    {
+      HdhomerunTunerItem *item = g_ptr_array_index (items, i);
+      const HdhomerunDeviceInfo *info;
+
+      info = hdhomerun_device_store_lookup_device (self->devices,
+                                                   hdhomerun_tuner_item_get_device_id (item));
+      hdhomerun_tuner_jobs_add_status (self->jobs, info,
+                                       hdhomerun_tuner_item_get_tuner_index (item));
+    }
+}
+
+static const GActionEntry win_actions[] = {
+  { "tune-selected", tune_selected_action, NULL, NULL, NULL },
+  { "stop-selected", stop_selected_action, NULL, NULL, NULL },
+  { "scan-selected", scan_selected_action, NULL, NULL, NULL },
+  { "status-selected", status_selected_action, NULL, NULL, NULL },
+};
+
+static void
+setup_tuner_row (GtkSignalListItemFactory *factory,
+                 GtkListItem              *list_item,
+                 HdhomerunWindow          *self)
+{
+  gint64 trace = hdhomerun_trace_begin ();
+
+  (void)factory; /* unused */
+  (void)self; /* unused */
+
+  gtk_list_item_set_child (list_item, GTK_WIDGET (hdhomerun_tuner_row_new ()));
+
+  hdhomerun_trace_end (trace, "setup-row", "position %u", gtk_list_item_get_position (list_item));
+}
+
+static void
+bind_tuner_row (GtkSignalListItemFactory *factory,
+                GtkListItem              *list_item,
+                HdhomerunWindow          *self)
+{
+  GtkWidget *row = gtk_list_item_get_child (list_item);
+  HdhomerunTunerItem *item = gtk_list_item_get_item (list_item);
+  gint64 trace = hdhomerun_trace_begin ();
+
+  (void)factory; /* unused */
+
+  /* Only bound rows are polled, so off-screen tuners cost nothing */
+  hdhomerun_tuner_row_set_item (HDHOMERUN_TUNER_ROW (row), item);
+  hdhomerun_status_poller_watch (self->poller, item);
+
+  hdhomerun_trace_end (trace, "bind-row", "position %u", gtk_list_item_get_position (list_item));
+}
+
+static void
+unbind_tuner_row (GtkSignalListItemFactory *factory,
+                  GtkListItem              *list_item,
+                  HdhomerunWindow          *self)
+{
+  GtkWidget *row = gtk_list_item_get_child (list_item);
+  HdhomerunTunerItem *item = hdhomerun_tuner_row_get_item (HDHOMERUN_TUNER_ROW (row));
+
+  (void)factory; /* unused */
+
+  if (item != NULL && self->poller != NULL)
+    hdhomerun_status_poller_unwatch (self->poller, item);
+
+  /* Let go of the item so the store can drop it while it is off-screen */
+  hdhomerun_tuner_row_set_item (HDHOMERUN_TUNER_ROW (row), NULL);
+}
+
+/* Polling stops while the window is hidden or minimized */
+static void
+update_polling (HdhomerunWindow *self)
+{
+  gboolean visible = gtk_widget_get_mapped (GTK_WIDGET (self));
+
+#if GTK_CHECK_VERSION (4, 12, 0)
+  visible = visible && !gtk_window_is_suspended (GTK_WINDOW (self));
+#endif
+
+  g_object_set (self->poller, "active", visible, NULL);
+  g_object_set (self->prober, "active", visible, NULL);
+}
+
+static void
+on_mapped_changed (GtkWidget       *widget,
+                   HdhomerunWindow *self)
+{
+  (void)widget; /* unused */
+
+  update_polling (self);
+}
+
+#if GTK_CHECK_VERSION (4, 12, 0)
+static void
+on_suspended_changed (GtkWindow       *window,
+                      GParamSpec      *pspec,
+                      HdhomerunWindow *self)
+{
+  (void)window; /* unused */
+  (void)pspec; /* unused */
+
+  update_polling (self);
+}
+#endif
+
+/* Launch is when the application was created, so the report covers
+ * GTK and libadwaita start up as well as our own window.
+ */
+static void
+on_after_paint (GdkFrameClock   *frame_clock,
+                HdhomerunWindow *self)
+{
+  GtkApplication *app = gtk_window_get_application (GTK_WINDOW (self));
+  gint64 now = g_get_monotonic_time ();
+  gint64 launched = self->init_started;
+
+  g_clear_signal_handler (&self->after_paint_id, frame_clock);
+  self->frame_clock = NULL;
+  self->first_frame_seen = TRUE;
+
+  if (HDHOMERUN_IS_APPLICATION (app))
+    launched = hdhomerun_application_get_launch_time (HDHOMERUN_APPLICATION (app));
+
+  g_message ("First frame %.1f ms after launch: window created at %.1f ms, "
+             "template took %.1f ms, the rest of its setup %.1f ms",
+             (now - launched) / 1000.0,
+             (self->init_started - launched) / 1000.0,
+             (self->template_done - self->init_started) / 1000.0,
+             (self->init_done - self->template_done) / 1000.0);
+}
+
+static void
+on_frame_update (GdkFrameClock   *frame_clock,
+                 HdhomerunWindow *self)
+{
+  (void)frame_clock; /* unused */
+  (void)self; /* unused */
+
+  hdhomerun_dispatcher_flush (hdhomerun_dispatcher_get_default ());
+}
+
+static void
+request_frame (HdhomerunDispatcher *dispatcher,
+               gpointer             user_data)
+{
+  HdhomerunWindow *self = user_data;
+
+  (void)dispatcher; /* unused */
+
+  gdk_frame_clock_request_phase (self->update_clock, GDK_FRAME_CLOCK_PHASE_UPDATE);
+}
+
+static void
+stop_frame_updates (HdhomerunWindow *self)
+{
+  if (self->update_clock == NULL)
+    return;
+
+  hdhomerun_dispatcher_remove_wake_func (hdhomerun_dispatcher_get_default (), self);
+  g_clear_signal_handler (&self->update_id, self->update_clock);
+  self->update_clock = NULL;
+}
+
+static void
+on_realize (GtkWidget       *widget,
+            HdhomerunWindow *self)
+{
+  /* Whatever the workers report during a frame lands in the next one */
+  self->update_clock = gtk_widget_get_frame_clock (widget);
+  self->update_id = g_signal_connect (self->update_clock, "update",
+                                      G_CALLBACK (on_frame_update), self);
+  hdhomerun_dispatcher_set_wake_func (hdhomerun_dispatcher_get_default (),
+                                      request_frame, self);
+
+  if (self->first_frame_seen || self->after_paint_id != 0)
+    return;
+
+  self->frame_clock = gtk_widget_get_frame_clock (widget);
+  self->after_paint_id = g_signal_connect (self->frame_clock, "after-paint",
+                                           G_CALLBACK (on_after_paint), self);
+}
+
+static void
+on_unrealize (GtkWidget       *widget,
+              HdhomerunWindow *self)
+{
+  (void)widget; /* unused */
+
+  stop_frame_updates (self);
+}
+
+static void
+hdhomerun_window_dispose (GObject *object)
+{
+  HdhomerunWindow *self = (HdhomerunWindow *)object;
+
+  if (self->frame_clock != NULL)
+    g_clear_signal_handler (&self->after_paint_id, self->frame_clock);
+  self->frame_clock = NULL;
+  stop_frame_updates (self);
+
+  if (self->monitor != NULL)
+    {
+      g_signal_handlers_disconnect_by_data (self->monitor, self);
+      hdhomerun_discovery_monitor_stop (self->monitor);
+      g_clear_object (&self->monitor);
+    }
+
+  if (self->poller != NULL)
+    {
+      if (self->selected != NULL)
+        hdhomerun_status_poller_unwatch (self->poller, self->selected);
+      g_object_set (self->poller, "active", FALSE, NULL);
+    }
+  g_clear_object (&self->selected);
+  if (self->jobs != NULL)
+    {
+      g_signal_handlers_disconnect_by_data (self->jobs, self);
+      hdhomerun_job_scheduler_cancel (self->jobs);
+      g_clear_object (&self->jobs);
+    }
+  if (self->selection != NULL)
+    g_signal_handlers_disconnect_by_data (self->selection, self);
+  g_clear_object (&self->selection);
+  if (self->settings != NULL)
+    g_signal_handlers_disconnect_by_data (self->settings, self);
+  g_clear_pointer (&self->publish_order, g_ptr_array_unref);
+  g_clear_object (&self->publish_group);
+  g_clear_pointer (&self->controllers, g_hash_table_unref);
+  g_clear_pointer (&self->channels, g_hash_table_unref);
+
+  if (self->prober != NULL)
+    {
+      g_signal_handlers_disconnect_by_data (self->prober, self);
+      g_object_set (self->prober, "active", FALSE, NULL);
+    }
+
+  G_OBJECT_CLASS (hdhomerun_window_parent_class)->dispose (object);
 }
 
 static void
@@ -241,7 +1223,9 @@ hdhomerun_window_finalize (GObject *object)
   HdhomerunWindow *self = (HdhomerunWindow *)object;
 
   g_clear_object (&self->settings);
-  g_list_free (self->devices);
+  g_clear_object (&self->poller);
+  g_clear_object (&self->prober);
+  g_clear_object (&self->devices);
 
   G_OBJECT_CLASS (hdhomerun_window_parent_class)->finalize (object);
 }
@@ -252,30 +1236,79 @@ hdhomerun_window_class_init (HdhomerunWindowClass *klass)
   GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
+  object_class->dispose = hdhomerun_window_dispose;
   object_class->finalize = hdhomerun_window_finalize;
 
-  /* Ensure HdhomerunTunerControls type is registered before loading the template */
-  g_type_ensure (HDHOMERUN_TYPE_TUNER_CONTROLS);
-
   gtk_widget_class_set_template_from_resource (widget_class, "/com/github/andrewstclair/HDHomeRunConfig/hdhomerun-window.ui");
   gtk_widget_class_bind_template_child (widget_class, HdhomerunWindow, header_bar);
   gtk_widget_class_bind_template_child (widget_class, HdhomerunWindow, split_view);
   gtk_widget_class_bind_template_child (widget_class, HdhomerunWindow, device_list);
   gtk_widget_class_bind_template_child (widget_class, HdhomerunWindow, content_stack);
   gtk_widget_class_bind_template_child (widget_class, HdhomerunWindow, placeholder_page);
-  gtk_widget_class_bind_template_child (widget_class, HdhomerunWindow, tuner_controls);
+  gtk_widget_class_bind_template_child (widget_class, HdhomerunWindow, diagnostics_button);
   gtk_widget_class_bind_template_child (widget_class, HdhomerunWindow, add_device_button);
   gtk_widget_class_bind_template_child (widget_class, HdhomerunWindow, refresh_button);
+  gtk_widget_class_bind_template_child (widget_class, HdhomerunWindow, jobs_banner);
   gtk_widget_class_bind_template_callback (widget_class, on_add_device_clicked);
   gtk_widget_class_bind_template_callback (widget_class, on_refresh_clicked);
+  gtk_widget_class_bind_template_callback (widget_class, on_tuner_row_activated);
+  gtk_widget_class_bind_template_callback (widget_class, on_jobs_banner_clicked);
+  gtk_widget_class_bind_template_callback (widget_class, on_diagnostics_toggled);
+  gtk_widget_class_bind_template_callback (widget_class, setup_tuner_row);
+  gtk_widget_class_bind_template_callback (widget_class, bind_tuner_row);
+  gtk_widget_class_bind_template_callback (widget_class, unbind_tuner_row);
 }
 
 static void
 hdhomerun_window_init (HdhomerunWindow *self)
 {
+  gint64 trace = hdhomerun_trace_begin ();
+
+  self->init_started = g_get_monotonic_time ();
   gtk_widget_init_template (GTK_WIDGET (self));
+  self->template_done = g_get_monotonic_time ();
+  hdhomerun_trace_end (trace, "init-template", "HdhomerunWindow");
 
   self->settings = g_settings_new ("com.github.andrewstclair.HDHomeRunConfig");
+
+  /* Only the rows that are on screen get realized */
+  self->devices = hdhomerun_device_store_new ();
+  self->controllers = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                             g_free, g_object_unref);
+  self->channels = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                          g_free, g_object_unref);
+  self->publish_order = g_ptr_array_new ();
+  self->poller = hdhomerun_status_poller_new (self->devices);
+  self->prober = hdhomerun_health_prober_new (self->devices);
+  g_signal_connect (self->prober, "interface-changed",
+                    G_CALLBACK (on_interface_changed), self);
+  self->selection = GTK_SELECTION_MODEL (gtk_multi_selection_new (g_object_ref (G_LIST_MODEL (self->devices))));
+  gtk_list_view_set_model (self->device_list, self->selection);
+
+  g_action_map_add_action_entries (G_ACTION_MAP (self),
+                                   win_actions,
+                                   G_N_ELEMENTS (win_actions),
+                                   self);
+  on_selection_changed (self->selection, 0, 0, self);
+  g_signal_connect (self->selection, "selection-changed",
+                    G_CALLBACK (on_selection_changed), self);
+
+  /* Bulk actions fan out as jobs, capped overall and per device */
+  self->jobs = hdhomerun_job_scheduler_new (1, 1);
+  g_settings_bind (self->settings, "bulk-max-jobs",
+                   self->jobs, "max-running",
+                   G_SETTINGS_BIND_GET);
+  g_settings_bind (self->settings, "bulk-max-jobs-per-device",
+                   self->jobs, "max-per-device",
+                   G_SETTINGS_BIND_GET);
+  g_signal_connect (self->jobs, "job-finished", G_CALLBACK (on_job_finished), self);
+  g_signal_connect (self->jobs, "notify::n-jobs", G_CALLBACK (on_jobs_progress), self);
+  g_signal_connect (self->jobs, "notify::n-done", G_CALLBACK (on_jobs_progress), self);
+
+  /* Playing tuners can be passed on to other hosts by multicast */
+  g_signal_connect (self->settings, "changed::stream-publish-group",
+                    G_CALLBACK (on_publish_group_changed), self);
+  on_publish_group_changed (self->settings, "stream-publish-group", self);
   
   /* Set initial visible child for the content stack */
   gtk_stack_set_visible_child_name (self->content_stack, "placeholder");
@@ -291,6 +1324,34 @@ hdhomerun_window_init (HdhomerunWindow *self)
                    self, "maximized",
                    G_SETTINGS_BIND_DEFAULT);
   
-  /* Automatically discover devices on startup (async to avoid blocking UI) */
-  g_idle_add (refresh_devices_async, self);
+  g_settings_bind (self->settings, "status-interval",
+                   self->poller, "interval",
+                   G_SETTINGS_BIND_GET);
+  g_signal_connect (self, "map", G_CALLBACK (on_mapped_changed), self);
+  g_signal_connect (self, "unmap", G_CALLBACK (on_mapped_changed), self);
+#if GTK_CHECK_VERSION (4, 12, 0)
+  g_signal_connect (self, "notify::suspended", G_CALLBACK (on_suspended_changed), self);
+#endif
+  update_polling (self);
+
+  /* Keep the device list current; the monitor backs off while it is stable */
+  self->monitor = hdhomerun_discovery_monitor_new ();
+  g_signal_connect (self->monitor, "device-added", G_CALLBACK (on_device_added), self);
+  g_signal_connect (self->monitor, "device-changed", G_CALLBACK (on_device_changed), self);
+  g_signal_connect (self->monitor, "device-removed", G_CALLBACK (on_device_removed), self);
+  g_signal_connect (self->monitor, "scan-finished", G_CALLBACK (on_scan_finished), self);
+  g_settings_bind (self->settings, "discovery-targets",
+                   self->monitor, "targets",
+                   G_SETTINGS_BIND_GET);
+  g_settings_bind (self->settings, "background-discovery",
+                   self->monitor, "enabled",
+                   G_SETTINGS_BIND_GET);
+
+  /* Show the last known devices, then reconcile them with a live scan */
+  load_cached_devices (self);
+  start_discovery (self);
+
+  g_signal_connect (self, "realize", G_CALLBACK (on_realize), self);
+  g_signal_connect (self, "unrealize", G_CALLBACK (on_unrealize), self);
+  self->init_done = g_get_monotonic_time ();
 }